@@ -6,7 +6,6 @@ precision highp float;
 precision mediump float;
 #endif
 
-varying lowp vec4 v_color;
 varying highp vec3 v_normal;
 varying highp vec3 v_eyeCoord;
 
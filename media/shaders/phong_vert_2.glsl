@@ -1,20 +1,29 @@
 #version 100
 
+// positions on normalized integers spanning the mesh bounds, octahedral encoded normals
 attribute highp vec4 a_position;
-attribute highp vec3 a_normal;
-attribute lowp vec4 a_color0;
+attribute highp vec2 a_normal;
 
 uniform mediump mat4 u_modelViewProj;
 uniform mediump mat4 u_modelView;
+uniform highp vec3 u_positionScale;
+uniform highp vec3 u_positionOffset;
 
-varying lowp vec4 v_color;
 varying highp vec3 v_normal;
 varying highp vec3 v_eyeCoord;
 
+vec3 OctDecode(vec2 encoded)
+{
+	vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-normal.z, 0.0);
+	vec2 folded = encoded - fold * (2.0 * step(0.0, encoded) - 1.0);
+	return normalize(vec3(folded, normal.z));
+}
+
 void main()
 {
-	v_eyeCoord = vec3(u_modelView * a_position);
-	v_normal = normalize(vec3(u_modelView * vec4(a_normal, 0.0)));
-	v_color = a_color0;
-	gl_Position = u_modelViewProj * a_position;
+	vec4 position = vec4(a_position.xyz * u_positionScale + u_positionOffset, 1.0);
+	v_eyeCoord = vec3(u_modelView * position);
+	v_normal = normalize(vec3(u_modelView * vec4(OctDecode(a_normal), 0.0)));
+	gl_Position = u_modelViewProj * position;
 }
@@ -1,6 +1,6 @@
 function(Enable_Cpp11 target)
 	set_target_properties(${target} PROPERTIES
-		CXX_STANDARD 11
+		CXX_STANDARD 14
 		CXX_STANDARD_REQUIRED ON
 		CXX_EXTENSIONS OFF
 	)
@@ -19,7 +19,11 @@ function(AddCompilerFlags target)
 		endif()
 	endif()
 
-	set_target_properties(${target} PROPERTIES COMPILE_FLAGS "/W4 /WX /GR- /Gy /arch:SSE2 /wd4201 /wd4324")
+	if(MSVC)
+		set_target_properties(${target} PROPERTIES COMPILE_FLAGS "/W4 /WX /GR- /Gy /arch:SSE2 /wd4201 /wd4324")
+	else()
+		set_target_properties(${target} PROPERTIES COMPILE_FLAGS "-Wall -Wno-unknown-pragmas -msse2")
+	endif()
 endfunction(AddCompilerFlags)
 
 function(SetLinkerSubsystem target)
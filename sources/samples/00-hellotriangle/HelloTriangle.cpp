@@ -1,5 +1,6 @@
 #include "ExampleBaseApp.h"
 #include "GraphicsDevice.h"
+#include "SoftwareShader.h"
 #include "VertexFormat.h"
 #include "TransformHelper.h"
 #include "Log.h"
@@ -57,11 +58,33 @@ public:
 			}
 		);
 
+		// same program for the software device
+		static constexpr UniformId cModelViewProj("u_modelViewProj");
+		SoftwareProgramDesc softwareProgram;
+		softwareProgram.mUniforms.push_back(cModelViewProj);
+		softwareProgram.mVertexStage = [](const SoftwareVertexInput& input, float position[4], float* varyings) {
+			TINYNGINE_UNUSED(varyings);
+			const float* modelViewProj = input.mUniforms;
+			const float* aPosition = input.mAttributes[Attributes::Position];
+			for (uint32_t row = 0; row < 4; row++) {
+				position[row] = modelViewProj[row] * aPosition[0] + modelViewProj[4 + row] * aPosition[1] + modelViewProj[8 + row] * aPosition[2] + modelViewProj[12 + row] * aPosition[3];
+			}
+		};
+		softwareProgram.mFragmentStage = [](const SoftwareFragmentInput& input, float color[4]) {
+			TINYNGINE_UNUSED(input);
+			color[0] = 1.0f;
+			color[1] = 1.0f;
+			color[2] = 0.66f;
+			color[3] = 1.0f;
+			return true;
+		};
+		RegisterSoftwareProgram(vertexShaderSource, fragmentShaderSource, softwareProgram);
+
 		ShaderHandle vsHandle = graphicsDevice.CreateShader(ShaderType::VertexProgram, vertexShaderSource);
 		ShaderHandle fsHandle = graphicsDevice.CreateShader(ShaderType::FragmentProgram, fragmentShaderSource);
 		
-		mProgramHandle = graphicsDevice.CreateProgram(vsHandle, fsHandle, true);
-		mModelViewProjHandle = graphicsDevice.GetUniform(mProgramHandle, "u_modelViewProj");
+		// the program compiles in the background, the triangle shows up once it is linked
+		mProgramHandle = graphicsDevice.CreateProgramAsync(vsHandle, fsHandle, true);
 	}
 
 	void RenderFrame(Engine& engine) override {
@@ -69,14 +92,20 @@ public:
 
 		GraphicsDevice& graphicsDevice = engine.GetSystem<GraphicsDevice>();
 
+		if (!mModelViewProjHandle.IsValid() && graphicsDevice.GetProgramStatus(mProgramHandle) == ProgramStatus::Ready) {
+			mModelViewProjHandle = graphicsDevice.GetUniform(mProgramHandle, "u_modelViewProj");
+		}
+
 		glm::mat4 modelViewProj = mTransformHelper.GetModelViewProjectionMatrix();
 
 		graphicsDevice.Clear(GraphicsDevice::ColorBuffer, Color(92, 92, 92));
 
-		graphicsDevice.SetVertexBuffer(mVertexBufferHandle, Attributes::Position);
+		graphicsDevice.SetVertexBuffer(mVertexBufferHandle);
 
 		graphicsDevice.SetProgram(mProgramHandle, mPosVertexFormat);
-		graphicsDevice.SetUniformMat4(mProgramHandle, mModelViewProjHandle, &modelViewProj[0][0], false);
+		if (mModelViewProjHandle.IsValid()) {
+			graphicsDevice.SetUniformMat4(mProgramHandle, mModelViewProjHandle, &modelViewProj[0][0], false);
+		}
 	
 		graphicsDevice.DrawArray(PrimitiveType::Triangles, 0, 3);
 
@@ -86,7 +115,7 @@ public:
 private:
 	VertexFormat mPosVertexFormat;
 	ProgramHandle mProgramHandle;
-	UniformHandle mModelViewProjHandle;
+	UniformHandle mModelViewProjHandle{ cInvalidHandle };
 	VertexBufferHandle mVertexBufferHandle;
 
 	TransformHelper mTransformHelper;
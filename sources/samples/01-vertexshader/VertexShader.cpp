@@ -36,19 +36,12 @@ public:
 		GraphicsDevice& graphicsDevice = engine.GetSystem<GraphicsDevice>();
 		MeshLoader& meshLoader = engine.GetSystem<MeshLoader>();
 		mCube = meshLoader.GenerateCube(1.0f);
-		mColors.reserve(mCube.mNumVertices * 4);
-		for (uint32_t i = 0; i < mCube.mNumVertices * 4; i += 4) {
-			mColors.push_back(255);
-			mColors.push_back(255);
-			mColors.push_back(0);
-			mColors.push_back(255);
-		}
 
 		mPosVertexFormat.Add(Attributes::Position, AttributeType::Float, 3, false);
 		mPosVertexFormat.Add(Attributes::Color0, AttributeType::Uint8, 4, true);
 
-		mPositionsHandle = graphicsDevice.CreateVertexBuffer(&mCube.mPositions[0], sizeof(mCube.mPositions[0]) * mCube.mNumVertices * 3, mPosVertexFormat);
-		mColorsHandle = graphicsDevice.CreateVertexBuffer(&mColors[0], sizeof(mColors[0]) * mColors.size() * 4, mPosVertexFormat);
+		std::vector<uint8_t> vertices = meshLoader.Interleave(mCube, mPosVertexFormat, Color(255, 255, 0));
+		mVertexBufferHandle = graphicsDevice.CreateVertexBuffer(&vertices[0], static_cast<uint32_t>(vertices.size()), mPosVertexFormat);
 		mIndexesBufferHandle = graphicsDevice.CreateIndexBuffer(&mCube.mIndices[0], sizeof(mCube.mIndices[0]) * mCube.mNumIndices);
 
 		const char* fragmentShaderSource = SHADER_SOURCE
@@ -111,8 +104,7 @@ public:
 
 		graphicsDevice.Clear(GraphicsDevice::ColorBuffer | GraphicsDevice::DepthBuffer, Color(92, 92, 92));
 
-		graphicsDevice.SetVertexBuffer(mPositionsHandle, Attributes::Position);
-		graphicsDevice.SetVertexBuffer(mColorsHandle, Attributes::Color0);
+		graphicsDevice.SetVertexBuffer(mVertexBufferHandle);
 
 		graphicsDevice.SetProgram(mProgramHandle, mPosVertexFormat);
 		graphicsDevice.SetUniformMat4(mProgramHandle, mModelViewProjHandle, &mTransformHelper.GetModelViewProjectionMatrix()[0][0], false);
@@ -125,13 +117,11 @@ public:
 
 private:
 	MeshInfo mCube;
-	std::vector<uint8_t> mColors;
 
 	VertexFormat mPosVertexFormat;
 	ProgramHandle mProgramHandle;
 	UniformHandle mModelViewProjHandle;
-	VertexBufferHandle mPositionsHandle;
-	VertexBufferHandle mColorsHandle;
+	VertexBufferHandle mVertexBufferHandle;
 	IndexBufferHandle mIndexesBufferHandle;
 
 	TransformHelper mTransformHelper;
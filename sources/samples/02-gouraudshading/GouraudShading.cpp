@@ -61,24 +61,14 @@ public:
 			return;
 		}
 		auto& mesh = allMeshes[0];
-		uint32_t numVertices = mesh.mNumVertices;
 		mNumIndices = mesh.mNumIndices;
 
-		mColors.reserve(numVertices * 4);
-		for (uint32_t i = 0; i < numVertices * 4; i += 4) {
-			mColors.push_back(255);
-			mColors.push_back(255);
-			mColors.push_back(255);
-			mColors.push_back(255);
-		}
-
 		mPosVertexFormat.Add(Attributes::Position, AttributeType::Float, 3, false);
 		mPosVertexFormat.Add(Attributes::Normal, AttributeType::Float, 3, false);
 		mPosVertexFormat.Add(Attributes::Color0, AttributeType::Uint8, 4, true);
 
-		mPositionsHandle = graphicsDevice.CreateVertexBuffer(&mesh.mPositions[0], sizeof(mesh.mPositions[0]) * numVertices * 3, mPosVertexFormat);
-		mNornalsHandle = graphicsDevice.CreateVertexBuffer(&mesh.mNormals[0], sizeof(mesh.mNormals[0]) * numVertices * 3, mPosVertexFormat);
-		mColorsHandle = graphicsDevice.CreateVertexBuffer(&mColors[0], sizeof(mColors[0]) * mColors.size() * 4, mPosVertexFormat);
+		std::vector<uint8_t> vertices = meshLoader.Interleave(mesh, mPosVertexFormat, Color::White());
+		mVertexBufferHandle = graphicsDevice.CreateVertexBuffer(&vertices[0], static_cast<uint32_t>(vertices.size()), mPosVertexFormat);
 		mIndexesBufferHandle = graphicsDevice.CreateIndexBuffer(&mesh.mIndices[0], sizeof(mesh.mIndices[0]) * mNumIndices);
 
 		std::string vertexShaderSource;
@@ -140,9 +130,7 @@ public:
 
 		graphicsDevice.Clear(GraphicsDevice::ColorBuffer | GraphicsDevice::DepthBuffer, Color(92, 92, 92), 1.0f);
 
-		graphicsDevice.SetVertexBuffer(mPositionsHandle, Attributes::Position);
-		graphicsDevice.SetVertexBuffer(mNornalsHandle, Attributes::Normal);
-		graphicsDevice.SetVertexBuffer(mColorsHandle, Attributes::Color0);
+		graphicsDevice.SetVertexBuffer(mVertexBufferHandle);
 
 		graphicsDevice.SetProgram(mProgramHandle, mPosVertexFormat);
 		graphicsDevice.SetUniformMat4(mProgramHandle, mModelViewProjHandle, &mTransformHelper.GetModelViewProjectionMatrix()[0][0], false);
@@ -176,14 +164,11 @@ private:
 	UniformHandle mShininessFactorHandle;
 	UniformHandle mLightPositionHandle;
 
-	VertexBufferHandle mPositionsHandle;
-	VertexBufferHandle mNornalsHandle;
-	VertexBufferHandle mColorsHandle;
+	VertexBufferHandle mVertexBufferHandle;
 	IndexBufferHandle mIndexesBufferHandle;
 
 	bool mInitialized = false;
 	uint32_t mNumIndices = 0;
-	std::vector<uint8_t> mColors;
 
 	TransformHelper mTransformHelper;
 
@@ -1,6 +1,6 @@
 #include "ExampleBaseApp.h"
 #include "GraphicsDevice.h"
-#include "Time.h"
+#include "Profiler.h"
 #include "MeshLoader.h"
 #include "VertexFormat.h"
 #include "TransformHelper.h"
@@ -12,6 +12,8 @@
 #include "glm/vec3.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
+#include <cstring>
+
 namespace
 {
 
@@ -56,30 +58,29 @@ public:
 		//const char * filename = "models/Teapot.obj";
 		//const char * filename = "models/Cylinder.obj";
 		const char * filename = "models/Monkey.obj";
-		std::vector<MeshInfo> allMeshes = meshLoader.LoadObj(filename);
-		if (allMeshes.size() == 0) {
-			return;
+		// 12 bytes per vertex, the vertex shader dequantizes the positions and decodes the normals
+		mPosVertexFormat = meshLoader.GetQuantizedVertexFormat();
+
+		// the OBJ is converted on the first launch, the next ones map the binary mesh
+		std::string meshFilename = std::string(filename) + ".mesh";
+		MeshBuffers mesh;
+		bool loaded = meshLoader.LoadMesh(meshFilename.c_str(), graphicsDevice, mesh);
+		// files written with another vertex format by an older build are converted again
+		if (loaded && std::memcmp(mesh.mVertexFormat.mAttributes, mPosVertexFormat.mAttributes, sizeof(mPosVertexFormat.mAttributes)) != 0) {
+			graphicsDevice.DestroyVertexBuffer(mesh.mVertexBuffer);
+			graphicsDevice.DestroyIndexBuffer(mesh.mIndexBuffer);
+			loaded = false;
 		}
-
-		auto& mesh = allMeshes[0];
-		mNumIndices = mesh.mNumIndices;
-		uint32_t numVertices = mesh.mNumVertices;
-		mColors.reserve(numVertices * 4);
-		for (uint32_t i = 0; i < numVertices * 4; i += 4) {
-			mColors.push_back(255);
-			mColors.push_back(255);
-			mColors.push_back(255);
-			mColors.push_back(255);
+		if (!loaded) {
+			if (!meshLoader.ConvertObj(filename, meshFilename.c_str(), mPosVertexFormat) || !meshLoader.LoadMesh(meshFilename.c_str(), graphicsDevice, mesh)) {
+				return;
+			}
 		}
-
-		mPosVertexFormat.Add(Attributes::Position, AttributeType::Float, 3, false);
-		mPosVertexFormat.Add(Attributes::Normal, AttributeType::Float, 3, false);
-		mPosVertexFormat.Add(Attributes::Color0, AttributeType::Uint8, 4, true);
-
-		mPositionsHandle = graphicsDevice.CreateVertexBuffer(&mesh.mPositions[0], sizeof(mesh.mPositions[0]) * numVertices * 3, mPosVertexFormat);
-		mNornalsHandle = graphicsDevice.CreateVertexBuffer(&mesh.mNormals[0], sizeof(mesh.mNormals[0]) * numVertices * 3, mPosVertexFormat);
-		mColorsHandle = graphicsDevice.CreateVertexBuffer(&mColors[0], sizeof(mColors[0]) * mColors.size() * 4, mPosVertexFormat);
-		mIndexesBufferHandle = graphicsDevice.CreateIndexBuffer(&mesh.mIndices[0], sizeof(mesh.mIndices[0]) * mNumIndices);
+		mNumIndices = mesh.mNumIndices;
+		mPosVertexFormat = mesh.mVertexFormat;
+		mDequantization = mesh.mDequantization;
+		mVertexBufferHandle = mesh.mVertexBuffer;
+		mIndexesBufferHandle = mesh.mIndexBuffer;
 
 		std::string vertexShaderSource;
 		StringUtils::ReadFileToString("shaders/phong_vert_2.glsl", vertexShaderSource);
@@ -91,6 +92,8 @@ public:
 		mProgramHandle = graphicsDevice.CreateProgram(vsHandle, fsHandle, true);
 		mModelViewProjHandle = graphicsDevice.GetUniform(mProgramHandle, "u_modelViewProj");
 		mModelViewHandle = graphicsDevice.GetUniform(mProgramHandle, "u_modelView");
+		mPositionScaleHandle = graphicsDevice.GetUniform(mProgramHandle, "u_positionScale");
+		mPositionOffsetHandle = graphicsDevice.GetUniform(mProgramHandle, "u_positionOffset");
 		mMaterialAmbientHandle = graphicsDevice.GetUniform(mProgramHandle, "u_materialAmbient");
 		mMaterialDiffuseHandle = graphicsDevice.GetUniform(mProgramHandle, "u_materialDiffuse");
 		mMaterialSpecularHandle = graphicsDevice.GetUniform(mProgramHandle, "u_materialSpecular");
@@ -114,8 +117,6 @@ public:
 		graphicsDevice.SetState(RendererStateType::CullFace, true);
 		graphicsDevice.SetState(RendererStateType::DepthTest, true);
 
-		Time& time = engine.GetSystem<Time>();
-		mLastTime = time.GetTime();
 		clear_color = ImColor(114, 144, 154);
 
 		mInitialized = true;
@@ -127,17 +128,11 @@ public:
 		if (!mInitialized) { return; }
 
 		GraphicsDevice& graphicsDevice = engine.GetSystem<GraphicsDevice>();
-		Time& time = engine.GetSystem<Time>();
 
-		int64_t now = time.GetTime();
-		float delta = ((float)(now - mLastTime) / (float)time.GetFrequency()) * 1000.0f;
-		mLastTime = now;
+		engine.GetSystem<Profiler>().DrawFlameView();
 
-		char buffer[512];
 		ImGui::SetNextWindowPos(ImVec2(5.0f, 5.0f), ImGuiSetCond_FirstUseEver);
 		ImGui::Begin("Phong Shading", nullptr, ImVec2(200.0f, 200.0f), -1.f, ImGuiWindowFlags_AlwaysAutoResize);
-		sprintf(buffer, "Time: %f", delta);
-		ImGui::Text(buffer);
 		ImGui::SliderFloat("RX", &mAngles.x, 0.0f, 360.0f, "%.2f");
 		ImGui::SliderFloat("RY", &mAngles.y, 0.0f, 360.0f, "%.2f");
 		ImGui::SliderFloat("RZ", &mAngles.z, 0.0f, 360.0f, "%.2f");
@@ -156,15 +151,18 @@ public:
 		mTransformHelper.Rotate(mAngles.y, mUp);
 		mTransformHelper.Rotate(mAngles.x, mRight);
 
+		TINYNGINE_PROFILE_SCOPE("Phong");
+		graphicsDevice.BeginGpuScope("Phong");
+
 		graphicsDevice.Clear(GraphicsDevice::ColorBuffer | GraphicsDevice::DepthBuffer, Color(80, 80, 80), 1.0f);
 
-		graphicsDevice.SetVertexBuffer(mPositionsHandle, Attributes::Position);
-		graphicsDevice.SetVertexBuffer(mNornalsHandle, Attributes::Normal);
-		graphicsDevice.SetVertexBuffer(mColorsHandle, Attributes::Color0);
+		graphicsDevice.SetVertexBuffer(mVertexBufferHandle);
 
 		graphicsDevice.SetProgram(mProgramHandle, mPosVertexFormat);
 		graphicsDevice.SetUniformMat4(mProgramHandle, mModelViewProjHandle, &mTransformHelper.GetModelViewProjectionMatrix()[0][0], false);
 		graphicsDevice.SetUniformMat4(mProgramHandle, mModelViewHandle, &mTransformHelper.GetModelViewMatrix()[0][0], false);
+		graphicsDevice.SetUniformFloat3(mProgramHandle, mPositionScaleHandle, mDequantization.mScale);
+		graphicsDevice.SetUniformFloat3(mProgramHandle, mPositionOffsetHandle, mDequantization.mOffset);
 		graphicsDevice.SetUniformFloat3(mProgramHandle, mMaterialAmbientHandle, &cMaterialAmbient[0]);
 		graphicsDevice.SetUniformFloat3(mProgramHandle, mMaterialDiffuseHandle, &cMaterialDiffuse[0]);
 		graphicsDevice.SetUniformFloat3(mProgramHandle, mMaterialSpecularHandle, &cMaterialSpecular[0]);
@@ -175,6 +173,8 @@ public:
 		graphicsDevice.SetIndexBuffer(mIndexesBufferHandle);
 		graphicsDevice.DrawElements(PrimitiveType::Triangles, mNumIndices);
 
+		graphicsDevice.EndGpuScope();
+
 		graphicsDevice.Commit();
 	}
 
@@ -183,13 +183,14 @@ private:
 
 	bool mInitialized = false;
 	uint32_t mNumIndices = 0;
-	std::vector<uint8_t> mColors;
-	int64_t mLastTime;
 
 	VertexFormat mPosVertexFormat;
+	PositionDequantization mDequantization;
 	ProgramHandle mProgramHandle;
 	UniformHandle mModelViewProjHandle;
 	UniformHandle mModelViewHandle;
+	UniformHandle mPositionScaleHandle;
+	UniformHandle mPositionOffsetHandle;
 	UniformHandle mMaterialAmbientHandle;
 	UniformHandle mMaterialDiffuseHandle;
 	UniformHandle mMaterialSpecularHandle;
@@ -197,9 +198,7 @@ private:
 	UniformHandle mLightColorHandle;
 	UniformHandle mLightPositionHandle;
 
-	VertexBufferHandle mPositionsHandle;
-	VertexBufferHandle mNornalsHandle;
-	VertexBufferHandle mColorsHandle;
+	VertexBufferHandle mVertexBufferHandle;
 	IndexBufferHandle mIndexesBufferHandle;
 
 	TransformHelper mTransformHelper;
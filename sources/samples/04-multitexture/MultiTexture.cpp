@@ -44,26 +44,15 @@ public:
 			return;
 		}
 		auto& mesh = allMeshes[0];
-		uint32_t numVertices = mesh.mNumVertices;
 		mNumIndices = mesh.mNumIndices;
 
-		mColors.reserve(numVertices * 4);
-		for (uint32_t i = 0; i < numVertices * 4; i += 4) {
-			mColors.push_back(255);
-			mColors.push_back(255);
-			mColors.push_back(255);
-			mColors.push_back(255);
-		}
-
 		mPosVertexFormat.Add(Attributes::Position, AttributeType::Float, 3, false);
 		mPosVertexFormat.Add(Attributes::TexCoord0, AttributeType::Float, 2, false);
 		mPosVertexFormat.Add(Attributes::Normal, AttributeType::Float, 3, false);
 		mPosVertexFormat.Add(Attributes::Color0, AttributeType::Uint8, 4, true);
 
-		mPositionsHandle = graphicsDevice.CreateVertexBuffer(&mesh.mPositions[0], sizeof(mesh.mPositions[0]) * numVertices * 3, mPosVertexFormat);
-		mTexcoords0Handle = graphicsDevice.CreateVertexBuffer(&mesh.mTexcoords[0], sizeof(mesh.mTexcoords[0]) * numVertices * 2, mPosVertexFormat);
-		mNornalsHandle = graphicsDevice.CreateVertexBuffer(&mesh.mNormals[0], sizeof(mesh.mNormals[0]) * numVertices * 3, mPosVertexFormat);
-		mColorsHandle = graphicsDevice.CreateVertexBuffer(&mColors[0], sizeof(mColors[0]) * mColors.size() * 4, mPosVertexFormat);
+		std::vector<uint8_t> vertices = meshLoader.Interleave(mesh, mPosVertexFormat, Color::White());
+		mVertexBufferHandle = graphicsDevice.CreateVertexBuffer(&vertices[0], static_cast<uint32_t>(vertices.size()), mPosVertexFormat);
 		mIndexesBufferHandle = graphicsDevice.CreateIndexBuffer(&mesh.mIndices[0], sizeof(mesh.mIndices[0]) * mNumIndices);
 
 		std::string vertexShaderSource;
@@ -82,13 +71,9 @@ public:
 
 		ImageManager& imageManager = engine.GetSystem<ImageManager>();
 
-		ImageHandle handle1 = imageManager.LoadImageFromFile("textures/woodenbox.png");
-		mPrimaryTextureHandle = graphicsDevice.CreateTexture2D(handle1, imageManager, TextureFormats::RGB8, TextureFilteringMode::Trilinear, true);
-		imageManager.ReleaseImage(handle1);
-
-		ImageHandle handle2 = imageManager.LoadImageFromFile("textures/smile.png");
-		mSecondaryTextureHandle = graphicsDevice.CreateTexture2D(handle2, imageManager, TextureFormats::RGBA8, TextureFilteringMode::Trilinear, true);
-		imageManager.ReleaseImage(handle2);
+		// grey until the files are decoded and uploaded
+		mPrimaryTextureHandle = graphicsDevice.CreateTexture2DAsync("textures/woodenbox.png", imageManager, TextureFormats::RGB8, TextureFilteringMode::Trilinear, true);
+		mSecondaryTextureHandle = graphicsDevice.CreateTexture2DAsync("textures/smile.png", imageManager, TextureFormats::RGBA8, TextureFilteringMode::Trilinear, true);
 
 		float ratio = static_cast<float>(windowWidth) / static_cast<float>(windowHeight);
 		mProj = glm::perspective(glm::radians(60.0f), ratio, 0.1f, 100.0f);
@@ -133,10 +118,7 @@ public:
 
 		graphicsDevice.Clear(GraphicsDevice::ColorBuffer | GraphicsDevice::DepthBuffer, Color(92, 92, 92), 1.0f);
 
-		graphicsDevice.SetVertexBuffer(mPositionsHandle, Attributes::Position);
-		graphicsDevice.SetVertexBuffer(mNornalsHandle, Attributes::Normal);
-		graphicsDevice.SetVertexBuffer(mTexcoords0Handle, Attributes::TexCoord0);
-		graphicsDevice.SetVertexBuffer(mColorsHandle, Attributes::Color0);
+		graphicsDevice.SetVertexBuffer(mVertexBufferHandle);
 
 		graphicsDevice.SetTexture(0, mPrimaryTextureHandle);
 		graphicsDevice.SetTexture(1, mSecondaryTextureHandle);
@@ -158,10 +140,7 @@ private:
 	VertexFormat mPosVertexFormat;
 	ProgramHandle mProgramHandle;
 
-	VertexBufferHandle mPositionsHandle;
-	VertexBufferHandle mTexcoords0Handle;
-	VertexBufferHandle mNornalsHandle;
-	VertexBufferHandle mColorsHandle;
+	VertexBufferHandle mVertexBufferHandle;
 	IndexBufferHandle mIndexesBufferHandle;
 	TextureHandle mPrimaryTextureHandle;
 	TextureHandle mSecondaryTextureHandle;
@@ -174,7 +153,6 @@ private:
 
 	bool mInitialized = false;
 	uint32_t mNumIndices = 0;
-	std::vector<uint8_t> mColors;
 
 	TransformHelper mTransformHelper;
 
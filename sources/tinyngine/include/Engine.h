@@ -1,6 +1,7 @@
 #pragma once
 
 #include "System.h"
+#include "PlatformTypes.h"
 
 #include <typeinfo>
 #include <typeindex>
@@ -9,6 +10,8 @@
 namespace tinyngine
 {
 
+class RenderQueue;
+
 class Engine final {
 public:
 	template<typename S>
@@ -17,10 +20,10 @@ public:
 	}
 	template<typename S>
 	const S& GetSystem() const {
-		return *(reinterpret_cast<S*>(mSystems[std::type_index(typeid(S))]));
+		return *(reinterpret_cast<S*>(mSystems.at(std::type_index(typeid(S)))));
 	}
 public:
-	Engine();
+	Engine(RenderQueue& renderQueue, GraphicsBackend backend = GraphicsBackend::OpenGLES);
 	~Engine();
 
 private:
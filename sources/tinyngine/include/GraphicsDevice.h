@@ -22,6 +22,15 @@ public:
 
 	virtual void Commit() = 0;
 
+	// Deferred submission records the draws and replays them at Commit, sorted by layer, program, texture, vertex
+	// buffer and depth (see SetSortLayer and SetSortDepth). Each draw keeps the bindings, uniforms, states and fixed
+	// function parameters set before it. Clear, SetViewport and ReadPixels replay the draws recorded so far, draws are
+	// never sorted across them.
+	virtual void SetSubmissionMode(SubmissionMode::Enum mode) = 0;
+	virtual void SetSortLayer(uint8_t layer) = 0;
+	virtual void SetSortDepth(float depth) = 0;
+	virtual void SetErrorCheckMode(ErrorCheckMode::Enum mode) = 0;
+
 	virtual void SetViewport(uint32_t x, uint32_t y, uint32_t width, uint32_t height) = 0;
 
 	virtual void Clear(uint8_t flags, Color color, float depth = 1.0f, uint8_t stencil = 0) = 0;
@@ -39,29 +48,91 @@ public:
 	virtual void SetBlendColor(Color color) = 0;
 	virtual void SetPolygonffset(float factor, float units) = 0;
 
+	virtual RenderStateHandle CreateRenderState(const RenderStateDesc& desc) = 0;
+	virtual void SetRenderState(const RenderStateHandle& handle) = 0;
+
 	virtual void DrawArray(PrimitiveType::Enum primitive, uint32_t first, uint32_t count) = 0;
 	virtual void DrawElements(PrimitiveType::Enum primitive, uint32_t count) = 0;
+	virtual void DrawArrayInstanced(PrimitiveType::Enum primitive, uint32_t first, uint32_t count, uint32_t instancesCount) = 0;
+	virtual void DrawElementsInstanced(PrimitiveType::Enum primitive, uint32_t count, uint32_t instancesCount) = 0;
 
 	virtual VertexBufferHandle CreateVertexBuffer(const void* data, uint32_t size, const VertexFormat& vertexFormat) = 0;
+	virtual void UpdateVertexBuffer(const VertexBufferHandle& handle, uint32_t offset, const void* data, uint32_t size) = 0;
+	virtual void DestroyVertexBuffer(VertexBufferHandle& handle) = 0;
+	virtual void SetVertexBuffer(const VertexBufferHandle& handle) = 0;
 	virtual void SetVertexBuffer(const VertexBufferHandle& handle, Attributes::Enum attribute) = 0;
 
+	// 32 bit indices, stored as 16 bit when every index fits. UpdateIndexBuffer takes 32 bit indices for these buffers
+	// too and rejects an update with an index that does not fit in 16 bits.
 	virtual IndexBufferHandle CreateIndexBuffer(const void* data, uint32_t size) = 0;
+	virtual IndexBufferHandle CreateIndexBuffer(const void* data, uint32_t size, IndexType::Enum type) = 0;
+	virtual void UpdateIndexBuffer(const IndexBufferHandle& handle, uint32_t offset, const void* data, uint32_t size) = 0;
+	virtual void DestroyIndexBuffer(IndexBufferHandle& handle) = 0;
 	virtual void SetIndexBuffer(const IndexBufferHandle& handle) = 0;
 
+	virtual bool AllocTransientVertexBuffer(const void* data, uint32_t size, TransientBuffer& buffer) = 0;
+	virtual bool AllocTransientIndexBuffer(const void* data, uint32_t size, IndexType::Enum type, TransientBuffer& buffer) = 0;
+	virtual void SetTransientVertexBuffer(const TransientBuffer& buffer) = 0;
+	virtual void SetTransientVertexBuffer(const TransientBuffer& buffer, Attributes::Enum attribute) = 0;
+	virtual void SetTransientIndexBuffer(const TransientBuffer& buffer) = 0;
+
+	// Interleaved per-instance attributes, one element every divisor instances, valid until the next Commit.
+	// The attributes must not overlap the ones of the vertex format set with SetProgram.
+	// Without GraphicsCaps::mInstancing, shaders are compiled with TINYNGINE_PSEUDO_INSTANCING defined. Programs
+	// declaring "uniform vec4 u_instanceData[N]" and "attribute float a_instanceIndex" then read the attributes of
+	// an instance from u_instanceData[int(a_instanceIndex) * K + k], K being the number of attributes of
+	// instanceFormat and k the rank of the attribute in Attributes order, missing components set to (0, 0, 0, 1).
+	// Up to N / K instances are drawn per draw call from copies of the geometry, made from the CPU copy the buffers
+	// keep on such devices. It needs list primitives, an interleaved buffer from CreateVertexBuffer and, for indexed
+	// draws, a buffer from CreateIndexBuffer, otherwise every instance is a draw call. Other programs get the
+	// attributes as constant values, one draw call per instance.
+	virtual void SetInstanceData(const void* data, uint32_t elementsCount, const VertexFormat& instanceFormat, uint32_t divisor = 1) = 0;
+
 	virtual ShaderHandle CreateShader(ShaderType::Enum tpye, const char* source) = 0;
 
 	virtual ProgramHandle CreateProgram(ShaderHandle& vertexShaderHandle, ShaderHandle& fragmentShaderHandle, bool destroyShaders) = 0;
+	// Submits the compilation and the link without waiting for them, so that a batch of programs is compiled in
+	// parallel when the driver can (GraphicsCaps::mParallelShaderCompile). Draws using the program are skipped until
+	// GetProgramStatus reports it ready, GetUniform waits for it.
+	virtual ProgramHandle CreateProgramAsync(ShaderHandle& vertexShaderHandle, ShaderHandle& fragmentShaderHandle, bool destroyShaders) = 0;
+	virtual ProgramStatus::Enum GetProgramStatus(const ProgramHandle& handle) const = 0;
+	// Linked programs are kept in this directory, relative to the working directory ("programcache" by default),
+	// and loaded from there instead of being compiled again. Empty or null disables the cache.
+	virtual void SetProgramCacheDirectory(const char* directory) = 0;
+	virtual void DestroyProgram(ProgramHandle& handle) = 0;
 	virtual void SetProgram(const ProgramHandle& handle, const VertexFormat& vertexFormat) = 0;
 
 	virtual UniformHandle GetUniform(const ProgramHandle& handle, const char* uniformName) const = 0;
+	virtual UniformHandle GetUniform(const ProgramHandle& handle, const UniformId& uniformId) const = 0;
 
 	virtual void setUniform1i(const ProgramHandle& programHandle, UniformHandle& uniformHandle, int32_t data) = 0;
 	virtual void SetUniformFloat(const ProgramHandle& programHandle, UniformHandle& uniformHandle, float data) = 0;
 	virtual void SetUniformFloat3(const ProgramHandle& programHandle, UniformHandle& uniformHandle, const float* data) = 0;
 	virtual void SetUniformMat4(const ProgramHandle& programHandle, const UniformHandle& uniformHandle, const float* data, bool transpose) = 0;
 
+	// Compressed images (see ImageManager::CompressImage and the KTX files) keep their own format, mipmaps then come
+	// from the image only. CreateTexture2D fails when GraphicsCaps::mTextureFormats does not list it.
 	virtual TextureHandle CreateTexture2D(const ImageHandle& imageHandle, ImageManager& manager, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps) = 0;
+	// Decodes the file in the background and uploads it over the next frames, the handle can be used right away and
+	// samples a grey placeholder until IsTextureResident. Only the uncompressed formats can be streamed.
+	virtual TextureHandle CreateTexture2DAsync(const char* filename, ImageManager& manager, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps) = 0;
+	virtual bool IsTextureResident(const TextureHandle& handle) const = 0;
+	// bytes of streamed textures uploaded per frame at most, at least a row of a texture is uploaded
+	virtual void SetTextureUploadBudget(uint32_t bytesPerFrame) = 0;
+	virtual void DestroyTexture(TextureHandle& handle) = 0;
 	virtual void SetTexture(uint32_t stage, const TextureHandle& textureHandle) = 0;
+
+	// Reads back the color buffer as RGBA8, rows bottom to top. Waits for the pending rendering, not meant for
+	// every frame except on the software device.
+	virtual bool ReadPixels(uint32_t x, uint32_t y, uint32_t width, uint32_t height, void* rgba) = 0;
+
+	// Nested GPU ranges, reported to the Profiler a few frames later when the device can time them (see
+	// GraphicsCaps::mTimerQueries). The name must be a string literal.
+	virtual void BeginGpuScope(const char* name) = 0;
+	virtual void EndGpuScope() = 0;
+
+	virtual const GraphicsStats& GetStats() const = 0;
+	virtual const GraphicsCaps& GetCaps() const = 0;
 };
 
 } // namespace tinyngine
\ No newline at end of file
@@ -11,10 +11,58 @@ namespace tinyngine
 			RGB8,
 			RGBA8,
 			BGRA8,
+			// block compressed, see GraphicsCaps::mTextureFormats
+			ETC1,
+			ETC2_RGB8,
+			ETC2_RGBA8,
+			EAC_R11,
+			EAC_RG11,
+			ASTC_4x4,
+			ASTC_8x8,
+			BC1,
+			BC2,
+			BC3,
 			Count
 		};
 	};
 
+	// Compressed formats are stored in blocks of mBlockWidth x mBlockHeight texels, the others have 1x1 blocks.
+	struct TextureFormatInfo {
+		uint8_t mBlockWidth;
+		uint8_t mBlockHeight;
+		uint8_t mBlockSize; // bytes
+		bool mCompressed;
+	};
+
+	inline const TextureFormatInfo& GetTextureFormatInfo(TextureFormats::Enum format) {
+		static const TextureFormatInfo cTextureFormatInfos[]{
+			{ 1, 1, 3, false }, // RGB8
+			{ 1, 1, 4, false }, // RGBA8
+			{ 1, 1, 4, false }, // BGRA8
+			{ 4, 4, 8, true }, // ETC1
+			{ 4, 4, 8, true }, // ETC2_RGB8
+			{ 4, 4, 16, true }, // ETC2_RGBA8
+			{ 4, 4, 8, true }, // EAC_R11
+			{ 4, 4, 16, true }, // EAC_RG11
+			{ 4, 4, 16, true }, // ASTC_4x4
+			{ 8, 8, 16, true }, // ASTC_8x8
+			{ 4, 4, 8, true }, // BC1
+			{ 4, 4, 16, true }, // BC2
+			{ 4, 4, 16, true }, // BC3
+			{ 0, 0, 0, false } // Count, raw pixels of an unknown layout
+		};
+		return cTextureFormatInfos[format];
+	}
+
+	// bytes of a mip level of width x height texels
+	inline uint32_t GetTextureLevelSize(TextureFormats::Enum format, uint32_t width, uint32_t height) {
+		const TextureFormatInfo& info = GetTextureFormatInfo(format);
+		if (info.mBlockSize == 0) {
+			return 0;
+		}
+		return ((width + info.mBlockWidth - 1) / info.mBlockWidth) * ((height + info.mBlockHeight - 1) / info.mBlockHeight) * info.mBlockSize;
+	}
+
 	struct TextureFilteringMode {
 		enum Enum {
 			None,
@@ -51,11 +99,17 @@ namespace tinyngine
 		};
 	};
 
+	// Integer types are fetched as floats, divided to [0, 1] or [-1, 1] when the attribute is normalized. The values
+	// are stored in the vertex formats of the mesh files, new types go at the end.
 	struct AttributeType {
 		enum Enum {
 			Uint8,
 			Int16,
 			Float,
+			Uint16,
+			Half, // GLES3 or OES_vertex_half_float, see GraphicsCaps::mAttributeTypes
+			Int10_10_10_2, // x, y, z, w from the least significant bits, always 4 components, GLES3 only
+			Uint10_10_10_2,
 			Count
 		};
 	};
@@ -83,11 +137,25 @@ namespace tinyngine
 		};
 	};
 
+	// FNV-1a of a uniform name, usable in constant expressions.
+	constexpr uint32_t HashUniformName(const char* name, uint32_t hash = 2166136261u) {
+		return *name ? HashUniformName(name + 1, static_cast<uint32_t>((static_cast<uint64_t>(hash ^ static_cast<uint8_t>(*name)) * 16777619u) & 0xffffffffu)) : hash;
+	}
+
+	// Hashed uniform name, declare as constexpr to resolve the hash at compile time:
+	// static constexpr UniformId cModelViewProj("u_modelViewProj");
+	struct UniformId {
+		constexpr explicit UniformId(const char* name) : mHash(HashUniformName(name)) {}
+
+		uint32_t mHash;
+	};
+
 	struct Uniform {
-		uint32_t mLocation;
+		int32_t mLocation;
+		uint32_t mNameHash;
+		uint32_t mShadowOffset;
 		uint16_t mSize;
 		UniformType::Enum mType;
-		char mName[256];
 	};
 
 	struct ShaderType {
@@ -109,6 +177,41 @@ namespace tinyngine
 		};
 	};
 
+	struct IndexType {
+		enum Enum {
+			Uint16,
+			Uint32,
+			Count
+		};
+	};
+
+	struct SubmissionMode {
+		enum Enum {
+			Immediate,
+			Deferred,
+			Count
+		};
+	};
+
+	struct ProgramStatus {
+		enum Enum {
+			Pending,
+			Ready,
+			Failed,
+			Count
+		};
+	};
+
+	struct ErrorCheckMode {
+		enum Enum {
+			Off,
+			PerFrame,
+			PerCall,
+			DebugCallback,
+			Count
+		};
+	};
+
 	struct RendererStateType {
 		enum Enum {
 			Blend,
@@ -201,12 +304,106 @@ namespace tinyngine
 		};
 	};
 
+	struct ColorMask {
+		enum Enum {
+			None = 0,
+			Red = 1 << 0,
+			Green = 1 << 1,
+			Blue = 1 << 2,
+			Alpha = 1 << 3,
+			All = Red | Green | Blue | Alpha
+		};
+	};
+
+	struct BlendStateDesc {
+		bool mEnabled = false;
+		BlendFuncs::Enum mSrcFactor = BlendFuncs::One;
+		BlendFuncs::Enum mDstFactor = BlendFuncs::Zero;
+	};
+
+	struct DepthStateDesc {
+		bool mTestEnabled = false;
+		bool mWriteEnabled = true;
+		DepthFuncs::Enum mFunc = DepthFuncs::Less;
+	};
+
+	struct StencilStateDesc {
+		bool mEnabled = false;
+		StencilFuncs::Enum mFunc = StencilFuncs::Always;
+		int32_t mRef = 0;
+		uint32_t mReadMask = UINT32_MAX;
+		uint32_t mWriteMask = UINT32_MAX;
+		StencilOpTypes::Enum mStencilFail = StencilOpTypes::Keep;
+		StencilOpTypes::Enum mDepthFail = StencilOpTypes::Keep;
+		StencilOpTypes::Enum mDepthPass = StencilOpTypes::Keep;
+	};
+
+	struct RasterStateDesc {
+		bool mCullEnabled = false;
+		CullFaceModes::Enum mCullMode = CullFaceModes::Back;
+		WindingModes::Enum mWinding = WindingModes::CounterClockWise;
+		bool mPolygonOffsetEnabled = false;
+		float mPolygonOffsetFactor = 0.0f;
+		float mPolygonOffsetUnits = 0.0f;
+		bool mScissorEnabled = false;
+	};
+
+	struct RenderStateDesc {
+		BlendStateDesc mBlend;
+		DepthStateDesc mDepth;
+		StencilStateDesc mStencil;
+		RasterStateDesc mRaster;
+		uint8_t mColorMask = ColorMask::All;
+	};
+
+	struct GraphicsCallType {
+		enum Enum {
+			Clear,
+			State,
+			RenderState,
+			Program,
+			VertexBuffer,
+			IndexBuffer,
+			Texture,
+			Uniform,
+			Draw,
+			DrawInstanced,
+			Create,
+			Update,
+			Destroy,
+			Count
+		};
+	};
+
+	struct GraphicsStats {
+		uint32_t mStateChanges = 0;
+		uint32_t mStateChangesElided = 0;
+		uint32_t mUniformUploads = 0;
+		uint32_t mUniformUploadsElided = 0;
+		// filled by GraphicsDeviceNull only
+		uint32_t mCalls[GraphicsCallType::Count] = {};
+		uint32_t mInvalidHandles = 0;
+		uint32_t mDrawsSkipped = 0; // programs still compiling or failed
+		uint32_t mTextureUploadBytes = 0; // streamed textures
+	};
+
+	struct GraphicsCaps {
+		bool mIndexUint32 = false; // OES_element_index_uint
+		bool mInstancing = false; // GLES3, ANGLE_instanced_arrays or EXT_instanced_arrays, emulated otherwise (see SetInstanceData)
+		bool mTimerQueries = false; // EXT_disjoint_timer_query timestamps, GPU scopes are timed
+		bool mProgramBinary = false; // GLES3 or OES_get_program_binary, linked programs are cached on disk
+		bool mParallelShaderCompile = false; // KHR_parallel_shader_compile, asynchronous programs complete in the background
+		bool mTextureFormats[TextureFormats::Count] = {}; // formats CreateTexture2D can upload
+		bool mAttributeTypes[AttributeType::Count] = {}; // types vertex and instance attributes can be fetched as
+	};
+
 	struct ImageData {
 		uint32_t mWidth;
 		uint32_t mHeight;
 		uint32_t mSize;
 		uint8_t mBitsPerPixel;
 		void* mData;
+		TextureFormats::Enum mFormat; // Count for pixels of another layout than the ones of TextureFormats
 	};
 
 	struct Color
@@ -251,5 +448,14 @@ namespace tinyngine
 	using UniformHandle = ResourceHandle;
 	using TextureHandle = ResourceHandle;
 	using ImageHandle = ResourceHandle;
+	using RenderStateHandle = ResourceHandle;
+
+	// Region of a per-frame transient buffer, valid until the next Commit.
+	struct TransientBuffer {
+		ResourceHandle mHandle = ResourceHandle(cInvalidHandle);
+		uint32_t mOffset = 0;
+		uint32_t mSize = 0;
+		IndexType::Enum mIndexType = IndexType::Uint16;
+	};
 
 } // namespace tinyngine
\ No newline at end of file
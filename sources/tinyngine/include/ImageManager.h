@@ -3,9 +3,24 @@
 #include "System.h"
 #include "GraphicsTypes.h"
 
+#include <functional>
+
 namespace tinyngine
 {
 
+struct MipmapFilter {
+	enum Enum {
+		None,
+		Box, // 2x2 average
+		Kaiser, // 6 taps Kaiser windowed sinc, sharper
+		Count
+	};
+};
+
+// Called on a decoding thread with the levels of the image, the pixels are only valid during the call. mData is null
+// when the file could not be decoded.
+using DecodedImageFunc = std::function<void(const ImageData* levels, uint32_t levelsCount)>;
+
 class ImageManager final : public System {
 public:
 	ImageManager();
@@ -13,8 +28,29 @@ public:
 
 	bool ReleaseImage(ImageHandle& handle);
 
+	// KTX 1.1 and KTX2 files (2D, without supercompression) are read as stored with their mipmaps, the other files
+	// are decoded by stb_image.
 	ImageHandle LoadImageFromFile(const char * filename);
-
+	// Loads the image with a complete mip chain, generated by GenerateMipmaps the first time and then read from
+	// "<filename>.<filter>.mips.ktx", written next to the file, as long as that one is newer.
+	ImageHandle LoadImageFromFile(const char* filename, MipmapFilter::Enum filter, bool srgb = true);
+
+	// Replaces the mipmaps of an uncompressed 8 bit image with a complete chain filtered on the CPU, see
+	// GenerateMipmaps in MipmapGenerator.h. srgb is false for the images that do not hold colors (normal maps).
+	bool GenerateMipmaps(const ImageHandle& imageHandle, MipmapFilter::Enum filter, bool srgb = true);
+
+	// Offline encoding of every level of an 8 bit image to BC1 or BC3 with stb_dxt, the other compressed formats
+	// need an external encoder. Returns a new image, to be saved with SaveImageKTX.
+	ImageHandle CompressImage(const ImageHandle& imageHandle, TextureFormats::Enum format);
+	// writes a KTX 1.1 file
+	bool SaveImageKTX(const ImageHandle& imageHandle, const char* filename) const;
+
+	// Decodes the file on a pool of worker threads, started with the first request. The pixels are converted to
+	// channels components, or kept as stored with 0. The mipmaps are generated there too unless filter is None.
+	void DecodeImageAsync(const char* filename, uint32_t channels, MipmapFilter::Enum filter, DecodedImageFunc onDecoded);
+
+	// Count for the images of another layout than the ones of TextureFormats
+	TextureFormats::Enum ImageGetFormat(const ImageHandle& imageHandle) const;
 	bool ImageHasMipmaps(const ImageHandle& imageHandle) const;
 	uint32_t ImageGetMipmapsCount(const ImageHandle& imageHandle) const;
 	bool GetImageData(const ImageHandle& imageHandle, uint32_t level, ImageData& imageData);
@@ -1,12 +1,19 @@
 #pragma once
 
 #include "System.h"
+#include "GraphicsTypes.h"
+#include "VertexFormat.h"
 #include <cstdint>
 #include <vector>
 
 namespace tinyngine
 {
 
+class GraphicsDevice;
+
+// post-transform cache size the optimizer and the statistics assume, the FIFO size of most GLES2 era GPUs
+static constexpr uint32_t cDefaultVertexCacheSize = 16;
+
 struct MeshInfo {
 	uint32_t mNumVertices;
 	std::vector<float> mPositions; // stride = 3
@@ -17,11 +24,85 @@ struct MeshInfo {
 	std::vector<uint32_t> mIndices;
 };
 
+// average cache miss ratio (transformed vertices per triangle) and average transformed vertex ratio (transformed
+// vertices per vertex, 1 is ideal) of a simulated FIFO post-transform cache
+struct VertexCacheStats {
+	float mACMR;
+	float mATVR;
+};
+
+struct MeshOptimizationStats {
+	VertexCacheStats mBefore;
+	VertexCacheStats mAfter;
+};
+
+struct SubMesh {
+	uint32_t mFirstIndex;
+	uint32_t mNumIndices;
+	float mBoundsMin[3];
+	float mBoundsMax[3];
+};
+
+// Positions stored as normalized integers span the bounds of their mesh, position = fetched * mScale + mOffset brings
+// them back to object space. The identity for positions stored as floats or halves.
+struct PositionDequantization {
+	float mScale[3] = { 1.0f, 1.0f, 1.0f };
+	float mOffset[3] = { 0.0f, 0.0f, 0.0f };
+};
+
+// Buffers created from a binary mesh file, the indices of every submesh address the whole vertex buffer.
+struct MeshBuffers {
+	VertexBufferHandle mVertexBuffer = VertexBufferHandle(cInvalidHandle);
+	IndexBufferHandle mIndexBuffer = IndexBufferHandle(cInvalidHandle);
+	IndexType::Enum mIndexType = IndexType::Uint16;
+	VertexFormat mVertexFormat;
+	uint32_t mNumVertices = 0;
+	uint32_t mNumIndices = 0;
+	float mBoundsMin[3] = { 0.0f, 0.0f, 0.0f };
+	float mBoundsMax[3] = { 0.0f, 0.0f, 0.0f };
+	PositionDequantization mDequantization;
+	std::vector<SubMesh> mSubMeshes;
+};
+
 class MeshLoader final : public System  {
 public:
 	MeshInfo GenerateCube(float scale);
 
 	std::vector<MeshInfo> LoadObj(const char* filename, bool triangulate = true);
+
+	// Breaks a triangle mesh into chunks whose indices fit in 16 bits, for devices without OES_element_index_uint.
+	// Meshes that already fit are returned unchanged as a single chunk.
+	std::vector<MeshInfo> SplitForUint16Indices(const MeshInfo& mesh) const;
+
+	VertexCacheStats AnalyzeVertexCache(const MeshInfo& mesh, uint32_t cacheSize = cDefaultVertexCacheSize) const;
+
+	// Reorders the triangles for the post-transform vertex cache, then clusters of them to reduce overdraw, then the
+	// vertices in the order the triangles first use them, unused vertices are dropped. The mesh must be triangulated.
+	MeshOptimizationStats Optimize(MeshInfo& mesh, uint32_t cacheSize = cDefaultVertexCacheSize) const;
+
+	// Vertex format for Interleave and SaveMesh at half the size of floats: positions on 16 bit normalized
+	// integers spanning the bounds, octahedral normals on two 16 bit components and texture coordinates on 16 bits,
+	// which must stay in [0, 1]. 12 bytes per vertex with positions and normals, 16 with texture coordinates too.
+	VertexFormat GetQuantizedVertexFormat(bool normals = true, bool texcoords = false) const;
+
+	// transform the vertex shaders apply to the positions stored with vertexFormat for a mesh within the bounds
+	PositionDequantization GetPositionDequantization(const VertexFormat& vertexFormat, const float boundsMin[3], const float boundsMax[3]) const;
+
+	// Packs the mesh streams into a single vertex buffer laid out as described by vertexFormat.
+	// MeshInfo carries no colors, Color0/Color1 are filled with color; other missing attributes are zeroed.
+	// Positions are stored relative to dequantization, normals declared with 2 components are octahedral encoded.
+	std::vector<uint8_t> Interleave(const MeshInfo& mesh, const VertexFormat& vertexFormat, Color color = Color::White(), const PositionDequantization& dequantization = PositionDequantization()) const;
+
+	// Writes a versioned binary mesh file: the vertices of all the meshes interleaved as described by vertexFormat,
+	// their indices (16 bit when the vertices allow it), the bounds and one submesh per mesh.
+	bool SaveMesh(const char* filename, const std::vector<MeshInfo>& meshes, const VertexFormat& vertexFormat, Color color = Color::White()) const;
+
+	// LoadObj, Optimize then SaveMesh, so that the text is parsed and the meshes optimized once instead of at every launch
+	bool ConvertObj(const char* objFilename, const char* meshFilename, const VertexFormat& vertexFormat, Color color = Color::White());
+
+	// Maps a file written by SaveMesh and creates the buffers straight from the mapped blobs. Returns false without
+	// logging when the file does not exist, so that the caller can convert the source model first.
+	bool LoadMesh(const char* filename, GraphicsDevice& graphicsDevice, MeshBuffers& buffers) const;
 };
 
 } // namespace tinyngine
\ No newline at end of file
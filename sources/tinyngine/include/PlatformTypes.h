@@ -42,6 +42,13 @@ inline const char* GetApiName(Api api)
 	return ApiCodes[(int)api];
 }
 
+enum class GraphicsBackend
+{
+	OpenGLES = 0,
+	Null,		// No graphics API call and no context, handles are validated and calls counted. For CPU side benchmarks.
+	Software,	// No context, rasterized on the CPU. Programs need stages registered with RegisterSoftwareProgram.
+};
+
 enum class VsyncMode
 {
 	Off,		// The application does not synchronizes with the vertical sync. If application renders faster than the display refreshes, frames are wasted and tearing may be observed. FPS is uncapped. Maximum power consumption. If unsupported, "ON" value will be used instead. Minimum latency.
@@ -91,6 +98,8 @@ struct ContextAttribs {
 	uint32_t mSamplesAA;
 	VsyncMode mVsyncMode;
 	uint32_t mContextPriority;
+	bool mRenderThread; // GL calls are recorded on the application thread and run one frame later on a render thread
+	GraphicsBackend mGraphicsBackend;
 };
 
 struct Modifier {
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "System.h"
+
+#include <cstdint>
+
+// Scoped markers are compiled in unless TINYNGINE_PROFILER is defined to 0, they only cost a clock read and a
+// ring buffer write each and can stay on in release builds.
+#ifndef TINYNGINE_PROFILER
+#define TINYNGINE_PROFILER 1
+#endif
+
+namespace tinyngine
+{
+
+static constexpr uint16_t cProfileGpuTrack = UINT16_MAX;
+
+struct ProfileEvent {
+	const char* mName; // string literal
+	int64_t mBegin; // ns, see Profiler::GetTime
+	int64_t mEnd;
+	uint16_t mTrack; // index of the recording thread, or cProfileGpuTrack
+	uint16_t mDepth;
+};
+
+// Collects the ranges recorded by every thread once per frame and keeps the last frames around, for the ImGui flame
+// view and the Chrome trace_event export (chrome://tracing or ui.perfetto.dev). Recording goes through static
+// functions so that threads without access to the engine can be instrumented, every thread has its own lock-free
+// ring buffer drained by NextFrame.
+class Profiler : public System {
+public:
+	Profiler();
+	virtual ~Profiler();
+
+	// called by the platform bridge at the end of every frame, from a single thread
+	void NextFrame();
+
+	// ImGui window with the frame times and the ranges of the last frame, call between the ImGui frame markers
+	void DrawFlameView();
+
+	// writes the frames kept in the history
+	bool WriteChromeTrace(const char* path) const;
+
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	// monotonic clock of the recorded ranges, in ns
+	static int64_t GetTime();
+
+	// name of the calling thread in the views, the string is copied
+	static void SetThreadName(const char* name);
+
+	static void BeginScope(const char* name);
+	static void EndScope();
+
+	// ranges measured by the graphics device, already converted to the clock of GetTime
+	static void RecordGpuRange(const char* name, int64_t begin, int64_t end, uint16_t depth);
+
+private:
+	struct Impl;
+	Impl* mImpl;
+};
+
+class ProfileScope final {
+public:
+	explicit ProfileScope(const char* name) { Profiler::BeginScope(name); }
+	~ProfileScope() { Profiler::EndScope(); }
+
+	ProfileScope(const ProfileScope& other) = delete;
+	ProfileScope& operator=(const ProfileScope& other) = delete;
+};
+
+} // namespace tinyngine
+
+#if TINYNGINE_PROFILER
+#define TINYNGINE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define TINYNGINE_PROFILE_CONCAT(a, b) TINYNGINE_PROFILE_CONCAT_IMPL(a, b)
+#define TINYNGINE_PROFILE_SCOPE(name) tinyngine::ProfileScope TINYNGINE_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define TINYNGINE_PROFILE_SCOPE(name)
+#endif
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "GraphicsTypes.h"
+
+#include <functional>
+#include <vector>
+
+namespace tinyngine
+{
+
+static constexpr uint32_t cMaxSoftwareVaryings = 16;
+static constexpr uint32_t cMaxSoftwareTextureStages = 8;
+static constexpr uint32_t cSoftwareUniformSize = 16; // floats reserved for each uniform, enough for a mat4
+
+// RGBA8 texture as seen by the fragment stages of the software device
+struct SoftwareTexture {
+	const uint8_t* mPixels = nullptr;
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+	TextureFilteringMode::Enum mFiltering = TextureFilteringMode::Nearest;
+};
+
+// Repeat wrapping, level 0 only. A null texture samples opaque black.
+void SampleSoftwareTexture(const SoftwareTexture* texture, float u, float v, float rgba[4]);
+
+struct SoftwareVertexInput {
+	float mAttributes[Attributes::Count][4]; // attributes missing from the vertex format read (0, 0, 0, 1)
+	const float* mUniforms; // cSoftwareUniformSize floats per uniform, in SoftwareProgramDesc::mUniforms order
+};
+
+struct SoftwareFragmentInput {
+	const float* mVaryings; // perspective correct
+	const float* mUniforms;
+	const SoftwareTexture* const* mTextures; // cMaxSoftwareTextureStages entries, null when nothing is bound
+	float mFragCoord[4];
+	bool mFrontFacing;
+};
+
+// Stages run concurrently on the rasterizer worker threads and must not modify shared state.
+using SoftwareVertexStage = std::function<void(const SoftwareVertexInput& input, float position[4], float* varyings)>;
+// returns false to discard the fragment
+using SoftwareFragmentStage = std::function<bool(const SoftwareFragmentInput& input, float color[4])>;
+
+struct SoftwareProgramDesc {
+	SoftwareVertexStage mVertexStage;
+	SoftwareFragmentStage mFragmentStage;
+	uint32_t mVaryingsCount = 0;
+	std::vector<UniformId> mUniforms; // GetUniform resolves to the index in this list
+};
+
+// Programs linked from this pair of shader sources run the given stages instead of the GLSL compiled by the software
+// device, for hand tuned shaders or the ones out of the supported subset.
+// Matrices are column major as glUniformMatrix4fv expects them, ints are stored as floats.
+void RegisterSoftwareProgram(const char* vertexSource, const char* fragmentSource, const SoftwareProgramDesc& desc);
+
+} // namespace tinyngine
\ No newline at end of file
@@ -14,8 +14,15 @@ struct VertexFormat final {
 
 	bool IsValid(Attributes::Enum attrib) const { return mAttributes[attrib] != UINT16_MAX; }
 
+	uint16_t GetSize(Attributes::Enum attrib) const;
+
+	// Conversions between the attribute and floats for the CPU side paths, source and destination point at the
+	// attribute. Read leaves the components the attribute lacks untouched, Write zeroes the ones values lacks.
+	void Read(Attributes::Enum attrib, const uint8_t* source, float values[4]) const;
+	void Write(Attributes::Enum attrib, const float* values, uint8_t valuesCount, uint8_t* destination) const;
+
 	uint16_t mAttributes[Attributes::Count];
-	uint16_t mOffset[Attributes::Count];
+	uint16_t mOffset[Attributes::Count]; // byte offset of the attribute inside an interleaved vertex
 	uint16_t mStride;
 };
 
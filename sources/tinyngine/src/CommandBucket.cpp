@@ -0,0 +1,167 @@
+#include "CommandBucket.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+static constexpr uint32_t cLayerBits = 8;
+static constexpr uint32_t cProgramBits = 10;
+static constexpr uint32_t cTextureBits = 12;
+static constexpr uint32_t cBufferBits = 12;
+static constexpr uint32_t cDepthBits = 22;
+
+static constexpr uint32_t cDepthShift = 0;
+static constexpr uint32_t cBufferShift = cDepthShift + cDepthBits;
+static constexpr uint32_t cTextureShift = cBufferShift + cBufferBits;
+static constexpr uint32_t cProgramShift = cTextureShift + cTextureBits;
+static constexpr uint32_t cLayerShift = cProgramShift + cProgramBits;
+
+static_assert(cLayerShift + cLayerBits == 64, "sort key fields must fill 64 bits");
+
+inline uint64_t EncodeField(uint32_t value, uint32_t bits, uint32_t shift) {
+	return (static_cast<uint64_t>(value) & ((UINT64_C(1) << bits) - 1)) << shift;
+}
+
+void RadixSort(uint64_t* keys, uint32_t* values, uint64_t* tempKeys, uint32_t* tempValues, uint32_t count) {
+	uint64_t* srcKeys = keys;
+	uint32_t* srcValues = values;
+	uint64_t* dstKeys = tempKeys;
+	uint32_t* dstValues = tempValues;
+
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		uint32_t histogram[256] = { 0 };
+		for (uint32_t n = 0; n < count; n++) {
+			histogram[(srcKeys[n] >> shift) & 0xff]++;
+		}
+
+		// all keys share this digit, nothing to reorder
+		if (histogram[(srcKeys[0] >> shift) & 0xff] == count) {
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t digitCount = histogram[n];
+			histogram[n] = offset;
+			offset += digitCount;
+		}
+
+		for (uint32_t n = 0; n < count; n++) {
+			uint32_t dest = histogram[(srcKeys[n] >> shift) & 0xff]++;
+			dstKeys[dest] = srcKeys[n];
+			dstValues[dest] = srcValues[n];
+		}
+
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcValues, dstValues);
+	}
+
+	if (srcKeys != keys) {
+		std::memcpy(keys, srcKeys, sizeof(uint64_t) * count);
+		std::memcpy(values, srcValues, sizeof(uint32_t) * count);
+	}
+}
+
+}
+
+namespace tinyngine
+{
+
+uint64_t SortKey::Encode(uint8_t layer, uint32_t program, uint32_t texture, uint32_t buffer, float depth) {
+	// positive IEEE floats compare like unsigned integers, keep the most significant bits
+	uint32_t depthBits = 0;
+	if (depth > 0.0f) {
+		std::memcpy(&depthBits, &depth, sizeof(depthBits));
+		depthBits >>= (32 - cDepthBits);
+	}
+
+	return EncodeField(layer, cLayerBits, cLayerShift)
+		| EncodeField(program, cProgramBits, cProgramShift)
+		| EncodeField(texture, cTextureBits, cTextureShift)
+		| EncodeField(buffer, cBufferBits, cBufferShift)
+		| EncodeField(depthBits, cDepthBits, cDepthShift);
+}
+
+//=====================================================================================================================
+
+void CommandBucket::Reset() {
+	mDraws.clear();
+	mKeys.clear();
+	mOrder.clear();
+	mUniformData.clear();
+	for (auto& recorded : mRecordedUniforms) {
+		recorded.mSnapshot = UINT32_MAX;
+	}
+}
+
+void CommandBucket::Submit(uint64_t key, const DrawCommand& command) {
+	mOrder.push_back(static_cast<uint32_t>(mDraws.size()));
+	mKeys.push_back(key);
+	mDraws.push_back(command);
+
+	auto& draw = mDraws.back();
+	draw.mUniformsOffset = UINT32_MAX;
+	RecordedUniforms* recorded = FindRecordedUniforms(command.mProgram);
+	if (recorded == nullptr) {
+		return;
+	}
+	// consecutive draws that do not change the uniforms share the same copy
+	if (recorded->mSnapshot == UINT32_MAX) {
+		recorded->mSnapshot = static_cast<uint32_t>(mUniformData.size());
+		mUniformData.insert(mUniformData.end(), recorded->mValues.begin(), recorded->mValues.end());
+	}
+	draw.mUniformsOffset = recorded->mSnapshot;
+}
+
+void CommandBucket::SetUniform(const ProgramHandle& program, const std::vector<uint8_t>& shadow, uint32_t offset, const void* data, uint32_t size) {
+	RecordedUniforms* recorded = FindRecordedUniforms(program);
+	if (recorded == nullptr) {
+		mRecordedUniforms.emplace_back();
+		recorded = &mRecordedUniforms.back();
+		recorded->mProgram = program;
+		recorded->mValues = shadow;
+	}
+	if (offset + size > recorded->mValues.size()) {
+		return;
+	}
+	uint8_t* values = &recorded->mValues[offset];
+	if (std::memcmp(values, data, size) != 0) {
+		std::memcpy(values, data, size);
+		recorded->mSnapshot = UINT32_MAX;
+	}
+}
+
+void CommandBucket::RemoveProgram(const ProgramHandle& program) {
+	RecordedUniforms* recorded = FindRecordedUniforms(program);
+	if (recorded != nullptr) {
+		std::swap(*recorded, mRecordedUniforms.back());
+		mRecordedUniforms.pop_back();
+	}
+}
+
+void CommandBucket::ClearRecordedUniforms() {
+	mRecordedUniforms.clear();
+}
+
+CommandBucket::RecordedUniforms* CommandBucket::FindRecordedUniforms(const ProgramHandle& program) {
+	for (auto& recorded : mRecordedUniforms) {
+		if (recorded.mProgram.mHandle == program.mHandle) {
+			return &recorded;
+		}
+	}
+	return nullptr;
+}
+
+void CommandBucket::Sort() {
+	uint32_t count = GetDrawsCount();
+	if (count < 2) {
+		return;
+	}
+	mTempKeys.resize(count);
+	mTempOrder.resize(count);
+	RadixSort(&mKeys[0], &mOrder[0], &mTempKeys[0], &mTempOrder[0], count);
+}
+
+} // namespace tinyngine
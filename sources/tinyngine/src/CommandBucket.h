@@ -0,0 +1,128 @@
+#pragma once
+
+#include "GraphicsTypes.h"
+#include "VertexFormat.h"
+
+#include <array>
+#include <vector>
+
+namespace tinyngine
+{
+
+static constexpr uint32_t cMaxTextureStages = 8;
+
+// 64 bit draw sort key, most significant field first:
+// layer (8) | program (10) | texture (12) | buffer (12) | depth (22)
+struct SortKey {
+	static uint64_t Encode(uint8_t layer, uint32_t program, uint32_t texture, uint32_t buffer, float depth);
+};
+
+// Fixed function parameters set with the individual setters rather than through a render state, mMask tells which
+// ones were set. They apply over the render state of the draw.
+struct DrawParameters {
+	enum Bits : uint16_t {
+		BlendFunc = 1 << 0,
+		BlendColor = 1 << 1,
+		DepthFunc = 1 << 2,
+		DepthMask = 1 << 3,
+		StencilFunc = 1 << 4,
+		StencilOp = 1 << 5,
+		StencilMask = 1 << 6,
+		CullFace = 1 << 7,
+		FrontFace = 1 << 8,
+		PolygonOffset = 1 << 9,
+		ColorMask = 1 << 10
+	};
+
+	uint16_t mMask;
+	BlendFuncs::Enum mBlendSrc;
+	BlendFuncs::Enum mBlendDst;
+	Color mBlendColor;
+	DepthFuncs::Enum mDepthFunc;
+	bool mDepthMask;
+	StencilFuncs::Enum mStencilFunc;
+	int32_t mStencilRef;
+	uint32_t mStencilReadMask;
+	StencilOpTypes::Enum mStencilFail;
+	StencilOpTypes::Enum mStencilDepthFail;
+	StencilOpTypes::Enum mStencilDepthPass;
+	uint32_t mStencilWriteMask;
+	CullFaceModes::Enum mCullFace;
+	WindingModes::Enum mFrontFace;
+	float mPolygonOffsetFactor;
+	float mPolygonOffsetUnits;
+	uint8_t mColorMask;
+};
+
+struct DrawCommand {
+	ProgramHandle mProgram;
+	VertexFormat mVertexFormat;
+	std::array<VertexBufferHandle, Attributes::Count> mVertexBuffers;
+	std::array<uint32_t, Attributes::Count> mVertexBufferOffsets;
+	bool mInterleaved;
+	IndexBufferHandle mIndexBuffer;
+	uint32_t mIndexBufferOffset;
+	IndexType::Enum mIndexType;
+	std::array<TextureHandle, cMaxTextureStages> mTextures;
+	RenderStateHandle mRenderState;
+	PrimitiveType::Enum mPrimitive;
+	uint32_t mFirst;
+	uint32_t mCount;
+	bool mIndexed;
+	VertexFormat mInstanceFormat;
+	VertexBufferHandle mInstanceBuffer;
+	uint32_t mInstanceBufferOffset;
+	uint32_t mInstanceDataOffset;
+	uint32_t mInstanceDivisor;
+	uint32_t mInstancesCount;
+	uint8_t mStates;
+	uint8_t mStatesMask;
+	DrawParameters mParameters;
+	// offset of the program's uniform values in the bucket, UINT32_MAX when none were recorded for it
+	uint32_t mUniformsOffset;
+};
+
+// Per-frame storage for deferred draws. DrawCommand is a full snapshot of the bound state. Uniform values are
+// recorded per program, laid out like the program's uniform shadow, and every draw references a copy of the values
+// of its program taken when it was submitted, so sorting cannot carry the uniforms of one draw over to another.
+// Storage is reused across frames, so after the first few frames recording does not allocate.
+class CommandBucket final {
+public:
+	struct RecordedUniforms {
+		ProgramHandle mProgram;
+		std::vector<uint8_t> mValues;
+		// offset of the copy taken for the draws of the current frame, UINT32_MAX once the values changed
+		uint32_t mSnapshot = UINT32_MAX;
+	};
+
+	// drops the draws, the recorded uniform values persist across frames
+	void Reset();
+
+	void Submit(uint64_t key, const DrawCommand& command);
+	// shadow is the current uniform shadow of the program, it seeds the recorded values on first use
+	void SetUniform(const ProgramHandle& program, const std::vector<uint8_t>& shadow, uint32_t offset, const void* data, uint32_t size);
+	void RemoveProgram(const ProgramHandle& program);
+	void ClearRecordedUniforms();
+
+	void Sort();
+
+	inline uint32_t GetDrawsCount() const { return static_cast<uint32_t>(mDraws.size()); }
+	inline const DrawCommand& GetSortedDraw(uint32_t index) const { return mDraws[mOrder[index]]; }
+	inline const uint8_t* GetUniforms(const DrawCommand& command) const { return &mUniformData[command.mUniformsOffset]; }
+	inline const std::vector<RecordedUniforms>& GetRecordedUniforms() const { return mRecordedUniforms; }
+
+private:
+	RecordedUniforms* FindRecordedUniforms(const ProgramHandle& program);
+
+private:
+	std::vector<DrawCommand> mDraws;
+	std::vector<uint64_t> mKeys;
+	std::vector<uint32_t> mOrder;
+	std::vector<uint64_t> mTempKeys;
+	std::vector<uint32_t> mTempOrder;
+
+	std::vector<RecordedUniforms> mRecordedUniforms;
+	std::vector<uint8_t> mUniformData;
+};
+
+} // namespace tinyngine
@@ -44,6 +44,25 @@ namespace {
 		return NULL;
 	}
 #elif defined( __linux__ ) || defined(__QNXNTO__) || defined(__APPLE__)
+#include <dlfcn.h>
+	typedef void* LIBTYPE;
+
+	LIBTYPE OpenLibrary(const char* libraryPath) {
+		return dlopen(libraryPath, RTLD_LAZY | RTLD_GLOBAL);
+	}
+
+	void CloseLibrary(LIBTYPE libraryHandle) {
+		if (libraryHandle != nullptr) {
+			dlclose(libraryHandle);
+		}
+	}
+
+	void* GetLibraryFunction(LIBTYPE libraryHandle, const char* functionName) {
+		if (libraryHandle != nullptr) {
+			return dlsym(libraryHandle, functionName);
+		}
+		return nullptr;
+	}
 #else
 #endif
 }
@@ -2,20 +2,36 @@
 #include "InputWin32.h"
 #include "Time.h"
 #include "gl/GraphicsDeviceGL.h"
+#include "null/GraphicsDeviceNull.h"
+#include "sw/GraphicsDeviceSW.h"
 #include "ImGUIWrapper.h"
 #include "MeshLoader.h"
 #include "ImageManager.h"
+#include "Profiler.h"
 
 namespace tinyngine
 {
 
-Engine::Engine() {
+Engine::Engine(RenderQueue& renderQueue, GraphicsBackend backend) {
+	// without a GL context the UI is laid out but not rendered
+	bool headless = backend != GraphicsBackend::OpenGLES;
 	mSystems[std::type_index(typeid(Input))] = new InputWin32();
-	mSystems[std::type_index(typeid(GraphicsDevice))] = new GraphicsDeviceGL();
-	mSystems[std::type_index(typeid(ImGUIWrapper))] = CreateImGUIWrapper();
+	switch (backend) {
+	case GraphicsBackend::Null:
+		mSystems[std::type_index(typeid(GraphicsDevice))] = new GraphicsDeviceNull();
+		break;
+	case GraphicsBackend::Software:
+		mSystems[std::type_index(typeid(GraphicsDevice))] = new GraphicsDeviceSW();
+		break;
+	default:
+		mSystems[std::type_index(typeid(GraphicsDevice))] = new GraphicsDeviceGL(renderQueue);
+		break;
+	}
+	mSystems[std::type_index(typeid(ImGUIWrapper))] = CreateImGUIWrapper(renderQueue, headless);
 	mSystems[std::type_index(typeid(Time))] = new Time();
 	mSystems[std::type_index(typeid(MeshLoader))] = new MeshLoader();
 	mSystems[std::type_index(typeid(ImageManager))] = new ImageManager();
+	mSystems[std::type_index(typeid(Profiler))] = new Profiler();
 }
 
 Engine::~Engine() {
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "GraphicsTypes.h"
+#include "Log.h"
+#include "PlatformDefine.h"
+
+#include <array>
+
+namespace tinyngine
+{
+
+// Fixed size storage handing out generational handles: the low 16 bits of a handle are the slot index, the high
+// 16 bits the generation of the slot when the handle was allocated. Freed slots are recycled through a free list
+// and their generation is bumped, so handles to released resources can be told apart from live ones.
+template<typename T, uint32_t Size>
+class HandlePool final {
+public:
+	static constexpr uint32_t cIndexBits = 16;
+	static constexpr uint32_t cIndexMask = (1 << cIndexBits) - 1;
+
+	static_assert(Size < cIndexMask, "HandlePool size must fit in the handle index bits");
+
+	HandlePool() {
+		mGenerations.fill(0);
+		for (uint32_t n = 0; n < Size; n++) {
+			mFreeList[n] = static_cast<uint16_t>(Size - n - 1);
+		}
+		mFreeCount = Size;
+	}
+
+	HandlePool(const HandlePool& other) = delete;
+	HandlePool& operator=(const HandlePool& other) = delete;
+
+	ResourceHandle Allocate() {
+		if (mFreeCount == 0) {
+			Log(Logger::Error, "HandlePool exhausted (%u slots)", Size);
+			return ResourceHandle(cInvalidHandle);
+		}
+		uint32_t index = mFreeList[--mFreeCount];
+		return ResourceHandle((static_cast<uint32_t>(mGenerations[index]) << cIndexBits) | index);
+	}
+
+	void Free(const ResourceHandle& handle) {
+		if (!IsValid(handle)) {
+			return;
+		}
+		uint32_t index = GetIndex(handle);
+		mData[index] = T();
+		mGenerations[index]++;
+		mFreeList[mFreeCount++] = static_cast<uint16_t>(index);
+	}
+
+	bool IsValid(const ResourceHandle& handle) const {
+		if (!handle.IsValid()) {
+			return false;
+		}
+		uint32_t index = GetIndex(handle);
+		return index < Size && mGenerations[index] == GetGeneration(handle);
+	}
+
+	T& Get(const ResourceHandle& handle) {
+		CheckStale(handle);
+		return mData[GetIndex(handle)];
+	}
+
+	const T& Get(const ResourceHandle& handle) const {
+		CheckStale(handle);
+		return mData[GetIndex(handle)];
+	}
+
+	inline uint32_t GetUsedCount() const { return Size - mFreeCount; }
+
+	static inline uint32_t GetIndex(const ResourceHandle& handle) { return handle.mHandle & cIndexMask; }
+	static inline uint16_t GetGeneration(const ResourceHandle& handle) { return static_cast<uint16_t>(handle.mHandle >> cIndexBits); }
+
+private:
+	void CheckStale(const ResourceHandle& handle) const {
+#if defined(_DEBUG)
+		if (!IsValid(handle)) {
+			Log(Logger::Error, "Stale or invalid handle 0x%x (slot %u)", handle.mHandle, GetIndex(handle));
+		}
+#else
+		TINYNGINE_UNUSED(handle);
+#endif
+	}
+
+private:
+	std::array<T, Size> mData;
+	std::array<uint16_t, Size> mGenerations;
+	std::array<uint16_t, Size> mFreeList;
+	uint32_t mFreeCount;
+};
+
+} // namespace tinyngine
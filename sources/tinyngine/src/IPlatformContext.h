@@ -15,9 +15,13 @@ public:
 
 	virtual Result MakeCurrent() = 0;
 
+	virtual Result ReleaseCurrent() = 0;
+
 	virtual std::string GetInfo() = 0;
 };
 
 extern "C" IPlatformContext* CreatePlatformContext(void* windowHandle, const ContextAttribs& attributes);
 
+extern "C" IPlatformContext* CreateOffscreenPlatformContext(uint32_t width, uint32_t height, const ContextAttribs& attributes);
+
 } // namespace tinyngine
\ No newline at end of file
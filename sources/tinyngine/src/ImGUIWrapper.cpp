@@ -1,21 +1,45 @@
 #include "ImGUIWrapper.h"
+#include "RenderQueue.h"
+#include "Profiler.h"
 #include "gl/GLApi.h"
 #include "imgui.h"
 
+#include <memory>
+#include <vector>
+
 namespace tinyngine
 {
-	
+
+// Copy of the ImGui draw lists, they are only valid until the next ImGui::NewFrame on the application thread.
+struct UIDrawList {
+	std::vector<ImDrawVert> mVertices;
+	std::vector<ImDrawIdx> mIndices;
+	std::vector<ImDrawCmd> mCommands;
+};
+
 class ImGUIWrapperImpl : public ImGUIWrapper {
 public:
-	ImGUIWrapperImpl() {
-		CreateDeviceObjects();
+	ImGUIWrapperImpl(RenderQueue& renderQueue, bool headless) : mRenderQueue(renderQueue), mHeadless(headless) {
+		if (mHeadless) {
+			unsigned char* pixels;
+			int width, height;
+			ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+			return;
+		}
+		// ImGui::NewFrame needs the font atlas, wait for it
+		mRenderQueue.Push([this]() { CreateDeviceObjects(); });
+		mRenderQueue.Flush();
 	}
 
 	virtual ~ImGUIWrapperImpl() {
-		DestroyDeviceObjects();
+		if (mHeadless) {
+			return;
+		}
+		mRenderQueue.Push([this]() { DestroyDeviceObjects(); });
+		mRenderQueue.Flush();
 	}
 
-	void ImGUIWrapperImpl::BeginFrame(MouseState& mouseState, int32_t windowWidth, int32_t windowHeight) override {
+	void BeginFrame(MouseState& mouseState, int32_t windowWidth, int32_t windowHeight) override {
 		ImGuiIO& io = ImGui::GetIO();
 		io.DisplaySize = ImVec2((float)windowWidth, (float)windowHeight);
 		io.DisplayFramebufferScale = ImVec2(1.0f, 1.0f);
@@ -30,8 +54,12 @@ public:
 		ImGui::NewFrame();
 	}
 
-	void ImGUIWrapperImpl::EndFrame() override {
+	void EndFrame() override {
+		TINYNGINE_PROFILE_SCOPE("ImGui");
 		ImGui::Render();
+		if (mHeadless) {
+			return;
+		}
 
 		ImDrawData* drawData = ImGui::GetDrawData();
 
@@ -42,6 +70,27 @@ public:
 			return;
 		drawData->ScaleClipRects(io.DisplayFramebufferScale);
 
+		auto drawLists = std::make_shared<std::vector<UIDrawList>>(drawData->CmdListsCount);
+		for (int n = 0; n < drawData->CmdListsCount; n++) {
+			const ImDrawList* cmd_list = drawData->CmdLists[n];
+			UIDrawList& drawList = (*drawLists)[n];
+			drawList.mVertices.assign(cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Data + cmd_list->VtxBuffer.Size);
+			drawList.mIndices.assign(cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Data + cmd_list->IdxBuffer.Size);
+			drawList.mCommands.assign(cmd_list->CmdBuffer.Data, cmd_list->CmdBuffer.Data + cmd_list->CmdBuffer.Size);
+		}
+		ImVec2 displaySize = io.DisplaySize;
+		mRenderQueue.Push([this, drawLists, displaySize, fb_width, fb_height]() { RenderDrawLists(*drawLists, displaySize, fb_width, fb_height); });
+	}
+
+	void AddInputCharacter(uint32_t ch) override {
+		ImGuiIO& io = ImGui::GetIO();
+		if (ch > 0 && ch < 0x10000) {
+			io.AddInputCharacter(static_cast<ImWchar>(ch));
+		}
+	}
+
+private:
+	void RenderDrawLists(const std::vector<UIDrawList>& drawLists, ImVec2 displaySize, int fb_width, int fb_height) {
 		GLenum last_active_texture; glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint*)&last_active_texture);
 		glActiveTexture(GL_TEXTURE0);
 		GLint last_program; glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
@@ -70,8 +119,8 @@ public:
 
 		glViewport(0, 0, (GLsizei)fb_width, (GLsizei)fb_height);
 		const float ortho_projection[4][4] = {
-			{ 2.0f / io.DisplaySize.x, 0.0f,                   0.0f, 0.0f },
-			{ 0.0f,                  2.0f / -io.DisplaySize.y, 0.0f, 0.0f },
+			{ 2.0f / displaySize.x, 0.0f,                   0.0f, 0.0f },
+			{ 0.0f,                  2.0f / -displaySize.y, 0.0f, 0.0f },
 			{ 0.0f,                  0.0f,                  -1.0f, 0.0f },
 			{ -1.0f,                  1.0f,                   0.0f, 1.0f },
 		};
@@ -90,23 +139,19 @@ public:
 		glVertexAttribPointer(mAttribLocationColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), (GLvoid*)OFFSETOF(ImDrawVert, col));
 #undef OFFSETOF
 
-		for (int n = 0; n < drawData->CmdListsCount; n++)
+		for (const auto& drawList : drawLists)
 		{
-			const ImDrawList* cmd_list = drawData->CmdLists[n];
 			const ImDrawIdx* idx_buffer_offset = 0;
 
-			glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)cmd_list->VtxBuffer.Size * sizeof(ImDrawVert), (const GLvoid*)cmd_list->VtxBuffer.Data, GL_STREAM_DRAW);
+			glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)drawList.mVertices.size() * sizeof(ImDrawVert), (const GLvoid*)drawList.mVertices.data(), GL_STREAM_DRAW);
 
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)cmd_list->IdxBuffer.Size * sizeof(ImDrawIdx), (const GLvoid*)cmd_list->IdxBuffer.Data, GL_STREAM_DRAW);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)drawList.mIndices.size() * sizeof(ImDrawIdx), (const GLvoid*)drawList.mIndices.data(), GL_STREAM_DRAW);
 
-			for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; cmd_i++)
+			for (const auto& cmd : drawList.mCommands)
 			{
-				const ImDrawCmd* pcmd = &cmd_list->CmdBuffer[cmd_i];
-				if (pcmd->UserCallback)
-				{
-					pcmd->UserCallback(cmd_list, pcmd);
-				}
-				else
+				const ImDrawCmd* pcmd = &cmd;
+				// callbacks expect the original draw list, which is gone by the time the copy is rendered
+				if (!pcmd->UserCallback)
 				{
 					glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)pcmd->TextureId);
 					glScissor((int)pcmd->ClipRect.x, (int)(fb_height - pcmd->ClipRect.w), (int)(pcmd->ClipRect.z - pcmd->ClipRect.x), (int)(pcmd->ClipRect.w - pcmd->ClipRect.y));
@@ -131,14 +176,6 @@ public:
 		glScissor(last_scissor_box[0], last_scissor_box[1], (GLsizei)last_scissor_box[2], (GLsizei)last_scissor_box[3]);
 	}
 
-	void AddInputCharacter(uint32_t ch) override {
-		ImGuiIO& io = ImGui::GetIO();
-		if (ch > 0 && ch < 0x10000) {
-			io.AddInputCharacter(static_cast<ImWchar>(ch));
-		}
-	}
-
-private:
 	void CreateDeviceObjects() {
 		ImGuiIO& io = ImGui::GetIO();
 		io.RenderDrawListsFn = nullptr;
@@ -231,6 +268,8 @@ private:
 	}
 
 private:
+	RenderQueue& mRenderQueue;
+	bool mHeadless;
 	GLuint mFontTexture = 0;
 	GLuint mVertexBufferHandle = 0;
 	GLuint mIndexBufferHandle = 0;
@@ -242,8 +281,8 @@ private:
 	GLint mAttribLocationColor = -1;
 };
 
-ImGUIWrapper* CreateImGUIWrapper() {
-	return new ImGUIWrapperImpl();
+ImGUIWrapper* CreateImGUIWrapper(RenderQueue& renderQueue, bool headless) {
+	return new ImGUIWrapperImpl(renderQueue, headless);
 }
 
 } // namespace tinyngine
\ No newline at end of file
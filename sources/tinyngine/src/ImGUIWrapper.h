@@ -7,6 +7,8 @@
 namespace tinyngine
 {
 
+class RenderQueue;
+
 class ImGUIWrapper : public System {
 public:
 	virtual ~ImGUIWrapper() = default;
@@ -16,6 +18,7 @@ public:
 	virtual void AddInputCharacter(uint32_t ch) = 0;
 };
 
-ImGUIWrapper* CreateImGUIWrapper();
+// a headless wrapper builds the ImGui frames but does not render them
+ImGUIWrapper* CreateImGUIWrapper(RenderQueue& renderQueue, bool headless);
 
 } // namespace tinyngine
\ No newline at end of file
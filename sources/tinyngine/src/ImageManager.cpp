@@ -1,103 +1,656 @@
 #include "ImageManager.h"
+#include "MipmapGenerator.h"
+#include "HandlePool.h"
+#include "Profiler.h"
+#include "Log.h"
+#include "StringUtils.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#define STB_DXT_IMPLEMENTATION
+// the default of stb_dxt 1.07 takes a single argument
+#define STBD_MEMSET memset
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include "stb_dxt.h"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
 
 #include <array>
 #include <vector>
+#include <deque>
 #include <memory>
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <sys/stat.h>
 
 namespace
 {
 static const int cMaxImageHandle = 256;
+static constexpr uint32_t cMaxDecodeThreads = 4;
+
+static const uint8_t cKTX1Identifier[12]{ 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const uint8_t cKTX2Identifier[12]{ 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+static constexpr uint32_t cKTXEndianness = 0x04030201;
+static constexpr uint32_t cGLUnsignedByte = 0x1401;
+
+static const char* cMipmapFilterNames[]{
+	"none",
+	"box",
+	"kaiser"
+};
+
+struct KTX1Header {
+	uint8_t mIdentifier[12];
+	uint32_t mEndianness;
+	uint32_t mGLType;
+	uint32_t mGLTypeSize;
+	uint32_t mGLFormat;
+	uint32_t mGLInternalFormat;
+	uint32_t mGLBaseInternalFormat;
+	uint32_t mPixelWidth;
+	uint32_t mPixelHeight;
+	uint32_t mPixelDepth;
+	uint32_t mNumberOfArrayElements;
+	uint32_t mNumberOfFaces;
+	uint32_t mNumberOfMipmapLevels;
+	uint32_t mBytesOfKeyValueData;
+};
+static_assert(sizeof(KTX1Header) == 64, "KTX1Header must match the file layout");
+
+struct KTX2Header {
+	uint8_t mIdentifier[12];
+	uint32_t mVkFormat;
+	uint32_t mTypeSize;
+	uint32_t mPixelWidth;
+	uint32_t mPixelHeight;
+	uint32_t mPixelDepth;
+	uint32_t mLayerCount;
+	uint32_t mFaceCount;
+	uint32_t mLevelCount;
+	uint32_t mSupercompressionScheme;
+	uint32_t mDfdByteOffset;
+	uint32_t mDfdByteLength;
+	uint32_t mKvdByteOffset;
+	uint32_t mKvdByteLength;
+	uint64_t mSgdByteOffset;
+	uint64_t mSgdByteLength;
+};
+static_assert(sizeof(KTX2Header) == 80, "KTX2Header must match the file layout");
+
+struct KTX2Level {
+	uint64_t mByteOffset;
+	uint64_t mByteLength;
+	uint64_t mUncompressedByteLength;
+};
+
+struct KTXFormat {
+	uint32_t mGLInternalFormat;
+	uint32_t mGLBaseFormat;
+	uint32_t mVkFormat; // 0 when Vulkan has none
+	tinyngine::TextureFormats::Enum mFormat;
+};
+
+// the first entry of a format is the one written
+static const KTXFormat cKTXFormats[]{
+	{ 0x8051, 0x1907, 23, tinyngine::TextureFormats::RGB8 }, // GL_RGB8, VK_FORMAT_R8G8B8_UNORM
+	{ 0x8058, 0x1908, 37, tinyngine::TextureFormats::RGBA8 }, // GL_RGBA8, VK_FORMAT_R8G8B8A8_UNORM
+	{ 0x93A1, 0x80E1, 44, tinyngine::TextureFormats::BGRA8 }, // GL_BGRA8_EXT, VK_FORMAT_B8G8R8A8_UNORM
+	{ 0x8D64, 0x1907, 0, tinyngine::TextureFormats::ETC1 }, // GL_ETC1_RGB8_OES
+	{ 0x9274, 0x1907, 147, tinyngine::TextureFormats::ETC2_RGB8 }, // GL_COMPRESSED_RGB8_ETC2, VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+	{ 0x9278, 0x1908, 151, tinyngine::TextureFormats::ETC2_RGBA8 }, // GL_COMPRESSED_RGBA8_ETC2_EAC, VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+	{ 0x9270, 0x1903, 153, tinyngine::TextureFormats::EAC_R11 }, // GL_COMPRESSED_R11_EAC, VK_FORMAT_EAC_R11_UNORM_BLOCK
+	{ 0x9272, 0x8227, 155, tinyngine::TextureFormats::EAC_RG11 }, // GL_COMPRESSED_RG11_EAC, VK_FORMAT_EAC_R11G11_UNORM_BLOCK
+	{ 0x93B0, 0x1908, 157, tinyngine::TextureFormats::ASTC_4x4 }, // GL_COMPRESSED_RGBA_ASTC_4x4_KHR, VK_FORMAT_ASTC_4x4_UNORM_BLOCK
+	{ 0x93B7, 0x1908, 171, tinyngine::TextureFormats::ASTC_8x8 }, // GL_COMPRESSED_RGBA_ASTC_8x8_KHR, VK_FORMAT_ASTC_8x8_UNORM_BLOCK
+	{ 0x83F0, 0x1907, 131, tinyngine::TextureFormats::BC1 }, // GL_COMPRESSED_RGB_S3TC_DXT1_EXT, VK_FORMAT_BC1_RGB_UNORM_BLOCK
+	{ 0x83F2, 0x1908, 135, tinyngine::TextureFormats::BC2 }, // GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, VK_FORMAT_BC2_UNORM_BLOCK
+	{ 0x83F3, 0x1908, 137, tinyngine::TextureFormats::BC3 }, // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, VK_FORMAT_BC3_UNORM_BLOCK
+	// unsized internal formats of the GLES2 files
+	{ 0x1907, 0x1907, 0, tinyngine::TextureFormats::RGB8 },
+	{ 0x1908, 0x1908, 0, tinyngine::TextureFormats::RGBA8 },
+	{ 0x80E1, 0x80E1, 0, tinyngine::TextureFormats::BGRA8 }
+};
+
+const KTXFormat* FindKTXFormat(uint32_t glInternalFormat, uint32_t vkFormat) {
+	for (const auto& format : cKTXFormats) {
+		if ((glInternalFormat != 0 && format.mGLInternalFormat == glInternalFormat) || (vkFormat != 0 && format.mVkFormat == vkFormat)) {
+			return &format;
+		}
+	}
+	return nullptr;
+}
+
+tinyngine::TextureFormats::Enum GetChannelsFormat(uint32_t channels) {
+	return channels == 3 ? tinyngine::TextureFormats::RGB8 : (channels == 4 ? tinyngine::TextureFormats::RGBA8 : tinyngine::TextureFormats::Count);
+}
+
 }
 
 namespace tinyngine
 {
 
 struct Image {
-	uint32_t mWidth;
-	uint32_t mHeight;
-	uint32_t mSize;
-	uint8_t mBitsPerPixel;
-	uint32_t mNumMipmaps;
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+	uint8_t mBitsPerPixel = 0;
+	TextureFormats::Enum mFormat = TextureFormats::Count;
+	uint32_t mNumMipmaps = 0;
 	std::vector<uint8_t*> mData;
+	std::vector<uint32_t> mSizes;
+	uint8_t* mDecoded = nullptr; // level 0 allocated by stb_image
+	std::vector<uint8_t> mStorage; // levels read from a KTX file or encoded
+	std::vector<uint8_t> mMipmaps; // levels 1 and above generated on the CPU
+};
+
+static bool IsNewerFile(const char* filename, const char* other) {
+	struct stat fileStat;
+	struct stat otherStat;
+	return stat(filename, &fileStat) == 0 && stat(other, &otherStat) == 0 && fileStat.st_mtime >= otherStat.st_mtime;
+}
+
+static bool ReadFile(const char* filename, std::vector<uint8_t>& content) {
+	FILE* file = fopen(filename, "rb");
+	if (!file) {
+		return false;
+	}
+	bool read = fseek(file, 0, SEEK_END) == 0;
+	long size = read ? ftell(file) : -1;
+	read = size >= 0 && fseek(file, 0, SEEK_SET) == 0;
+	if (read) {
+		content.resize(static_cast<size_t>(size));
+		read = size == 0 || fread(content.data(), content.size(), 1, file) == 1;
+	}
+	fclose(file);
+	return read;
+}
+
+static void SetFormat(Image& image, const KTXFormat& format, uint32_t width, uint32_t height) {
+	const TextureFormatInfo& info = GetTextureFormatInfo(format.mFormat);
+	image.mWidth = width;
+	image.mHeight = height;
+	image.mFormat = format.mFormat;
+	image.mBitsPerPixel = static_cast<uint8_t>(info.mBlockSize * 8 / (info.mBlockWidth * info.mBlockHeight));
+}
+
+// KTX 1.1, rows of uncompressed levels are padded to 4 bytes and packed in place
+static bool ParseKTX1(const char* filename, Image& image) {
+	std::vector<uint8_t>& file = image.mStorage;
+	KTX1Header header;
+	memcpy(&header, file.data(), sizeof(header));
+	if (header.mEndianness != cKTXEndianness) {
+		Log(Logger::Error, "%s: byte swapped KTX files are not supported", filename);
+		return false;
+	}
+	const KTXFormat* format = FindKTXFormat(header.mGLInternalFormat, 0);
+	if (!format || (!GetTextureFormatInfo(format->mFormat).mCompressed && header.mGLType != cGLUnsignedByte)) {
+		Log(Logger::Error, "%s: KTX internal format 0x%x is not supported", filename, header.mGLInternalFormat);
+		return false;
+	}
+	if (header.mPixelWidth == 0 || header.mPixelHeight == 0 || header.mPixelDepth > 1 || header.mNumberOfArrayElements > 0 || header.mNumberOfFaces != 1) {
+		Log(Logger::Error, "%s: only 2D KTX textures are supported", filename);
+		return false;
+	}
+
+	SetFormat(image, *format, header.mPixelWidth, header.mPixelHeight);
+	const bool compressed = GetTextureFormatInfo(format->mFormat).mCompressed;
+	const uint32_t levels = std::max(header.mNumberOfMipmapLevels, 1u);
+	size_t offset = sizeof(header) + header.mBytesOfKeyValueData;
+	for (uint32_t level = 0; level < levels; level++) {
+		uint32_t width = std::max(header.mPixelWidth >> level, 1u);
+		uint32_t height = std::max(header.mPixelHeight >> level, 1u);
+		uint32_t size = GetTextureLevelSize(format->mFormat, width, height);
+		uint32_t rowSize = compressed ? 0 : size / height;
+		uint32_t rowPitch = (rowSize + 3) & ~3u;
+		uint32_t imageSize = 0;
+		if (offset + sizeof(imageSize) > file.size()) {
+			break;
+		}
+		memcpy(&imageSize, file.data() + offset, sizeof(imageSize));
+		offset += sizeof(imageSize);
+		if (imageSize != (compressed ? size : rowPitch * height) || offset + imageSize > file.size()) {
+			break;
+		}
+		uint8_t* data = file.data() + offset;
+		for (uint32_t row = 1; row < height && rowPitch != rowSize; row++) {
+			memmove(data + row * rowSize, data + row * rowPitch, rowSize);
+		}
+		image.mData.push_back(data);
+		image.mSizes.push_back(size);
+		offset += (imageSize + 3) & ~3u;
+	}
+	image.mNumMipmaps = static_cast<uint32_t>(image.mData.size());
+	if (image.mNumMipmaps != levels) {
+		Log(Logger::Error, "%s: truncated or malformed KTX file", filename);
+		return false;
+	}
+	return true;
+}
+
+// KTX2 without supercompression, the levels are tightly packed
+static bool ParseKTX2(const char* filename, Image& image) {
+	std::vector<uint8_t>& file = image.mStorage;
+	KTX2Header header;
+	memcpy(&header, file.data(), sizeof(header));
+	const KTXFormat* format = FindKTXFormat(0, header.mVkFormat);
+	if (!format) {
+		Log(Logger::Error, "%s: KTX2 format %u is not supported", filename, header.mVkFormat);
+		return false;
+	}
+	if (header.mSupercompressionScheme != 0) {
+		Log(Logger::Error, "%s: supercompressed KTX2 files are not supported", filename);
+		return false;
+	}
+	if (header.mPixelWidth == 0 || header.mPixelHeight == 0 || header.mPixelDepth > 1 || header.mLayerCount > 1 || header.mFaceCount != 1) {
+		Log(Logger::Error, "%s: only 2D KTX2 textures are supported", filename);
+		return false;
+	}
+
+	SetFormat(image, *format, header.mPixelWidth, header.mPixelHeight);
+	const uint32_t levels = std::max(header.mLevelCount, 1u);
+	if (sizeof(header) + levels * sizeof(KTX2Level) <= file.size()) {
+		for (uint32_t level = 0; level < levels; level++) {
+			KTX2Level levelIndex;
+			memcpy(&levelIndex, file.data() + sizeof(header) + level * sizeof(KTX2Level), sizeof(levelIndex));
+			uint32_t size = GetTextureLevelSize(format->mFormat, std::max(header.mPixelWidth >> level, 1u), std::max(header.mPixelHeight >> level, 1u));
+			if (levelIndex.mByteLength != size || levelIndex.mByteOffset + levelIndex.mByteLength > file.size()) {
+				break;
+			}
+			image.mData.push_back(file.data() + levelIndex.mByteOffset);
+			image.mSizes.push_back(size);
+		}
+	}
+	image.mNumMipmaps = static_cast<uint32_t>(image.mData.size());
+	if (image.mNumMipmaps != levels) {
+		Log(Logger::Error, "%s: truncated or malformed KTX2 file", filename);
+		return false;
+	}
+	return true;
+}
+
+// 4x4 blocks of an 8 bit image with 1 to 4 channels, the edges are clamped
+static void EncodeBC(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, bool alpha, uint8_t* blocks) {
+	uint8_t block[16 * 4];
+	for (uint32_t blockY = 0; blockY < height; blockY += 4) {
+		for (uint32_t blockX = 0; blockX < width; blockX += 4) {
+			for (uint32_t n = 0; n < 16; n++) {
+				uint32_t x = std::min(blockX + (n & 3), width - 1);
+				uint32_t y = std::min(blockY + (n >> 2), height - 1);
+				const uint8_t* source = pixels + (y * width + x) * channels;
+				uint8_t* texel = &block[n * 4];
+				texel[0] = source[0];
+				texel[1] = channels > 1 ? source[1] : source[0];
+				texel[2] = channels > 2 ? source[2] : source[0];
+				texel[3] = channels > 3 ? source[3] : (channels == 2 ? source[1] : 255);
+			}
+			stb_compress_dxt_block(blocks, block, alpha ? 1 : 0, STB_DXT_HIGHQUAL);
+			blocks += alpha ? 16 : 8;
+		}
+	}
+}
+
+struct DecodeRequest {
+	std::string mFilename;
+	uint32_t mChannels;
+	MipmapFilter::Enum mFilter;
+	DecodedImageFunc mOnDecoded;
 };
 
 struct ImageManager::Impl {
-	uint32_t mImagesCount = 0;
-	std::array<Image, cMaxImageHandle> mImages;
+	~Impl();
+
+	void StartWorkers();
+	void WorkerFunc(uint32_t index);
+
+	HandlePool<Image, cMaxImageHandle> mImages;
+
+	std::vector<std::thread> mWorkers;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::deque<DecodeRequest> mRequests;
+	bool mExit = false;
 };
 
+// the requests still queued are dropped, their callbacks are never called
+ImageManager::Impl::~Impl() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mExit = true;
+	}
+	mCondition.notify_all();
+	for (auto& worker : mWorkers) {
+		worker.join();
+	}
+}
+
+// decoding is mostly bound by inflate and leaves the other cores to the application
+void ImageManager::Impl::StartWorkers() {
+	uint32_t threadsCount = std::min(std::max(std::thread::hardware_concurrency() / 2, 1u), cMaxDecodeThreads);
+	for (uint32_t n = 0; n < threadsCount; n++) {
+		mWorkers.emplace_back(&ImageManager::Impl::WorkerFunc, this, n);
+	}
+}
+
+void ImageManager::Impl::WorkerFunc(uint32_t index) {
+	Profiler::SetThreadName(("Image decode " + std::to_string(index)).c_str());
+
+	std::vector<uint8_t> mipmaps;
+
+	for (;;) {
+		DecodeRequest request;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this]() { return mExit || !mRequests.empty(); });
+			if (mExit) {
+				return;
+			}
+			request = std::move(mRequests.front());
+			mRequests.pop_front();
+		}
+
+		TINYNGINE_PROFILE_SCOPE("DecodeImage");
+		int x = 0, y = 0, n = 0;
+		uint8_t* data = stbi_load(request.mFilename.c_str(), &x, &y, &n, static_cast<int>(request.mChannels));
+		uint32_t channels = request.mChannels ? request.mChannels : static_cast<uint32_t>(n);
+
+		ImageData imageData;
+		imageData.mWidth = data ? x : 0;
+		imageData.mHeight = data ? y : 0;
+		imageData.mSize = imageData.mWidth * imageData.mHeight * channels;
+		imageData.mBitsPerPixel = static_cast<uint8_t>(channels * 8);
+		imageData.mData = data;
+		imageData.mFormat = GetChannelsFormat(channels);
+
+		std::vector<ImageData> levels(1, imageData);
+		if (data && request.mFilter != MipmapFilter::None && channels <= 4) {
+			mipmaps.resize(GetMipmapsSize(imageData.mWidth, imageData.mHeight, channels));
+			tinyngine::GenerateMipmaps(data, imageData.mWidth, imageData.mHeight, channels, request.mFilter, true, mipmaps.data());
+			uint8_t* level = mipmaps.data();
+			uint32_t levelsCount = GetMipmapsCount(imageData.mWidth, imageData.mHeight);
+			for (uint32_t n = 1; n < levelsCount; n++) {
+				imageData.mWidth = std::max(imageData.mWidth >> 1, 1u);
+				imageData.mHeight = std::max(imageData.mHeight >> 1, 1u);
+				imageData.mSize = imageData.mWidth * imageData.mHeight * channels;
+				imageData.mData = level;
+				levels.push_back(imageData);
+				level += imageData.mSize;
+			}
+		}
+		request.mOnDecoded(levels.data(), static_cast<uint32_t>(levels.size()));
+		stbi_image_free(data);
+	}
+}
+
 //=====================================================================================================================
 
 ImageManager::ImageManager() : mImpl(new Impl()) {
 
 }
 
-ImageManager::~ImageManager() {}
+ImageManager::~ImageManager() {
+	delete mImpl;
+}
 
 bool ImageManager::ReleaseImage(ImageHandle& imageHandle) {
-	if (imageHandle.IsValid()) {
-		auto& image = mImpl->mImages[imageHandle.mHandle];
-		for (auto data : image.mData) {
-			stbi_image_free(data);
-		}
-		image.mData.clear();
-
-		//@note: build list of released handles that can be recycled
-
+	if (mImpl->mImages.IsValid(imageHandle)) {
+		auto& image = mImpl->mImages.Get(imageHandle);
+		stbi_image_free(image.mDecoded);
+		mImpl->mImages.Free(imageHandle);
+		imageHandle = ImageHandle(cInvalidHandle);
 		return true;
 	}
 	return false;
 }
 
 ImageHandle ImageManager::LoadImageFromFile(const char * filename) {
-	if (filename) {
-		ImageHandle handle = ImageHandle(mImpl->mImagesCount++);
-		auto& image = mImpl->mImages[handle.mHandle];
+	std::vector<uint8_t> file;
+	if (filename && ReadFile(filename, file)) {
+		bool ktx1 = file.size() >= sizeof(KTX1Header) && memcmp(file.data(), cKTX1Identifier, sizeof(cKTX1Identifier)) == 0;
+		bool ktx2 = file.size() >= sizeof(KTX2Header) && memcmp(file.data(), cKTX2Identifier, sizeof(cKTX2Identifier)) == 0;
+		if (ktx1 || ktx2) {
+			Image image;
+			image.mStorage = std::move(file);
+			bool parsed = ktx1 ? ParseKTX1(filename, image) : ParseKTX2(filename, image);
+			ImageHandle handle = parsed ? mImpl->mImages.Allocate() : ImageHandle(cInvalidHandle);
+			if (handle.IsValid()) {
+				mImpl->mImages.Get(handle) = std::move(image);
+			}
+			return handle;
+		}
 
 		int x, y, n;
-		uint8_t* data = stbi_load(filename, &x, &y, &n, 0);
-		if (data) {
+		uint8_t* data = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &x, &y, &n, 0);
+		ImageHandle handle = data ? mImpl->mImages.Allocate() : ImageHandle(cInvalidHandle);
+		if (handle.IsValid()) {
+			auto& image = mImpl->mImages.Get(handle);
+			image.mDecoded = data;
 			image.mData.push_back(data);
+			image.mSizes.push_back(x * y * n);
 			image.mWidth = x;
 			image.mHeight = y;
-			image.mSize = x * y * n;
 			image.mBitsPerPixel = static_cast<uint8_t>(n * 8);
-
-			uint32_t depth = 1;
-			const uint32_t max = std::max(std::max(image.mWidth, image.mHeight), depth);
-			image.mNumMipmaps = 1;// +uint32_t(std::floor(std::log2(max)));
-
+			image.mFormat = GetChannelsFormat(n);
+			image.mNumMipmaps = 1;
 			return handle;
 		}
+		stbi_image_free(data);
 	}
 	return ImageHandle(cInvalidHandle);
 }
 
+ImageHandle ImageManager::LoadImageFromFile(const char* filename, MipmapFilter::Enum filter, bool srgb) {
+	if (!filename || filter == MipmapFilter::None) {
+		return LoadImageFromFile(filename);
+	}
+
+	std::string cachePath = StringUtils::CreateFormatted("%s.%s%s.mips.ktx", filename, cMipmapFilterNames[filter], srgb ? "" : "-linear");
+	if (IsNewerFile(cachePath.c_str(), filename)) {
+		ImageHandle handle = LoadImageFromFile(cachePath.c_str());
+		if (handle.IsValid()) {
+			const Image& image = mImpl->mImages.Get(handle);
+			if (image.mNumMipmaps == GetMipmapsCount(image.mWidth, image.mHeight)) {
+				return handle;
+			}
+			ReleaseImage(handle);
+		}
+	}
+
+	ImageHandle handle = LoadImageFromFile(filename);
+	if (!handle.IsValid()) {
+		return handle;
+	}
+	const Image& image = mImpl->mImages.Get(handle);
+	// compressed files and the ones with a complete chain already are used as they are
+	if (GetTextureFormatInfo(image.mFormat).mCompressed || image.mNumMipmaps == GetMipmapsCount(image.mWidth, image.mHeight) || !GenerateMipmaps(handle, filter, srgb)) {
+		return handle;
+	}
+	if (image.mFormat != TextureFormats::Count) {
+		SaveImageKTX(handle, cachePath.c_str());
+	}
+	return handle;
+}
+
+bool ImageManager::GenerateMipmaps(const ImageHandle& imageHandle, MipmapFilter::Enum filter, bool srgb) {
+	if (!mImpl->mImages.IsValid(imageHandle) || filter == MipmapFilter::None) {
+		return false;
+	}
+	Image& image = mImpl->mImages.Get(imageHandle);
+	uint32_t channels = image.mBitsPerPixel / 8;
+	if (GetTextureFormatInfo(image.mFormat).mCompressed || channels == 0 || channels > 4) {
+		Log(Logger::Error, "GenerateMipmaps: the image must be an uncompressed 8 bit image");
+		return false;
+	}
+
+	std::vector<uint8_t> mipmaps(GetMipmapsSize(image.mWidth, image.mHeight, channels));
+	tinyngine::GenerateMipmaps(image.mData[0], image.mWidth, image.mHeight, channels, filter, srgb, mipmaps.data());
+	image.mMipmaps.swap(mipmaps);
+	image.mNumMipmaps = GetMipmapsCount(image.mWidth, image.mHeight);
+	image.mData.resize(1);
+	image.mSizes.resize(1);
+	uint8_t* level = image.mMipmaps.data();
+	for (uint32_t n = 1; n < image.mNumMipmaps; n++) {
+		image.mData.push_back(level);
+		image.mSizes.push_back(std::max(image.mWidth >> n, 1u) * std::max(image.mHeight >> n, 1u) * channels);
+		level += image.mSizes.back();
+	}
+	return true;
+}
+
+void ImageManager::DecodeImageAsync(const char* filename, uint32_t channels, MipmapFilter::Enum filter, DecodedImageFunc onDecoded) {
+	if (!filename || !onDecoded) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mImpl->mMutex);
+		if (mImpl->mWorkers.empty()) {
+			mImpl->StartWorkers();
+		}
+		mImpl->mRequests.push_back({ filename, channels, filter, std::move(onDecoded) });
+	}
+	mImpl->mCondition.notify_one();
+}
+
+ImageHandle ImageManager::CompressImage(const ImageHandle& imageHandle, TextureFormats::Enum format) {
+	if (format != TextureFormats::BC1 && format != TextureFormats::BC3) {
+		Log(Logger::Error, "CompressImage: only BC1 and BC3 can be encoded");
+		return ImageHandle(cInvalidHandle);
+	}
+	if (!mImpl->mImages.IsValid(imageHandle)) {
+		return ImageHandle(cInvalidHandle);
+	}
+	const Image& source = mImpl->mImages.Get(imageHandle);
+	uint32_t channels = source.mBitsPerPixel / 8;
+	if (GetTextureFormatInfo(source.mFormat).mCompressed || source.mFormat == TextureFormats::BGRA8 || channels == 0 || channels > 4) {
+		Log(Logger::Error, "CompressImage: the source must be an 8 bit RGB(A) image");
+		return ImageHandle(cInvalidHandle);
+	}
+
+	TINYNGINE_PROFILE_SCOPE("CompressImage");
+	Image image;
+	image.mWidth = source.mWidth;
+	image.mHeight = source.mHeight;
+	image.mFormat = format;
+	image.mBitsPerPixel = static_cast<uint8_t>(GetTextureFormatInfo(format).mBlockSize / 2);
+	image.mNumMipmaps = source.mNumMipmaps;
+	size_t size = 0;
+	for (uint32_t level = 0; level < source.mNumMipmaps; level++) {
+		image.mSizes.push_back(GetTextureLevelSize(format, std::max(source.mWidth >> level, 1u), std::max(source.mHeight >> level, 1u)));
+		size += image.mSizes.back();
+	}
+	image.mStorage.resize(size);
+	uint8_t* blocks = image.mStorage.data();
+	for (uint32_t level = 0; level < source.mNumMipmaps; level++) {
+		EncodeBC(source.mData[level], std::max(source.mWidth >> level, 1u), std::max(source.mHeight >> level, 1u), channels, format == TextureFormats::BC3, blocks);
+		image.mData.push_back(blocks);
+		blocks += image.mSizes[level];
+	}
+
+	ImageHandle handle = mImpl->mImages.Allocate();
+	if (handle.IsValid()) {
+		mImpl->mImages.Get(handle) = std::move(image);
+	}
+	return handle;
+}
+
+bool ImageManager::SaveImageKTX(const ImageHandle& imageHandle, const char* filename) const {
+	if (!mImpl->mImages.IsValid(imageHandle) || !filename) {
+		return false;
+	}
+	const Image& image = mImpl->mImages.Get(imageHandle);
+	const KTXFormat* format = nullptr;
+	for (const auto& candidate : cKTXFormats) {
+		if (candidate.mFormat == image.mFormat) {
+			format = &candidate;
+			break;
+		}
+	}
+	if (!format) {
+		Log(Logger::Error, "%s: the image has no KTX format", filename);
+		return false;
+	}
+
+	const bool compressed = GetTextureFormatInfo(image.mFormat).mCompressed;
+	KTX1Header header;
+	memcpy(header.mIdentifier, cKTX1Identifier, sizeof(cKTX1Identifier));
+	header.mEndianness = cKTXEndianness;
+	header.mGLType = compressed ? 0 : cGLUnsignedByte;
+	header.mGLTypeSize = 1;
+	header.mGLFormat = compressed ? 0 : format->mGLBaseFormat;
+	header.mGLInternalFormat = format->mGLInternalFormat;
+	header.mGLBaseInternalFormat = format->mGLBaseFormat;
+	header.mPixelWidth = image.mWidth;
+	header.mPixelHeight = image.mHeight;
+	header.mPixelDepth = 0;
+	header.mNumberOfArrayElements = 0;
+	header.mNumberOfFaces = 1;
+	header.mNumberOfMipmapLevels = image.mNumMipmaps;
+	header.mBytesOfKeyValueData = 0;
+
+	FILE* file = fopen(filename, "wb");
+	if (!file) {
+		Log(Logger::Error, "Cannot write %s", filename);
+		return false;
+	}
+	static const uint8_t cPadding[4]{};
+	auto write = [file](const void* data, size_t size) { return size == 0 || fwrite(data, size, 1, file) == 1; };
+	bool written = write(&header, sizeof(header));
+	for (uint32_t level = 0; level < image.mNumMipmaps && written; level++) {
+		// uncompressed rows are padded to 4 bytes, as the levels
+		uint32_t height = std::max(image.mHeight >> level, 1u);
+		uint32_t rows = compressed ? 1 : height;
+		uint32_t rowSize = image.mSizes[level] / rows;
+		uint32_t rowPitch = compressed ? rowSize : (rowSize + 3) & ~3u;
+		uint32_t imageSize = rowPitch * rows;
+		written = write(&imageSize, sizeof(imageSize));
+		for (uint32_t row = 0; row < rows && written; row++) {
+			written = write(image.mData[level] + row * rowSize, rowSize) && write(cPadding, rowPitch - rowSize);
+		}
+		written = written && write(cPadding, ((imageSize + 3) & ~3u) - imageSize);
+	}
+	written = fclose(file) == 0 && written;
+	if (!written) {
+		Log(Logger::Error, "Cannot write %s", filename);
+		remove(filename);
+	}
+	return written;
+}
+
+TextureFormats::Enum ImageManager::ImageGetFormat(const ImageHandle& imageHandle) const {
+	return mImpl->mImages.IsValid(imageHandle) ? mImpl->mImages.Get(imageHandle).mFormat : TextureFormats::Count;
+}
+
 bool ImageManager::ImageHasMipmaps(const ImageHandle& imageHandle) const {
 	uint32_t mips = ImageGetMipmapsCount(imageHandle);
 	return mips > 1;
 }
 
 uint32_t ImageManager::ImageGetMipmapsCount(const ImageHandle& imageHandle) const {
-	if (imageHandle.IsValid()) {
-		auto& image = mImpl->mImages[imageHandle.mHandle];
+	if (mImpl->mImages.IsValid(imageHandle)) {
+		auto& image = mImpl->mImages.Get(imageHandle);
 		return image.mNumMipmaps;
 	}
 	return 0;
 }
 
 bool ImageManager::GetImageData(const ImageHandle& imageHandle, uint32_t level, ImageData& imageData) {
-	if (imageHandle.IsValid()) {
-		auto& image = mImpl->mImages[imageHandle.mHandle];
+	if (mImpl->mImages.IsValid(imageHandle)) {
+		auto& image = mImpl->mImages.Get(imageHandle);
 		if (image.mNumMipmaps > level) {
 			imageData.mData = image.mData[level];
-			imageData.mWidth = image.mWidth;
-			imageData.mHeight = image.mHeight;
+			imageData.mWidth = std::max(image.mWidth >> level, 1u);
+			imageData.mHeight = std::max(image.mHeight >> level, 1u);
+			imageData.mSize = image.mSizes[level];
 			imageData.mBitsPerPixel = image.mBitsPerPixel;
+			imageData.mFormat = image.mFormat;
 			return true;
 		}
 	}
@@ -1,5 +1,7 @@
 #include "InputWin32.h"
 
+#include <cstring>
+
 namespace tinyngine
 {
 
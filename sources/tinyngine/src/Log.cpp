@@ -1,5 +1,7 @@
 #include "Log.h"
 #include <cstdarg>
+#include <cstdio>
+#include <cstring>
 #include <memory>
 
 #if defined(_WIN32)
@@ -42,7 +44,7 @@ namespace {
 			OutputDebugString("\n");
 		}
 #else
-		printf("%s", messageTypes[severity]);
+		printf("%s", severityString);
 		vprintf(formatString, tempList);
 		printf("\n");
 #endif
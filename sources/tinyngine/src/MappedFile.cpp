@@ -0,0 +1,79 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tinyngine
+{
+
+#if defined(_WIN32)
+MappedFile::MappedFile(const char* filename) {
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	LARGE_INTEGER size;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+		if (file != INVALID_HANDLE_VALUE) {
+			CloseHandle(file);
+		}
+		return;
+	}
+	mFile = file;
+	mSize = static_cast<size_t>(size.QuadPart);
+	mValid = mSize == 0;
+	if (mSize > 0) {
+		mMapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		mData = mMapping ? static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		mValid = mData != nullptr;
+	}
+}
+
+MappedFile::~MappedFile() {
+	if (mData) {
+		UnmapViewOfFile(mData);
+	}
+	if (mMapping) {
+		CloseHandle(mMapping);
+	}
+	if (mFile) {
+		CloseHandle(mFile);
+	}
+}
+#else
+MappedFile::MappedFile(const char* filename) {
+	int file = open(filename, O_RDONLY);
+	struct stat status;
+	if (file < 0 || fstat(file, &status) != 0) {
+		if (file >= 0) {
+			close(file);
+		}
+		return;
+	}
+	mSize = static_cast<size_t>(status.st_size);
+	mValid = mSize == 0;
+	if (mSize > 0) {
+		void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED) {
+			// callers read the whole file, fault the pages in ahead of them
+			madvise(data, mSize, MADV_WILLNEED);
+			mData = static_cast<const char*>(data);
+			mValid = true;
+		}
+	}
+	close(file);
+}
+
+MappedFile::~MappedFile() {
+	if (mData) {
+		munmap(const_cast<char*>(mData), mSize);
+	}
+}
+#endif
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+namespace tinyngine
+{
+
+// Read only view of a whole file, mapped in the address space of the process. An empty file is valid and has no data.
+class MappedFile final {
+public:
+	explicit MappedFile(const char* filename);
+	~MappedFile();
+
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+
+	bool IsValid() const { return mValid; }
+	const char* GetData() const { return mData; }
+	size_t GetSize() const { return mSize; }
+
+private:
+	const char* mData = nullptr;
+	size_t mSize = 0;
+	bool mValid = false;
+#if defined(_WIN32)
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#endif
+};
+
+} // namespace tinyngine
\ No newline at end of file
@@ -1,12 +1,15 @@
 #include "MeshLoader.h"
+#include "GraphicsDevice.h"
 #include "Log.h"
 
+#include <cstdio>
 #include <cstring>
 #include <algorithm>
+#include <cmath>
 
-#include <fstream>
-#include <iostream>
-#include "tiny_obj_loader.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
 
 #include "glm/vec3.hpp"
 #include "glm/geometric.hpp"
@@ -14,6 +17,55 @@
 namespace
 {
 
+// 0xffff is left unused, it is the primitive restart index on the APIs that have one
+static constexpr uint32_t cMaxUint16Vertices = UINT16_MAX;
+
+static constexpr uint32_t cEmptySlot = UINT32_MAX;
+
+// how close to the miss ratio of its hard cluster a soft cluster gets before it is closed
+static constexpr float cOverdrawThreshold = 1.05f;
+
+static constexpr char cMeshFileMagic[4] = { 'T', 'N', 'M', 'S' };
+static constexpr uint32_t cMeshFileVersion = 1;
+static constexpr uint32_t cMeshFileAttributes = 16;
+// of the blobs inside the file, the mapping itself is page aligned
+static constexpr uint32_t cMeshFileAlignment = 16;
+
+static_assert(tinyngine::Attributes::Count <= cMeshFileAttributes, "the mesh file header has no room for the attributes");
+static_assert(sizeof(tinyngine::SubMesh) == 32, "the submeshes are stored as is");
+
+// Little endian, a big endian reader sees a wrong version. The attributes are stored in the encoding of VertexFormat,
+// new attribute types must be appended to keep the files valid.
+struct MeshFileHeader {
+	char mMagic[4];
+	uint32_t mVersion;
+	uint32_t mNumVertices;
+	uint32_t mNumIndices;
+	uint32_t mIndexType;
+	uint32_t mSubMeshesCount;
+	uint16_t mAttributes[cMeshFileAttributes]; // UINT16_MAX when absent
+	uint16_t mOffsets[cMeshFileAttributes];
+	uint32_t mStride;
+	float mBoundsMin[3];
+	float mBoundsMax[3];
+	// bytes from the start of the file
+	uint32_t mSubMeshesOffset;
+	uint32_t mVerticesOffset;
+	uint32_t mIndicesOffset;
+};
+
+inline uint32_t AlignMeshFileOffset(size_t offset) {
+	return static_cast<uint32_t>((offset + cMeshFileAlignment - 1) & ~static_cast<size_t>(cMeshFileAlignment - 1));
+}
+
+size_t HashIndex(const tinyngine::ObjIndex& index) {
+	uint64_t hash = static_cast<uint32_t>(index.mPosition);
+	hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(index.mNormal);
+	hash = hash * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(index.mTexcoord);
+	hash *= 0x9E3779B97F4A7C15ull;
+	return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
 void GenerateNormalsIfNeeded(tinyngine::MeshInfo& mesh) {
 	if (mesh.mNormals.size() > 0) {
 		return;
@@ -49,6 +101,47 @@ void GenerateNormalsIfNeeded(tinyngine::MeshInfo& mesh) {
 	}
 }
 
+// the blob offsets are aligned, the indices are read from the mapping as is
+template <typename T>
+uint32_t MaxIndex(const char* data, uint32_t count) {
+	const T* indices = reinterpret_cast<const T*>(data);
+	return count > 0 ? *std::max_element(indices, indices + count) : 0;
+}
+
+template <typename T>
+void RemapStream(std::vector<T>& stream, uint32_t stride, const std::vector<uint32_t>& remap, uint32_t usedCount) {
+	if (stream.empty()) {
+		return;
+	}
+	std::vector<T> remapped(static_cast<size_t>(usedCount) * stride);
+	for (size_t v = 0; v < remap.size(); v++) {
+		if (remap[v] != UINT32_MAX) {
+			std::copy(&stream[v * stride], &stream[v * stride] + stride, &remapped[static_cast<size_t>(remap[v]) * stride]);
+		}
+	}
+	stream.swap(remapped);
+}
+
+// Octahedral mapping of a normal to [-1, 1]^2, the lower hemisphere is folded over the diagonals. The shaders fold it
+// back with step(0.0, xy), zero components count as positive on both sides.
+void OctEncode(const float* normal, float encoded[2]) {
+	float length = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+	if (length == 0.0f) {
+		encoded[0] = encoded[1] = 0.0f;
+		return;
+	}
+	float x = normal[0] / length;
+	float y = normal[1] / length;
+	if (normal[2] < 0.0f) {
+		float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	encoded[0] = x;
+	encoded[1] = y;
+}
+
 }
 
 namespace tinyngine
@@ -183,67 +276,59 @@ MeshInfo MeshLoader::GenerateCube(float scale) {
 std::vector<MeshInfo> MeshLoader::LoadObj(const char* filename, bool triangulate) {
 	std::vector<MeshInfo> meshes;
 
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-
-	std::string err;
-	bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, filename, nullptr, triangulate);
-	if (ret) {
-		for (size_t i = 0; i < shapes.size(); i++) {
-			std::vector<tinyobj::index_t> vertices;
+	ObjData obj;
+	if (ParseObj(filename, triangulate, obj)) {
+		meshes.reserve(obj.GetShapesCount());
+		for (size_t i = 0; i < obj.GetShapesCount(); i++) {
+			const ObjIndex* indices = &obj.mIndices[obj.mShapeOffsets[i]];
+			size_t indicesCount = obj.mShapeOffsets[i + 1] - obj.mShapeOffsets[i];
+			std::vector<ObjIndex> vertices;
+			vertices.reserve(indicesCount);
 			MeshInfo newMesh{ 0 };
+			newMesh.mIndices.reserve(indicesCount);
 
-			size_t index_offset = 0;
-			for (size_t f = 0; f < shapes[i].mesh.num_face_vertices.size(); f++) {
-				size_t fnum = shapes[i].mesh.num_face_vertices[f];
-				for (size_t v = 0; v < fnum; v++) {
-					tinyobj::index_t thisIdx = shapes[i].mesh.indices[index_offset + v];
-					auto elem = std::find_if(std::begin(vertices), std::end(vertices), [&thisIdx](const tinyobj::index_t otherIdx) {
-						return thisIdx.vertex_index == otherIdx.vertex_index && thisIdx.normal_index == otherIdx.normal_index && thisIdx.texcoord_index == otherIdx.texcoord_index;
-					});
-					if (elem == vertices.end()) {
-						vertices.push_back(thisIdx);
-					}
-				}
-				index_offset += fnum;
+			// open addressing with linear probing, the table is kept at most half full
+			size_t tableSize = 16;
+			while (tableSize < indicesCount * 2) {
+				tableSize <<= 1;
 			}
-
-			index_offset = 0;
-			for (size_t f = 0; f < shapes[i].mesh.num_face_vertices.size(); f++) {
-				size_t fnum = shapes[i].mesh.num_face_vertices[f];
-				for (size_t v = 0; v < fnum; v++) {
-					tinyobj::index_t thisIdx = shapes[i].mesh.indices[index_offset + v];
-					for (size_t n = 0; n < vertices.size(); n++) {
-						tinyobj::index_t otherIdx = vertices[n];
-						if (thisIdx.vertex_index == otherIdx.vertex_index && thisIdx.normal_index == otherIdx.normal_index && thisIdx.texcoord_index == otherIdx.texcoord_index) {
-							newMesh.mIndices.push_back(n);
-							newMesh.mNumIndices++;
-							break;
-						}
+			std::vector<uint32_t> table(tableSize, cEmptySlot);
+			size_t tableMask = tableSize - 1;
+
+			for (size_t n = 0; n < indicesCount; n++) {
+				const ObjIndex& thisIdx = indices[n];
+				size_t slot = HashIndex(thisIdx) & tableMask;
+				while (table[slot] != cEmptySlot) {
+					const ObjIndex& otherIdx = vertices[table[slot]];
+					if (thisIdx.mPosition == otherIdx.mPosition && thisIdx.mNormal == otherIdx.mNormal && thisIdx.mTexcoord == otherIdx.mTexcoord) {
+						break;
 					}
+					slot = (slot + 1) & tableMask;
+				}
+				if (table[slot] == cEmptySlot) {
+					table[slot] = static_cast<uint32_t>(vertices.size());
+					vertices.push_back(thisIdx);
 				}
-				index_offset += fnum;
+				newMesh.mIndices.push_back(table[slot]);
 			}
-
-			int32_t numVertices = attrib.vertices.size() / 3;
-			int32_t numNormals = attrib.normals.size() / 3;
-			int32_t numTexcoords = attrib.texcoords.size() / 2;
+			newMesh.mNumIndices = static_cast<uint32_t>(newMesh.mIndices.size());
+
+			int32_t numVertices = obj.mPositions.size() / 3;
+			int32_t numNormals = obj.mNormals.size() / 3;
+			int32_t numTexcoords = obj.mTexcoords.size() / 2;
+			newMesh.mPositions.reserve(numVertices > 0 ? vertices.size() * 3 : 0);
+			newMesh.mNormals.reserve(numNormals > 0 ? vertices.size() * 3 : 0);
+			newMesh.mTexcoords.reserve(numTexcoords > 0 ? vertices.size() * 2 : 0);
 			for (size_t ii = 0; ii < vertices.size(); ii++) {
-				tinyobj::index_t idx = vertices[ii];
-				if (numVertices > 0 && idx.vertex_index < numVertices) {
-					newMesh.mPositions.push_back(attrib.vertices[3 * idx.vertex_index]);
-					newMesh.mPositions.push_back(attrib.vertices[3 * idx.vertex_index + 1]);
-					newMesh.mPositions.push_back(attrib.vertices[3 * idx.vertex_index + 2]);
+				const ObjIndex& idx = vertices[ii];
+				if (idx.mPosition >= 0 && idx.mPosition < numVertices) {
+					newMesh.mPositions.insert(newMesh.mPositions.end(), &obj.mPositions[3 * idx.mPosition], &obj.mPositions[3 * idx.mPosition] + 3);
 				}
-				if (numNormals > 0 && idx.normal_index < numNormals) {
-					newMesh.mNormals.push_back(attrib.normals[3 * idx.normal_index]);
-					newMesh.mNormals.push_back(attrib.normals[3 * idx.normal_index + 1]);
-					newMesh.mNormals.push_back(attrib.normals[3 * idx.normal_index + 2]);
+				if (idx.mNormal >= 0 && idx.mNormal < numNormals) {
+					newMesh.mNormals.insert(newMesh.mNormals.end(), &obj.mNormals[3 * idx.mNormal], &obj.mNormals[3 * idx.mNormal] + 3);
 				}
-				if (numTexcoords > 0 && idx.texcoord_index < numTexcoords) {
-					newMesh.mTexcoords.push_back(attrib.texcoords[2 * idx.texcoord_index]);
-					newMesh.mTexcoords.push_back(attrib.texcoords[2 * idx.texcoord_index + 1]);
+				if (idx.mTexcoord >= 0 && idx.mTexcoord < numTexcoords) {
+					newMesh.mTexcoords.insert(newMesh.mTexcoords.end(), &obj.mTexcoords[2 * idx.mTexcoord], &obj.mTexcoords[2 * idx.mTexcoord] + 2);
 				}
 				newMesh.mNumVertices++;
 			}
@@ -294,7 +379,7 @@ std::vector<MeshInfo> MeshLoader::LoadObj(const char* filename, bool triangulate
 			//	Log(Logger::Information, "---------------------------------------------------------------------------------");
 			//}
 
-			meshes.push_back(newMesh);
+			meshes.push_back(std::move(newMesh));
 		}
 
 		//Log(Logger::Information, "# of shapes: %d", result.numShapes);
@@ -315,4 +400,387 @@ std::vector<MeshInfo> MeshLoader::LoadObj(const char* filename, bool triangulate
 	return meshes;
 }
 
-} // namespace tinyngine
+std::vector<MeshInfo> MeshLoader::SplitForUint16Indices(const MeshInfo& mesh) const {
+	std::vector<MeshInfo> chunks;
+	if (mesh.mNumVertices <= cMaxUint16Vertices) {
+		chunks.push_back(mesh);
+		return chunks;
+	}
+
+	bool hasNormals = !mesh.mNormals.empty();
+	bool hasTexcoords = !mesh.mTexcoords.empty();
+
+	std::vector<uint32_t> remap(mesh.mNumVertices, UINT32_MAX);
+	std::vector<uint32_t> used;
+	MeshInfo chunk = MeshInfo();
+
+	auto flush = [&]() {
+		for (uint32_t vertex : used) {
+			remap[vertex] = UINT32_MAX;
+		}
+		used.clear();
+		chunk.mNumIndices = static_cast<uint32_t>(chunk.mIndices.size());
+		chunks.push_back(std::move(chunk));
+		chunk = MeshInfo();
+	};
+
+	for (uint32_t n = 0; n + 2 < mesh.mNumIndices; n += 3) {
+		uint32_t missing = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			missing += remap[mesh.mIndices[n + k]] == UINT32_MAX ? 1 : 0;
+		}
+		if (chunk.mNumVertices + missing > cMaxUint16Vertices) {
+			flush();
+		}
+
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t vertex = mesh.mIndices[n + k];
+			if (remap[vertex] == UINT32_MAX) {
+				remap[vertex] = chunk.mNumVertices++;
+				used.push_back(vertex);
+				chunk.mPositions.insert(chunk.mPositions.end(), &mesh.mPositions[vertex * 3], &mesh.mPositions[vertex * 3] + 3);
+				if (hasNormals) {
+					chunk.mNormals.insert(chunk.mNormals.end(), &mesh.mNormals[vertex * 3], &mesh.mNormals[vertex * 3] + 3);
+				}
+				if (hasTexcoords) {
+					chunk.mTexcoords.insert(chunk.mTexcoords.end(), &mesh.mTexcoords[vertex * 2], &mesh.mTexcoords[vertex * 2] + 2);
+				}
+			}
+			chunk.mIndices.push_back(remap[vertex]);
+		}
+	}
+	if (!chunk.mIndices.empty()) {
+		flush();
+	}
+	return chunks;
+}
+
+VertexCacheStats MeshLoader::AnalyzeVertexCache(const MeshInfo& mesh, uint32_t cacheSize) const {
+	return tinyngine::AnalyzeVertexCache(mesh.mIndices.data(), mesh.mNumIndices, mesh.mNumVertices, cacheSize);
+}
+
+MeshOptimizationStats MeshLoader::Optimize(MeshInfo& mesh, uint32_t cacheSize) const {
+	MeshOptimizationStats stats;
+	stats.mBefore = AnalyzeVertexCache(mesh, cacheSize);
+	stats.mAfter = stats.mBefore;
+	if (mesh.mNumIndices < 3 || mesh.mNumVertices == 0) {
+		return stats;
+	}
+	if (mesh.mNumIndices % 3 != 0 || mesh.mPositions.size() != static_cast<size_t>(mesh.mNumVertices) * 3) {
+		Log(Logger::Warning, "MeshLoader::Optimize: only triangle lists with positions can be optimized");
+		return stats;
+	}
+
+	// exported meshes are sometimes already in strips that replay better than the fans
+	std::vector<uint32_t> indices(mesh.mNumIndices);
+	tinyngine::OptimizeVertexCache(mesh.mIndices.data(), mesh.mNumIndices, mesh.mNumVertices, cacheSize, indices.data());
+	if (tinyngine::AnalyzeVertexCache(indices.data(), mesh.mNumIndices, mesh.mNumVertices, cacheSize).mACMR >= stats.mBefore.mACMR) {
+		indices = mesh.mIndices;
+	}
+	tinyngine::OptimizeOverdraw(indices.data(), mesh.mNumIndices, mesh.mPositions.data(), mesh.mNumVertices, cacheSize, cOverdrawThreshold, mesh.mIndices.data());
+
+	std::vector<uint32_t> remap;
+	uint32_t usedCount = tinyngine::OptimizeVertexFetch(mesh.mIndices.data(), mesh.mNumIndices, mesh.mNumVertices, remap);
+	RemapStream(mesh.mPositions, 3, remap, usedCount);
+	RemapStream(mesh.mNormals, 3, remap, usedCount);
+	RemapStream(mesh.mTexcoords, 2, remap, usedCount);
+	mesh.mNumVertices = usedCount;
+
+	stats.mAfter = AnalyzeVertexCache(mesh, cacheSize);
+	return stats;
+}
+
+VertexFormat MeshLoader::GetQuantizedVertexFormat(bool normals, bool texcoords) const {
+	VertexFormat vertexFormat;
+	vertexFormat.Add(Attributes::Position, AttributeType::Uint16, 3, true);
+	if (normals) {
+		vertexFormat.Add(Attributes::Normal, AttributeType::Int16, 2, true);
+	}
+	if (texcoords) {
+		vertexFormat.Add(Attributes::TexCoord0, AttributeType::Uint16, 2, true);
+	}
+	return vertexFormat;
+}
+
+PositionDequantization MeshLoader::GetPositionDequantization(const VertexFormat& vertexFormat, const float boundsMin[3], const float boundsMax[3]) const {
+	PositionDequantization dequantization;
+	if (!vertexFormat.IsValid(Attributes::Position)) {
+		return dequantization;
+	}
+	uint8_t type;
+	uint8_t count;
+	bool normalized;
+	vertexFormat.Decode(Attributes::Position, type, count, normalized);
+	if (!normalized || type == AttributeType::Float || type == AttributeType::Half) {
+		return dequantization;
+	}
+	// signed types map the bounds to [-1, 1], unsigned ones to [0, 1]
+	bool isSigned = type == AttributeType::Int16 || type == AttributeType::Int10_10_10_2;
+	for (uint32_t k = 0; k < 3; k++) {
+		float extent = boundsMax[k] - boundsMin[k];
+		dequantization.mScale[k] = isSigned ? extent * 0.5f : extent;
+		dequantization.mOffset[k] = isSigned ? boundsMin[k] + extent * 0.5f : boundsMin[k];
+	}
+	return dequantization;
+}
+
+std::vector<uint8_t> MeshLoader::Interleave(const MeshInfo& mesh, const VertexFormat& vertexFormat, Color color, const PositionDequantization& dequantization) const {
+	const float colorComponents[] = { color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f };
+	float inverseScale[3];
+	for (uint32_t k = 0; k < 3; k++) {
+		inverseScale[k] = dequantization.mScale[k] != 0.0f ? 1.0f / dequantization.mScale[k] : 0.0f;
+	}
+
+	std::vector<uint8_t> vertices(static_cast<size_t>(mesh.mNumVertices) * vertexFormat.mStride, 0);
+	for (uint8_t n = 0; n < Attributes::Count; n++) {
+		Attributes::Enum attrib = static_cast<Attributes::Enum>(n);
+		if (!vertexFormat.IsValid(attrib)) {
+			continue;
+		}
+
+		const float* src = nullptr;
+		uint8_t srcCount = 0;
+		uint8_t srcStride = 0;
+		switch (attrib) {
+		case Attributes::Position:
+			src = mesh.mPositions.empty() ? nullptr : &mesh.mPositions[0];
+			srcCount = srcStride = 3;
+			break;
+		case Attributes::Normal:
+			src = mesh.mNormals.empty() ? nullptr : &mesh.mNormals[0];
+			srcCount = srcStride = 3;
+			break;
+		case Attributes::TexCoord0:
+			src = mesh.mTexcoords.empty() ? nullptr : &mesh.mTexcoords[0];
+			srcCount = srcStride = 2;
+			break;
+		case Attributes::Color0:
+		case Attributes::Color1:
+			src = colorComponents;
+			srcCount = 4;
+			break;
+		default:
+			break;
+		}
+		if (src == nullptr) {
+			continue;
+		}
+
+		uint8_t type;
+		uint8_t count;
+		bool normalized;
+		vertexFormat.Decode(attrib, type, count, normalized);
+		// two components are not enough for a normal, they hold its octahedral encoding
+		bool octahedral = attrib == Attributes::Normal && count == 2;
+
+		uint8_t* dst = &vertices[vertexFormat.mOffset[attrib]];
+		for (uint32_t v = 0; v < mesh.mNumVertices; v++) {
+			const float* values = src + v * srcStride;
+			float transformed[4];
+			if (attrib == Attributes::Position) {
+				// w stays 1 for the packed types, which always have 4 components
+				for (uint32_t k = 0; k < 3; k++) {
+					transformed[k] = (values[k] - dequantization.mOffset[k]) * inverseScale[k];
+				}
+				transformed[3] = 1.0f;
+				vertexFormat.Write(attrib, transformed, 4, dst);
+			} else if (octahedral) {
+				OctEncode(values, transformed);
+				vertexFormat.Write(attrib, transformed, 2, dst);
+			} else {
+				vertexFormat.Write(attrib, values, srcCount, dst);
+			}
+			dst += vertexFormat.mStride;
+		}
+	}
+	return vertices;
+}
+
+bool MeshLoader::SaveMesh(const char* filename, const std::vector<MeshInfo>& meshes, const VertexFormat& vertexFormat, Color color) const {
+	MeshFileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.mMagic, cMeshFileMagic, sizeof(cMeshFileMagic));
+	header.mVersion = cMeshFileVersion;
+	std::memset(header.mAttributes, UINT16_MAX, sizeof(header.mAttributes));
+	std::memcpy(header.mAttributes, vertexFormat.mAttributes, sizeof(vertexFormat.mAttributes));
+	std::memcpy(header.mOffsets, vertexFormat.mOffset, sizeof(vertexFormat.mOffset));
+	header.mStride = vertexFormat.mStride;
+	header.mSubMeshesCount = static_cast<uint32_t>(meshes.size());
+
+	uint64_t numVertices = 0;
+	for (const MeshInfo& mesh : meshes) {
+		numVertices += mesh.mNumVertices;
+		header.mNumIndices += mesh.mNumIndices;
+	}
+	if (numVertices * vertexFormat.mStride > UINT32_MAX) {
+		Log(Logger::Error, "%s: too many vertices for a mesh file", filename);
+		return false;
+	}
+	header.mNumVertices = static_cast<uint32_t>(numVertices);
+	header.mIndexType = numVertices <= cMaxUint16Vertices ? IndexType::Uint16 : IndexType::Uint32;
+
+	std::vector<SubMesh> subMeshes;
+	std::vector<uint8_t> vertices;
+	std::vector<uint8_t> indices;
+	vertices.reserve(static_cast<size_t>(header.mNumVertices) * vertexFormat.mStride);
+	indices.reserve(static_cast<size_t>(header.mNumIndices) * (header.mIndexType == IndexType::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t)));
+	uint32_t firstIndex = 0;
+	for (const MeshInfo& mesh : meshes) {
+		SubMesh subMesh = { firstIndex, mesh.mNumIndices, { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.0f } };
+		for (size_t n = 0; n < mesh.mPositions.size(); n += 3) {
+			for (size_t k = 0; k < 3; k++) {
+				subMesh.mBoundsMin[k] = n == 0 ? mesh.mPositions[k] : std::min(subMesh.mBoundsMin[k], mesh.mPositions[n + k]);
+				subMesh.mBoundsMax[k] = n == 0 ? mesh.mPositions[k] : std::max(subMesh.mBoundsMax[k], mesh.mPositions[n + k]);
+			}
+		}
+		for (size_t k = 0; k < 3; k++) {
+			header.mBoundsMin[k] = subMeshes.empty() ? subMesh.mBoundsMin[k] : std::min(header.mBoundsMin[k], subMesh.mBoundsMin[k]);
+			header.mBoundsMax[k] = subMeshes.empty() ? subMesh.mBoundsMax[k] : std::max(header.mBoundsMax[k], subMesh.mBoundsMax[k]);
+		}
+		subMeshes.push_back(subMesh);
+		firstIndex += mesh.mNumIndices;
+	}
+
+	uint32_t firstVertex = 0;
+	// quantized positions span the bounds of the whole file, LoadMesh derives the same transform from the header
+	PositionDequantization dequantization = GetPositionDequantization(vertexFormat, header.mBoundsMin, header.mBoundsMax);
+	for (const MeshInfo& mesh : meshes) {
+		std::vector<uint8_t> meshVertices = Interleave(mesh, vertexFormat, color, dequantization);
+		vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+		for (uint32_t index : mesh.mIndices) {
+			uint32_t vertex = firstVertex + index;
+			if (header.mIndexType == IndexType::Uint16) {
+				uint16_t narrowed = static_cast<uint16_t>(vertex);
+				indices.insert(indices.end(), reinterpret_cast<const uint8_t*>(&narrowed), reinterpret_cast<const uint8_t*>(&narrowed) + sizeof(narrowed));
+			} else {
+				indices.insert(indices.end(), reinterpret_cast<const uint8_t*>(&vertex), reinterpret_cast<const uint8_t*>(&vertex) + sizeof(vertex));
+			}
+		}
+		firstVertex += mesh.mNumVertices;
+	}
+
+	header.mSubMeshesOffset = AlignMeshFileOffset(sizeof(header));
+	header.mVerticesOffset = AlignMeshFileOffset(header.mSubMeshesOffset + subMeshes.size() * sizeof(SubMesh));
+	header.mIndicesOffset = AlignMeshFileOffset(header.mVerticesOffset + vertices.size());
+
+	FILE* file = fopen(filename, "wb");
+	if (!file) {
+		Log(Logger::Error, "%s: cannot create the file", filename);
+		return false;
+	}
+	size_t written = 0;
+	auto write = [&](uint32_t offset, const void* data, size_t size) {
+		static const uint8_t padding[cMeshFileAlignment] = {};
+		bool result = written == offset || fwrite(padding, offset - written, 1, file) == 1;
+		result = result && (size == 0 || fwrite(data, size, 1, file) == 1);
+		written = offset + size;
+		return result;
+	};
+	bool result = write(0, &header, sizeof(header));
+	result = result && write(header.mSubMeshesOffset, subMeshes.data(), subMeshes.size() * sizeof(SubMesh));
+	result = result && write(header.mVerticesOffset, vertices.data(), vertices.size());
+	result = result && write(header.mIndicesOffset, indices.data(), indices.size());
+	result = fclose(file) == 0 && result;
+	if (!result) {
+		Log(Logger::Error, "%s: cannot write the file", filename);
+		remove(filename);
+	}
+	return result;
+}
+
+bool MeshLoader::ConvertObj(const char* objFilename, const char* meshFilename, const VertexFormat& vertexFormat, Color color) {
+	std::vector<MeshInfo> meshes = LoadObj(objFilename);
+	for (size_t n = 0; n < meshes.size(); n++) {
+		MeshOptimizationStats stats = Optimize(meshes[n]);
+		Log(Logger::Information, "%s: mesh %u ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", objFilename, static_cast<uint32_t>(n), stats.mBefore.mACMR, stats.mAfter.mACMR, stats.mBefore.mATVR, stats.mAfter.mATVR);
+	}
+	return !meshes.empty() && SaveMesh(meshFilename, meshes, vertexFormat, color);
+}
+
+bool MeshLoader::LoadMesh(const char* filename, GraphicsDevice& graphicsDevice, MeshBuffers& buffers) const {
+	buffers = MeshBuffers();
+	MappedFile file(filename);
+	if (!file.IsValid()) {
+		return false;
+	}
+
+	MeshFileHeader header;
+	bool valid = file.GetSize() >= sizeof(header);
+	if (valid) {
+		std::memcpy(&header, file.GetData(), sizeof(header));
+		valid = std::memcmp(header.mMagic, cMeshFileMagic, sizeof(cMeshFileMagic)) == 0;
+	}
+	if (valid && header.mVersion != cMeshFileVersion) {
+		Log(Logger::Error, "%s: mesh file version %u is not supported", filename, header.mVersion);
+		return false;
+	}
+
+	uint64_t indexSize = valid && header.mIndexType == IndexType::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	valid = valid && header.mIndexType < IndexType::Count && header.mStride > 0 && header.mStride <= UINT16_MAX;
+	valid = valid && header.mSubMeshesOffset % cMeshFileAlignment == 0 && header.mVerticesOffset % cMeshFileAlignment == 0 && header.mIndicesOffset % cMeshFileAlignment == 0;
+	valid = valid && uint64_t(header.mSubMeshesOffset) + uint64_t(header.mSubMeshesCount) * sizeof(SubMesh) <= file.GetSize();
+	valid = valid && uint64_t(header.mVerticesOffset) + uint64_t(header.mNumVertices) * header.mStride <= file.GetSize();
+	valid = valid && uint64_t(header.mIndicesOffset) + uint64_t(header.mNumIndices) * indexSize <= file.GetSize();
+	for (uint32_t n = Attributes::Count; valid && n < cMeshFileAttributes; n++) {
+		valid = header.mAttributes[n] == UINT16_MAX;
+	}
+	if (!valid) {
+		Log(Logger::Error, "%s: truncated or malformed mesh file", filename);
+		return false;
+	}
+
+	std::memcpy(buffers.mVertexFormat.mAttributes, header.mAttributes, sizeof(buffers.mVertexFormat.mAttributes));
+	std::memcpy(buffers.mVertexFormat.mOffset, header.mOffsets, sizeof(buffers.mVertexFormat.mOffset));
+	buffers.mVertexFormat.mStride = static_cast<uint16_t>(header.mStride);
+	const GraphicsCaps& caps = graphicsDevice.GetCaps();
+	for (uint8_t n = 0; n < Attributes::Count; n++) {
+		Attributes::Enum attrib = static_cast<Attributes::Enum>(n);
+		if (!buffers.mVertexFormat.IsValid(attrib)) {
+			continue;
+		}
+		uint8_t type;
+		uint8_t count;
+		bool normalized;
+		buffers.mVertexFormat.Decode(attrib, type, count, normalized);
+		if (type >= AttributeType::Count || !caps.mAttributeTypes[type]) {
+			Log(Logger::Error, "%s: the device cannot fetch the attribute type %u", filename, type);
+			buffers = MeshBuffers();
+			return false;
+		}
+	}
+	buffers.mIndexType = static_cast<IndexType::Enum>(header.mIndexType);
+	buffers.mNumVertices = header.mNumVertices;
+	buffers.mNumIndices = header.mNumIndices;
+	std::memcpy(buffers.mBoundsMin, header.mBoundsMin, sizeof(buffers.mBoundsMin));
+	std::memcpy(buffers.mBoundsMax, header.mBoundsMax, sizeof(buffers.mBoundsMax));
+	buffers.mDequantization = GetPositionDequantization(buffers.mVertexFormat, header.mBoundsMin, header.mBoundsMax);
+	buffers.mSubMeshes.resize(header.mSubMeshesCount);
+	if (header.mSubMeshesCount > 0) {
+		std::memcpy(buffers.mSubMeshes.data(), file.GetData() + header.mSubMeshesOffset, header.mSubMeshesCount * sizeof(SubMesh));
+	}
+
+	// the file is not trusted, an index past the vertices would make the device fetch out of the buffer
+	const char* indices = file.GetData() + header.mIndicesOffset;
+	uint32_t maxIndex = buffers.mIndexType == IndexType::Uint16 ? MaxIndex<uint16_t>(indices, header.mNumIndices) : MaxIndex<uint32_t>(indices, header.mNumIndices);
+	valid = header.mNumIndices == 0 || maxIndex < header.mNumVertices;
+	for (const auto& subMesh : buffers.mSubMeshes) {
+		valid = valid && uint64_t(subMesh.mFirstIndex) + subMesh.mNumIndices <= header.mNumIndices;
+	}
+	if (!valid) {
+		Log(Logger::Error, "%s: indices out of the vertices or submeshes out of the indices", filename);
+		buffers = MeshBuffers();
+		return false;
+	}
+
+	// the device reads the blobs from the mapping, or copies them once if it records for a render thread
+	buffers.mVertexBuffer = graphicsDevice.CreateVertexBuffer(file.GetData() + header.mVerticesOffset, header.mNumVertices * header.mStride, buffers.mVertexFormat);
+	buffers.mIndexBuffer = graphicsDevice.CreateIndexBuffer(file.GetData() + header.mIndicesOffset, static_cast<uint32_t>(header.mNumIndices * indexSize), buffers.mIndexType);
+	if (!buffers.mVertexBuffer.IsValid() || !buffers.mIndexBuffer.IsValid()) {
+		graphicsDevice.DestroyVertexBuffer(buffers.mVertexBuffer);
+		graphicsDevice.DestroyIndexBuffer(buffers.mIndexBuffer);
+		return false;
+	}
+	return true;
+}
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,275 @@
+#include "MeshOptimizer.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+
+// FIFO cache replay with time stamps, a vertex is in the cache while fewer than cacheSize vertices were added since
+class VertexCache final {
+public:
+	VertexCache(uint32_t verticesCount, uint32_t cacheSize) : mTimestamps(verticesCount, 0), mTime(cacheSize + 1), mCacheSize(cacheSize) {}
+
+	// returns the misses of the triangle
+	uint32_t Add(const uint32_t* triangle) {
+		uint32_t misses = 0;
+		for (uint32_t k = 0; k < 3; k++) {
+			uint32_t vertex = triangle[k];
+			if (mTime - mTimestamps[vertex] > mCacheSize) {
+				mTimestamps[vertex] = mTime++;
+				misses++;
+			}
+		}
+		return misses;
+	}
+
+	void Flush() { mTime += mCacheSize + 1; }
+
+private:
+	std::vector<uint32_t> mTimestamps;
+	uint32_t mTime;
+	uint32_t mCacheSize;
+};
+
+// triangles referencing every vertex, as offsets in a single list
+struct Adjacency {
+	Adjacency(const uint32_t* indices, uint32_t indicesCount, uint32_t verticesCount) : mCounts(verticesCount, 0), mOffsets(verticesCount + 1, 0), mTriangles(indicesCount) {
+		for (uint32_t n = 0; n < indicesCount; n++) {
+			mCounts[indices[n]]++;
+		}
+		for (uint32_t v = 0; v < verticesCount; v++) {
+			mOffsets[v + 1] = mOffsets[v] + mCounts[v];
+		}
+		std::vector<uint32_t> cursor(mOffsets.begin(), mOffsets.end() - 1);
+		for (uint32_t n = 0; n < indicesCount; n++) {
+			mTriangles[cursor[indices[n]]++] = n / 3;
+		}
+	}
+
+	std::vector<uint32_t> mCounts;
+	std::vector<uint32_t> mOffsets;
+	std::vector<uint32_t> mTriangles;
+};
+
+}
+
+namespace tinyngine
+{
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, uint32_t indicesCount, uint32_t verticesCount, uint32_t cacheSize) {
+	VertexCacheStats stats = { 0.0f, 0.0f };
+	if (indicesCount < 3 || verticesCount == 0) {
+		return stats;
+	}
+
+	VertexCache cache(verticesCount, cacheSize);
+	std::vector<bool> used(verticesCount, false);
+	uint32_t misses = 0;
+	uint32_t usedCount = 0;
+	for (uint32_t n = 0; n + 2 < indicesCount; n += 3) {
+		misses += cache.Add(indices + n);
+		for (uint32_t k = 0; k < 3; k++) {
+			usedCount += used[indices[n + k]] ? 0 : 1;
+			used[indices[n + k]] = true;
+		}
+	}
+	stats.mACMR = static_cast<float>(misses) / static_cast<float>(indicesCount / 3);
+	stats.mATVR = static_cast<float>(misses) / static_cast<float>(usedCount);
+	return stats;
+}
+
+void OptimizeVertexCache(const uint32_t* indices, uint32_t indicesCount, uint32_t verticesCount, uint32_t cacheSize, uint32_t* destination) {
+	TINYNGINE_PROFILE_SCOPE("OptimizeVertexCache");
+	if (indicesCount < 3 || verticesCount == 0) {
+		return;
+	}
+	uint32_t trianglesCount = indicesCount / 3;
+	Adjacency adjacency(indices, trianglesCount * 3, verticesCount);
+	std::vector<uint32_t>& liveTriangles = adjacency.mCounts;
+	std::vector<uint32_t> timestamps(verticesCount, 0);
+	std::vector<bool> emitted(trianglesCount, false);
+	// vertices of the emitted triangles, the ones of the last fan are the candidates for the next one
+	std::vector<uint32_t> deadEnd;
+	deadEnd.reserve(trianglesCount * 3);
+
+	uint32_t time = cacheSize + 1;
+	uint32_t cursor = 0;
+	uint32_t written = 0;
+	uint32_t fanVertex = 0;
+	while (fanVertex != UINT32_MAX) {
+		size_t candidatesBegin = deadEnd.size();
+		for (uint32_t n = adjacency.mOffsets[fanVertex]; n < adjacency.mOffsets[fanVertex + 1]; n++) {
+			uint32_t triangle = adjacency.mTriangles[n];
+			if (emitted[triangle]) {
+				continue;
+			}
+			for (uint32_t k = 0; k < 3; k++) {
+				uint32_t vertex = indices[triangle * 3 + k];
+				destination[written++] = vertex;
+				deadEnd.push_back(vertex);
+				liveTriangles[vertex]--;
+				if (time - timestamps[vertex] > cacheSize) {
+					timestamps[vertex] = time++;
+				}
+			}
+			emitted[triangle] = true;
+		}
+
+		// the candidate still in the cache once its remaining triangles are emitted, preferring the oldest one
+		fanVertex = UINT32_MAX;
+		int64_t bestPriority = -1;
+		for (size_t n = candidatesBegin; n < deadEnd.size(); n++) {
+			uint32_t vertex = deadEnd[n];
+			if (liveTriangles[vertex] == 0) {
+				continue;
+			}
+			int64_t priority = 0;
+			if (time - timestamps[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+				priority = time - timestamps[vertex];
+			}
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				fanVertex = vertex;
+			}
+		}
+
+		// dead end: back to the most recent vertex with triangles left, then to the first one in input order
+		while (fanVertex == UINT32_MAX && !deadEnd.empty()) {
+			uint32_t vertex = deadEnd.back();
+			deadEnd.pop_back();
+			fanVertex = liveTriangles[vertex] > 0 ? vertex : UINT32_MAX;
+		}
+		for (; fanVertex == UINT32_MAX && cursor < verticesCount; cursor++) {
+			fanVertex = liveTriangles[cursor] > 0 ? cursor : UINT32_MAX;
+		}
+	}
+}
+
+void OptimizeOverdraw(const uint32_t* indices, uint32_t indicesCount, const float* positions, uint32_t verticesCount, uint32_t cacheSize, float threshold, uint32_t* destination) {
+	TINYNGINE_PROFILE_SCOPE("OptimizeOverdraw");
+	uint32_t trianglesCount = indicesCount / 3;
+	if (trianglesCount == 0 || verticesCount == 0) {
+		return;
+	}
+
+	// hard boundaries where the cache has nothing of the triangle, the first triangle always starts a cluster even
+	// when it is degenerate and misses less than 3 times
+	std::vector<uint32_t> hardClusters(1, 0);
+	VertexCache cache(verticesCount, cacheSize);
+	for (uint32_t t = 0; t < trianglesCount; t++) {
+		if (cache.Add(indices + t * 3) == 3 && t > 0) {
+			hardClusters.push_back(t);
+		}
+	}
+	hardClusters.push_back(trianglesCount);
+
+	// soft boundaries as soon as the running miss ratio is as good as the one of the whole hard cluster
+	std::vector<uint32_t> clusters;
+	for (size_t c = 0; c + 1 < hardClusters.size(); c++) {
+		uint32_t first = hardClusters[c];
+		uint32_t last = hardClusters[c + 1];
+
+		cache.Flush();
+		uint32_t clusterMisses = 0;
+		for (uint32_t t = first; t < last; t++) {
+			clusterMisses += cache.Add(indices + t * 3);
+		}
+		float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(last - first);
+
+		size_t clusterStart = clusters.size();
+		clusters.push_back(first);
+		cache.Flush();
+		uint32_t misses = 0;
+		uint32_t triangles = 0;
+		for (uint32_t t = first; t < last; t++) {
+			misses += cache.Add(indices + t * 3);
+			triangles++;
+			if (t + 1 < last && static_cast<float>(misses) <= clusterThreshold * static_cast<float>(triangles)) {
+				clusters.push_back(t + 1);
+				cache.Flush();
+				misses = 0;
+				triangles = 0;
+			}
+		}
+		// the tail rarely reaches the ratio, it joins the cluster before it
+		if (triangles > 0 && clusters.size() > clusterStart + 1) {
+			clusters.pop_back();
+		}
+	}
+	size_t clustersCount = clusters.size();
+	clusters.push_back(trianglesCount);
+
+	auto position = [positions](uint32_t vertex, uint32_t k) { return positions[vertex * 3 + k]; };
+	float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t n = 0; n < trianglesCount * 3; n++) {
+		for (uint32_t k = 0; k < 3; k++) {
+			meshCenter[k] += position(indices[n], k);
+		}
+	}
+	for (uint32_t k = 0; k < 3; k++) {
+		meshCenter[k] /= static_cast<float>(trianglesCount * 3);
+	}
+
+	// area weighted center and normal of every cluster
+	std::vector<float> sortKeys(clustersCount);
+	for (size_t c = 0; c < clustersCount; c++) {
+		float center[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float area = 0.0f;
+		for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+			const uint32_t* triangle = indices + t * 3;
+			float edge0[3], edge1[3];
+			for (uint32_t k = 0; k < 3; k++) {
+				edge0[k] = position(triangle[1], k) - position(triangle[0], k);
+				edge1[k] = position(triangle[2], k) - position(triangle[0], k);
+			}
+			float faceNormal[3] = {
+				edge0[1] * edge1[2] - edge0[2] * edge1[1],
+				edge0[2] * edge1[0] - edge0[0] * edge1[2],
+				edge0[0] * edge1[1] - edge0[1] * edge1[0],
+			};
+			float faceArea = std::sqrt(faceNormal[0] * faceNormal[0] + faceNormal[1] * faceNormal[1] + faceNormal[2] * faceNormal[2]);
+			for (uint32_t k = 0; k < 3; k++) {
+				center[k] += (position(triangle[0], k) + position(triangle[1], k) + position(triangle[2], k)) * (faceArea / 3.0f);
+				normal[k] += faceNormal[k];
+			}
+			area += faceArea;
+		}
+		float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float key = 0.0f;
+		for (uint32_t k = 0; k < 3; k++) {
+			float offset = area > 0.0f ? center[k] / area - meshCenter[k] : 0.0f;
+			key += normalLength > 0.0f ? offset * normal[k] / normalLength : 0.0f;
+		}
+		sortKeys[c] = key;
+	}
+
+	std::vector<uint32_t> order(clustersCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	uint32_t written = 0;
+	for (uint32_t c : order) {
+		for (uint32_t n = clusters[c] * 3; n < clusters[c + 1] * 3; n++) {
+			destination[written++] = indices[n];
+		}
+	}
+}
+
+uint32_t OptimizeVertexFetch(uint32_t* indices, uint32_t indicesCount, uint32_t verticesCount, std::vector<uint32_t>& remap) {
+	remap.assign(verticesCount, UINT32_MAX);
+	uint32_t usedCount = 0;
+	for (uint32_t n = 0; n < indicesCount; n++) {
+		uint32_t& vertex = remap[indices[n]];
+		if (vertex == UINT32_MAX) {
+			vertex = usedCount++;
+		}
+		indices[n] = vertex;
+	}
+	return usedCount;
+}
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace tinyngine
+{
+
+// Misses of a FIFO post-transform cache of cacheSize vertices replaying the triangle list.
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, uint32_t indicesCount, uint32_t verticesCount, uint32_t cacheSize);
+
+// Tipsify (Sander et al. 2007): triangles are emitted as fans around the vertex that keeps the most of the cache alive.
+void OptimizeVertexCache(const uint32_t* indices, uint32_t indicesCount, uint32_t verticesCount, uint32_t cacheSize, uint32_t* destination);
+
+// Splits a cache optimized triangle list into clusters, at the triangles missing the cache on all their vertices and
+// where the running miss ratio gets within threshold of the one of the cluster, then draws first the clusters facing
+// away from the center of the mesh, which tend to occlude the others. positions has a stride of 3.
+void OptimizeOverdraw(const uint32_t* indices, uint32_t indicesCount, const float* positions, uint32_t verticesCount, uint32_t cacheSize, float threshold, uint32_t* destination);
+
+// Renumbers the vertices in the order the indices first reference them, remap gets the new place of every vertex or
+// UINT32_MAX for the unused ones. Returns the number of used vertices.
+uint32_t OptimizeVertexFetch(uint32_t* indices, uint32_t indicesCount, uint32_t verticesCount, std::vector<uint32_t>& remap);
+
+} // namespace tinyngine
\ No newline at end of file
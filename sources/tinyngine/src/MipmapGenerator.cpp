@@ -0,0 +1,239 @@
+#include "MipmapGenerator.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TINYNGINE_MIP_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TINYNGINE_MIP_NEON 1
+#endif
+
+namespace
+{
+
+static constexpr uint32_t cSrgbTableSize = 4096;
+static constexpr uint32_t cKaiserTaps = 6;
+static constexpr float cKaiserAlpha = 4.0f;
+static constexpr uint32_t cMaxThreads = 8;
+// smaller levels are not worth a thread
+static constexpr uint32_t cTexelsPerThread = 64 * 1024;
+
+// Texels are filtered as 4 linear floats, a single vector.
+#if defined(TINYNGINE_MIP_SSE2)
+using Texel = __m128;
+inline Texel TexelLoad(const float* texel) { return _mm_loadu_ps(texel); }
+inline void TexelStore(float* texel, Texel value) { _mm_storeu_ps(texel, value); }
+inline Texel TexelZero() { return _mm_setzero_ps(); }
+inline Texel TexelAdd(Texel a, Texel b) { return _mm_add_ps(a, b); }
+inline Texel TexelScale(Texel a, float scale) { return _mm_mul_ps(a, _mm_set1_ps(scale)); }
+inline Texel TexelMulAdd(Texel sum, Texel a, float scale) { return _mm_add_ps(sum, _mm_mul_ps(a, _mm_set1_ps(scale))); }
+#elif defined(TINYNGINE_MIP_NEON)
+using Texel = float32x4_t;
+inline Texel TexelLoad(const float* texel) { return vld1q_f32(texel); }
+inline void TexelStore(float* texel, Texel value) { vst1q_f32(texel, value); }
+inline Texel TexelZero() { return vdupq_n_f32(0.0f); }
+inline Texel TexelAdd(Texel a, Texel b) { return vaddq_f32(a, b); }
+inline Texel TexelScale(Texel a, float scale) { return vmulq_n_f32(a, scale); }
+inline Texel TexelMulAdd(Texel sum, Texel a, float scale) { return vmlaq_n_f32(sum, a, scale); }
+#else
+struct Texel {
+	float mValues[4];
+};
+inline Texel TexelLoad(const float* texel) { return Texel{ { texel[0], texel[1], texel[2], texel[3] } }; }
+inline void TexelStore(float* texel, Texel value) { std::copy(value.mValues, value.mValues + 4, texel); }
+inline Texel TexelZero() { return Texel{ { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+inline Texel TexelAdd(Texel a, Texel b) { return Texel{ { a.mValues[0] + b.mValues[0], a.mValues[1] + b.mValues[1], a.mValues[2] + b.mValues[2], a.mValues[3] + b.mValues[3] } }; }
+inline Texel TexelScale(Texel a, float scale) { return Texel{ { a.mValues[0] * scale, a.mValues[1] * scale, a.mValues[2] * scale, a.mValues[3] * scale } }; }
+inline Texel TexelMulAdd(Texel sum, Texel a, float scale) { return TexelAdd(sum, TexelScale(a, scale)); }
+#endif
+
+struct FilterTables {
+	float mToLinear[256];
+	uint8_t mToSrgb[cSrgbTableSize];
+	float mKaiserWeights[cKaiserTaps];
+};
+
+// modified Bessel function of the first kind, order 0
+float BesselI0(float x) {
+	float sum = 1.0f;
+	float term = 1.0f;
+	for (uint32_t k = 1; k < 20; k++) {
+		term *= (x * 0.5f) / k;
+		sum += term * term;
+	}
+	return sum;
+}
+
+FilterTables BuildFilterTables() {
+	FilterTables tables;
+	for (uint32_t n = 0; n < 256; n++) {
+		float value = n / 255.0f;
+		tables.mToLinear[n] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+	for (uint32_t n = 0; n < cSrgbTableSize; n++) {
+		float value = static_cast<float>(n) / (cSrgbTableSize - 1);
+		float srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+		tables.mToSrgb[n] = static_cast<uint8_t>(std::min(std::max(srgb, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+	// Kaiser windowed sinc halving the frequency, the taps sit half a texel away from the center of the
+	// destination texel
+	const float radius = cKaiserTaps * 0.5f;
+	const float pi = 3.14159265358979f;
+	float sum = 0.0f;
+	for (uint32_t tap = 0; tap < cKaiserTaps; tap++) {
+		float distance = std::fabs(tap + 0.5f - radius);
+		float x = distance * 0.5f;
+		float sinc = std::sin(pi * x) / (pi * x);
+		float ratio = distance / radius;
+		float window = BesselI0(cKaiserAlpha * std::sqrt(std::max(1.0f - ratio * ratio, 0.0f))) / BesselI0(cKaiserAlpha);
+		tables.mKaiserWeights[tap] = sinc * window;
+		sum += tables.mKaiserWeights[tap];
+	}
+	for (auto& weight : tables.mKaiserWeights) {
+		weight /= sum;
+	}
+	return tables;
+}
+
+const FilterTables& GetFilterTables() {
+	static const FilterTables tables = BuildFilterTables();
+	return tables;
+}
+
+template<typename Func>
+void ParallelRows(uint32_t rows, uint32_t rowTexels, Func func) {
+	uint32_t threadsCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), cMaxThreads);
+	threadsCount = std::min(threadsCount, std::max(rows * rowTexels / cTexelsPerThread, 1u));
+	uint32_t step = (rows + threadsCount - 1) / threadsCount;
+	std::vector<std::thread> threads;
+	for (uint32_t first = step; first < rows; first += step) {
+		threads.emplace_back(func, first, std::min(first + step, rows));
+	}
+	func(0, std::min(step, rows));
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+void BoxRows(const float* source, uint32_t sourceWidth, uint32_t sourceHeight, float* destination, uint32_t width, uint32_t firstRow, uint32_t lastRow) {
+	for (uint32_t y = firstRow; y < lastRow; y++) {
+		const float* row0 = source + static_cast<size_t>(std::min(y * 2, sourceHeight - 1)) * sourceWidth * 4;
+		const float* row1 = source + static_cast<size_t>(std::min(y * 2 + 1, sourceHeight - 1)) * sourceWidth * 4;
+		float* texel = destination + static_cast<size_t>(y) * width * 4;
+		for (uint32_t x = 0; x < width; x++, texel += 4) {
+			uint32_t x0 = std::min(x * 2, sourceWidth - 1) * 4;
+			uint32_t x1 = std::min(x * 2 + 1, sourceWidth - 1) * 4;
+			Texel sum = TexelAdd(TexelAdd(TexelLoad(row0 + x0), TexelLoad(row0 + x1)), TexelAdd(TexelLoad(row1 + x0), TexelLoad(row1 + x1)));
+			TexelStore(texel, TexelScale(sum, 0.25f));
+		}
+	}
+}
+
+// halves the width of the rows
+void KaiserColumns(const float* source, uint32_t sourceWidth, float* destination, uint32_t width, const float* weights, uint32_t firstRow, uint32_t lastRow) {
+	for (uint32_t y = firstRow; y < lastRow; y++) {
+		const float* row = source + static_cast<size_t>(y) * sourceWidth * 4;
+		float* texel = destination + static_cast<size_t>(y) * width * 4;
+		for (uint32_t x = 0; x < width; x++, texel += 4) {
+			Texel sum = TexelZero();
+			for (uint32_t tap = 0; tap < cKaiserTaps; tap++) {
+				int32_t sourceX = std::min(std::max(static_cast<int32_t>(x * 2 + tap) - static_cast<int32_t>(cKaiserTaps / 2 - 1), 0), static_cast<int32_t>(sourceWidth) - 1);
+				sum = TexelMulAdd(sum, TexelLoad(row + sourceX * 4), weights[tap]);
+			}
+			TexelStore(texel, sum);
+		}
+	}
+}
+
+// halves the height of the columns
+void KaiserRows(const float* source, uint32_t sourceHeight, float* destination, uint32_t width, const float* weights, uint32_t firstRow, uint32_t lastRow) {
+	for (uint32_t y = firstRow; y < lastRow; y++) {
+		float* texel = destination + static_cast<size_t>(y) * width * 4;
+		for (uint32_t x = 0; x < width; x++, texel += 4) {
+			Texel sum = TexelZero();
+			for (uint32_t tap = 0; tap < cKaiserTaps; tap++) {
+				int32_t sourceY = std::min(std::max(static_cast<int32_t>(y * 2 + tap) - static_cast<int32_t>(cKaiserTaps / 2 - 1), 0), static_cast<int32_t>(sourceHeight) - 1);
+				sum = TexelMulAdd(sum, TexelLoad(source + (static_cast<size_t>(sourceY) * width + x) * 4), weights[tap]);
+			}
+			TexelStore(texel, sum);
+		}
+	}
+}
+
+}
+
+namespace tinyngine
+{
+
+uint32_t GetMipmapsCount(uint32_t width, uint32_t height) {
+	uint32_t count = 1;
+	while ((std::max(width, height) >> count) > 0) {
+		count++;
+	}
+	return count;
+}
+
+size_t GetMipmapsSize(uint32_t width, uint32_t height, uint32_t channels) {
+	size_t size = 0;
+	for (uint32_t level = 1; level < GetMipmapsCount(width, height); level++) {
+		size += static_cast<size_t>(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * channels;
+	}
+	return size;
+}
+
+void GenerateMipmaps(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, MipmapFilter::Enum filter, bool srgb, uint8_t* levels) {
+	TINYNGINE_PROFILE_SCOPE("GenerateMipmaps");
+	const FilterTables& tables = GetFilterTables();
+	// gray or RGB, the last channel of 2 and 4 channels images is alpha
+	const uint32_t colorChannels = srgb ? (channels >= 3 ? 3 : 1) : 0;
+
+	std::vector<float> source(static_cast<size_t>(width) * height * 4, 0.0f);
+	for (size_t n = 0; n < static_cast<size_t>(width) * height; n++) {
+		for (uint32_t c = 0; c < channels; c++) {
+			uint8_t value = pixels[n * channels + c];
+			source[n * 4 + c] = c < colorChannels ? tables.mToLinear[value] : value * (1.0f / 255.0f);
+		}
+	}
+
+	std::vector<float> destination;
+	std::vector<float> columns;
+	uint32_t sourceWidth = width;
+	uint32_t sourceHeight = height;
+	for (uint32_t level = 1; level < GetMipmapsCount(width, height); level++) {
+		uint32_t levelWidth = std::max(sourceWidth >> 1, 1u);
+		uint32_t levelHeight = std::max(sourceHeight >> 1, 1u);
+		destination.resize(static_cast<size_t>(levelWidth) * levelHeight * 4);
+		if (filter == MipmapFilter::Kaiser) {
+			columns.resize(static_cast<size_t>(levelWidth) * sourceHeight * 4);
+			ParallelRows(sourceHeight, levelWidth, [&](uint32_t first, uint32_t last) {
+				KaiserColumns(source.data(), sourceWidth, columns.data(), levelWidth, tables.mKaiserWeights, first, last);
+			});
+			ParallelRows(levelHeight, levelWidth, [&](uint32_t first, uint32_t last) {
+				KaiserRows(columns.data(), sourceHeight, destination.data(), levelWidth, tables.mKaiserWeights, first, last);
+			});
+		} else {
+			ParallelRows(levelHeight, levelWidth, [&](uint32_t first, uint32_t last) {
+				BoxRows(source.data(), sourceWidth, sourceHeight, destination.data(), levelWidth, first, last);
+			});
+		}
+
+		// the Kaiser lobes can overshoot
+		for (size_t n = 0; n < static_cast<size_t>(levelWidth) * levelHeight; n++) {
+			for (uint32_t c = 0; c < channels; c++) {
+				float value = std::min(std::max(destination[n * 4 + c], 0.0f), 1.0f);
+				*levels++ = c < colorChannels ? tables.mToSrgb[static_cast<uint32_t>(value * (cSrgbTableSize - 1) + 0.5f)] : static_cast<uint8_t>(value * 255.0f + 0.5f);
+			}
+		}
+		source.swap(destination);
+		sourceWidth = levelWidth;
+		sourceHeight = levelHeight;
+	}
+}
+
+} // namespace tinyngine
\ No newline at end of file
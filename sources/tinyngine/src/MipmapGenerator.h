@@ -0,0 +1,20 @@
+#pragma once
+
+#include "ImageManager.h"
+
+#include <cstddef>
+
+namespace tinyngine
+{
+
+// levels of a complete chain, down to 1x1
+uint32_t GetMipmapsCount(uint32_t width, uint32_t height);
+// bytes of the levels 1 and above of an 8 bit image
+size_t GetMipmapsSize(uint32_t width, uint32_t height, uint32_t channels);
+
+// Builds the levels 1 and above of an 8 bit image of 1 to 4 channels into levels, packed one after the other. Texels
+// are filtered in linear space: the color channels are decoded from sRGB unless srgb is false, alpha is always
+// linear. The rows of the large levels are split across threads.
+void GenerateMipmaps(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, MipmapFilter::Enum filter, bool srgb, uint8_t* levels);
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,383 @@
+#include "ObjParser.h"
+#include "Log.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+
+static constexpr uint32_t cMaxThreads = 8;
+// smaller files are not worth a thread
+static constexpr size_t cBytesPerChunk = 1 << 20;
+// significant digits that fit a uint64_t mantissa
+static constexpr int cMaxMantissaDigits = 19;
+
+// exactly representable as floats, a mantissa up to 2^24 scaled by one of them is rounded once, to the float
+static constexpr float cFloatPowersOf10[] = {
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+};
+static constexpr int cMaxExactFloatPower = static_cast<int>(sizeof(cFloatPowersOf10) / sizeof(cFloatPowersOf10[0])) - 1;
+
+// exactly representable as doubles, a mantissa up to 2^53 scaled by one of them is a correctly rounded double
+static constexpr double cPowersOf10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+static constexpr int cMaxExactPower = static_cast<int>(sizeof(cPowersOf10) / sizeof(cPowersOf10[0])) - 1;
+
+struct ObjChunk {
+	const char* mBegin;
+	const char* mEnd;
+	// mShapeOffsets holds the index counts at the g and o lines of the chunk
+	tinyngine::ObjData mData;
+	// (index << 3) | mask of the face vertex components given relative to the end of the chunk lists
+	std::vector<uint32_t> mRelative;
+	bool mValid = true;
+};
+
+// the \r of \r\n line breaks is trailing space
+inline bool IsSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool IsDigit(char c) {
+	return static_cast<unsigned char>(c - '0') < 10;
+}
+
+inline const char* SkipSpaces(const char* p, const char* end) {
+	while (p < end && IsSpace(*p)) {
+		p++;
+	}
+	return p;
+}
+
+inline const char* SkipToken(const char* p, const char* end) {
+	while (p < end && !IsSpace(*p)) {
+		p++;
+	}
+	return p;
+}
+
+// [sign] digits [. digits] [(e|E) [sign] digits], the decimal point is never taken from the locale. Correctly
+// rounded up to 7 significant digits with a power of ten up to 10, which covers the usual OBJ coordinates. Other
+// numbers go through a double, rounded again to a float, and are within 1 ULP.
+bool ParseFloat(const char*& p, const char* end, float& value) {
+	bool negative = false;
+	if (p < end && (*p == '+' || *p == '-')) {
+		negative = *p == '-';
+		p++;
+	}
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool any = false;
+	for (; p < end && IsDigit(*p); p++) {
+		any = true;
+		if (digits < cMaxMantissaDigits) {
+			mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+			digits += mantissa != 0 ? 1 : 0;
+		} else {
+			exponent++;
+		}
+	}
+	if (p < end && *p == '.') {
+		for (p++; p < end && IsDigit(*p); p++) {
+			any = true;
+			if (digits < cMaxMantissaDigits) {
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+				digits += mantissa != 0 ? 1 : 0;
+				exponent--;
+			}
+		}
+	}
+	if (!any) {
+		return false;
+	}
+
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		bool negativeExponent = false;
+		if (p < end && (*p == '+' || *p == '-')) {
+			negativeExponent = *p == '-';
+			p++;
+		}
+		if (p == end || !IsDigit(*p)) {
+			return false;
+		}
+		int written = 0;
+		for (; p < end && IsDigit(*p); p++) {
+			written = std::min(written * 10 + (*p - '0'), 10000);
+		}
+		exponent += negativeExponent ? -written : written;
+	}
+
+	if (mantissa <= (1ull << 24) && exponent >= -cMaxExactFloatPower && exponent <= cMaxExactFloatPower) {
+		float exact = static_cast<float>(mantissa);
+		exact = exponent < 0 ? exact / cFloatPowersOf10[-exponent] : exact * cFloatPowersOf10[exponent];
+		value = negative ? -exact : exact;
+		return true;
+	}
+
+	double result = static_cast<double>(mantissa);
+	if (mantissa <= (1ull << 53) && exponent >= -cMaxExactPower && exponent <= cMaxExactPower) {
+		result = exponent < 0 ? result / cPowersOf10[-exponent] : result * cPowersOf10[exponent];
+	} else if (mantissa != 0) {
+		result *= std::pow(10.0, exponent);
+	}
+	value = static_cast<float>(negative ? -result : result);
+	return true;
+}
+
+// components missing or not parsed read as 0
+const char* ParseFloats(const char* p, const char* end, float* values, uint32_t count) {
+	for (uint32_t n = 0; n < count; n++) {
+		p = SkipSpaces(p, end);
+		if (!ParseFloat(p, end, values[n])) {
+			values[n] = 0.0f;
+		}
+		p = SkipToken(p, end);
+	}
+	return p;
+}
+
+// 1 based or negative relative to the end of the list, 0 is not a valid index
+bool ParseIndex(const char*& p, const char* end, uint32_t count, int32_t& index, bool& relative) {
+	bool negative = false;
+	if (p < end && (*p == '+' || *p == '-')) {
+		negative = *p == '-';
+		p++;
+	}
+	int64_t value = 0;
+	for (; p < end && IsDigit(*p); p++) {
+		value = std::min<int64_t>(value * 10 + (*p - '0'), INT32_MAX);
+	}
+	while (p < end && *p != '/' && !IsSpace(*p)) {
+		p++;
+	}
+	if (value == 0) {
+		return false;
+	}
+	relative = negative;
+	index = negative ? static_cast<int32_t>(count - value) : static_cast<int32_t>(value - 1);
+	return true;
+}
+
+// v, v/t, v//n or v/t/n, relative is a mask of the components given relative to the end of their list
+bool ParseFaceVertex(const char*& p, const char* end, const tinyngine::ObjData& data, tinyngine::ObjIndex& index, uint32_t& relative) {
+	index = { -1, -1, -1 };
+	relative = 0;
+	bool isRelative = false;
+	if (!ParseIndex(p, end, static_cast<uint32_t>(data.mPositions.size() / 3), index.mPosition, isRelative)) {
+		return false;
+	}
+	relative |= isRelative ? 1 : 0;
+	if (p == end || *p != '/') {
+		return true;
+	}
+	p++;
+	if (p == end || *p != '/') {
+		if (!ParseIndex(p, end, static_cast<uint32_t>(data.mTexcoords.size() / 2), index.mTexcoord, isRelative)) {
+			return false;
+		}
+		relative |= isRelative ? 2 : 0;
+		if (p == end || *p != '/') {
+			return true;
+		}
+	}
+	p++;
+	if (!ParseIndex(p, end, static_cast<uint32_t>(data.mNormals.size() / 3), index.mNormal, isRelative)) {
+		return false;
+	}
+	relative |= isRelative ? 4 : 0;
+	return true;
+}
+
+void ParseChunk(ObjChunk& chunk, bool triangulate) {
+	tinyngine::ObjData& data = chunk.mData;
+	std::vector<tinyngine::ObjIndex> face;
+	std::vector<uint32_t> faceRelative;
+
+	auto addIndex = [&](size_t vertex) {
+		if (faceRelative[vertex] != 0) {
+			chunk.mRelative.push_back(static_cast<uint32_t>(data.mIndices.size() << 3) | faceRelative[vertex]);
+		}
+		data.mIndices.push_back(face[vertex]);
+	};
+
+	const char* line = chunk.mBegin;
+	while (line < chunk.mEnd) {
+		const char* end = static_cast<const char*>(std::memchr(line, '\n', chunk.mEnd - line));
+		end = end ? end : chunk.mEnd;
+		const char* p = SkipSpaces(line, end);
+		line = end + 1;
+		if (end - p < 2) {
+			continue;
+		}
+
+		float values[3];
+		if (p[0] == 'v' && IsSpace(p[1])) {
+			ParseFloats(p + 2, end, values, 3);
+			data.mPositions.push_back(values[0]);
+			data.mPositions.push_back(values[1]);
+			data.mPositions.push_back(values[2]);
+		} else if (p[0] == 'v' && p[1] == 'n' && end - p > 2 && IsSpace(p[2])) {
+			ParseFloats(p + 3, end, values, 3);
+			data.mNormals.push_back(values[0]);
+			data.mNormals.push_back(values[1]);
+			data.mNormals.push_back(values[2]);
+		} else if (p[0] == 'v' && p[1] == 't' && end - p > 2 && IsSpace(p[2])) {
+			ParseFloats(p + 3, end, values, 2);
+			data.mTexcoords.push_back(values[0]);
+			data.mTexcoords.push_back(values[1]);
+		} else if (p[0] == 'f' && IsSpace(p[1])) {
+			face.clear();
+			faceRelative.clear();
+			for (p = SkipSpaces(p + 2, end); p < end; p = SkipSpaces(p, end)) {
+				tinyngine::ObjIndex index;
+				uint32_t relative;
+				if (!ParseFaceVertex(p, end, data, index, relative)) {
+					chunk.mValid = false;
+					return;
+				}
+				face.push_back(index);
+				faceRelative.push_back(relative);
+			}
+			if (triangulate) {
+				for (size_t n = 2; n < face.size(); n++) {
+					addIndex(0);
+					addIndex(n - 1);
+					addIndex(n);
+				}
+			} else {
+				for (size_t n = 0; n < face.size(); n++) {
+					addIndex(n);
+				}
+			}
+		} else if ((p[0] == 'g' || p[0] == 'o') && IsSpace(p[1])) {
+			data.mShapeOffsets.push_back(static_cast<uint32_t>(data.mIndices.size()));
+		}
+	}
+}
+
+template <typename Func>
+void ParallelChunks(size_t count, Func func) {
+	std::vector<std::thread> threads;
+	for (size_t n = 1; n < count; n++) {
+		threads.emplace_back(func, n);
+	}
+	if (count > 0) {
+		func(0);
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+template <typename T>
+void CopyInto(const std::vector<T>& source, std::vector<T>& destination, size_t offset) {
+	if (!source.empty()) {
+		std::memcpy(&destination[offset], source.data(), source.size() * sizeof(T));
+	}
+}
+
+}
+
+namespace tinyngine
+{
+
+bool ParseObj(const char* filename, bool triangulate, ObjData& data) {
+	TINYNGINE_PROFILE_SCOPE("ParseObj");
+	data = ObjData();
+
+	MappedFile file(filename);
+	if (!file.IsValid()) {
+		Log(Logger::Error, "%s: cannot open the file", filename);
+		return false;
+	}
+
+	const char* begin = file.GetData();
+	const char* end = begin + file.GetSize();
+	size_t chunksCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), cMaxThreads);
+	chunksCount = std::min(chunksCount, std::max(file.GetSize() / cBytesPerChunk, size_t(1)));
+
+	// every chunk but the first starts after the line break closest to its nominal start
+	std::vector<ObjChunk> chunks(chunksCount);
+	for (size_t n = 0; n < chunksCount; n++) {
+		const char* chunkBegin = begin;
+		if (n > 0) {
+			chunkBegin = std::max(begin + file.GetSize() * n / chunksCount, chunks[n - 1].mBegin);
+			const char* lineBreak = static_cast<const char*>(std::memchr(chunkBegin, '\n', end - chunkBegin));
+			chunkBegin = lineBreak ? lineBreak + 1 : end;
+		}
+		chunks[n].mBegin = chunkBegin;
+		if (n > 0) {
+			chunks[n - 1].mEnd = chunkBegin;
+		}
+	}
+	if (chunksCount > 0) {
+		chunks.back().mEnd = end;
+	}
+
+	ParallelChunks(chunksCount, [&](size_t n) {
+		TINYNGINE_PROFILE_SCOPE("ParseObjChunk");
+		ParseChunk(chunks[n], triangulate);
+	});
+
+	// prefix sums of the list sizes give the place of every chunk in the merged lists
+	std::vector<size_t> positionsBase(chunksCount + 1, 0), normalsBase(chunksCount + 1, 0), texcoordsBase(chunksCount + 1, 0), indicesBase(chunksCount + 1, 0);
+	for (size_t n = 0; n < chunksCount; n++) {
+		if (!chunks[n].mValid) {
+			Log(Logger::Error, "%s: invalid face, indices start at 1", filename);
+			return false;
+		}
+		const ObjData& chunkData = chunks[n].mData;
+		positionsBase[n + 1] = positionsBase[n] + chunkData.mPositions.size();
+		normalsBase[n + 1] = normalsBase[n] + chunkData.mNormals.size();
+		texcoordsBase[n + 1] = texcoordsBase[n] + chunkData.mTexcoords.size();
+		indicesBase[n + 1] = indicesBase[n] + chunkData.mIndices.size();
+	}
+	if (indicesBase[chunksCount] > UINT32_MAX) {
+		Log(Logger::Error, "%s: too many face vertices", filename);
+		return false;
+	}
+
+	data.mPositions.resize(positionsBase[chunksCount]);
+	data.mNormals.resize(normalsBase[chunksCount]);
+	data.mTexcoords.resize(texcoordsBase[chunksCount]);
+	data.mIndices.resize(indicesBase[chunksCount]);
+	ParallelChunks(chunksCount, [&](size_t n) {
+		ObjData& chunkData = chunks[n].mData;
+		CopyInto(chunkData.mPositions, data.mPositions, positionsBase[n]);
+		CopyInto(chunkData.mNormals, data.mNormals, normalsBase[n]);
+		CopyInto(chunkData.mTexcoords, data.mTexcoords, texcoordsBase[n]);
+		CopyInto(chunkData.mIndices, data.mIndices, indicesBase[n]);
+		for (uint32_t relative : chunks[n].mRelative) {
+			ObjIndex& index = data.mIndices[indicesBase[n] + (relative >> 3)];
+			index.mPosition += (relative & 1) ? static_cast<int32_t>(positionsBase[n] / 3) : 0;
+			index.mTexcoord += (relative & 2) ? static_cast<int32_t>(texcoordsBase[n] / 2) : 0;
+			index.mNormal += (relative & 4) ? static_cast<int32_t>(normalsBase[n] / 3) : 0;
+		}
+		chunkData.mPositions = std::vector<float>();
+		chunkData.mNormals = std::vector<float>();
+		chunkData.mTexcoords = std::vector<float>();
+		chunkData.mIndices = std::vector<ObjIndex>();
+	});
+
+	data.mShapeOffsets.push_back(0);
+	for (size_t n = 0; n < chunksCount; n++) {
+		for (uint32_t offset : chunks[n].mData.mShapeOffsets) {
+			data.mShapeOffsets.push_back(static_cast<uint32_t>(indicesBase[n] + offset));
+		}
+	}
+	data.mShapeOffsets.push_back(static_cast<uint32_t>(data.mIndices.size()));
+	data.mShapeOffsets.erase(std::unique(data.mShapeOffsets.begin(), data.mShapeOffsets.end()), data.mShapeOffsets.end());
+	return true;
+}
+
+} // namespace tinyngine
\ No newline at end of file
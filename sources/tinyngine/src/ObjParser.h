@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tinyngine
+{
+
+// zero based, -1 when the face vertex has no such attribute
+struct ObjIndex {
+	int32_t mPosition;
+	int32_t mTexcoord;
+	int32_t mNormal;
+};
+
+struct ObjData {
+	std::vector<float> mPositions; // stride = 3
+	std::vector<float> mNormals; // stride = 3
+	std::vector<float> mTexcoords; // stride = 2
+	std::vector<ObjIndex> mIndices;
+	// shape n is [mShapeOffsets[n], mShapeOffsets[n + 1]) in mIndices, empty shapes are skipped
+	std::vector<uint32_t> mShapeOffsets;
+
+	size_t GetShapesCount() const { return mShapeOffsets.empty() ? 0 : mShapeOffsets.size() - 1; }
+};
+
+// Parses the geometry of a Wavefront OBJ file: v, vt, vn and f, with g and o starting new shapes, materials are
+// ignored. Polygons are fanned into triangles when triangulate is set. The file is memory mapped and split at line
+// boundaries into chunks parsed in parallel, relative indices are resolved once the chunks are merged.
+bool ParseObj(const char* filename, bool triangulate, ObjData& data);
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,348 @@
+#include "Profiler.h"
+#include "SpScLockFreeQueue.h"
+#include "Log.h"
+#include "imgui.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using tinyngine::ProfileEvent;
+
+// ranges a thread can record between two NextFrame calls, the following ones are dropped
+static constexpr size_t cThreadEventsCount = (1 << 14);
+static constexpr uint32_t cMaxScopeDepth = 32;
+static constexpr uint32_t cHistoryFramesCount = 256;
+
+static constexpr float cTrackRowHeight = 18.0f;
+static constexpr float cTrackLabelWidth = 90.0f;
+
+struct OpenScope {
+	const char* mName;
+	int64_t mBegin; // 0 when the scope was opened while disabled
+};
+
+struct ThreadRecorder {
+	tinyngine::SpScLockFreeQueue<ProfileEvent, cThreadEventsCount> mEvents;
+	std::array<OpenScope, cMaxScopeDepth> mScopes;
+	uint32_t mDepth = 0;
+	uint16_t mTrack = 0;
+	std::atomic<uint32_t> mDropped{ 0 };
+};
+
+// recorders are never released, a thread that exits leaves its last ranges to the next NextFrame
+struct Registry {
+	std::mutex mMutex;
+	std::vector<std::unique_ptr<ThreadRecorder>> mRecorders;
+	std::vector<std::string> mNames;
+	std::atomic<bool> mEnabled{ true };
+};
+
+static Registry& GetRegistry() {
+	static Registry sRegistry;
+	return sRegistry;
+}
+
+static thread_local ThreadRecorder* sRecorder = nullptr;
+
+static ThreadRecorder& GetRecorder() {
+	if (sRecorder == nullptr) {
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mMutex);
+		std::unique_ptr<ThreadRecorder> recorder(new ThreadRecorder());
+		recorder->mTrack = static_cast<uint16_t>(registry.mRecorders.size());
+		registry.mNames.push_back("Thread " + std::to_string(recorder->mTrack));
+		sRecorder = recorder.get();
+		registry.mRecorders.push_back(std::move(recorder));
+	}
+	return *sRecorder;
+}
+
+static void PushEvent(ThreadRecorder& recorder, ProfileEvent&& event) {
+	if (!recorder.mEvents.push(std::move(event))) {
+		recorder.mDropped++;
+	}
+}
+
+// stable color per name, names are literals so their address is enough
+static ImU32 GetScopeColor(const char* name) {
+	uint32_t hash = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(name) * 2654435761u);
+	float hue = float(hash >> 8 & 0xff) / 255.0f;
+	return ImColor::HSV(hue, 0.5f, 0.8f);
+}
+
+static void WriteJsonString(FILE* file, const char* text) {
+	fputc('"', file);
+	for (const char* c = text; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			fputc('\\', file);
+		}
+		fputc(*c, file);
+	}
+	fputc('"', file);
+}
+
+}
+
+namespace tinyngine
+{
+
+struct Profiler::Impl {
+	struct Frame {
+		uint64_t mIndex = 0;
+		int64_t mBegin = 0;
+		int64_t mEnd = 0;
+		std::vector<ProfileEvent> mEvents;
+	};
+
+	std::array<Frame, cHistoryFramesCount> mHistory;
+	uint32_t mFramesCount = 0;
+	uint32_t mNextFrame = 0;
+	uint64_t mFrameIndex = 0;
+	int64_t mFrameBegin = 0;
+
+	// the flame view shows a copy so that it can be frozen
+	Frame mShownFrame;
+	bool mPaused = false;
+
+	const Frame* GetFrame(uint32_t age) const;
+	void DrawTrack(const char* label, uint16_t track, const Frame& frame, float width);
+};
+
+const Profiler::Impl::Frame* Profiler::Impl::GetFrame(uint32_t age) const {
+	if (age >= mFramesCount) {
+		return nullptr;
+	}
+	return &mHistory[(mNextFrame + cHistoryFramesCount - 1 - age) % cHistoryFramesCount];
+}
+
+void Profiler::Impl::DrawTrack(const char* label, uint16_t track, const Frame& frame, float width) {
+	uint16_t maxDepth = 0;
+	bool empty = true;
+	for (const auto& event : frame.mEvents) {
+		if (event.mTrack == track) {
+			maxDepth = std::max(maxDepth, event.mDepth);
+			empty = false;
+		}
+	}
+	if (empty) {
+		return;
+	}
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	float height = (maxDepth + 1) * cTrackRowHeight;
+	float duration = float(std::max<int64_t>(frame.mEnd - frame.mBegin, 1));
+	float left = origin.x + cTrackLabelWidth;
+	float scale = (width - cTrackLabelWidth) / duration;
+
+	drawList->AddText(ImVec2(origin.x, origin.y), ImGui::GetColorU32(ImGuiCol_Text), label);
+	for (const auto& event : frame.mEvents) {
+		if (event.mTrack != track) {
+			continue;
+		}
+		// ranges of the render thread may straddle the frame boundaries
+		float x0 = left + std::max(float(event.mBegin - frame.mBegin), 0.0f) * scale;
+		float x1 = left + std::min(float(event.mEnd - frame.mBegin), duration) * scale;
+		if (x1 <= x0) {
+			continue;
+		}
+		ImVec2 min(x0, origin.y + event.mDepth * cTrackRowHeight);
+		ImVec2 max(std::max(x1, x0 + 1.0f), min.y + cTrackRowHeight - 1.0f);
+		drawList->AddRectFilled(min, max, GetScopeColor(event.mName));
+		float milliseconds = float(event.mEnd - event.mBegin) / 1000000.0f;
+		if (max.x - min.x > ImGui::CalcTextSize(event.mName).x + 4.0f) {
+			drawList->PushClipRect(min, max, true);
+			drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(0, 0, 0, 255), event.mName);
+			drawList->PopClipRect();
+		}
+		if (ImGui::IsMouseHoveringRect(min, max)) {
+			ImGui::SetTooltip("%s: %.3f ms", event.mName, milliseconds);
+		}
+	}
+	ImGui::Dummy(ImVec2(width, height));
+}
+
+Profiler::Profiler() : mImpl(new Impl()) {
+	mImpl->mFrameBegin = GetTime();
+}
+
+Profiler::~Profiler() {
+	delete mImpl;
+}
+
+void Profiler::NextFrame() {
+	int64_t now = GetTime();
+	Impl::Frame& frame = mImpl->mHistory[mImpl->mNextFrame];
+	frame.mIndex = mImpl->mFrameIndex++;
+	frame.mBegin = mImpl->mFrameBegin;
+	frame.mEnd = now;
+	frame.mEvents.clear();
+
+	Registry& registry = GetRegistry();
+	uint32_t dropped = 0;
+	{
+		std::lock_guard<std::mutex> lock(registry.mMutex);
+		ProfileEvent event;
+		for (auto& recorder : registry.mRecorders) {
+			while (recorder->mEvents.pop(event)) {
+				frame.mEvents.push_back(event);
+			}
+			dropped += recorder->mDropped.exchange(0);
+		}
+	}
+	if (dropped > 0) {
+		Log(Logger::Warning, "Profiler: %u ranges dropped in frame %llu", dropped, static_cast<unsigned long long>(frame.mIndex));
+	}
+
+	mImpl->mNextFrame = (mImpl->mNextFrame + 1) % cHistoryFramesCount;
+	mImpl->mFramesCount = std::min(mImpl->mFramesCount + 1, cHistoryFramesCount);
+	mImpl->mFrameBegin = now;
+	if (!mImpl->mPaused) {
+		mImpl->mShownFrame = frame;
+	}
+}
+
+void Profiler::DrawFlameView() {
+	ImGui::SetNextWindowPos(ImVec2(5.0f, 400.0f), ImGuiSetCond_FirstUseEver);
+	ImGui::SetNextWindowSize(ImVec2(640.0f, 240.0f), ImGuiSetCond_FirstUseEver);
+	if (!ImGui::Begin("Profiler")) {
+		ImGui::End();
+		return;
+	}
+
+	const Impl::Frame& shown = mImpl->mShownFrame;
+	float frameTimes[cHistoryFramesCount];
+	uint32_t framesCount = mImpl->mFramesCount;
+	for (uint32_t n = 0; n < framesCount; n++) {
+		const Impl::Frame* frame = mImpl->GetFrame(framesCount - 1 - n);
+		frameTimes[n] = float(frame->mEnd - frame->mBegin) / 1000000.0f;
+	}
+	char overlay[64];
+	snprintf(overlay, sizeof(overlay), "frame %llu: %.3f ms", static_cast<unsigned long long>(shown.mIndex), float(shown.mEnd - shown.mBegin) / 1000000.0f);
+	ImGui::PlotHistogram("##frames", frameTimes, static_cast<int>(framesCount), 0, overlay, 0.0f, FLT_MAX, ImVec2(ImGui::GetContentRegionAvailWidth(), 40.0f));
+
+	ImGui::Checkbox("Pause", &mImpl->mPaused);
+	ImGui::SameLine();
+	if (ImGui::Button("Save trace")) {
+		WriteChromeTrace("trace.json");
+	}
+
+	float width = ImGui::GetContentRegionAvailWidth();
+	std::vector<std::string> names;
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mMutex);
+		names = registry.mNames;
+	}
+	for (size_t track = 0; track < names.size(); track++) {
+		mImpl->DrawTrack(names[track].c_str(), static_cast<uint16_t>(track), shown, width);
+	}
+	mImpl->DrawTrack("GPU", cProfileGpuTrack, shown, width);
+
+	ImGui::End();
+}
+
+bool Profiler::WriteChromeTrace(const char* path) const {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		Log(Logger::Error, "Profiler: could not open %s for writing", path);
+		return false;
+	}
+
+	std::vector<std::string> names;
+	{
+		Registry& registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mMutex);
+		names = registry.mNames;
+	}
+
+	// tid 0 holds the frames, threads follow, the GPU comes last
+	uint32_t gpuTid = static_cast<uint32_t>(names.size()) + 1;
+	const Impl::Frame* oldest = mImpl->GetFrame(mImpl->mFramesCount > 0 ? mImpl->mFramesCount - 1 : 0);
+	int64_t origin = oldest ? oldest->mBegin : 0;
+	auto toMicroseconds = [origin](int64_t time) { return double(time - origin) / 1000.0; };
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Frames\"}},\n");
+	for (size_t track = 0; track < names.size(); track++) {
+		fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", static_cast<uint32_t>(track) + 1);
+		WriteJsonString(file, names[track].c_str());
+		fprintf(file, "}},\n");
+	}
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"GPU\"}}", gpuTid);
+
+	for (uint32_t age = mImpl->mFramesCount; age-- > 0;) {
+		const Impl::Frame* frame = mImpl->GetFrame(age);
+		fprintf(file, ",\n{\"name\":\"Frame %llu\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}",
+			static_cast<unsigned long long>(frame->mIndex), toMicroseconds(frame->mBegin), double(frame->mEnd - frame->mBegin) / 1000.0);
+		for (const auto& event : frame->mEvents) {
+			uint32_t tid = event.mTrack == cProfileGpuTrack ? gpuTid : event.mTrack + 1u;
+			fprintf(file, ",\n{\"name\":");
+			WriteJsonString(file, event.mName);
+			fprintf(file, ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", tid, toMicroseconds(event.mBegin), double(event.mEnd - event.mBegin) / 1000.0);
+		}
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
+
+void Profiler::SetEnabled(bool enabled) {
+	GetRegistry().mEnabled = enabled;
+}
+
+bool Profiler::IsEnabled() {
+	return GetRegistry().mEnabled;
+}
+
+int64_t Profiler::GetTime() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::SetThreadName(const char* name) {
+	ThreadRecorder& recorder = GetRecorder();
+	Registry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mMutex);
+	registry.mNames[recorder.mTrack] = name;
+}
+
+void Profiler::BeginScope(const char* name) {
+	ThreadRecorder& recorder = GetRecorder();
+	if (recorder.mDepth < cMaxScopeDepth) {
+		recorder.mScopes[recorder.mDepth] = { name, GetRegistry().mEnabled ? GetTime() : 0 };
+	}
+	recorder.mDepth++;
+}
+
+void Profiler::EndScope() {
+	ThreadRecorder& recorder = GetRecorder();
+	if (recorder.mDepth == 0) {
+		return;
+	}
+	uint32_t depth = --recorder.mDepth;
+	if (depth >= cMaxScopeDepth) {
+		return;
+	}
+	const OpenScope& scope = recorder.mScopes[depth];
+	if (scope.mBegin != 0 && GetRegistry().mEnabled) {
+		PushEvent(recorder, { scope.mName, scope.mBegin, GetTime(), recorder.mTrack, static_cast<uint16_t>(depth) });
+	}
+}
+
+void Profiler::RecordGpuRange(const char* name, int64_t begin, int64_t end, uint16_t depth) {
+	if (GetRegistry().mEnabled) {
+		PushEvent(GetRecorder(), { name, begin, end, cProfileGpuTrack, depth });
+	}
+}
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "RenderQueue.h"
+#include "Profiler.h"
+
+namespace tinyngine
+{
+
+RenderQueue::~RenderQueue() {
+	Stop();
+}
+
+void RenderQueue::Start(Job onStart, Job onStop) {
+	if (IsThreaded()) {
+		return;
+	}
+	mExit = false;
+	mThread = std::thread(&RenderQueue::ThreadFunc, this, onStart, onStop);
+}
+
+void RenderQueue::Stop() {
+	if (!IsThreaded()) {
+		return;
+	}
+	Flush();
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mExit = true;
+	}
+	mCondition.notify_all();
+	mThread.join();
+}
+
+void RenderQueue::Push(Job job) {
+	if (!IsThreaded()) {
+		job();
+		return;
+	}
+	mRecording.push_back(std::move(job));
+}
+
+void RenderQueue::Submit() {
+	if (!IsThreaded()) {
+		return;
+	}
+	TINYNGINE_PROFILE_SCOPE("Submit");
+	std::unique_lock<std::mutex> lock(mMutex);
+	mCondition.wait(lock, [this]() { return !mBusy; });
+	// the render thread clears its list once done, swapping keeps both allocations alive across frames
+	std::swap(mRecording, mRendering);
+	mBusy = true;
+	lock.unlock();
+	mCondition.notify_all();
+}
+
+void RenderQueue::Flush() {
+	if (!IsThreaded()) {
+		return;
+	}
+	Submit();
+	std::unique_lock<std::mutex> lock(mMutex);
+	mCondition.wait(lock, [this]() { return !mBusy; });
+}
+
+void RenderQueue::ThreadFunc(Job onStart, Job onStop) {
+	Profiler::SetThreadName("Render");
+	onStart();
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;) {
+		mCondition.wait(lock, [this]() { return mBusy || mExit; });
+		if (!mBusy) {
+			break;
+		}
+		lock.unlock();
+		{
+			TINYNGINE_PROFILE_SCOPE("RenderJobs");
+			for (auto& job : mRendering) {
+				job();
+			}
+			mRendering.clear();
+		}
+		lock.lock();
+		mBusy = false;
+		mCondition.notify_all();
+	}
+	lock.unlock();
+
+	onStop();
+}
+
+} // namespace tinyngine
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "PlatformDefine.h"
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tinyngine
+{
+
+// Payload of a job: refers to the caller's memory when jobs run right away, owns a copy of it when they run
+// later on the render thread.
+class JobData final {
+public:
+	JobData(const void* data, size_t size, bool copy) : mData(data) {
+		if (copy && data != nullptr && size > 0) {
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+			mCopy = std::make_shared<std::vector<uint8_t>>(bytes, bytes + size);
+			mData = mCopy->data();
+		}
+	}
+
+	inline const void* Get() const { return mData; }
+
+private:
+	const void* mData;
+	std::shared_ptr<std::vector<uint8_t>> mCopy;
+};
+
+// Double buffered list of jobs for the thread owning the graphics context: the application thread records the
+// jobs of frame N while the render thread runs the ones of frame N-1. Until Start is called there is no render
+// thread and jobs run as soon as they are pushed, on the calling thread.
+// Push, Submit and Flush must only be called from the application thread.
+class RenderQueue final {
+public:
+	using Job = std::function<void()>;
+
+	RenderQueue() = default;
+	~RenderQueue();
+
+	RenderQueue(const RenderQueue& other) = delete;
+	RenderQueue& operator=(const RenderQueue& other) = delete;
+
+	// onStart is the first job run by the render thread (typically making the context current), onStop the last one
+	void Start(Job onStart, Job onStop);
+	void Stop();
+
+	inline bool IsThreaded() const { return mThread.joinable(); }
+
+	void Push(Job job);
+	inline JobData Copy(const void* data, size_t size) const { return JobData(data, size, IsThreaded()); }
+	// hands the recorded jobs over to the render thread, once it is done with the previous frame
+	void Submit();
+	// Submit, then waits until every job has run
+	void Flush();
+
+private:
+	void ThreadFunc(Job onStart, Job onStop);
+
+private:
+	std::thread mThread;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::vector<Job> mRecording;
+	std::vector<Job> mRendering;
+	bool mBusy = false;
+	bool mExit = false;
+};
+
+} // namespace tinyngine
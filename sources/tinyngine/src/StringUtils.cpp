@@ -1,6 +1,9 @@
 #include "StringUtils.h"
 
 #include <cctype>
+#include <cstdarg>
+#include <cstdio>
+#include <cwchar>
 #include <algorithm>
 #include <iostream>
 #include <fstream>
@@ -28,7 +31,7 @@ std::string vaFormatString(const char* format, va_list argumentList) {
 #ifdef _WIN32
 		if (_vsnprintf_s(const_cast<char*>(newString.c_str()), newStringSize + 1, newStringSize, format, argumentList) != newStringSize)
 #else
-		pvr::int32 n = vsnprintf(const_cast<char*>(newString.data()), newStringSize + 1, format, argumentList);
+		int n = vsnprintf(const_cast<char*>(newString.data()), newStringSize + 1, format, argumentList);
 		if ((n < 0) || (n >= newStringSize + 1))
 #endif
 		{
@@ -1,12 +1,17 @@
 #include "Time.h"
 
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #include <Windows.h>
+#else
+#include <time.h>
+#endif
 
 namespace tinyngine
 {
 
+#if defined(_WIN32)
 int64_t Time::GetTime() const {
 	LARGE_INTEGER li;
 	QueryPerformanceCounter(&li);
@@ -20,5 +25,16 @@ int64_t Time::GetFrequency() const {
 	int64_t i64 = li.QuadPart;
 	return i64;
 }
+#else
+int64_t Time::GetTime() const {
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+int64_t Time::GetFrequency() const {
+	return 1000000000;
+}
+#endif
 
 } // tinyngine
\ No newline at end of file
@@ -1,5 +1,8 @@
 #include "VertexFormat.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <memory>
 
 namespace {
@@ -8,9 +11,63 @@ static const uint8_t cAttribTypeSizeGL[static_cast<uint8_t>(tinyngine::Attribute
 {
 	{ 1,  2,  4,  4 },
 	{ 2,  4,  6,  8 },
-	{ 4,  8, 12, 16 } 
+	{ 4,  8, 12, 16 },
+	{ 2,  4,  6,  8 },
+	{ 2,  4,  6,  8 },
+	{ 4,  4,  4,  4 },
+	{ 4,  4,  4,  4 }
 };
 
+inline bool IsPacked(uint8_t type) {
+	return type == tinyngine::AttributeType::Int10_10_10_2 || type == tinyngine::AttributeType::Uint10_10_10_2;
+}
+
+// rounds to nearest, flushes the denormals to zero and saturates to infinity
+uint16_t FloatToHalf(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+	uint32_t magnitude = bits & 0x7fffffff;
+	if (magnitude > 0x7f800000) {
+		return sign | 0x7e00;
+	}
+	if (magnitude >= (143u << 23)) {
+		return sign | 0x7c00;
+	}
+	if (magnitude < (113u << 23)) {
+		return sign;
+	}
+	// rebias the exponent from 127 to 15, the rounding carry may overflow into the exponent and give infinity
+	return sign | static_cast<uint16_t>((magnitude - (112u << 23) + (1u << 12)) >> 13);
+}
+
+float HalfToFloat(uint16_t half) {
+	uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1f;
+	uint32_t mantissa = half & 0x3ff;
+	uint32_t bits;
+	if (exponent == 0) {
+		float value = std::ldexp(static_cast<float>(mantissa), -24);
+		std::memcpy(&bits, &value, sizeof(bits));
+		bits |= sign;
+	} else if (exponent == 31) {
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	} else {
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+inline float Normalize(float value, bool isSigned, float maxValue) {
+	return isSigned ? std::max(value / maxValue, -1.0f) : value / maxValue;
+}
+
+inline float Quantize(float value, bool isSigned, float maxValue) {
+	return std::round(std::min(std::max(value, isSigned ? -1.0f : 0.0f), 1.0f) * maxValue);
+}
+
 }
 
 namespace tinyngine
@@ -25,15 +82,28 @@ VertexFormat::VertexFormat() {
 void VertexFormat::Add(Attributes::Enum attrib, AttributeType::Enum type, uint8_t componentsCount, bool normalized) {
 	uint8_t iAttrib = static_cast<uint8_t>(attrib);
 	uint8_t iType = static_cast<uint8_t>(type);
-	uint8_t num = componentsCount - 1;
+	// packed types are always fetched as 4 components
+	uint8_t num = IsPacked(iType) ? 3 : componentsCount - 1;
 
 	const uint16_t encodedCount = num & 3;
 	const uint16_t encodedType = (iType & 7) << 3;
 	const uint16_t encodedNormalized = (normalized & 1) << 7;
 	
 	mAttributes[iAttrib] = encodedNormalized | encodedType | encodedCount;
-	mOffset[iAttrib] = cAttribTypeSizeGL[iType][num];// mStride;
-	mStride += cAttribTypeSizeGL[iType][num];
+	mOffset[iAttrib] = mStride;
+	// keep every attribute 4 byte aligned, unaligned vertex fetch is slow or unsupported on many GLES2 parts
+	mStride += (cAttribTypeSizeGL[iType][num] + 3) & ~3;
+}
+
+uint16_t VertexFormat::GetSize(Attributes::Enum attrib) const {
+	if (!IsValid(attrib)) {
+		return 0;
+	}
+	uint8_t type;
+	uint8_t componentsCount;
+	bool normalized;
+	Decode(attrib, type, componentsCount, normalized);
+	return cAttribTypeSizeGL[type][componentsCount - 1];
 }
 
 void VertexFormat::Decode(Attributes::Enum attrib, uint8_t& type, uint8_t& componentCounts, bool& normalized) const {
@@ -43,4 +113,98 @@ void VertexFormat::Decode(Attributes::Enum attrib, uint8_t& type, uint8_t& compo
 	normalized = (mAttributes[iAttrib] >> 7) & 1;
 }
 
+void VertexFormat::Read(Attributes::Enum attrib, const uint8_t* source, float values[4]) const {
+	uint8_t type;
+	uint8_t size;
+	bool normalized;
+	Decode(attrib, type, size, normalized);
+	if (IsPacked(type)) {
+		uint32_t bits;
+		std::memcpy(&bits, source, sizeof(bits));
+		bool isSigned = type == AttributeType::Int10_10_10_2;
+		for (uint8_t c = 0; c < 4; c++) {
+			uint32_t width = c < 3 ? 10 : 2;
+			uint32_t raw = (bits >> (c * 10)) & ((1u << width) - 1);
+			int32_t component = isSigned && raw >= (1u << (width - 1)) ? static_cast<int32_t>(raw) - (1 << width) : static_cast<int32_t>(raw);
+			float maxValue = static_cast<float>((1u << (isSigned ? width - 1 : width)) - 1);
+			values[c] = normalized ? Normalize(static_cast<float>(component), isSigned, maxValue) : static_cast<float>(component);
+		}
+		return;
+	}
+	for (uint8_t c = 0; c < size; c++) {
+		switch (type) {
+		case AttributeType::Uint8:
+			values[c] = normalized ? source[c] / 255.0f : source[c];
+			break;
+		case AttributeType::Int16: {
+			int16_t value;
+			std::memcpy(&value, source + c * sizeof(int16_t), sizeof(int16_t));
+			values[c] = normalized ? Normalize(value, true, 32767.0f) : value;
+			break;
+		}
+		case AttributeType::Uint16: {
+			uint16_t value;
+			std::memcpy(&value, source + c * sizeof(uint16_t), sizeof(uint16_t));
+			values[c] = normalized ? value / 65535.0f : value;
+			break;
+		}
+		case AttributeType::Half: {
+			uint16_t value;
+			std::memcpy(&value, source + c * sizeof(uint16_t), sizeof(uint16_t));
+			values[c] = HalfToFloat(value);
+			break;
+		}
+		default:
+			std::memcpy(&values[c], source + c * sizeof(float), sizeof(float));
+			break;
+		}
+	}
+}
+
+void VertexFormat::Write(Attributes::Enum attrib, const float* values, uint8_t valuesCount, uint8_t* destination) const {
+	uint8_t type;
+	uint8_t size;
+	bool normalized;
+	Decode(attrib, type, size, normalized);
+	if (IsPacked(type)) {
+		bool isSigned = type == AttributeType::Int10_10_10_2;
+		uint32_t bits = 0;
+		for (uint8_t c = 0; c < 4; c++) {
+			uint32_t width = c < 3 ? 10 : 2;
+			float value = c < valuesCount ? values[c] : 0.0f;
+			float maxValue = static_cast<float>((1u << (isSigned ? width - 1 : width)) - 1);
+			int32_t component = static_cast<int32_t>(normalized ? Quantize(value, isSigned, maxValue) : value);
+			bits |= (static_cast<uint32_t>(component) & ((1u << width) - 1)) << (c * 10);
+		}
+		std::memcpy(destination, &bits, sizeof(bits));
+		return;
+	}
+	for (uint8_t c = 0; c < size; c++) {
+		float value = c < valuesCount ? values[c] : 0.0f;
+		switch (type) {
+		case AttributeType::Uint8:
+			destination[c] = static_cast<uint8_t>(normalized ? Quantize(value, false, 255.0f) : value);
+			break;
+		case AttributeType::Int16: {
+			int16_t component = static_cast<int16_t>(normalized ? Quantize(value, true, 32767.0f) : value);
+			std::memcpy(destination + c * sizeof(int16_t), &component, sizeof(int16_t));
+			break;
+		}
+		case AttributeType::Uint16: {
+			uint16_t component = static_cast<uint16_t>(normalized ? Quantize(value, false, 65535.0f) : value);
+			std::memcpy(destination + c * sizeof(uint16_t), &component, sizeof(uint16_t));
+			break;
+		}
+		case AttributeType::Half: {
+			uint16_t component = FloatToHalf(value);
+			std::memcpy(destination + c * sizeof(uint16_t), &component, sizeof(uint16_t));
+			break;
+		}
+		default:
+			std::memcpy(destination + c * sizeof(float), &value, sizeof(float));
+			break;
+		}
+	}
+}
+
 } // namespace tinyngine
\ No newline at end of file
@@ -7,6 +7,10 @@
 #include <algorithm>
 #include <vector>
 
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
 namespace tinyngine
 {
 
@@ -17,6 +21,13 @@ extern "C" IPlatformContext* CreatePlatformContext(void* windowHandle, const Con
 	return new EGLPlatformContext({ reinterpret_cast<NativeWindow>(windowHandle) }, attributes);
 }
 
+extern "C" IPlatformContext* CreateOffscreenPlatformContext(uint32_t width, uint32_t height, const ContextAttribs& attributes) {
+	if (!egl::InitTrampoline()) {
+		return nullptr;
+	}
+	return new EGLPlatformContext(width, height, attributes);
+}
+
 //=====================================================================================================================
 
 EGLPlatformContext::EGLPlatformContext(const NativeWindowHandle& handle, const ContextAttribs& attributes)
@@ -24,7 +35,21 @@ EGLPlatformContext::EGLPlatformContext(const NativeWindowHandle& handle, const C
 	, mEGLDisplay(0)
 	, mEGLContext(0)
 	, mEGLSurface(0)
-	, mAttributes(attributes) {
+	, mAttributes(attributes)
+	, mSurfaceWidth(0)
+	, mSurfaceHeight(0)
+	, mOffscreen(false) {
+}
+
+EGLPlatformContext::EGLPlatformContext(uint32_t width, uint32_t height, const ContextAttribs& attributes)
+	: mWindowHandle({ 0 })
+	, mEGLDisplay(0)
+	, mEGLContext(0)
+	, mEGLSurface(0)
+	, mAttributes(attributes)
+	, mSurfaceWidth(width)
+	, mSurfaceHeight(height)
+	, mOffscreen(true) {
 }
 
 Result EGLPlatformContext::Initialize() {
@@ -35,7 +60,7 @@ Result EGLPlatformContext::Initialize() {
 	}
 
 	EGLConfig config;
-	result = InitializeContext(config, true);
+	result = InitializeContext(config, !mOffscreen);
 	if (result != Result::Success) {
 		return result;
 	}
@@ -57,7 +82,12 @@ Result EGLPlatformContext::Initialize() {
 	//	}
 	//}
 
-	mEGLSurface = egl::CreateWindowSurface(mEGLDisplay, config, mWindowHandle.mNativeWindow, eglattribs);
+	if (mOffscreen) {
+		const EGLint pbufferAttribs[] = { EGL_WIDTH, static_cast<EGLint>(mSurfaceWidth), EGL_HEIGHT, static_cast<EGLint>(mSurfaceHeight), EGL_NONE };
+		mEGLSurface = egl::CreatePbufferSurface(mEGLDisplay, config, pbufferAttribs);
+	} else {
+		mEGLSurface = egl::CreateWindowSurface(mEGLDisplay, config, mWindowHandle.mNativeWindow, eglattribs);
+	}
 	if (mEGLSurface == EGL_NO_SURFACE) {
 		Log(Logger::Error, "Context creation failed\n");
 		return Result::InvalidArgument;
@@ -93,6 +123,11 @@ Result EGLPlatformContext::MakeCurrent() {
 	return Result::Success;
 }
 
+Result EGLPlatformContext::ReleaseCurrent() {
+	egl::MakeCurrent(mEGLDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	return Result::Success;
+}
+
 std::string EGLPlatformContext::GetInfo() {
 	std::ostringstream lines;
 	std::string tmp;
@@ -195,7 +230,21 @@ std::string EGLPlatformContext::GetInfo() {
 }
 
 Result EGLPlatformContext::InitializeBinding() {
-	mEGLDisplay = egl::GetDisplay(GetDC(mWindowHandle.mNativeWindow));
+	if (mOffscreen) {
+		// Mesa can run without a display server through its surfaceless platform, pbuffers included
+		auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(egl::GetProcAddress("eglGetPlatformDisplayEXT"));
+		if (getPlatformDisplay && egl::isEglExtensionSupported(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless")) {
+			mEGLDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		} else {
+			mEGLDisplay = egl::GetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+	} else {
+#if defined(_WIN32)
+		mEGLDisplay = egl::GetDisplay(GetDC(mWindowHandle.mNativeWindow));
+#else
+		mEGLDisplay = egl::GetDisplay(EGL_DEFAULT_DISPLAY);
+#endif
+	}
 	if (mEGLDisplay == EGL_NO_DISPLAY) {
 		return Result::InvalidArgument;
 	}
@@ -301,10 +350,8 @@ Result EGLPlatformContext::InitializeContext(EGLConfig& config, bool wantsWindow
 		configAttributes[i++] = EGL_STENCIL_SIZE;
 		configAttributes[i++] = mAttributes.mStencilBPP;
 
-		if (wantsWindow) {
-			configAttributes[i++] = EGL_SURFACE_TYPE;
-			configAttributes[i++] = EGL_WINDOW_BIT;
-		}
+		configAttributes[i++] = EGL_SURFACE_TYPE;
+		configAttributes[i++] = wantsWindow ? EGL_WINDOW_BIT : EGL_PBUFFER_BIT;
 
 		switch (mAttributes.mRequiredApi) {
 		case Api::OpenGLES2:
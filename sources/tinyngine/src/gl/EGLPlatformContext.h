@@ -18,11 +18,14 @@ struct NativeWindowHandle {
 class EGLPlatformContext : public IPlatformContext {
 public:
 	EGLPlatformContext(const NativeWindowHandle& handle, const ContextAttribs& attributes);
+	// renders to a pbuffer of the given size, no window or display server needed
+	EGLPlatformContext(uint32_t width, uint32_t height, const ContextAttribs& attributes);
 
 	Result Initialize() override;
 	Result Terminate() override;
 	Result Present() override;
 	Result MakeCurrent() override;
+	Result ReleaseCurrent() override;
 
 	std::string GetInfo() override;
 
@@ -40,6 +43,7 @@ private:
 
 	uint32_t mSurfaceWidth;
 	uint32_t mSurfaceHeight;
+	bool mOffscreen;
 };
 
 } // namespace tinyngine
\ No newline at end of file
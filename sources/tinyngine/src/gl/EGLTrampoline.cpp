@@ -1,14 +1,16 @@
 #include "EGLTrampoline.h"
 #include "DynLibLoader.h"
 
+#include <cstring>
+
 namespace {
 	static tinyngine::DynLibLoader& GetEGLLibrary() {
 #ifdef _WIN32
 		static constexpr const char* sEGLLibraryPath = "libEGL.dll";
 #elif defined(TARGET_OS_MAC)
-		static constexpr char* sEGLLibraryPath = "libEGL.dylib";
+		static constexpr const char* sEGLLibraryPath = "libEGL.dylib";
 #else
-		static constexpr char* sEGLLibraryPath = "libEGL.so";
+		static constexpr const char* sEGLLibraryPath = "libEGL.so.1;libEGL.so";
 #endif
 
 		static tinyngine::DynLibLoader sEGLLibrary(sEGLLibraryPath);
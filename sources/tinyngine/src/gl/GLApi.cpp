@@ -1,11 +1,28 @@
 #include "GLApi.h"
+#include "EGLTrampoline.h"
+#include "PlatformDefine.h"
+
+#include <cstring>
 
 namespace {
 
 static const GLenum cAttributeTypes[]{
 	GL_UNSIGNED_BYTE,
 	GL_SHORT,
-	GL_FLOAT
+	GL_FLOAT,
+	GL_UNSIGNED_SHORT,
+	GL_HALF_FLOAT,
+	GL_INT_2_10_10_10_REV,
+	GL_UNSIGNED_INT_2_10_10_10_REV
+};
+static_assert(sizeof(cAttributeTypes) / sizeof(cAttributeTypes[0]) == tinyngine::AttributeType::Count, "cAttributeTypes out of sync");
+
+// filled by InitAttributeTypes, GLES2 half floats have an enum of their own
+static GLenum sAttributeTypes[tinyngine::AttributeType::Count]{
+	GL_UNSIGNED_BYTE,
+	GL_SHORT,
+	GL_FLOAT,
+	GL_UNSIGNED_SHORT
 };
 
 static const char* cAttributeNames[]{
@@ -34,6 +51,11 @@ static const GLenum cPrimitiveTypes[]{
 	GL_POINTS
 };
 
+static const GLenum cIndexTypes[]{
+	GL_UNSIGNED_SHORT,
+	GL_UNSIGNED_INT
+};
+
 static const GLenum cStateTypes[]{
 	GL_BLEND,
 	GL_CULL_FACE,
@@ -112,6 +134,103 @@ static const GLint cWrapMode[]{
 	0 //OpenGL specific GL_CLAMP_TO_BORDER
 };
 
+static const GLenum cCompressedTextureFormats[]{
+	0, // RGB8
+	0, // RGBA8
+	0, // BGRA8
+	GL_ETC1_RGB8_OES, // ETC1
+	GL_COMPRESSED_RGB8_ETC2, // ETC2_RGB8
+	GL_COMPRESSED_RGBA8_ETC2_EAC, // ETC2_RGBA8
+	GL_COMPRESSED_R11_EAC, // EAC_R11
+	GL_COMPRESSED_RG11_EAC, // EAC_RG11
+	GL_COMPRESSED_RGBA_ASTC_4x4_KHR, // ASTC_4x4
+	GL_COMPRESSED_RGBA_ASTC_8x8_KHR, // ASTC_8x8
+	GL_COMPRESSED_RGB_S3TC_DXT1_EXT, // BC1
+	GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, // BC2
+	GL_COMPRESSED_RGBA_S3TC_DXT5_EXT // BC3
+};
+static_assert(sizeof(cCompressedTextureFormats) / sizeof(cCompressedTextureFormats[0]) == tinyngine::TextureFormats::Count, "cCompressedTextureFormats out of sync");
+
+// filled by InitTextureFormats
+static GLenum sCompressedTextureFormats[tinyngine::TextureFormats::Count] = {};
+
+static constexpr uint32_t cMaxQueuedErrors = 8;
+
+#if TINYNGINE_GL_CHECK_CALLS
+static tinyngine::ErrorCheckMode::Enum sErrorCheckMode = tinyngine::ErrorCheckMode::PerCall;
+#else
+static tinyngine::ErrorCheckMode::Enum sErrorCheckMode = tinyngine::ErrorCheckMode::PerFrame;
+#endif
+
+struct CallSite {
+	const char* mCall = "<unknown>";
+	const char* mFile = "<unknown>";
+	int mLine = 0;
+};
+
+static CallSite sLastCallSite;
+
+static PFNGLDRAWARRAYSINSTANCEDANGLEPROC sDrawArraysInstanced = nullptr;
+static PFNGLDRAWELEMENTSINSTANCEDANGLEPROC sDrawElementsInstanced = nullptr;
+static PFNGLVERTEXATTRIBDIVISORANGLEPROC sVertexAttribDivisor = nullptr;
+
+static PFNGLGENQUERIESEXTPROC sGenQueries = nullptr;
+static PFNGLDELETEQUERIESEXTPROC sDeleteQueries = nullptr;
+static PFNGLQUERYCOUNTEREXTPROC sQueryCounter = nullptr;
+static PFNGLGETQUERYIVEXTPROC sGetQueryiv = nullptr;
+static PFNGLGETQUERYOBJECTUIVEXTPROC sGetQueryObjectuiv = nullptr;
+static PFNGLGETQUERYOBJECTUI64VEXTPROC sGetQueryObjectui64v = nullptr;
+
+static PFNGLGETPROGRAMBINARYOESPROC sGetProgramBinary = nullptr;
+static PFNGLPROGRAMBINARYOESPROC sProgramBinary = nullptr;
+
+// core, ANGLE and EXT entry points share the same signatures
+static bool ResolveInstancing(const char* drawArrays, const char* drawElements, const char* divisor) {
+	sDrawArraysInstanced = reinterpret_cast<PFNGLDRAWARRAYSINSTANCEDANGLEPROC>(egl::GetProcAddress(drawArrays));
+	sDrawElementsInstanced = reinterpret_cast<PFNGLDRAWELEMENTSINSTANCEDANGLEPROC>(egl::GetProcAddress(drawElements));
+	sVertexAttribDivisor = reinterpret_cast<PFNGLVERTEXATTRIBDIVISORANGLEPROC>(egl::GetProcAddress(divisor));
+	if (!sDrawArraysInstanced || !sDrawElementsInstanced || !sVertexAttribDivisor) {
+		sDrawArraysInstanced = nullptr;
+		sDrawElementsInstanced = nullptr;
+		sVertexAttribDivisor = nullptr;
+		return false;
+	}
+	return true;
+}
+
+static void GL_APIENTRY DebugMessageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam) {
+	TINYNGINE_UNUSED(length); TINYNGINE_UNUSED(userParam);
+
+	tinyngine::Logger::Severity logSeverity = tinyngine::Logger::Debug;
+	switch (severity) {
+	case GL_DEBUG_SEVERITY_HIGH_KHR: logSeverity = tinyngine::Logger::Error; break;
+	case GL_DEBUG_SEVERITY_MEDIUM_KHR: logSeverity = tinyngine::Logger::Warning; break;
+	case GL_DEBUG_SEVERITY_LOW_KHR: logSeverity = tinyngine::Logger::Information; break;
+	default: break;
+	}
+	Log(logSeverity, "GL debug (source 0x%x, type 0x%x, id %u): %s after %s (%s:%d)", source, type, id, message, sLastCallSite.mCall, sLastCallSite.mFile, sLastCallSite.mLine);
+}
+
+static bool EnableDebugCallback(bool enable) {
+	if (!tinyngine::gl::IsExtensionSupported("GL_KHR_debug")) {
+		return false;
+	}
+	auto debugMessageCallback = reinterpret_cast<PFNGLDEBUGMESSAGECALLBACKKHRPROC>(egl::GetProcAddress("glDebugMessageCallbackKHR"));
+	if (!debugMessageCallback) {
+		return false;
+	}
+	if (enable) {
+		glEnable(GL_DEBUG_OUTPUT_KHR);
+		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_KHR);
+		debugMessageCallback(DebugMessageCallback, nullptr);
+	} else {
+		debugMessageCallback(nullptr, nullptr);
+		glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS_KHR);
+		glDisable(GL_DEBUG_OUTPUT_KHR);
+	}
+	return true;
+}
+
 }
 
 namespace tinyngine {
@@ -138,7 +257,7 @@ const char* GetErrorString(GLenum _enum) {
 }
 
 GLenum GetAttributeType(AttributeType::Enum type) {
-	return cAttributeTypes[type];
+	return sAttributeTypes[type];
 }
 
 const char* GetAttributeName(Attributes::Enum attribute) {
@@ -153,6 +272,10 @@ GLenum GetPrimitiveType(PrimitiveType::Enum type) {
 	return cPrimitiveTypes[type];
 }
 
+GLenum GetIndexType(IndexType::Enum type) {
+	return cIndexTypes[type];
+}
+
 GLenum GetRendererStateType(RendererStateType::Enum type) {
 	return cStateTypes[type];
 }
@@ -185,5 +308,235 @@ GLint GetWrapMode(TextureWrapMode::Enum mode) {
 	return cWrapMode[mode];
 }
 
+bool IsExtensionSupported(const char* extension) {
+	const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+	if (!extensions || !extension || *extension == '\0') {
+		return false;
+	}
+
+	size_t length = strlen(extension);
+	for (const char* position = strstr(extensions, extension); position; position = strstr(position + length, extension)) {
+		bool startsToken = position == extensions || *(position - 1) == ' ';
+		bool endsToken = position[length] == ' ' || position[length] == '\0';
+		if (startsToken && endsToken) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool InitInstancing() {
+	const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	if (version && strncmp(version, "OpenGL ES 3", 11) == 0 && ResolveInstancing("glDrawArraysInstanced", "glDrawElementsInstanced", "glVertexAttribDivisor")) {
+		return true;
+	}
+	if (IsExtensionSupported("GL_ANGLE_instanced_arrays") && ResolveInstancing("glDrawArraysInstancedANGLE", "glDrawElementsInstancedANGLE", "glVertexAttribDivisorANGLE")) {
+		return true;
+	}
+	if (IsExtensionSupported("GL_EXT_instanced_arrays") && ResolveInstancing("glDrawArraysInstancedEXT", "glDrawElementsInstancedEXT", "glVertexAttribDivisorEXT")) {
+		return true;
+	}
+	return false;
+}
+
+void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancesCount) {
+	sDrawArraysInstanced(mode, first, count, instancesCount);
+}
+
+void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancesCount) {
+	sDrawElementsInstanced(mode, count, type, indices, instancesCount);
+}
+
+void VertexAttribDivisor(GLuint index, GLuint divisor) {
+	sVertexAttribDivisor(index, divisor);
+}
+
+bool InitTimerQueries() {
+	if (!IsExtensionSupported("GL_EXT_disjoint_timer_query")) {
+		return false;
+	}
+	sGenQueries = reinterpret_cast<PFNGLGENQUERIESEXTPROC>(egl::GetProcAddress("glGenQueriesEXT"));
+	sDeleteQueries = reinterpret_cast<PFNGLDELETEQUERIESEXTPROC>(egl::GetProcAddress("glDeleteQueriesEXT"));
+	sQueryCounter = reinterpret_cast<PFNGLQUERYCOUNTEREXTPROC>(egl::GetProcAddress("glQueryCounterEXT"));
+	sGetQueryiv = reinterpret_cast<PFNGLGETQUERYIVEXTPROC>(egl::GetProcAddress("glGetQueryivEXT"));
+	sGetQueryObjectuiv = reinterpret_cast<PFNGLGETQUERYOBJECTUIVEXTPROC>(egl::GetProcAddress("glGetQueryObjectuivEXT"));
+	sGetQueryObjectui64v = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VEXTPROC>(egl::GetProcAddress("glGetQueryObjectui64vEXT"));
+	if (!sGenQueries || !sDeleteQueries || !sQueryCounter || !sGetQueryiv || !sGetQueryObjectuiv || !sGetQueryObjectui64v) {
+		return false;
+	}
+	// some implementations only time GL_TIME_ELAPSED_EXT ranges, which cannot be nested
+	GLint counterBits = 0;
+	sGetQueryiv(GL_TIMESTAMP_EXT, GL_QUERY_COUNTER_BITS_EXT, &counterBits);
+	return counterBits > 0;
+}
+
+void GenQueries(GLsizei count, GLuint* ids) {
+	sGenQueries(count, ids);
+}
+
+void DeleteQueries(GLsizei count, const GLuint* ids) {
+	sDeleteQueries(count, ids);
+}
+
+void QueryTimestamp(GLuint id) {
+	sQueryCounter(id, GL_TIMESTAMP_EXT);
+}
+
+bool IsQueryAvailable(GLuint id) {
+	GLuint available = GL_FALSE;
+	sGetQueryObjectuiv(id, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+	return available != GL_FALSE;
+}
+
+uint64_t GetQueryTimestamp(GLuint id) {
+	GLuint64 timestamp = 0;
+	sGetQueryObjectui64v(id, GL_QUERY_RESULT_EXT, &timestamp);
+	return timestamp;
+}
+
+bool IsTimerDisjoint() {
+	GLint disjoint = GL_FALSE;
+	glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+	return disjoint != GL_FALSE;
+}
+
+bool InitProgramBinary() {
+	const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	if (version && strncmp(version, "OpenGL ES 3", 11) == 0) {
+		sGetProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(egl::GetProcAddress("glGetProgramBinary"));
+		sProgramBinary = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(egl::GetProcAddress("glProgramBinary"));
+	}
+	if ((!sGetProgramBinary || !sProgramBinary) && IsExtensionSupported("GL_OES_get_program_binary")) {
+		sGetProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYOESPROC>(egl::GetProcAddress("glGetProgramBinaryOES"));
+		sProgramBinary = reinterpret_cast<PFNGLPROGRAMBINARYOESPROC>(egl::GetProcAddress("glProgramBinaryOES"));
+	}
+	if (!sGetProgramBinary || !sProgramBinary) {
+		sGetProgramBinary = nullptr;
+		sProgramBinary = nullptr;
+		return false;
+	}
+	// the entry points can be exposed by drivers that have no format to save the programs in
+	GLint formatsCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formatsCount);
+	return formatsCount > 0;
+}
+
+GLint GetProgramBinaryLength(GLuint program) {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+	return length;
+}
+
+bool GetProgramBinary(GLuint program, GLsizei size, GLenum& format, void* binary) {
+	GLsizei length = 0;
+	sGetProgramBinary(program, size, &length, &format, binary);
+	return length == size;
+}
+
+void ProgramBinary(GLuint program, GLenum format, const void* binary, GLsizei length) {
+	sProgramBinary(program, format, binary, length);
+}
+
+bool InitParallelShaderCompile() {
+	if (!IsExtensionSupported("GL_KHR_parallel_shader_compile")) {
+		return false;
+	}
+	auto maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(egl::GetProcAddress("glMaxShaderCompilerThreadsKHR"));
+	if (!maxShaderCompilerThreads) {
+		return false;
+	}
+	// the driver picks the number of threads
+	maxShaderCompilerThreads(0xffffffffu);
+	return true;
+}
+
+void InitTextureFormats(bool* supported) {
+	const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	bool gles3 = version && strncmp(version, "OpenGL ES 3", 11) == 0;
+	bool etc1 = IsExtensionSupported("GL_OES_compressed_ETC1_RGB8_texture");
+	bool astc = IsExtensionSupported("GL_KHR_texture_compression_astc_ldr") || IsExtensionSupported("GL_OES_texture_compression_astc");
+	bool s3tc = IsExtensionSupported("GL_EXT_texture_compression_s3tc");
+	// ANGLE exposes the S3TC formats one by one
+	bool dxt1 = s3tc || IsExtensionSupported("GL_EXT_texture_compression_dxt1");
+	bool dxt3 = s3tc || IsExtensionSupported("GL_ANGLE_texture_compression_dxt3");
+	bool dxt5 = s3tc || IsExtensionSupported("GL_ANGLE_texture_compression_dxt5");
+
+	const bool compressed[]{ etc1 || gles3, gles3, gles3, gles3, gles3, astc, astc, dxt1, dxt3, dxt5 };
+	for (uint32_t format = 0; format < TextureFormats::Count; format++) {
+		bool isCompressed = GetTextureFormatInfo(static_cast<TextureFormats::Enum>(format)).mCompressed;
+		supported[format] = isCompressed ? compressed[format - TextureFormats::ETC1] : true;
+		sCompressedTextureFormats[format] = isCompressed && supported[format] ? cCompressedTextureFormats[format] : 0;
+	}
+	// ETC2 decoders read ETC1 blocks as well
+	if (!etc1 && gles3) {
+		sCompressedTextureFormats[TextureFormats::ETC1] = GL_COMPRESSED_RGB8_ETC2;
+	}
+}
+
+void InitAttributeTypes(bool* supported) {
+	const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+	bool gles3 = version && strncmp(version, "OpenGL ES 3", 11) == 0;
+	// OES_vertex_type_10_10_10_2 packs x in the most significant bits, only the GLES3 layout is exposed
+	const bool available[]{ true, true, true, true, gles3 || IsExtensionSupported("GL_OES_vertex_half_float"), gles3, gles3 };
+	for (uint32_t type = 0; type < AttributeType::Count; type++) {
+		supported[type] = available[type];
+		sAttributeTypes[type] = available[type] ? cAttributeTypes[type] : 0;
+	}
+	if (supported[AttributeType::Half] && !gles3) {
+		sAttributeTypes[AttributeType::Half] = GL_HALF_FLOAT_OES;
+	}
+}
+
+GLenum GetCompressedTextureFormat(TextureFormats::Enum format) {
+	return format < TextureFormats::Count ? sCompressedTextureFormats[format] : 0;
+}
+
+ErrorCheckMode::Enum GetErrorCheckMode() {
+	return sErrorCheckMode;
+}
+
+ErrorCheckMode::Enum SetErrorCheckMode(ErrorCheckMode::Enum mode) {
+#if !TINYNGINE_GL_CHECK_CALLS
+	if (mode == ErrorCheckMode::PerCall) {
+		Log(Logger::Warning, "Per-call GL error checks are compiled out (TINYNGINE_GL_CHECK_CALLS=0), checking once per frame instead");
+		mode = ErrorCheckMode::PerFrame;
+	}
+#endif
+
+	if (sErrorCheckMode == ErrorCheckMode::DebugCallback && mode != ErrorCheckMode::DebugCallback) {
+		EnableDebugCallback(false);
+	}
+	if (mode == ErrorCheckMode::DebugCallback && sErrorCheckMode != ErrorCheckMode::DebugCallback) {
+		if (!EnableDebugCallback(true)) {
+			Log(Logger::Warning, "GL_KHR_debug not available, checking GL errors once per frame instead");
+			mode = ErrorCheckMode::PerFrame;
+		}
+	}
+
+	sErrorCheckMode = mode;
+	return sErrorCheckMode;
+}
+
+void SetCallSite(const char* call, const char* file, int line) {
+	sLastCallSite.mCall = call;
+	sLastCallSite.mFile = file;
+	sLastCallSite.mLine = line;
+}
+
+void CheckErrors(const char* call, const char* file, int line) {
+	bool failed = false;
+	for (uint32_t n = 0; n < cMaxQueuedErrors; n++) {
+		GLenum glError = glGetError();
+		if (glError == GL_NO_ERROR) {
+			break;
+		}
+		Log(Logger::Error, "GL error 0x%x %s after %s (%s:%d)", glError, GetErrorString(glError), call, file, line);
+		failed = true;
+	}
+	if (failed && sErrorCheckMode == ErrorCheckMode::PerCall) {
+		abort();
+	}
+}
+
 }
 }
\ No newline at end of file
@@ -4,8 +4,30 @@
 #define GL_GLEXT_PROTOTYPES
 #endif
 #include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
 //#include <GLES3/gl3.h>
 
+// missing from the bundled Khronos headers
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_KHR_parallel_shader_compile 1
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (GL_APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) (GLuint count);
+#endif
+
+// GLES3 core, not part of gl2ext.h
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_R11_EAC 0x9270
+#define GL_COMPRESSED_RG11_EAC 0x9272
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+#ifndef GL_HALF_FLOAT
+#define GL_HALF_FLOAT 0x140B
+#define GL_INT_2_10_10_10_REV 0x8D9F
+#define GL_UNSIGNED_INT_2_10_10_10_REV 0x8368
+#endif
+
 #include <cstdlib>
 
 #include "GraphicsTypes.h"
@@ -22,6 +44,7 @@ const char* GetAttributeName(Attributes::Enum attribute);
 GLenum GetShaderType(ShaderType::Enum type);
 
 GLenum GetPrimitiveType(PrimitiveType::Enum type);
+GLenum GetIndexType(IndexType::Enum type);
 
 GLenum GetRendererStateType(RendererStateType::Enum type);
 GLenum GetBlendFunc(BlendFuncs::Enum func);
@@ -33,15 +56,80 @@ GLenum GetStencilOpType(StencilOpTypes::Enum type);
 
 GLint GetWrapMode(TextureWrapMode::Enum mode);
 
+bool IsExtensionSupported(const char* extension);
+
+// Resolves the instanced draw entry points from GLES3 core, ANGLE_instanced_arrays or EXT_instanced_arrays,
+// returns false when the context has none of them. Needs a current context.
+bool InitInstancing();
+void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancesCount);
+void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instancesCount);
+void VertexAttribDivisor(GLuint index, GLuint divisor);
+
+// Resolves the EXT_disjoint_timer_query entry points, returns false when the extension is missing or has no
+// timestamp counter. Needs a current context.
+bool InitTimerQueries();
+void GenQueries(GLsizei count, GLuint* ids);
+void DeleteQueries(GLsizei count, const GLuint* ids);
+void QueryTimestamp(GLuint id);
+bool IsQueryAvailable(GLuint id);
+uint64_t GetQueryTimestamp(GLuint id);
+// true when the GPU timings may have been invalidated since the last call (frequency change, context loss)
+bool IsTimerDisjoint();
+
+// Resolves the program binary entry points from GLES3 core or OES_get_program_binary, returns false when the
+// driver has none of them or reports no binary format. Needs a current context.
+bool InitProgramBinary();
+GLint GetProgramBinaryLength(GLuint program);
+bool GetProgramBinary(GLuint program, GLsizei size, GLenum& format, void* binary);
+void ProgramBinary(GLuint program, GLenum format, const void* binary, GLsizei length);
+
+// Lets the driver compile and link on its own threads (KHR_parallel_shader_compile), the completion of a program
+// can then be polled with GL_COMPLETION_STATUS_KHR. Needs a current context.
+bool InitParallelShaderCompile();
+
+// Fills supported with the TextureFormats the context can upload, from the GLES version and the ETC1, ASTC and S3TC
+// extensions. Needs a current context.
+void InitTextureFormats(bool* supported);
+// Fills supported with the AttributeTypes glVertexAttribPointer accepts, from the GLES version and
+// OES_vertex_half_float. Needs a current context.
+void InitAttributeTypes(bool* supported);
+// internal format for glCompressedTexImage2D, 0 when the format is not compressed or not supported
+GLenum GetCompressedTextureFormat(TextureFormats::Enum format);
+
+ErrorCheckMode::Enum GetErrorCheckMode();
+ErrorCheckMode::Enum SetErrorCheckMode(ErrorCheckMode::Enum mode);
+void SetCallSite(const char* call, const char* file, int line);
+void CheckErrors(const char* call, const char* file, int line);
+
 } // namespace gl
 } // namespace tinyngine
 
+// Per-call error checks are compiled in for debug builds only; release builds can still check once per frame
+// or through the KHR_debug callback at run-time. Define TINYNGINE_GL_CHECK_CALLS to override.
+#ifndef TINYNGINE_GL_CHECK_CALLS
+#if defined(_DEBUG)
+#define TINYNGINE_GL_CHECK_CALLS 1
+#else
+#define TINYNGINE_GL_CHECK_CALLS 0
+#endif
+#endif
+
+#if TINYNGINE_GL_CHECK_CALLS
 #define GL_ERROR(condition) \
-			if (condition) { GLenum glError = glGetError(); if (glError != GL_NO_ERROR) { Log(tinyngine::Logger::Error, "GL error 0x%x %s", glError, tinyngine::gl::GetErrorString(glError)); abort(); } }
+			if ((condition) && tinyngine::gl::GetErrorCheckMode() != tinyngine::ErrorCheckMode::Off) { tinyngine::gl::CheckErrors(#condition, __FILE__, __LINE__); }
 
 #define GL_CHECK(_call) \
 			for(;;) { \
+			tinyngine::gl::SetCallSite(#_call, __FILE__, __LINE__); \
 			_call; \
-			GLenum glError = glGetError(); \
-			if (glError != GL_NO_ERROR) { Log(tinyngine::Logger::Error, "GL error 0x%x %s", glError, tinyngine::gl::GetErrorString(glError)); abort(); } \
+			if (tinyngine::gl::GetErrorCheckMode() == tinyngine::ErrorCheckMode::PerCall) { tinyngine::gl::CheckErrors(#_call, __FILE__, __LINE__); } \
 			break; }
+#else
+#define GL_ERROR(condition) \
+			(void)(condition)
+
+#define GL_CHECK(_call) \
+			for(;;) { \
+			_call; \
+			break; }
+#endif
@@ -0,0 +1,145 @@
+#include "GpuTimerGL.h"
+#include "Profiler.h"
+
+namespace tinyngine
+{
+
+bool GpuTimerGL::Initialize() {
+	mEnabled = tinyngine::gl::InitTimerQueries();
+	if (mEnabled) {
+		Calibrate();
+		BeginFrame();
+	}
+	return mEnabled;
+}
+
+void GpuTimerGL::Terminate() {
+	if (!mQueries.empty()) {
+		tinyngine::gl::DeleteQueries(static_cast<GLsizei>(mQueries.size()), mQueries.data());
+	}
+	mQueries.clear();
+	mFreeQueries.clear();
+	for (auto& frame : mFrames) {
+		frame.mRanges.clear();
+	}
+	mOpenRanges.clear();
+	mPending = 0;
+	mEnabled = false;
+}
+
+void GpuTimerGL::BeginScope(const char* name) {
+	if (!mEnabled) {
+		return;
+	}
+	Frame& frame = mFrames[mCurrent];
+	GLuint query = AllocQuery();
+	tinyngine::gl::QueryTimestamp(query);
+	mOpenRanges.push_back(static_cast<uint32_t>(frame.mRanges.size()));
+	frame.mRanges.push_back({ name, query, 0, static_cast<uint16_t>(mOpenRanges.size() - 1) });
+}
+
+void GpuTimerGL::EndScope() {
+	// the frame range is closed by EndFrame only
+	if (!mEnabled || mOpenRanges.size() <= 1) {
+		return;
+	}
+	Range& range = mFrames[mCurrent].mRanges[mOpenRanges.back()];
+	mOpenRanges.pop_back();
+	range.mEnd = AllocQuery();
+	tinyngine::gl::QueryTimestamp(range.mEnd);
+}
+
+void GpuTimerGL::EndFrame() {
+	if (!mEnabled) {
+		return;
+	}
+	while (mOpenRanges.size() > 1) {
+		EndScope();
+	}
+	Range& frameRange = mFrames[mCurrent].mRanges[mOpenRanges.back()];
+	mOpenRanges.pop_back();
+	frameRange.mEnd = AllocQuery();
+	tinyngine::gl::QueryTimestamp(frameRange.mEnd);
+
+	mPending++;
+	mCurrent = (mCurrent + 1) % cGpuTimerFramesCount;
+
+	// frames complete in order, stop at the first one still running
+	bool disjoint = tinyngine::gl::IsTimerDisjoint();
+	while (mPending > 0) {
+		Frame& oldest = mFrames[(mCurrent + cGpuTimerFramesCount - mPending) % cGpuTimerFramesCount];
+		if (!IsAvailable(oldest)) {
+			break;
+		}
+		if (!disjoint) {
+			Resolve(oldest);
+		}
+		ReleaseFrame(oldest);
+		mPending--;
+	}
+	if (disjoint) {
+		Calibrate();
+	}
+
+	// the slot of the next frame is still waited for, drop it instead of stalling
+	if (mPending == cGpuTimerFramesCount) {
+		ReleaseFrame(mFrames[mCurrent]);
+		mPending--;
+	}
+
+	BeginFrame();
+}
+
+GLuint GpuTimerGL::AllocQuery() {
+	if (mFreeQueries.empty()) {
+		GLuint query = 0;
+		tinyngine::gl::GenQueries(1, &query);
+		mQueries.push_back(query);
+		return query;
+	}
+	GLuint query = mFreeQueries.back();
+	mFreeQueries.pop_back();
+	return query;
+}
+
+void GpuTimerGL::BeginFrame() {
+	BeginScope("Frame");
+}
+
+void GpuTimerGL::ReleaseFrame(Frame& frame) {
+	for (const auto& range : frame.mRanges) {
+		mFreeQueries.push_back(range.mBegin);
+		if (range.mEnd != 0) {
+			mFreeQueries.push_back(range.mEnd);
+		}
+	}
+	frame.mRanges.clear();
+}
+
+// the frame range ends last
+bool GpuTimerGL::IsAvailable(const Frame& frame) const {
+	return frame.mRanges.empty() || tinyngine::gl::IsQueryAvailable(frame.mRanges.front().mEnd);
+}
+
+void GpuTimerGL::Resolve(Frame& frame) {
+	for (const auto& range : frame.mRanges) {
+		if (range.mEnd == 0) {
+			continue;
+		}
+		int64_t begin = static_cast<int64_t>(tinyngine::gl::GetQueryTimestamp(range.mBegin)) + mOffset;
+		int64_t end = static_cast<int64_t>(tinyngine::gl::GetQueryTimestamp(range.mEnd)) + mOffset;
+		Profiler::RecordGpuRange(range.mName, begin, end, range.mDepth);
+	}
+}
+
+// waits for the GPU once, only at start up and after a disjoint event
+void GpuTimerGL::Calibrate() {
+	GLuint query = AllocQuery();
+	tinyngine::gl::QueryTimestamp(query);
+	GL_CHECK(glFinish());
+	int64_t now = Profiler::GetTime();
+	mOffset = now - static_cast<int64_t>(tinyngine::gl::GetQueryTimestamp(query));
+	mFreeQueries.push_back(query);
+}
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "GLApi.h"
+
+#include <array>
+#include <vector>
+
+namespace tinyngine
+{
+
+// frames of queries in flight
+static constexpr uint32_t cGpuTimerFramesCount = 4;
+
+// GPU ranges timed with EXT_disjoint_timer_query timestamps, on the thread owning the context. The results of a frame
+// are read once available, a few frames later, and handed to the Profiler; frames still pending when the queries
+// run out are dropped rather than waited for. Depth 0 is the whole frame.
+class GpuTimerGL final {
+public:
+	GpuTimerGL() = default;
+
+	GpuTimerGL(const GpuTimerGL& other) = delete;
+	GpuTimerGL& operator=(const GpuTimerGL& other) = delete;
+
+	// returns false when timestamps are not supported, the other calls do nothing then
+	bool Initialize();
+	void Terminate();
+
+	void BeginScope(const char* name);
+	void EndScope();
+	void EndFrame();
+
+private:
+	struct Range {
+		const char* mName;
+		GLuint mBegin;
+		GLuint mEnd;
+		uint16_t mDepth;
+	};
+
+	struct Frame {
+		std::vector<Range> mRanges;
+	};
+
+	GLuint AllocQuery();
+	void BeginFrame();
+	void ReleaseFrame(Frame& frame);
+	bool IsAvailable(const Frame& frame) const;
+	void Resolve(Frame& frame);
+	void Calibrate();
+
+private:
+	std::array<Frame, cGpuTimerFramesCount> mFrames;
+	uint32_t mCurrent = 0;
+	uint32_t mPending = 0;
+	std::vector<uint32_t> mOpenRanges;
+	std::vector<GLuint> mFreeQueries;
+	std::vector<GLuint> mQueries;
+	int64_t mOffset = 0; // Profiler::GetTime minus GPU time
+	bool mEnabled = false;
+};
+
+} // namespace tinyngine
\ No newline at end of file
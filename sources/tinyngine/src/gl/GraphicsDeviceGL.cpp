@@ -2,12 +2,25 @@
 #include "PlatformDefine.h"
 #include "ShaderGL.h"
 #include "ProgramGL.h"
+#include "ProgramCacheGL.h"
 #include "VertexBufferGL.h"
 #include "IndexBufferGL.h"
 #include "TextureGL.h"
+#include "TextureStreamerGL.h"
+#include "RenderStateGL.h"
+#include "GpuTimerGL.h"
+#include "CommandBucket.h"
+#include "HandlePool.h"
+#include "RenderQueue.h"
+#include "Log.h"
+#include "Profiler.h"
 
 #include <array>
+#include <string>
 #include <unordered_map>
+#include <vector>
+#include <cstring>
+#include <algorithm>
 
 namespace
 {
@@ -17,177 +30,1897 @@ static constexpr uint32_t cMaxProgramHandles = (1 << 6);
 static constexpr uint32_t cMaxVertexBufferHandles = (1 << 10);
 static constexpr uint32_t cMaxIndexBufferHandle = (1 << 10);
 static constexpr uint32_t cMaxTextureHandle = (1 << 10);
+static constexpr uint32_t cMaxRenderStateHandles = (1 << 8);
+
+// number of Commit calls a destroyed resource is kept alive for, covering the frames the driver may still have queued
+static constexpr uint64_t cMaxFramesInFlight = 2;
+
+// frames of jobs the render thread can be behind the application thread: the one it runs and the one being recorded
+static constexpr uint64_t cMaxQueuedFrames = 2;
+
+// transient geometry is streamed into one ring per frame in flight, each orphaned when it comes around again
+static constexpr uint32_t cTransientBuffersCount = static_cast<uint32_t>(cMaxFramesInFlight) + 1;
+static constexpr uint32_t cTransientVertexBufferSize = (4 << 20);
+static constexpr uint32_t cTransientIndexBufferSize = (1 << 20);
+static constexpr uint32_t cTransientAlignment = 16;
+
+// without instanced arrays, instances drawn by a single draw call, the geometry is copied that many times
+static constexpr uint32_t cMaxInstancesPerBatch = 64;
+// frames a copied geometry is kept for without being drawn
+static constexpr uint64_t cInstancedGeometryLifetime = 60;
+
+// the define goes after the #version directive, which must come first
+static std::string AddDefine(const char* source, const char* define) {
+	std::string text(source);
+	size_t position = text.find_first_not_of(" \t\r\n");
+	if (position != std::string::npos && text.compare(position, 8, "#version") == 0) {
+		position = text.find('\n', position);
+		position = (position == std::string::npos ? text.size() : position + 1);
+	} else {
+		position = 0;
+	}
+	return text.insert(position, std::string("#define ") + define + "\n");
+}
 
 }
 
 namespace tinyngine
 {
 
+// Last values sent to GL for the pipeline state that is not covered by the enable bits cache.
+struct StateShadow {
+	enum Bits : uint32_t {
+		BlendFunc = 1 << 0,
+		BlendColor = 1 << 1,
+		DepthFunc = 1 << 2,
+		DepthMask = 1 << 3,
+		StencilFunc = 1 << 4,
+		StencilOp = 1 << 5,
+		StencilMask = 1 << 6,
+		CullFace = 1 << 7,
+		FrontFace = 1 << 8,
+		PolygonOffset = 1 << 9,
+		ColorMask = 1 << 10
+	};
+
+	uint32_t mKnown = 0;
+	GLenum mBlendSrc = GL_ONE;
+	GLenum mBlendDst = GL_ZERO;
+	Color mBlendColor;
+	GLenum mDepthFunc = GL_LESS;
+	GLboolean mDepthMask = GL_TRUE;
+	GLenum mStencilFunc = GL_ALWAYS;
+	GLint mStencilRef = 0;
+	GLuint mStencilReadMask = UINT32_MAX;
+	GLenum mStencilFail = GL_KEEP;
+	GLenum mStencilDepthFail = GL_KEEP;
+	GLenum mStencilDepthPass = GL_KEEP;
+	GLuint mStencilWriteMask = UINT32_MAX;
+	GLenum mCullFace = GL_BACK;
+	GLenum mFrontFace = GL_CCW;
+	GLfloat mPolygonOffsetFactor = 0.0f;
+	GLfloat mPolygonOffsetUnits = 0.0f;
+	uint8_t mColorMask = ColorMask::All;
+};
+
+struct PendingDestroy {
+	enum Type {
+		VertexBuffer,
+		IndexBuffer,
+		Texture,
+		Program,
+		Shader
+	};
+
+	Type mType;
+	ResourceHandle mHandle;
+	uint64_t mFrame;
+};
+
+struct CompilingProgram {
+	ProgramHandle mHandle;
+	uint64_t mCacheKey;
+};
+
+struct TransientRing {
+	std::array<ResourceHandle, cTransientBuffersCount> mBuffers;
+	uint32_t mSize = 0;
+	uint32_t mCurrent = 0;
+	uint32_t mOffset = 0;
+	bool mCreated = false;
+	bool mOrphaned = false;
+};
+
+// Geometry of a draw copied once per instance of a batch, with the index of the copy as a float attribute, so
+// that the pseudo-instanced draws cover a batch of instances with a single draw call.
+struct InstancedGeometry {
+	VertexBufferHandle mVertexBuffer = ResourceHandle(cInvalidHandle);
+	uint32_t mVertexBufferOffset = 0;
+	VertexFormat mVertexFormat;
+	IndexBufferHandle mIndexBuffer = ResourceHandle(cInvalidHandle);
+	uint32_t mIndexBufferOffset = 0;
+	IndexType::Enum mIndexType = IndexType::Uint16;
+	uint32_t mFirst = 0;
+	uint32_t mCount = 0;
+	uint32_t mVertexVersion = 0;
+	uint32_t mIndexVersion = 0;
+	uint32_t mRequestedBatchSize = 0;
+	// copies actually made, 0 when the geometry cannot be copied
+	uint32_t mBatchSize = 0;
+	GLuint mVertices = 0;
+	GLuint mInstanceIndices = 0;
+	GLuint mIndices = 0;
+	GLenum mCopyIndexType = GL_UNSIGNED_SHORT;
+	uint64_t mLastUsedFrame = 0;
+};
+
+// With a render thread, members are owned by one of the two threads: the handle pools bookkeeping, pending
+// destroys and transient rings offsets belong to the application thread, everything touching GL or the GL objects
+// belongs to the render thread. Pool slots are only read by the render thread and only released by the application
+// thread once the render thread cannot reference them anymore.
 struct GraphicsDeviceGL::Impl {
-	uint32_t mVertexBuffersCount = 0;
-	std::array<VertexBufferGL, cMaxVertexBufferHandles> mVertexBuffers;
+	explicit Impl(RenderQueue& queue) : mQueue(queue) {}
+
+	RenderQueue& mQueue;
+
+	HandlePool<VertexBufferGL, cMaxVertexBufferHandles> mVertexBuffers;
 	std::array<GLuint, Attributes::Count> mAttributesVertexBufferHandles;
+	std::array<uint32_t, Attributes::Count> mAttributesVertexBufferOffsets;
+	bool mInterleavedVertexBuffer = false;
 
-	uint32_t mIndexBuffersCount = 0;
-	std::array<IndexBufferGL, cMaxIndexBufferHandle> mIndexBuffers;
+	HandlePool<IndexBufferGL, cMaxIndexBufferHandle> mIndexBuffers;
+	GLuint mBoundIndexBufferId = 0;
+	uint32_t mIndexBufferOffset = 0;
+	IndexType::Enum mIndexType = IndexType::Uint32;
+	std::vector<uint16_t> mIndexScratch;
+	// buffers created from 32 bit indices and stored as 16 bit, indexed by pool slot, owned by the application thread
+	std::array<bool, cMaxIndexBufferHandle> mIndexBuffersNarrowed{};
 
-	uint32_t mShadersCount = 0;
-	std::array<ShaderGL, cMaxShaderHandles> mShaders;
+	TransientRing mTransientVertices;
+	TransientRing mTransientIndices;
 
-	uint32_t mProgramsCount = 0;
-	std::array<ProgramGL, cMaxProgramHandles> mPrograms;
+	// instance elements of the frame, kept on the CPU for the draws without instanced arrays
+	std::vector<uint8_t> mInstanceData;
+	std::vector<InstancedGeometry> mInstancedGeometries;
+	std::vector<float> mInstanceUniforms;
+	uint64_t mRenderFrameIndex = 0;
+
+	HandlePool<ShaderGL, cMaxShaderHandles> mShaders;
+
+	HandlePool<ProgramGL, cMaxProgramHandles> mPrograms;
 	ProgramHandle mCurrentProgramHandle = ResourceHandle(cInvalidHandle);
 	ProgramGL mInvalidProgram;
+	bool mProgramsPending = false;
+	ProgramCacheGL mProgramCache;
+	// written by the render thread, read by GetProgramStatus, indexed by pool slot
+	std::array<std::atomic<uint8_t>, cMaxProgramHandles> mProgramStatus;
+	std::vector<CompilingProgram> mCompilingPrograms;
+
+	HandlePool<TextureGL, cMaxTextureHandle> mTextures;
+	TextureStreamerGL mTextureStreamer;
+	// written by the render thread once a streamed texture is uploaded, indexed by pool slot
+	std::array<std::atomic<bool>, cMaxTextureHandle> mTexturesResident;
+	std::vector<TextureHandle> mStreamedTextures;
 
-	uint32_t mTexturesCount = 0;
-	std::array<TextureGL, cMaxTextureHandle> mTextures;
+	std::vector<PendingDestroy> mPendingDestroys;
+	std::vector<PendingDestroy> mPendingFrees;
+	uint64_t mFrameIndex = 0;
 
 	std::array<uint8_t, RendererStateType::Count> mStatesCache;
+	StateShadow mShadow;
+
+	HandlePool<RenderStateGL, cMaxRenderStateHandles> mRenderStates;
+
+	GraphicsCaps mCaps;
+	std::atomic<bool> mCapsQueried{ false };
+
+	GpuTimerGL mGpuTimer;
+
+	GraphicsStats mFrameStats;
+	// indexed by frame parity, the render thread fills one while the application thread reads the other
+	std::array<GraphicsStats, 2> mLastFrameStats;
+
+	SubmissionMode::Enum mSubmissionMode = SubmissionMode::Immediate;
+	CommandBucket mCommandBucket;
+	DrawCommand mPendingDraw;
+	std::vector<float> mTransposedScratch;
+	// fixed function state when deferred submission started, draws get it for what they do not set themselves
+	StateShadow mDeferredShadow;
+	std::array<uint8_t, RendererStateType::Count> mDeferredStates{};
+	uint8_t mSortLayer = 0;
+	float mSortDepth = 0.0f;
+
+	bool ShouldApply(uint32_t bit, bool unchanged);
+	void ApplyState(RendererStateType::Enum type, bool value);
+	void ApplyBlendFunc(GLenum src, GLenum dst);
+	void ApplyBlendColor(Color color);
+	void ApplyDepthFunc(GLenum func);
+	void ApplyDepthMask(GLboolean flag);
+	void ApplyStencilFunc(GLenum func, GLint ref, GLuint mask);
+	void ApplyStencilOp(GLenum sfail, GLenum dpfail, GLenum dppass);
+	void ApplyStencilMask(GLuint mask);
+	void ApplyCullFace(GLenum mode);
+	void ApplyFrontFace(GLenum mode);
+	void ApplyPolygonOffset(GLfloat factor, GLfloat units);
+	void ApplyColorMask(uint8_t mask);
+	void ApplyRenderState(const RenderStateGL& renderState);
+	void ApplyDrawState(const DrawCommand& draw);
+	void SetAttributeStream(Attributes::Enum attribute, const VertexBufferHandle& handle, uint32_t offset);
+	void SetInterleavedStream(const VertexBufferHandle& handle, uint32_t offset);
+	void BindProgram(const ProgramHandle& handle, const VertexFormat& vertexFormat);
+	bool HasUniform(const ProgramHandle& handle, const UniformHandle& uniformHandle);
+	void RecordUniform(const ProgramHandle& handle, const UniformHandle& uniformHandle, const void* data, uint32_t size);
+	void FlushRecordedUniforms();
+	void CountUniformUpload(bool uploaded);
+	void SetProgramStatus(const ProgramHandle& handle, ProgramStatus::Enum status);
+	void PollPrograms(bool wait);
+	void SetTextureResident(const TextureHandle& handle, bool resident);
+	void StreamTextures();
+	void CompleteProgram(const ProgramHandle& handle);
+
+	void ResetPendingDraw();
+	void RecordDraw(PrimitiveType::Enum primitive, uint32_t first, uint32_t count, bool indexed, uint32_t instancesCount);
+	void DrawInstanced(const DrawCommand& instances, GLenum primitive, uint32_t first, uint32_t count, bool indexed, GLenum indexType, uint32_t indexOffset);
+	void DrawPseudoInstanced(const DrawCommand& instances, GLenum primitive, uint32_t first, uint32_t count, bool indexed, GLenum indexType, uint32_t indexOffset);
+	const InstancedGeometry* FindInstancedGeometry(const DrawCommand& draw, uint32_t first, uint32_t count, bool indexed, uint32_t batchSize);
+	void BuildInstancedGeometry(InstancedGeometry& geometry);
+	void DeleteInstancedGeometry(InstancedGeometry& geometry);
+	template<typename Predicate>
+	void ReleaseInstancedGeometries(Predicate predicate);
+	void ResetInstanceData();
+	void Replay();
+	void BeginDeferred();
+	void EndDeferred();
+	void EndFrame(uint32_t statsSlot);
+
+	const GraphicsCaps& QueryCaps();
+	const GraphicsCaps& GetCaps();
+	void BindIndexBuffer(GLuint id);
+	void RestoreIndexBuffer();
+	bool AllocTransient(TransientRing& ring, bool indices, const void* data, uint32_t size, TransientBuffer& buffer);
+	void AdvanceTransient(TransientRing& ring);
+
+	template<typename T, uint32_t Size, typename CreateFunc>
+	ResourceHandle CreateResource(HandlePool<T, Size>& pool, CreateFunc create);
+
+	void QueueDestroy(PendingDestroy::Type type, const ResourceHandle& handle);
+	void ReleasePendingDestroys(bool all);
+	void DestroyObject(PendingDestroy::Type type, const ResourceHandle& handle);
+	void FreeSlot(PendingDestroy::Type type, const ResourceHandle& handle);
+	void ReleaseSlot(PendingDestroy::Type type, const ResourceHandle& handle);
+	void ReleasePendingFrees(bool all);
 };
 
-//=====================================================================================================================
+bool GraphicsDeviceGL::Impl::ShouldApply(uint32_t bit, bool unchanged) {
+	if ((mShadow.mKnown & bit) && unchanged) {
+		mFrameStats.mStateChangesElided++;
+		return false;
+	}
+	mShadow.mKnown |= bit;
+	mFrameStats.mStateChanges++;
+	return true;
+}
 
-GraphicsDeviceGL::GraphicsDeviceGL() : mImpl(new Impl()) {
-	std::fill(std::begin(mImpl->mStatesCache), std::end(mImpl->mStatesCache), UINT8_MAX);
+void GraphicsDeviceGL::Impl::ApplyState(RendererStateType::Enum type, bool value) {
+	if (mStatesCache[type] != UINT8_MAX && (mStatesCache[type] ? 1 : 0) == value) {
+		mFrameStats.mStateChangesElided++;
+		return;
+	}
+	mFrameStats.mStateChanges++;
+	GLenum cap = tinyngine::gl::GetRendererStateType(type);
+	mStatesCache[type] = value ? 1 : 0;
+	if (value) {
+		GL_CHECK(glEnable(cap));
+		return;
+	}
+	GL_CHECK(glDisable(cap));
 }
 
-GraphicsDeviceGL::~GraphicsDeviceGL() {
-	GL_CHECK(glUseProgram(0));
+void GraphicsDeviceGL::Impl::ApplyBlendFunc(GLenum src, GLenum dst) {
+	if (ShouldApply(StateShadow::BlendFunc, mShadow.mBlendSrc == src && mShadow.mBlendDst == dst)) {
+		mShadow.mBlendSrc = src;
+		mShadow.mBlendDst = dst;
+		GL_CHECK(glBlendFunc(src, dst));
+	}
+}
+
+void GraphicsDeviceGL::Impl::ApplyBlendColor(Color color) {
+	const Color& last = mShadow.mBlendColor;
+	if (ShouldApply(StateShadow::BlendColor, last.r == color.r && last.g == color.g && last.b == color.b && last.a == color.a)) {
+		mShadow.mBlendColor = color;
+		GL_CHECK(glBlendColor(color.red(), color.green(), color.blue(), color.alpha()));
+	}
+}
+
+void GraphicsDeviceGL::Impl::ApplyDepthFunc(GLenum func) {
+	if (ShouldApply(StateShadow::DepthFunc, mShadow.mDepthFunc == func)) {
+		mShadow.mDepthFunc = func;
+		GL_CHECK(glDepthFunc(func));
+	}
+}
+
+void GraphicsDeviceGL::Impl::ApplyDepthMask(GLboolean flag) {
+	if (ShouldApply(StateShadow::DepthMask, mShadow.mDepthMask == flag)) {
+		mShadow.mDepthMask = flag;
+		GL_CHECK(glDepthMask(flag));
+	}
+}
+
+void GraphicsDeviceGL::Impl::ApplyStencilFunc(GLenum func, GLint ref, GLuint mask) {
+	if (ShouldApply(StateShadow::StencilFunc, mShadow.mStencilFunc == func && mShadow.mStencilRef == ref && mShadow.mStencilReadMask == mask)) {
+		mShadow.mStencilFunc = func;
+		mShadow.mStencilRef = ref;
+		mShadow.mStencilReadMask = mask;
+		GL_CHECK(glStencilFunc(func, ref, mask));
+	}
+}
+
+void GraphicsDeviceGL::Impl::ApplyStencilOp(GLenum sfail, GLenum dpfail, GLenum dppass) {
+	if (ShouldApply(StateShadow::StencilOp, mShadow.mStencilFail == sfail && mShadow.mStencilDepthFail == dpfail && mShadow.mStencilDepthPass == dppass)) {
+		mShadow.mStencilFail = sfail;
+		mShadow.mStencilDepthFail = dpfail;
+		mShadow.mStencilDepthPass = dppass;
+		GL_CHECK(glStencilOp(sfail, dpfail, dppass));
+	}
+}
+
+void GraphicsDeviceGL::Impl::ApplyStencilMask(GLuint mask) {
+	if (ShouldApply(StateShadow::StencilMask, mShadow.mStencilWriteMask == mask)) {
+		mShadow.mStencilWriteMask = mask;
+		GL_CHECK(glStencilMask(mask));
+	}
+}
+
+void GraphicsDeviceGL::Impl::ApplyCullFace(GLenum mode) {
+	if (ShouldApply(StateShadow::CullFace, mShadow.mCullFace == mode)) {
+		mShadow.mCullFace = mode;
+		GL_CHECK(glCullFace(mode));
+	}
+}
+
+void GraphicsDeviceGL::Impl::ApplyFrontFace(GLenum mode) {
+	if (ShouldApply(StateShadow::FrontFace, mShadow.mFrontFace == mode)) {
+		mShadow.mFrontFace = mode;
+		GL_CHECK(glFrontFace(mode));
+	}
+}
+
+void GraphicsDeviceGL::Impl::ApplyPolygonOffset(GLfloat factor, GLfloat units) {
+	if (ShouldApply(StateShadow::PolygonOffset, mShadow.mPolygonOffsetFactor == factor && mShadow.mPolygonOffsetUnits == units)) {
+		mShadow.mPolygonOffsetFactor = factor;
+		mShadow.mPolygonOffsetUnits = units;
+		GL_CHECK(glPolygonOffset(factor, units));
+	}
+}
+
+void GraphicsDeviceGL::Impl::ApplyColorMask(uint8_t mask) {
+	if (ShouldApply(StateShadow::ColorMask, mShadow.mColorMask == mask)) {
+		mShadow.mColorMask = mask;
+		GL_CHECK(glColorMask((mask & ColorMask::Red) != 0, (mask & ColorMask::Green) != 0, (mask & ColorMask::Blue) != 0, (mask & ColorMask::Alpha) != 0));
+	}
+}
+
+void GraphicsDeviceGL::Impl::ApplyRenderState(const RenderStateGL& renderState) {
+	for (uint8_t state = 0; state < RendererStateType::Count; state++) {
+		ApplyState(static_cast<RendererStateType::Enum>(state), (renderState.mEnabledStates & (1 << state)) != 0);
+	}
+
+	// parameters of disabled stages are left untouched, they are applied once the stage is enabled again
+	if (renderState.mEnabledStates & (1 << RendererStateType::Blend)) {
+		ApplyBlendFunc(renderState.mBlendSrc, renderState.mBlendDst);
+	}
+	if (renderState.mEnabledStates & (1 << RendererStateType::DepthTest)) {
+		ApplyDepthFunc(renderState.mDepthFunc);
+	}
+	if (renderState.mEnabledStates & (1 << RendererStateType::Stencil)) {
+		ApplyStencilFunc(renderState.mStencilFunc, renderState.mStencilRef, renderState.mStencilReadMask);
+		ApplyStencilOp(renderState.mStencilFail, renderState.mStencilDepthFail, renderState.mStencilDepthPass);
+	}
+	if (renderState.mEnabledStates & (1 << RendererStateType::CullFace)) {
+		ApplyCullFace(renderState.mCullFace);
+		ApplyFrontFace(renderState.mFrontFace);
+	}
+	if (renderState.mEnabledStates & (1 << RendererStateType::PolygonOffset)) {
+		ApplyPolygonOffset(renderState.mPolygonOffsetFactor, renderState.mPolygonOffsetUnits);
+	}
+	// write masks also affect Clear, keep them in sync regardless of the enable bits
+	ApplyDepthMask(renderState.mDepthMask);
+	ApplyStencilMask(renderState.mStencilWriteMask);
+	ApplyColorMask(renderState.mColorMask);
+}
+
+// A deferred draw is replayed with the state found when deferred submission started, overridden by its render state
+// and then by the states and parameters set after it. The whole state is resolved first so that each value is sent
+// once, the shadow elides the ones that did not change since the previous draw.
+void GraphicsDeviceGL::Impl::ApplyDrawState(const DrawCommand& draw) {
+	StateShadow state = mDeferredShadow;
+	uint8_t enabledStates = 0;
+	for (uint8_t type = 0; type < RendererStateType::Count; type++) {
+		// GL starts with every one of them disabled
+		if (mDeferredStates[type] == 1) {
+			enabledStates |= static_cast<uint8_t>(1 << type);
+		}
+	}
+
+	if (mRenderStates.IsValid(draw.mRenderState)) {
+		const RenderStateGL& renderState = mRenderStates.Get(draw.mRenderState);
+		enabledStates = renderState.mEnabledStates;
+		if (enabledStates & (1 << RendererStateType::Blend)) {
+			state.mBlendSrc = renderState.mBlendSrc;
+			state.mBlendDst = renderState.mBlendDst;
+		}
+		if (enabledStates & (1 << RendererStateType::DepthTest)) {
+			state.mDepthFunc = renderState.mDepthFunc;
+		}
+		if (enabledStates & (1 << RendererStateType::Stencil)) {
+			state.mStencilFunc = renderState.mStencilFunc;
+			state.mStencilRef = renderState.mStencilRef;
+			state.mStencilReadMask = renderState.mStencilReadMask;
+			state.mStencilFail = renderState.mStencilFail;
+			state.mStencilDepthFail = renderState.mStencilDepthFail;
+			state.mStencilDepthPass = renderState.mStencilDepthPass;
+		}
+		if (enabledStates & (1 << RendererStateType::CullFace)) {
+			state.mCullFace = renderState.mCullFace;
+			state.mFrontFace = renderState.mFrontFace;
+		}
+		if (enabledStates & (1 << RendererStateType::PolygonOffset)) {
+			state.mPolygonOffsetFactor = renderState.mPolygonOffsetFactor;
+			state.mPolygonOffsetUnits = renderState.mPolygonOffsetUnits;
+		}
+		state.mDepthMask = renderState.mDepthMask;
+		state.mStencilWriteMask = renderState.mStencilWriteMask;
+		state.mColorMask = renderState.mColorMask;
+	}
+	enabledStates = (enabledStates & ~draw.mStatesMask) | (draw.mStates & draw.mStatesMask);
+
+	const DrawParameters& parameters = draw.mParameters;
+	if (parameters.mMask & DrawParameters::BlendFunc) {
+		state.mBlendSrc = tinyngine::gl::GetBlendFunc(parameters.mBlendSrc);
+		state.mBlendDst = tinyngine::gl::GetBlendFunc(parameters.mBlendDst);
+	}
+	if (parameters.mMask & DrawParameters::BlendColor) {
+		state.mBlendColor = parameters.mBlendColor;
+	}
+	if (parameters.mMask & DrawParameters::DepthFunc) {
+		state.mDepthFunc = tinyngine::gl::GetDepthFunc(parameters.mDepthFunc);
+	}
+	if (parameters.mMask & DrawParameters::DepthMask) {
+		state.mDepthMask = parameters.mDepthMask ? GL_TRUE : GL_FALSE;
+	}
+	if (parameters.mMask & DrawParameters::StencilFunc) {
+		state.mStencilFunc = tinyngine::gl::GetStencilFunc(parameters.mStencilFunc);
+		state.mStencilRef = parameters.mStencilRef;
+		state.mStencilReadMask = parameters.mStencilReadMask;
+	}
+	if (parameters.mMask & DrawParameters::StencilOp) {
+		state.mStencilFail = tinyngine::gl::GetStencilOpType(parameters.mStencilFail);
+		state.mStencilDepthFail = tinyngine::gl::GetStencilOpType(parameters.mStencilDepthFail);
+		state.mStencilDepthPass = tinyngine::gl::GetStencilOpType(parameters.mStencilDepthPass);
+	}
+	if (parameters.mMask & DrawParameters::StencilMask) {
+		state.mStencilWriteMask = parameters.mStencilWriteMask;
+	}
+	if (parameters.mMask & DrawParameters::CullFace) {
+		state.mCullFace = tinyngine::gl::GetCullFaceMode(parameters.mCullFace);
+	}
+	if (parameters.mMask & DrawParameters::FrontFace) {
+		state.mFrontFace = tinyngine::gl::GetWindingMode(parameters.mFrontFace);
+	}
+	if (parameters.mMask & DrawParameters::PolygonOffset) {
+		state.mPolygonOffsetFactor = parameters.mPolygonOffsetFactor;
+		state.mPolygonOffsetUnits = parameters.mPolygonOffsetUnits;
+	}
+	if (parameters.mMask & DrawParameters::ColorMask) {
+		state.mColorMask = parameters.mColorMask;
+	}
+
+	for (uint8_t type = 0; type < RendererStateType::Count; type++) {
+		ApplyState(static_cast<RendererStateType::Enum>(type), (enabledStates & (1 << type)) != 0);
+	}
+	ApplyBlendFunc(state.mBlendSrc, state.mBlendDst);
+	ApplyBlendColor(state.mBlendColor);
+	ApplyDepthFunc(state.mDepthFunc);
+	ApplyDepthMask(state.mDepthMask);
+	ApplyStencilFunc(state.mStencilFunc, state.mStencilRef, state.mStencilReadMask);
+	ApplyStencilOp(state.mStencilFail, state.mStencilDepthFail, state.mStencilDepthPass);
+	ApplyStencilMask(state.mStencilWriteMask);
+	ApplyCullFace(state.mCullFace);
+	ApplyFrontFace(state.mFrontFace);
+	ApplyPolygonOffset(state.mPolygonOffsetFactor, state.mPolygonOffsetUnits);
+	ApplyColorMask(state.mColorMask);
+}
+
+void GraphicsDeviceGL::Impl::SetAttributeStream(Attributes::Enum attribute, const VertexBufferHandle& handle, uint32_t offset) {
+	mAttributesVertexBufferHandles[attribute] = mVertexBuffers.Get(handle).GetId();
+	mAttributesVertexBufferOffsets[attribute] = offset;
+	mInterleavedVertexBuffer = false;
+	mPendingDraw.mVertexBuffers[attribute] = handle;
+	mPendingDraw.mVertexBufferOffsets[attribute] = offset;
+	mPendingDraw.mInterleaved = false;
+}
+
+// the interleaved buffer is recorded in every attribute slot, so the sort key and the rebind checks see it
+void GraphicsDeviceGL::Impl::SetInterleavedStream(const VertexBufferHandle& handle, uint32_t offset) {
+	GLuint id = mVertexBuffers.Get(handle).GetId();
+	mAttributesVertexBufferHandles.fill(id);
+	mAttributesVertexBufferOffsets.fill(offset);
+	mInterleavedVertexBuffer = true;
+	std::fill(std::begin(mPendingDraw.mVertexBuffers), std::end(mPendingDraw.mVertexBuffers), handle);
+	mPendingDraw.mVertexBufferOffsets.fill(offset);
+	mPendingDraw.mInterleaved = true;
+}
+
+void GraphicsDeviceGL::Impl::BindProgram(const ProgramHandle& handle, const VertexFormat& vertexFormat) {
+	if (mCurrentProgramHandle.IsValid()) {
+		auto& program = mPrograms.Get(mCurrentProgramHandle);
+		program.UnbindAttributes();
+	}
+
+	// using a program still linking would wait for it, its draws are skipped instead
+	bool ready = mPrograms.IsValid(handle) && mPrograms.Get(handle).IsReady();
+	mCurrentProgramHandle = ready ? handle : ProgramHandle(cInvalidHandle);
+	if (mCurrentProgramHandle.IsValid()) {
+		auto& program = mPrograms.Get(mCurrentProgramHandle);
+		GL_CHECK(glUseProgram(program.GetId()));
+		if (mInterleavedVertexBuffer) {
+			program.BindAttributes(vertexFormat, mAttributesVertexBufferHandles[0], mAttributesVertexBufferOffsets[0]);
+		} else {
+			program.BindAttributes(vertexFormat, mAttributesVertexBufferHandles, mAttributesVertexBufferOffsets);
+		}
+	}
+}
+
+bool GraphicsDeviceGL::Impl::HasUniform(const ProgramHandle& handle, const UniformHandle& uniformHandle) {
+	return mPrograms.IsValid(handle) && mPrograms.Get(handle).HasUniform(uniformHandle);
+}
+
+// deferred uniforms are recorded per program, each draw takes a copy of the values of its own program
+void GraphicsDeviceGL::Impl::RecordUniform(const ProgramHandle& handle, const UniformHandle& uniformHandle, const void* data, uint32_t size) {
+	auto& program = mPrograms.Get(handle);
+	const Uniform& uniform = program.GetUniform(uniformHandle);
+	mCommandBucket.SetUniform(handle, program.GetUniformShadow(), uniform.mShadowOffset, data, size);
+}
+
+// the values recorded after the last draw of a program still apply once draws are immediate again
+void GraphicsDeviceGL::Impl::FlushRecordedUniforms() {
+	for (const auto& recorded : mCommandBucket.GetRecordedUniforms()) {
+		if (!mPrograms.IsValid(recorded.mProgram) || !mPrograms.Get(recorded.mProgram).IsReady()) {
+			continue;
+		}
+		auto& program = mPrograms.Get(recorded.mProgram);
+		GL_CHECK(glUseProgram(program.GetId()));
+		mFrameStats.mUniformUploads += program.SetUniforms(recorded.mValues.data(), recorded.mValues.size());
+	}
+	mCommandBucket.ClearRecordedUniforms();
+	GL_CHECK(glUseProgram(mCurrentProgramHandle.IsValid() ? mPrograms.Get(mCurrentProgramHandle).GetId() : 0));
+}
+
+void GraphicsDeviceGL::Impl::CountUniformUpload(bool uploaded) {
+	if (uploaded) {
+		mFrameStats.mUniformUploads++;
+	} else {
+		mFrameStats.mUniformUploadsElided++;
+	}
+}
+
+void GraphicsDeviceGL::Impl::SetProgramStatus(const ProgramHandle& handle, ProgramStatus::Enum status) {
+	mProgramStatus[HandlePool<ProgramGL, cMaxProgramHandles>::GetIndex(handle)] = static_cast<uint8_t>(status);
+}
+
+// without KHR_parallel_shader_compile the completion cannot be polled, the programs submitted during the frame
+// are waited for at its end
+void GraphicsDeviceGL::Impl::PollPrograms(bool wait) {
+	for (size_t n = 0; n < mCompilingPrograms.size();) {
+		const CompilingProgram& compiling = mCompilingPrograms[n];
+		auto& program = mPrograms.Get(compiling.mHandle);
+		if (!program.Poll(wait)) {
+			n++;
+			continue;
+		}
+		mProgramCache.Complete(program, compiling.mCacheKey);
+		SetProgramStatus(compiling.mHandle, program.IsValid() ? ProgramStatus::Ready : ProgramStatus::Failed);
+		mCompilingPrograms[n] = mCompilingPrograms.back();
+		mCompilingPrograms.pop_back();
+	}
+}
+
+void GraphicsDeviceGL::Impl::CompleteProgram(const ProgramHandle& handle) {
+	for (auto& compiling : mCompilingPrograms) {
+		if (compiling.mHandle.mHandle == handle.mHandle) {
+			std::swap(compiling, mCompilingPrograms.back());
+			auto& program = mPrograms.Get(handle);
+			program.Poll(true);
+			mProgramCache.Complete(program, mCompilingPrograms.back().mCacheKey);
+			SetProgramStatus(handle, program.IsValid() ? ProgramStatus::Ready : ProgramStatus::Failed);
+			mCompilingPrograms.pop_back();
+			return;
+		}
+	}
+}
+
+void GraphicsDeviceGL::Impl::ResetPendingDraw() {
+	mPendingDraw.mProgram = ProgramHandle(cInvalidHandle);
+	mPendingDraw.mVertexFormat = VertexFormat();
+	std::fill(std::begin(mPendingDraw.mVertexBuffers), std::end(mPendingDraw.mVertexBuffers), VertexBufferHandle(cInvalidHandle));
+	mPendingDraw.mVertexBufferOffsets.fill(0);
+	mPendingDraw.mInterleaved = false;
+	mPendingDraw.mIndexBuffer = IndexBufferHandle(cInvalidHandle);
+	mPendingDraw.mIndexBufferOffset = 0;
+	mPendingDraw.mIndexType = IndexType::Uint32;
+	mPendingDraw.mRenderState = RenderStateHandle(cInvalidHandle);
+	std::fill(std::begin(mPendingDraw.mTextures), std::end(mPendingDraw.mTextures), TextureHandle(cInvalidHandle));
+	mPendingDraw.mStates = 0;
+	mPendingDraw.mStatesMask = 0;
+	mPendingDraw.mParameters.mMask = 0;
+	ResetInstanceData();
+}
+
+void GraphicsDeviceGL::Impl::RecordDraw(PrimitiveType::Enum primitive, uint32_t first, uint32_t count, bool indexed, uint32_t instancesCount) {
+	mPendingDraw.mPrimitive = primitive;
+	mPendingDraw.mFirst = first;
+	mPendingDraw.mCount = count;
+	mPendingDraw.mIndexed = indexed;
+	mPendingDraw.mInstancesCount = instancesCount;
+
+	uint64_t key = SortKey::Encode(mSortLayer, mPendingDraw.mProgram.mHandle, mPendingDraw.mTextures[0].mHandle, mPendingDraw.mVertexBuffers[Attributes::Position].mHandle, mSortDepth);
+	mCommandBucket.Submit(key, mPendingDraw);
+}
+
+void GraphicsDeviceGL::Impl::Replay() {
+	TINYNGINE_PROFILE_SCOPE("Replay");
+	mCommandBucket.Sort();
+
+	const DrawCommand* last = nullptr;
+	std::array<uint32_t, cMaxTextureStages> boundTextures;
+	std::fill(std::begin(boundTextures), std::end(boundTextures), cInvalidHandle);
+
+	uint32_t drawsCount = mCommandBucket.GetDrawsCount();
+	for (uint32_t n = 0; n < drawsCount; n++) {
+		const DrawCommand& draw = mCommandBucket.GetSortedDraw(n);
+
+		// padding makes the parameters comparison conservative, a false difference only costs elided state changes
+		bool stateChanged = last == nullptr || last->mRenderState.mHandle != draw.mRenderState.mHandle
+			|| last->mStates != draw.mStates || last->mStatesMask != draw.mStatesMask || last->mParameters.mMask != draw.mParameters.mMask
+			|| (draw.mParameters.mMask != 0 && std::memcmp(&last->mParameters, &draw.mParameters, sizeof(DrawParameters)) != 0);
+		if (stateChanged) {
+			ApplyDrawState(draw);
+		}
+
+		bool rebind = last == nullptr || last->mProgram.mHandle != draw.mProgram.mHandle || last->mInterleaved != draw.mInterleaved
+			|| std::memcmp(&last->mVertexBuffers[0], &draw.mVertexBuffers[0], sizeof(draw.mVertexBuffers)) != 0
+			|| std::memcmp(&last->mVertexBufferOffsets[0], &draw.mVertexBufferOffsets[0], sizeof(draw.mVertexBufferOffsets)) != 0
+			|| std::memcmp(&last->mVertexFormat, &draw.mVertexFormat, sizeof(VertexFormat)) != 0;
+		last = &draw;
+		if (rebind) {
+			for (uint32_t attrib = 0; attrib < Attributes::Count; attrib++) {
+				const VertexBufferHandle& handle = draw.mVertexBuffers[attrib];
+				mAttributesVertexBufferHandles[attrib] = handle.IsValid() ? mVertexBuffers.Get(handle).GetId() : 0;
+				mAttributesVertexBufferOffsets[attrib] = draw.mVertexBufferOffsets[attrib];
+			}
+			mInterleavedVertexBuffer = draw.mInterleaved;
+			BindProgram(draw.mProgram, draw.mVertexFormat);
+		}
+		if (!mCurrentProgramHandle.IsValid()) {
+			mFrameStats.mDrawsSkipped++;
+			continue;
+		}
+
+		for (uint32_t stage = 0; stage < cMaxTextureStages; stage++) {
+			const TextureHandle& handle = draw.mTextures[stage];
+			if (handle.IsValid() && boundTextures[stage] != handle.mHandle) {
+				mTextures.Get(handle).Bind(stage);
+				boundTextures[stage] = handle.mHandle;
+			}
+		}
+
+		if (draw.mUniformsOffset != UINT32_MAX) {
+			auto& program = mPrograms.Get(mCurrentProgramHandle);
+			const uint8_t* values = mCommandBucket.GetUniforms(draw);
+			mFrameStats.mUniformUploads += program.SetUniforms(values, program.GetUniformShadow().size());
+		}
+
+		GLenum primitive = tinyngine::gl::GetPrimitiveType(draw.mPrimitive);
+		if (draw.mIndexed && draw.mIndexBuffer.IsValid()) {
+			BindIndexBuffer(mIndexBuffers.Get(draw.mIndexBuffer).GetId());
+		}
+		if (draw.mInstancesCount > 0) {
+			DrawInstanced(draw, primitive, draw.mFirst, draw.mCount, draw.mIndexed, tinyngine::gl::GetIndexType(draw.mIndexType), draw.mIndexBufferOffset);
+		} else if (draw.mIndexed) {
+			GL_CHECK(glDrawElements(primitive, draw.mCount, tinyngine::gl::GetIndexType(draw.mIndexType), reinterpret_cast<const void*>(static_cast<uintptr_t>(draw.mIndexBufferOffset))));
+		} else {
+			GL_CHECK(glDrawArrays(primitive, draw.mFirst, draw.mCount));
+		}
+	}
+
+	mCommandBucket.Reset();
+}
+
+void GraphicsDeviceGL::Impl::BeginDeferred() {
+	mDeferredShadow = mShadow;
+	mDeferredStates = mStatesCache;
+	mPendingDraw.mRenderState = RenderStateHandle(cInvalidHandle);
+	mPendingDraw.mStatesMask = 0;
+	mPendingDraw.mParameters.mMask = 0;
+}
+
+// the bindings and the state recorded last are the current ones for the immediate draws that follow
+void GraphicsDeviceGL::Impl::EndDeferred() {
+	Replay();
+	FlushRecordedUniforms();
+	ApplyDrawState(mPendingDraw);
+
+	for (uint32_t attrib = 0; attrib < Attributes::Count; attrib++) {
+		const VertexBufferHandle& handle = mPendingDraw.mVertexBuffers[attrib];
+		mAttributesVertexBufferHandles[attrib] = mVertexBuffers.IsValid(handle) ? mVertexBuffers.Get(handle).GetId() : 0;
+		mAttributesVertexBufferOffsets[attrib] = mPendingDraw.mVertexBufferOffsets[attrib];
+	}
+	mInterleavedVertexBuffer = mPendingDraw.mInterleaved;
+	BindProgram(mPendingDraw.mProgram, mPendingDraw.mVertexFormat);
+	if (mIndexBuffers.IsValid(mPendingDraw.mIndexBuffer)) {
+		BindIndexBuffer(mIndexBuffers.Get(mPendingDraw.mIndexBuffer).GetId());
+		mIndexBufferOffset = mPendingDraw.mIndexBufferOffset;
+		mIndexType = mPendingDraw.mIndexType;
+	}
+	for (uint32_t stage = 0; stage < cMaxTextureStages; stage++) {
+		const TextureHandle& handle = mPendingDraw.mTextures[stage];
+		if (mTextures.IsValid(handle)) {
+			mTextures.Get(handle).Bind(stage);
+		}
+	}
+}
+
+// The instance stream is bound around the draw only, so the attribute bindings cached for the following
+// draws stay untouched. Without instanced arrays, the programs declaring the pseudo-instancing inputs draw
+// batches of instances, the others draw every instance separately, fed through constant generic attribute values.
+void GraphicsDeviceGL::Impl::DrawInstanced(const DrawCommand& instances, GLenum primitive, uint32_t first, uint32_t count, bool indexed, GLenum indexType, uint32_t indexOffset) {
+	if (!mCurrentProgramHandle.IsValid()) {
+		mFrameStats.mDrawsSkipped++;
+		return;
+	}
+	auto& program = mPrograms.Get(mCurrentProgramHandle);
+	const VertexFormat& format = instances.mInstanceFormat;
+	const void* indices = reinterpret_cast<const void*>(static_cast<uintptr_t>(indexOffset));
+
+	if (QueryCaps().mInstancing) {
+		if (instances.mInstanceBuffer.IsValid()) {
+			program.BindInstanceAttributes(format, mVertexBuffers.Get(instances.mInstanceBuffer).GetId(), instances.mInstanceBufferOffset, instances.mInstanceDivisor);
+		}
+		if (indexed) {
+			GL_CHECK(tinyngine::gl::DrawElementsInstanced(primitive, count, indexType, indices, instances.mInstancesCount));
+		} else {
+			GL_CHECK(tinyngine::gl::DrawArraysInstanced(primitive, first, count, instances.mInstancesCount));
+		}
+		if (instances.mInstanceBuffer.IsValid()) {
+			program.UnbindInstanceAttributes(format);
+		}
+		return;
+	}
+
+	if (program.GetInstanceDataCapacity() > 0) {
+		DrawPseudoInstanced(instances, primitive, first, count, indexed, indexType, indexOffset);
+		return;
+	}
+
+	for (uint32_t n = 0; n < instances.mInstancesCount; n++) {
+		if (format.mStride > 0) {
+			size_t element = instances.mInstanceDataOffset + static_cast<size_t>(n / instances.mInstanceDivisor) * format.mStride;
+			if (element + format.mStride > mInstanceData.size()) {
+				break;
+			}
+			program.SetInstanceAttributes(format, &mInstanceData[element]);
+		}
+		if (indexed) {
+			GL_CHECK(glDrawElements(primitive, count, indexType, indices));
+		} else {
+			GL_CHECK(glDrawArrays(primitive, first, count));
+		}
+	}
+}
+
+// Every instance takes one vec4 of u_instanceData per attribute of the instance format. The batch is drawn from
+// copies of the geometry when it can be made, list primitives read from non transient interleaved buffers,
+// otherwise the instances are drawn one by one from the bound geometry, all with a_instanceIndex 0.
+void GraphicsDeviceGL::Impl::DrawPseudoInstanced(const DrawCommand& instances, GLenum primitive, uint32_t first, uint32_t count, bool indexed, GLenum indexType, uint32_t indexOffset) {
+	auto& program = mPrograms.Get(mCurrentProgramHandle);
+	const VertexFormat& format = instances.mInstanceFormat;
+	uint32_t capacity = program.GetInstanceDataCapacity();
+	uint32_t slots = 0;
+	for (uint8_t n = 0; n < Attributes::Count; n++) {
+		slots += (format.mStride > 0 && format.IsValid(static_cast<Attributes::Enum>(n))) ? 1 : 0;
+	}
+	if (slots > capacity) {
+		Log(Logger::Error, "u_instanceData holds %u vec4, an instance needs %u", capacity, slots);
+		mFrameStats.mDrawsSkipped++;
+		return;
+	}
+
+	uint32_t batchSize = std::min(slots > 0 ? capacity / slots : cMaxInstancesPerBatch, cMaxInstancesPerBatch);
+	const InstancedGeometry* geometry = nullptr;
+	if (primitive == GL_TRIANGLES || primitive == GL_LINES || primitive == GL_POINTS) {
+		geometry = FindInstancedGeometry(instances, first, count, indexed, batchSize);
+	}
+	if (geometry != nullptr && geometry->mBatchSize > 0) {
+		batchSize = std::min(batchSize, geometry->mBatchSize);
+		program.BindAttributes(instances.mVertexFormat, geometry->mVertices, 0);
+		program.BindInstanceIndex(geometry->mInstanceIndices);
+		if (indexed) {
+			GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry->mIndices));
+		}
+	} else {
+		geometry = nullptr;
+		batchSize = 1;
+		program.SetInstanceIndex(0.0f);
+	}
+
+	mInstanceUniforms.resize(static_cast<size_t>(batchSize) * slots * 4);
+	const void* indices = reinterpret_cast<const void*>(static_cast<uintptr_t>(indexOffset));
+	for (uint32_t n = 0; n < instances.mInstancesCount; n += batchSize) {
+		uint32_t batch = std::min(batchSize, instances.mInstancesCount - n);
+		if (slots > 0) {
+			float* values = mInstanceUniforms.data();
+			for (uint32_t instance = 0; instance < batch; instance++) {
+				size_t element = instances.mInstanceDataOffset + static_cast<size_t>((n + instance) / instances.mInstanceDivisor) * format.mStride;
+				if (element + format.mStride > mInstanceData.size()) {
+					batch = instance;
+					break;
+				}
+				for (uint8_t attrib = 0; attrib < Attributes::Count; attrib++) {
+					if (format.IsValid(static_cast<Attributes::Enum>(attrib))) {
+						values[0] = values[1] = values[2] = 0.0f;
+						values[3] = 1.0f;
+						format.Read(static_cast<Attributes::Enum>(attrib), &mInstanceData[element + format.mOffset[attrib]], values);
+						values += 4;
+					}
+				}
+			}
+			if (batch == 0) {
+				break;
+			}
+			CountUniformUpload(program.SetInstanceData(mInstanceUniforms.data(), batch * slots));
+		}
+
+		if (geometry != nullptr && indexed) {
+			GL_CHECK(glDrawElements(primitive, count * batch, geometry->mCopyIndexType, nullptr));
+		} else if (geometry != nullptr) {
+			GL_CHECK(glDrawArrays(primitive, 0, count * batch));
+		} else if (indexed) {
+			GL_CHECK(glDrawElements(primitive, count, indexType, indices));
+		} else {
+			GL_CHECK(glDrawArrays(primitive, first, count));
+		}
+	}
+
+	if (geometry != nullptr) {
+		program.UnbindInstanceIndex();
+		program.BindAttributes(instances.mVertexFormat, mAttributesVertexBufferHandles[0], mAttributesVertexBufferOffsets[0]);
+		if (indexed) {
+			GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBoundIndexBufferId));
+		}
+	}
+}
+
+// made from the CPU copy of the non transient buffers, rebuilt when the buffers are updated
+const InstancedGeometry* GraphicsDeviceGL::Impl::FindInstancedGeometry(const DrawCommand& draw, uint32_t first, uint32_t count, bool indexed, uint32_t batchSize) {
+	const VertexBufferHandle& vertexBufferHandle = draw.mVertexBuffers[Attributes::Position];
+	if (!draw.mInterleaved || !mVertexBuffers.IsValid(vertexBufferHandle) || mVertexBuffers.Get(vertexBufferHandle).GetCopy().empty()) {
+		return nullptr;
+	}
+	IndexBufferHandle indexBufferHandle = indexed ? draw.mIndexBuffer : IndexBufferHandle(cInvalidHandle);
+	if (indexed && (!mIndexBuffers.IsValid(indexBufferHandle) || mIndexBuffers.Get(indexBufferHandle).GetCopy().empty())) {
+		return nullptr;
+	}
+
+	uint32_t vertexVersion = mVertexBuffers.Get(vertexBufferHandle).GetVersion();
+	uint32_t indexVersion = indexed ? mIndexBuffers.Get(indexBufferHandle).GetVersion() : 0;
+	uint32_t indexOffset = indexed ? draw.mIndexBufferOffset : 0;
+	IndexType::Enum indexType = indexed ? draw.mIndexType : IndexType::Uint16;
+	InstancedGeometry* found = nullptr;
+	for (auto& geometry : mInstancedGeometries) {
+		if (geometry.mVertexBuffer.mHandle == vertexBufferHandle.mHandle && geometry.mVertexBufferOffset == draw.mVertexBufferOffsets[Attributes::Position]
+			&& std::memcmp(&geometry.mVertexFormat, &draw.mVertexFormat, sizeof(VertexFormat)) == 0 && geometry.mIndexBuffer.mHandle == indexBufferHandle.mHandle
+			&& geometry.mIndexBufferOffset == indexOffset && geometry.mIndexType == indexType && geometry.mFirst == first && geometry.mCount == count) {
+			found = &geometry;
+			break;
+		}
+	}
+
+	if (found == nullptr) {
+		mInstancedGeometries.emplace_back();
+		found = &mInstancedGeometries.back();
+		found->mVertexBuffer = vertexBufferHandle;
+		found->mVertexBufferOffset = draw.mVertexBufferOffsets[Attributes::Position];
+		found->mVertexFormat = draw.mVertexFormat;
+		found->mIndexBuffer = indexBufferHandle;
+		found->mIndexBufferOffset = indexOffset;
+		found->mIndexType = indexType;
+		found->mFirst = first;
+		found->mCount = count;
+	} else if (found->mVertexVersion == vertexVersion && found->mIndexVersion == indexVersion && found->mRequestedBatchSize >= batchSize) {
+		found->mLastUsedFrame = mRenderFrameIndex;
+		return found;
+	}
+
+	DeleteInstancedGeometry(*found);
+	found->mVertexVersion = vertexVersion;
+	found->mIndexVersion = indexVersion;
+	found->mRequestedBatchSize = batchSize;
+	found->mLastUsedFrame = mRenderFrameIndex;
+	BuildInstancedGeometry(*found);
+	return found;
+}
+
+void GraphicsDeviceGL::Impl::BuildInstancedGeometry(InstancedGeometry& geometry) {
+	const std::vector<uint8_t>& vertices = mVertexBuffers.Get(geometry.mVertexBuffer).GetCopy();
+	bool indexed = geometry.mIndexBuffer.IsValid();
+	uint32_t base = geometry.mFirst;
+	uint32_t vertexCount = geometry.mCount;
+
+	std::vector<uint32_t> indices;
+	if (indexed) {
+		const std::vector<uint8_t>& source = mIndexBuffers.Get(geometry.mIndexBuffer).GetCopy();
+		uint32_t indexSize = (geometry.mIndexType == IndexType::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t));
+		if (geometry.mCount == 0 || geometry.mIndexBufferOffset + static_cast<uint64_t>(geometry.mCount) * indexSize > source.size()) {
+			return;
+		}
+		indices.resize(geometry.mCount);
+		for (uint32_t n = 0; n < geometry.mCount; n++) {
+			const uint8_t* index = &source[geometry.mIndexBufferOffset + n * indexSize];
+			if (indexSize == sizeof(uint16_t)) {
+				uint16_t value;
+				memcpy(&value, index, sizeof(value));
+				indices[n] = value;
+			} else {
+				memcpy(&indices[n], index, sizeof(uint32_t));
+			}
+		}
+		base = *std::min_element(indices.begin(), indices.end());
+		vertexCount = *std::max_element(indices.begin(), indices.end()) - base + 1;
+	}
+
+	uint32_t stride = geometry.mVertexFormat.mStride;
+	if (vertexCount == 0 || stride == 0 || geometry.mVertexBufferOffset + (static_cast<uint64_t>(base) + vertexCount) * stride > vertices.size()) {
+		return;
+	}
+
+	// the copies are indexed with 16 bit indices when they fit, otherwise 32 bit ones or fewer copies
+	uint32_t batchSize = geometry.mRequestedBatchSize;
+	bool wideIndices = false;
+	if (indexed && static_cast<uint64_t>(vertexCount) * batchSize > UINT16_MAX + 1u) {
+		if (QueryCaps().mIndexUint32) {
+			wideIndices = true;
+		} else {
+			batchSize = (UINT16_MAX + 1u) / vertexCount;
+		}
+	}
+	if (batchSize == 0) {
+		return;
+	}
+
+	size_t vertexSize = static_cast<size_t>(vertexCount) * stride;
+	std::vector<uint8_t> copies(vertexSize * batchSize);
+	std::vector<float> instanceIndices(static_cast<size_t>(vertexCount) * batchSize);
+	const uint8_t* source = &vertices[geometry.mVertexBufferOffset + static_cast<size_t>(base) * stride];
+	for (uint32_t copy = 0; copy < batchSize; copy++) {
+		memcpy(&copies[copy * vertexSize], source, vertexSize);
+		std::fill_n(instanceIndices.begin() + static_cast<size_t>(copy) * vertexCount, vertexCount, static_cast<float>(copy));
+	}
+
+	GL_CHECK(glGenBuffers(1, &geometry.mVertices));
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, geometry.mVertices));
+	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, copies.size(), copies.data(), GL_STATIC_DRAW));
+	GL_CHECK(glGenBuffers(1, &geometry.mInstanceIndices));
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, geometry.mInstanceIndices));
+	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, instanceIndices.size() * sizeof(float), instanceIndices.data(), GL_STATIC_DRAW));
 	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
-	GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+
+	if (indexed) {
+		std::vector<uint32_t> wide;
+		std::vector<uint16_t> narrow;
+		for (uint32_t copy = 0; copy < batchSize; copy++) {
+			for (uint32_t index : indices) {
+				uint32_t value = index - base + copy * vertexCount;
+				if (wideIndices) {
+					wide.push_back(value);
+				} else {
+					narrow.push_back(static_cast<uint16_t>(value));
+				}
+			}
+		}
+		GL_CHECK(glGenBuffers(1, &geometry.mIndices));
+		GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry.mIndices));
+		if (wideIndices) {
+			GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, wide.size() * sizeof(uint32_t), wide.data(), GL_STATIC_DRAW));
+		} else {
+			GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow.size() * sizeof(uint16_t), narrow.data(), GL_STATIC_DRAW));
+		}
+		GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBoundIndexBufferId));
+		geometry.mCopyIndexType = (wideIndices ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT);
+	}
+	geometry.mBatchSize = batchSize;
 }
 
-void GraphicsDeviceGL::SetViewport(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
-	GL_CHECK(glViewport(x, y, width, height));
+void GraphicsDeviceGL::Impl::DeleteInstancedGeometry(InstancedGeometry& geometry) {
+	GLuint buffers[] = { geometry.mVertices, geometry.mInstanceIndices, geometry.mIndices };
+	for (GLuint buffer : buffers) {
+		if (buffer != 0) {
+			GL_CHECK(glDeleteBuffers(1, &buffer));
+		}
+	}
+	geometry.mVertices = 0;
+	geometry.mInstanceIndices = 0;
+	geometry.mIndices = 0;
+	geometry.mBatchSize = 0;
 }
 
-void GraphicsDeviceGL::Commit() {
+template<typename Predicate>
+void GraphicsDeviceGL::Impl::ReleaseInstancedGeometries(Predicate predicate) {
+	for (auto& geometry : mInstancedGeometries) {
+		if (predicate(geometry)) {
+			DeleteInstancedGeometry(geometry);
+		}
+	}
+	mInstancedGeometries.erase(std::remove_if(mInstancedGeometries.begin(), mInstancedGeometries.end(), predicate), mInstancedGeometries.end());
+}
+
+void GraphicsDeviceGL::Impl::ResetInstanceData() {
+	mPendingDraw.mInstanceFormat = VertexFormat();
+	mPendingDraw.mInstanceBuffer = VertexBufferHandle(cInvalidHandle);
+	mPendingDraw.mInstanceBufferOffset = 0;
+	mPendingDraw.mInstanceDataOffset = 0;
+	mPendingDraw.mInstanceDivisor = 1;
+	mPendingDraw.mInstancesCount = 0;
+}
+
+void GraphicsDeviceGL::Impl::SetTextureResident(const TextureHandle& handle, bool resident) {
+	mTexturesResident[HandlePool<TextureGL, cMaxTextureHandle>::GetIndex(handle)] = resident;
+}
+
+void GraphicsDeviceGL::Impl::StreamTextures() {
+	mFrameStats.mTextureUploadBytes += mTextureStreamer.Update([this](const TextureHandle& handle) -> TextureGL& { return mTextures.Get(handle); }, mStreamedTextures);
+	for (const auto& handle : mStreamedTextures) {
+		SetTextureResident(handle, true);
+	}
+	mStreamedTextures.clear();
+}
+
+void GraphicsDeviceGL::Impl::EndFrame(uint32_t statsSlot) {
+	TINYNGINE_PROFILE_SCOPE("EndFrame");
+	if (mSubmissionMode == SubmissionMode::Deferred) {
+		Replay();
+	}
+
+	QueryCaps();
+	mGpuTimer.EndFrame();
+	PollPrograms(!mCaps.mParallelShaderCompile);
+	StreamTextures();
+
 	GL_CHECK(glFlush());
 
-	if (mImpl->mCurrentProgramHandle.IsValid()) {
-		auto& program = mImpl->mPrograms[mImpl->mCurrentProgramHandle.mHandle];
+	if (mCurrentProgramHandle.IsValid()) {
+		auto& program = mPrograms.Get(mCurrentProgramHandle);
 		program.UnbindAttributes();
 	}
 
 	GL_CHECK(glUseProgram(0));
 	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
 	GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+	mBoundIndexBufferId = 0;
+
+	mInstanceData.clear();
+	ResetInstanceData();
+	mRenderFrameIndex++;
+	ReleaseInstancedGeometries([this](const InstancedGeometry& geometry) { return geometry.mLastUsedFrame + cInstancedGeometryLifetime < mRenderFrameIndex; });
+
+	if (tinyngine::gl::GetErrorCheckMode() == ErrorCheckMode::PerFrame) {
+		tinyngine::gl::CheckErrors("GraphicsDeviceGL::Commit", __FILE__, __LINE__);
+	}
+
+	mLastFrameStats[statsSlot] = mFrameStats;
+	mFrameStats = GraphicsStats();
 }
 
-void GraphicsDeviceGL::Clear(uint8_t flags, Color color, float depth, uint8_t stencil) {
-	if (flags & ClearFlags::ColorBuffer) {
-		GL_CHECK(glClearColor(color.red(), color.green(), color.blue(), color.alpha()));
-		GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
+// caps need a current context, they are read on first use rather than at construction
+const GraphicsCaps& GraphicsDeviceGL::Impl::QueryCaps() {
+	if (!mCapsQueried) {
+		mCaps.mIndexUint32 = tinyngine::gl::IsExtensionSupported("GL_OES_element_index_uint");
+		mCaps.mInstancing = tinyngine::gl::InitInstancing();
+		mCaps.mTimerQueries = mGpuTimer.Initialize();
+		mCaps.mProgramBinary = mProgramCache.Initialize();
+		mCaps.mParallelShaderCompile = tinyngine::gl::InitParallelShaderCompile();
+		tinyngine::gl::InitTextureFormats(mCaps.mTextureFormats);
+		tinyngine::gl::InitAttributeTypes(mCaps.mAttributeTypes);
+		mCapsQueried = true;
 	}
-	if (flags & ClearFlags::DepthBuffer) {
-		GL_CHECK(glClearDepthf(depth));
-		GL_CHECK(glClear(GL_DEPTH_BUFFER_BIT));
+	return mCaps;
+}
+
+// application thread side of QueryCaps, waits for the render thread the first time
+const GraphicsCaps& GraphicsDeviceGL::Impl::GetCaps() {
+	if (!mCapsQueried) {
+		mQueue.Push([this]() { QueryCaps(); });
+		mQueue.Flush();
 	}
-	if (flags & ClearFlags::StencilBuffer) {
-		GL_CHECK(glClearStencil(stencil));
-		GL_CHECK(glClear(GL_STENCIL_BUFFER_BIT));
+	return mCaps;
+}
+
+void GraphicsDeviceGL::Impl::BindIndexBuffer(GLuint id) {
+	if (mBoundIndexBufferId != id) {
+		GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id));
+		mBoundIndexBufferId = id;
 	}
-	std::memset(&mImpl->mAttributesVertexBufferHandles[0], 0, sizeof(GLuint) * mImpl->mAttributesVertexBufferHandles.size());
-	mImpl->mCurrentProgramHandle = ProgramHandle(cInvalidHandle);
 }
 
-void GraphicsDeviceGL::SetColorMake(bool red, bool green, bool blue, bool alpha) {
-	GL_CHECK(glColorMask(red, green, blue, alpha));
+// IndexBufferGL uploads leave GL_ELEMENT_ARRAY_BUFFER unbound, put back the buffer the next draw expects
+void GraphicsDeviceGL::Impl::RestoreIndexBuffer() {
+	if (mBoundIndexBufferId != 0) {
+		GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mBoundIndexBufferId));
+	}
 }
-void GraphicsDeviceGL::SetDepthMask(bool flag) {
-	GL_CHECK(glDepthMask(flag));
+
+bool GraphicsDeviceGL::Impl::AllocTransient(TransientRing& ring, bool indices, const void* data, uint32_t size, TransientBuffer& buffer) {
+	if (!ring.mCreated) {
+		for (auto& handle : ring.mBuffers) {
+			handle = indices ? mIndexBuffers.Allocate() : mVertexBuffers.Allocate();
+			if (!handle.IsValid()) {
+				return false;
+			}
+		}
+		std::array<ResourceHandle, cTransientBuffersCount> buffers = ring.mBuffers;
+		uint32_t ringSize = ring.mSize;
+		mQueue.Push([this, buffers, ringSize, indices]() {
+			for (const auto& handle : buffers) {
+				if (indices) {
+					mIndexBuffers.Get(handle).Create(nullptr, ringSize, IndexType::Uint16, false);
+				} else {
+					mVertexBuffers.Get(handle).Create(nullptr, ringSize, VertexFormat(), false);
+				}
+			}
+			if (indices) {
+				RestoreIndexBuffer();
+			}
+		});
+		ring.mCreated = true;
+	}
+
+	uint32_t offset = (ring.mOffset + cTransientAlignment - 1) & ~(cTransientAlignment - 1);
+	if (size == 0 || offset + size > ring.mSize) {
+		Log(Logger::Error, "Transient %s buffer out of space (%u bytes requested, %u used)", indices ? "index" : "vertex", size, ring.mOffset);
+		return false;
+	}
+
+	ResourceHandle handle = ring.mBuffers[ring.mCurrent];
+	bool orphan = !ring.mOrphaned;
+	JobData bytes = mQueue.Copy(data, size);
+	mQueue.Push([this, handle, indices, orphan, offset, bytes, size]() {
+		if (indices) {
+			auto& indexBuffer = mIndexBuffers.Get(handle);
+			if (orphan) {
+				indexBuffer.Orphan();
+			}
+			indexBuffer.Update(offset, bytes.Get(), size);
+			RestoreIndexBuffer();
+		} else {
+			auto& vertexBuffer = mVertexBuffers.Get(handle);
+			if (orphan) {
+				vertexBuffer.Orphan();
+			}
+			vertexBuffer.Update(offset, bytes.Get(), size);
+		}
+	});
+	ring.mOrphaned = true;
+	ring.mOffset = offset + size;
+
+	buffer.mHandle = handle;
+	buffer.mOffset = offset;
+	buffer.mSize = size;
+	return true;
 }
 
-void GraphicsDeviceGL::SetStencilMask(uint32_t mask) {
-	GL_CHECK(SetStencilMask(mask));
+void GraphicsDeviceGL::Impl::AdvanceTransient(TransientRing& ring) {
+	ring.mCurrent = (ring.mCurrent + 1) % cTransientBuffersCount;
+	ring.mOffset = 0;
+	ring.mOrphaned = false;
 }
 
-void GraphicsDeviceGL::SetState(RendererStateType::Enum type, bool value) {
-	if (mImpl->mStatesCache[type] != UINT8_MAX && (mImpl->mStatesCache[type] ? 1 : 0) == value) {
+// The GL object is created on the render thread. Without one the outcome is known right away and a failed
+// creation releases its slot; with one the slot stays allocated, holding an invalid object, until destroyed.
+template<typename T, uint32_t Size, typename CreateFunc>
+ResourceHandle GraphicsDeviceGL::Impl::CreateResource(HandlePool<T, Size>& pool, CreateFunc create) {
+	ResourceHandle handle = pool.Allocate();
+	if (!handle.IsValid()) {
+		return handle;
+	}
+	HandlePool<T, Size>* resources = &pool;
+	mQueue.Push([resources, handle, create]() { create(resources->Get(handle)); });
+	if (!mQueue.IsThreaded() && !pool.Get(handle).IsValid()) {
+		pool.Free(handle);
+		return ResourceHandle(cInvalidHandle);
+	}
+	return handle;
+}
+
+void GraphicsDeviceGL::Impl::QueueDestroy(PendingDestroy::Type type, const ResourceHandle& handle) {
+	if (!handle.IsValid()) {
 		return;
 	}
-	GLenum cap = tinyngine::gl::GetRendererStateType(type);
-	mImpl->mStatesCache[type] = value ? 1 : 0;
-	if (value) {
-		GL_CHECK(glEnable(cap));
+	PendingDestroy pending;
+	pending.mType = type;
+	pending.mHandle = handle;
+	pending.mFrame = mFrameIndex;
+	mPendingDestroys.push_back(pending);
+}
+
+void GraphicsDeviceGL::Impl::ReleasePendingDestroys(bool all) {
+	uint32_t kept = 0;
+	for (uint32_t n = 0; n < mPendingDestroys.size(); n++) {
+		const PendingDestroy pending = mPendingDestroys[n];
+		if (!all && pending.mFrame + cMaxFramesInFlight > mFrameIndex) {
+			mPendingDestroys[kept++] = pending;
+			continue;
+		}
+		mQueue.Push([this, pending]() { DestroyObject(pending.mType, pending.mHandle); });
+		FreeSlot(pending.mType, pending.mHandle);
+	}
+	mPendingDestroys.resize(kept);
+}
+
+void GraphicsDeviceGL::Impl::DestroyObject(PendingDestroy::Type type, const ResourceHandle& handle) {
+	switch (type) {
+	case PendingDestroy::VertexBuffer:
+		if (mVertexBuffers.IsValid(handle)) {
+			ReleaseInstancedGeometries([&handle](const InstancedGeometry& geometry) { return geometry.mVertexBuffer.mHandle == handle.mHandle; });
+			mVertexBuffers.Get(handle).Destroy();
+		}
+		break;
+	case PendingDestroy::IndexBuffer:
+		if (mIndexBuffers.IsValid(handle)) {
+			auto& indexBuffer = mIndexBuffers.Get(handle);
+			// deleting the bound buffer resets the binding to zero
+			if (mBoundIndexBufferId == static_cast<GLuint>(indexBuffer.GetId())) {
+				mBoundIndexBufferId = 0;
+			}
+			ReleaseInstancedGeometries([&handle](const InstancedGeometry& geometry) { return geometry.mIndexBuffer.mHandle == handle.mHandle; });
+			indexBuffer.Destroy();
+		}
+		break;
+	case PendingDestroy::Texture:
+		if (mTextures.IsValid(handle)) {
+			mTextureStreamer.Untrack(handle);
+			mTextures.Get(handle).Destroy();
+		}
+		break;
+	case PendingDestroy::Program:
+		if (mPrograms.IsValid(handle)) {
+			if (mCurrentProgramHandle.mHandle == handle.mHandle) {
+				mCurrentProgramHandle = ProgramHandle(cInvalidHandle);
+			}
+			mCompilingPrograms.erase(std::remove_if(mCompilingPrograms.begin(), mCompilingPrograms.end(), [&handle](const CompilingProgram& compiling) {
+				return compiling.mHandle.mHandle == handle.mHandle;
+			}), mCompilingPrograms.end());
+			mCommandBucket.RemoveProgram(handle);
+			mPrograms.Get(handle).Destroy();
+		}
+		break;
+	case PendingDestroy::Shader:
+		if (mShaders.IsValid(handle)) {
+			mShaders.Get(handle).Destroy();
+		}
+		break;
+	}
+}
+
+// Slots are recycled on the application thread. With a render thread, the jobs recorded so far may still refer
+// to the slot, so it is only released once they are guaranteed to have run.
+void GraphicsDeviceGL::Impl::FreeSlot(PendingDestroy::Type type, const ResourceHandle& handle) {
+	if (mQueue.IsThreaded()) {
+		PendingDestroy pending;
+		pending.mType = type;
+		pending.mHandle = handle;
+		pending.mFrame = mFrameIndex;
+		mPendingFrees.push_back(pending);
 		return;
 	}
-	GL_CHECK(glDisable(cap));
+	ReleaseSlot(type, handle);
+}
+
+void GraphicsDeviceGL::Impl::ReleaseSlot(PendingDestroy::Type type, const ResourceHandle& handle) {
+	switch (type) {
+	case PendingDestroy::VertexBuffer:
+		mVertexBuffers.Free(handle);
+		break;
+	case PendingDestroy::IndexBuffer:
+		mIndexBuffers.Free(handle);
+		break;
+	case PendingDestroy::Texture:
+		mTextures.Free(handle);
+		break;
+	case PendingDestroy::Program:
+		mPrograms.Free(handle);
+		break;
+	case PendingDestroy::Shader:
+		mShaders.Free(handle);
+		break;
+	}
+}
+
+void GraphicsDeviceGL::Impl::ReleasePendingFrees(bool all) {
+	uint32_t kept = 0;
+	for (uint32_t n = 0; n < mPendingFrees.size(); n++) {
+		const PendingDestroy& pending = mPendingFrees[n];
+		if (!all && pending.mFrame + cMaxQueuedFrames > mFrameIndex) {
+			mPendingFrees[kept++] = pending;
+			continue;
+		}
+		ReleaseSlot(pending.mType, pending.mHandle);
+	}
+	mPendingFrees.resize(kept);
+}
+
+//=====================================================================================================================
+
+GraphicsDeviceGL::GraphicsDeviceGL(RenderQueue& renderQueue) : mImpl(new Impl(renderQueue)) {
+	std::fill(std::begin(mImpl->mStatesCache), std::end(mImpl->mStatesCache), UINT8_MAX);
+	mImpl->mAttributesVertexBufferHandles.fill(0);
+	mImpl->mAttributesVertexBufferOffsets.fill(0);
+	mImpl->mTransientVertices.mSize = cTransientVertexBufferSize;
+	mImpl->mTransientIndices.mSize = cTransientIndexBufferSize;
+	mImpl->ResetPendingDraw();
+}
+
+GraphicsDeviceGL::~GraphicsDeviceGL() {
+	mImpl->mQueue.Push([this]() {
+		mImpl->mGpuTimer.Terminate();
+		mImpl->ReleaseInstancedGeometries([](const InstancedGeometry&) { return true; });
+		GL_CHECK(glUseProgram(0));
+		GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+		GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+	});
+	for (uint32_t n = 0; n < cTransientBuffersCount; n++) {
+		mImpl->QueueDestroy(PendingDestroy::VertexBuffer, mImpl->mTransientVertices.mBuffers[n]);
+		mImpl->QueueDestroy(PendingDestroy::IndexBuffer, mImpl->mTransientIndices.mBuffers[n]);
+	}
+	mImpl->ReleasePendingDestroys(true);
+	mImpl->mQueue.Flush();
+	mImpl->ReleasePendingFrees(true);
+	delete mImpl;
+}
+
+void GraphicsDeviceGL::SetViewport(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+	mImpl->mQueue.Push([=]() {
+		// the draws recorded so far keep the previous viewport
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->Replay();
+		}
+		GL_CHECK(glViewport(x, y, width, height));
+	});
+}
+
+void GraphicsDeviceGL::Commit() {
+	uint32_t statsSlot = static_cast<uint32_t>(mImpl->mFrameIndex & 1);
+	mImpl->mQueue.Push([this, statsSlot]() { mImpl->EndFrame(statsSlot); });
+
+	mImpl->ReleasePendingFrees(false);
+	mImpl->mFrameIndex++;
+	mImpl->ReleasePendingDestroys(false);
+	mImpl->AdvanceTransient(mImpl->mTransientVertices);
+	mImpl->AdvanceTransient(mImpl->mTransientIndices);
+}
+
+void GraphicsDeviceGL::SetSubmissionMode(SubmissionMode::Enum mode) {
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred && mode != SubmissionMode::Deferred) {
+			mImpl->EndDeferred();
+		} else if (mImpl->mSubmissionMode != SubmissionMode::Deferred && mode == SubmissionMode::Deferred) {
+			mImpl->BeginDeferred();
+		}
+		mImpl->mSubmissionMode = mode;
+	});
+}
+
+void GraphicsDeviceGL::SetSortLayer(uint8_t layer) {
+	mImpl->mQueue.Push([=]() { mImpl->mSortLayer = layer; });
+}
+
+void GraphicsDeviceGL::SetSortDepth(float depth) {
+	mImpl->mQueue.Push([=]() { mImpl->mSortDepth = depth; });
+}
+
+void GraphicsDeviceGL::SetErrorCheckMode(ErrorCheckMode::Enum mode) {
+	mImpl->mQueue.Push([=]() { tinyngine::gl::SetErrorCheckMode(mode); });
+}
+
+void GraphicsDeviceGL::Clear(uint8_t flags, Color color, float depth, uint8_t stencil) {
+	mImpl->mQueue.Push([=]() {
+		// draws are not sorted across a clear, and the write masks recorded before it apply to it
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->Replay();
+			mImpl->ApplyDrawState(mImpl->mPendingDraw);
+		}
+		if (flags & ClearFlags::ColorBuffer) {
+			GL_CHECK(glClearColor(color.red(), color.green(), color.blue(), color.alpha()));
+			GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
+		}
+		if (flags & ClearFlags::DepthBuffer) {
+			GL_CHECK(glClearDepthf(depth));
+			GL_CHECK(glClear(GL_DEPTH_BUFFER_BIT));
+		}
+		if (flags & ClearFlags::StencilBuffer) {
+			GL_CHECK(glClearStencil(stencil));
+			GL_CHECK(glClear(GL_STENCIL_BUFFER_BIT));
+		}
+		std::memset(&mImpl->mAttributesVertexBufferHandles[0], 0, sizeof(GLuint) * mImpl->mAttributesVertexBufferHandles.size());
+		mImpl->mAttributesVertexBufferOffsets.fill(0);
+		mImpl->mInterleavedVertexBuffer = false;
+		mImpl->mCurrentProgramHandle = ProgramHandle(cInvalidHandle);
+		std::fill(std::begin(mImpl->mPendingDraw.mVertexBuffers), std::end(mImpl->mPendingDraw.mVertexBuffers), VertexBufferHandle(cInvalidHandle));
+		mImpl->mPendingDraw.mVertexBufferOffsets.fill(0);
+		mImpl->mPendingDraw.mInterleaved = false;
+		mImpl->mPendingDraw.mProgram = ProgramHandle(cInvalidHandle);
+	});
+}
+
+void GraphicsDeviceGL::SetColorMake(bool red, bool green, bool blue, bool alpha) {
+	uint8_t mask = (red ? ColorMask::Red : 0) | (green ? ColorMask::Green : 0) | (blue ? ColorMask::Blue : 0) | (alpha ? ColorMask::Alpha : 0);
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mParameters.mColorMask = mask;
+			mImpl->mPendingDraw.mParameters.mMask |= DrawParameters::ColorMask;
+			return;
+		}
+		mImpl->ApplyColorMask(mask);
+	});
+}
+
+void GraphicsDeviceGL::SetDepthMask(bool flag) {
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mParameters.mDepthMask = flag;
+			mImpl->mPendingDraw.mParameters.mMask |= DrawParameters::DepthMask;
+			return;
+		}
+		mImpl->ApplyDepthMask(flag ? GL_TRUE : GL_FALSE);
+	});
+}
+
+void GraphicsDeviceGL::SetStencilMask(uint32_t mask) {
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mParameters.mStencilWriteMask = mask;
+			mImpl->mPendingDraw.mParameters.mMask |= DrawParameters::StencilMask;
+			return;
+		}
+		mImpl->ApplyStencilMask(mask);
+	});
+}
+
+void GraphicsDeviceGL::SetState(RendererStateType::Enum type, bool value) {
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			uint8_t bit = static_cast<uint8_t>(1 << type);
+			mImpl->mPendingDraw.mStatesMask |= bit;
+			mImpl->mPendingDraw.mStates = value ? (mImpl->mPendingDraw.mStates | bit) : (mImpl->mPendingDraw.mStates & ~bit);
+			return;
+		}
+		mImpl->ApplyState(type, value);
+	});
 }
 
 void GraphicsDeviceGL::SetCullMode(CullFaceModes::Enum mode) {
-	GL_CHECK(glCullFace(tinyngine::gl::GetCullFaceMode(mode)));
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mParameters.mCullFace = mode;
+			mImpl->mPendingDraw.mParameters.mMask |= DrawParameters::CullFace;
+			return;
+		}
+		mImpl->ApplyCullFace(tinyngine::gl::GetCullFaceMode(mode));
+	});
 }
 
 void GraphicsDeviceGL::SetWinding(WindingModes::Enum mode) {
-	GL_CHECK(glFrontFace(tinyngine::gl::GetWindingMode(mode)));
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mParameters.mFrontFace = mode;
+			mImpl->mPendingDraw.mParameters.mMask |= DrawParameters::FrontFace;
+			return;
+		}
+		mImpl->ApplyFrontFace(tinyngine::gl::GetWindingMode(mode));
+	});
 }
 
 void GraphicsDeviceGL::SetBlendFunc(BlendFuncs::Enum sfactor, BlendFuncs::Enum dfactor) {
-	GL_CHECK(glBlendFunc(tinyngine::gl::GetBlendFunc(sfactor), tinyngine::gl::GetBlendFunc(dfactor)));
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mParameters.mBlendSrc = sfactor;
+			mImpl->mPendingDraw.mParameters.mBlendDst = dfactor;
+			mImpl->mPendingDraw.mParameters.mMask |= DrawParameters::BlendFunc;
+			return;
+		}
+		mImpl->ApplyBlendFunc(tinyngine::gl::GetBlendFunc(sfactor), tinyngine::gl::GetBlendFunc(dfactor));
+	});
 }
 
 void GraphicsDeviceGL::SetDepthFunc(DepthFuncs::Enum func) {
-	GL_CHECK(glDepthFunc(tinyngine::gl::GetDepthFunc(func)));
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mParameters.mDepthFunc = func;
+			mImpl->mPendingDraw.mParameters.mMask |= DrawParameters::DepthFunc;
+			return;
+		}
+		mImpl->ApplyDepthFunc(tinyngine::gl::GetDepthFunc(func));
+	});
 }
 
 void GraphicsDeviceGL::SetStencilFunc(StencilFuncs::Enum func, int32_t ref, uint32_t mask) {
-	GL_CHECK(glStencilFunc(func, ref, mask))
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mParameters.mStencilFunc = func;
+			mImpl->mPendingDraw.mParameters.mStencilRef = ref;
+			mImpl->mPendingDraw.mParameters.mStencilReadMask = mask;
+			mImpl->mPendingDraw.mParameters.mMask |= DrawParameters::StencilFunc;
+			return;
+		}
+		mImpl->ApplyStencilFunc(tinyngine::gl::GetStencilFunc(func), ref, mask);
+	});
 }
 
 void GraphicsDeviceGL::SetStencilOp(StencilOpTypes::Enum sfail, StencilOpTypes::Enum dpfail, StencilOpTypes::Enum dppass) {
-	GL_CHECK(glStencilOp(tinyngine::gl::GetStencilOpType(sfail), tinyngine::gl::GetStencilOpType(dpfail), tinyngine::gl::GetStencilOpType(dppass)));
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mParameters.mStencilFail = sfail;
+			mImpl->mPendingDraw.mParameters.mStencilDepthFail = dpfail;
+			mImpl->mPendingDraw.mParameters.mStencilDepthPass = dppass;
+			mImpl->mPendingDraw.mParameters.mMask |= DrawParameters::StencilOp;
+			return;
+		}
+		mImpl->ApplyStencilOp(tinyngine::gl::GetStencilOpType(sfail), tinyngine::gl::GetStencilOpType(dpfail), tinyngine::gl::GetStencilOpType(dppass));
+	});
 }
 
 void GraphicsDeviceGL::SetBlendColor(Color color) {
-	GL_CHECK(glBlendColor(color.red(), color.green(), color.blue(), color.alpha()));
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mParameters.mBlendColor = color;
+			mImpl->mPendingDraw.mParameters.mMask |= DrawParameters::BlendColor;
+			return;
+		}
+		mImpl->ApplyBlendColor(color);
+	});
 }
 
 void GraphicsDeviceGL::SetPolygonffset(float factor, float units) {
-	GL_CHECK(glPolygonOffset(factor, units));
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mParameters.mPolygonOffsetFactor = factor;
+			mImpl->mPendingDraw.mParameters.mPolygonOffsetUnits = units;
+			mImpl->mPendingDraw.mParameters.mMask |= DrawParameters::PolygonOffset;
+			return;
+		}
+		mImpl->ApplyPolygonOffset(factor, units);
+	});
+}
+
+// render states hold no GL object, they are translated right away on the calling thread
+RenderStateHandle GraphicsDeviceGL::CreateRenderState(const RenderStateDesc& desc) {
+	RenderStateHandle handle = mImpl->mRenderStates.Allocate();
+	if (!handle.IsValid()) {
+		return handle;
+	}
+	auto& renderState = mImpl->mRenderStates.Get(handle);
+	renderState.Create(desc);
+	if (!renderState.IsValid()) {
+		mImpl->mRenderStates.Free(handle);
+		return RenderStateHandle(cInvalidHandle);
+	}
+	return handle;
+}
+
+void GraphicsDeviceGL::SetRenderState(const RenderStateHandle& handle) {
+	mImpl->mQueue.Push([=]() {
+		if (!handle.IsValid()) {
+			return;
+		}
+		// a render state replaces the states and parameters set before it
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mRenderState = handle;
+			mImpl->mPendingDraw.mStatesMask = 0;
+			mImpl->mPendingDraw.mParameters.mMask = 0;
+			return;
+		}
+		mImpl->ApplyRenderState(mImpl->mRenderStates.Get(handle));
+	});
 }
 
 void GraphicsDeviceGL::DrawArray(PrimitiveType::Enum primitive, uint32_t first, uint32_t count) {
-	GL_CHECK(glDrawArrays(tinyngine::gl::GetPrimitiveType(primitive), first, count));
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->RecordDraw(primitive, first, count, false, 0);
+			return;
+		}
+		if (!mImpl->mCurrentProgramHandle.IsValid()) {
+			mImpl->mFrameStats.mDrawsSkipped++;
+			return;
+		}
+		GL_CHECK(glDrawArrays(tinyngine::gl::GetPrimitiveType(primitive), first, count));
+	});
 }
 
 void GraphicsDeviceGL::DrawElements(PrimitiveType::Enum primitive, uint32_t count) {
-	GL_CHECK(glDrawElements(tinyngine::gl::GetPrimitiveType(primitive), count, GL_UNSIGNED_INT, 0));
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->RecordDraw(primitive, 0, count, true, 0);
+			return;
+		}
+		if (!mImpl->mCurrentProgramHandle.IsValid()) {
+			mImpl->mFrameStats.mDrawsSkipped++;
+			return;
+		}
+		GL_CHECK(glDrawElements(tinyngine::gl::GetPrimitiveType(primitive), count, tinyngine::gl::GetIndexType(mImpl->mIndexType), reinterpret_cast<const void*>(static_cast<uintptr_t>(mImpl->mIndexBufferOffset))));
+	});
+}
+
+void GraphicsDeviceGL::DrawArrayInstanced(PrimitiveType::Enum primitive, uint32_t first, uint32_t count, uint32_t instancesCount) {
+	if (instancesCount == 0) {
+		return;
+	}
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->RecordDraw(primitive, first, count, false, instancesCount);
+			return;
+		}
+		mImpl->mPendingDraw.mInstancesCount = instancesCount;
+		mImpl->DrawInstanced(mImpl->mPendingDraw, tinyngine::gl::GetPrimitiveType(primitive), first, count, false, GL_NONE, 0);
+	});
+}
+
+void GraphicsDeviceGL::DrawElementsInstanced(PrimitiveType::Enum primitive, uint32_t count, uint32_t instancesCount) {
+	if (instancesCount == 0) {
+		return;
+	}
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->RecordDraw(primitive, 0, count, true, instancesCount);
+			return;
+		}
+		mImpl->mPendingDraw.mInstancesCount = instancesCount;
+		mImpl->DrawInstanced(mImpl->mPendingDraw, tinyngine::gl::GetPrimitiveType(primitive), 0, count, true, tinyngine::gl::GetIndexType(mImpl->mIndexType), mImpl->mIndexBufferOffset);
+	});
 }
 
 VertexBufferHandle GraphicsDeviceGL::CreateVertexBuffer(const void* data, uint32_t size, const VertexFormat& vertexFormat) {
-	VertexBufferHandle handle = VertexBufferHandle(mImpl->mVertexBuffersCount++);
-	auto& vertexBuffer = mImpl->mVertexBuffers[handle.mHandle];
-	vertexBuffer.Create(data, size, vertexFormat);
-	return vertexBuffer.IsValid() ? handle : VertexBufferHandle(cInvalidHandle);
+	JobData bytes = mImpl->mQueue.Copy(data, size);
+	Impl* impl = mImpl;
+	return mImpl->CreateResource(mImpl->mVertexBuffers, [impl, bytes, size, vertexFormat](VertexBufferGL& vertexBuffer) {
+		vertexBuffer.Create(bytes.Get(), size, vertexFormat, !impl->QueryCaps().mInstancing);
+	});
+}
+
+void GraphicsDeviceGL::UpdateVertexBuffer(const VertexBufferHandle& handle, uint32_t offset, const void* data, uint32_t size) {
+	if (!mImpl->mVertexBuffers.IsValid(handle)) {
+		return;
+	}
+	JobData bytes = mImpl->mQueue.Copy(data, size);
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mVertexBuffers.IsValid(handle)) {
+			mImpl->mVertexBuffers.Get(handle).Update(offset, bytes.Get(), size);
+		}
+	});
+}
+
+void GraphicsDeviceGL::DestroyVertexBuffer(VertexBufferHandle& handle) {
+	mImpl->QueueDestroy(PendingDestroy::VertexBuffer, handle);
+	handle = VertexBufferHandle(cInvalidHandle);
+}
+
+void GraphicsDeviceGL::SetVertexBuffer(const VertexBufferHandle& handle) {
+	if (handle.IsValid()) {
+		mImpl->mQueue.Push([=]() { mImpl->SetInterleavedStream(handle, 0); });
+	}
 }
 
 void GraphicsDeviceGL::SetVertexBuffer(const VertexBufferHandle& handle, Attributes::Enum attribute) {
 	if (handle.IsValid()) {
-		auto& vertexBuffer = mImpl->mVertexBuffers[handle.mHandle];
-		mImpl->mAttributesVertexBufferHandles[attribute] = vertexBuffer.GetId();
+		mImpl->mQueue.Push([=]() { mImpl->SetAttributeStream(attribute, handle, 0); });
 	}
 }
 
 IndexBufferHandle GraphicsDeviceGL::CreateIndexBuffer(const void* data, uint32_t size) {
-	IndexBufferHandle handle = IndexBufferHandle(mImpl->mIndexBuffersCount++);
-	auto& indexBuffer = mImpl->mIndexBuffers[handle.mHandle];
-	indexBuffer.Create(data, size);
-	return indexBuffer.IsValid() ? handle : IndexBufferHandle(cInvalidHandle);
+	if (data == nullptr) {
+		return CreateIndexBuffer(data, size, IndexType::Uint32);
+	}
+
+	const uint32_t* indices = static_cast<const uint32_t*>(data);
+	uint32_t count = size / sizeof(uint32_t);
+	if (count == 0 || *std::max_element(indices, indices + count) > UINT16_MAX) {
+		return CreateIndexBuffer(data, size, IndexType::Uint32);
+	}
+
+	// half the index bandwidth and no dependency on OES_element_index_uint
+	auto& narrowed = mImpl->mIndexScratch;
+	narrowed.resize(count);
+	for (uint32_t n = 0; n < count; n++) {
+		narrowed[n] = static_cast<uint16_t>(indices[n]);
+	}
+	IndexBufferHandle handle = CreateIndexBuffer(&narrowed[0], count * sizeof(uint16_t), IndexType::Uint16);
+	if (handle.IsValid()) {
+		mImpl->mIndexBuffersNarrowed[HandlePool<IndexBufferGL, cMaxIndexBufferHandle>::GetIndex(handle)] = true;
+	}
+	return handle;
 }
 
-void GraphicsDeviceGL::SetIndexBuffer(const IndexBufferHandle& handle) {
+IndexBufferHandle GraphicsDeviceGL::CreateIndexBuffer(const void* data, uint32_t size, IndexType::Enum type) {
+	if (type == IndexType::Uint32 && !mImpl->GetCaps().mIndexUint32) {
+		Log(Logger::Error, "32 bit indices need GL_OES_element_index_uint, split the mesh with MeshLoader::SplitForUint16Indices");
+		return IndexBufferHandle(cInvalidHandle);
+	}
+
+	JobData bytes = mImpl->mQueue.Copy(data, size);
+	Impl* impl = mImpl;
+	IndexBufferHandle handle = mImpl->CreateResource(mImpl->mIndexBuffers, [impl, bytes, size, type](IndexBufferGL& indexBuffer) {
+		indexBuffer.Create(bytes.Get(), size, type, !impl->QueryCaps().mInstancing);
+		impl->RestoreIndexBuffer();
+	});
 	if (handle.IsValid()) {
-		auto& indexBuffer = mImpl->mIndexBuffers[handle.mHandle];
-		GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.GetId()));
+		mImpl->mIndexBuffersNarrowed[HandlePool<IndexBufferGL, cMaxIndexBufferHandle>::GetIndex(handle)] = false;
+	}
+	return handle;
+}
+
+// a buffer narrowed at creation is still updated with 32 bit indices, they are narrowed the same way
+void GraphicsDeviceGL::UpdateIndexBuffer(const IndexBufferHandle& handle, uint32_t offset, const void* data, uint32_t size) {
+	if (!mImpl->mIndexBuffers.IsValid(handle)) {
+		return;
+	}
+	if (mImpl->mIndexBuffersNarrowed[HandlePool<IndexBufferGL, cMaxIndexBufferHandle>::GetIndex(handle)]) {
+		if (offset % sizeof(uint32_t) != 0 || size % sizeof(uint32_t) != 0) {
+			Log(Logger::Error, "UpdateIndexBuffer: offset %u and size %u must be multiples of 4 for 32 bit indices", offset, size);
+			return;
+		}
+		const uint32_t* indices = static_cast<const uint32_t*>(data);
+		uint32_t count = size / sizeof(uint32_t);
+		auto& narrowed = mImpl->mIndexScratch;
+		narrowed.resize(count);
+		for (uint32_t n = 0; n < count; n++) {
+			if (indices[n] > UINT16_MAX) {
+				Log(Logger::Error, "UpdateIndexBuffer: index %u does not fit the 16 bit indices the buffer was created with, create it with IndexType::Uint32", indices[n]);
+				return;
+			}
+			narrowed[n] = static_cast<uint16_t>(indices[n]);
+		}
+		data = narrowed.data();
+		offset /= 2;
+		size /= 2;
+	}
+	JobData bytes = mImpl->mQueue.Copy(data, size);
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mIndexBuffers.IsValid(handle)) {
+			mImpl->mIndexBuffers.Get(handle).Update(offset, bytes.Get(), size);
+			mImpl->RestoreIndexBuffer();
+		}
+	});
+}
+
+void GraphicsDeviceGL::DestroyIndexBuffer(IndexBufferHandle& handle) {
+	mImpl->QueueDestroy(PendingDestroy::IndexBuffer, handle);
+	handle = IndexBufferHandle(cInvalidHandle);
+}
+
+void GraphicsDeviceGL::SetIndexBuffer(const IndexBufferHandle& handle) {
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mIndexBuffer = handle;
+			mImpl->mPendingDraw.mIndexBufferOffset = 0;
+			mImpl->mPendingDraw.mIndexType = handle.IsValid() ? mImpl->mIndexBuffers.Get(handle).GetType() : IndexType::Uint32;
+			return;
+		}
+		if (handle.IsValid()) {
+			auto& indexBuffer = mImpl->mIndexBuffers.Get(handle);
+			mImpl->BindIndexBuffer(indexBuffer.GetId());
+			mImpl->mIndexBufferOffset = 0;
+			mImpl->mIndexType = indexBuffer.GetType();
+			mImpl->mPendingDraw.mIndexBuffer = handle;
+			mImpl->mPendingDraw.mIndexBufferOffset = 0;
+			mImpl->mPendingDraw.mIndexType = indexBuffer.GetType();
+		}
+	});
+}
+
+bool GraphicsDeviceGL::AllocTransientVertexBuffer(const void* data, uint32_t size, TransientBuffer& buffer) {
+	return mImpl->AllocTransient(mImpl->mTransientVertices, false, data, size, buffer);
+}
+
+bool GraphicsDeviceGL::AllocTransientIndexBuffer(const void* data, uint32_t size, IndexType::Enum type, TransientBuffer& buffer) {
+	if (type == IndexType::Uint32 && !mImpl->GetCaps().mIndexUint32) {
+		Log(Logger::Error, "32 bit indices need GL_OES_element_index_uint");
+		return false;
 	}
+	buffer.mIndexType = type;
+	return mImpl->AllocTransient(mImpl->mTransientIndices, true, data, size, buffer);
+}
+
+void GraphicsDeviceGL::SetTransientVertexBuffer(const TransientBuffer& buffer) {
+	if (buffer.mHandle.IsValid()) {
+		mImpl->mQueue.Push([=]() { mImpl->SetInterleavedStream(buffer.mHandle, buffer.mOffset); });
+	}
+}
+
+void GraphicsDeviceGL::SetTransientVertexBuffer(const TransientBuffer& buffer, Attributes::Enum attribute) {
+	if (buffer.mHandle.IsValid()) {
+		mImpl->mQueue.Push([=]() { mImpl->SetAttributeStream(attribute, buffer.mHandle, buffer.mOffset); });
+	}
+}
+
+void GraphicsDeviceGL::SetTransientIndexBuffer(const TransientBuffer& buffer) {
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mIndexBuffer = buffer.mHandle;
+			mImpl->mPendingDraw.mIndexBufferOffset = buffer.mOffset;
+			mImpl->mPendingDraw.mIndexType = buffer.mIndexType;
+			return;
+		}
+		if (buffer.mHandle.IsValid()) {
+			auto& indexBuffer = mImpl->mIndexBuffers.Get(buffer.mHandle);
+			mImpl->BindIndexBuffer(indexBuffer.GetId());
+			mImpl->mIndexBufferOffset = buffer.mOffset;
+			mImpl->mIndexType = buffer.mIndexType;
+			mImpl->mPendingDraw.mIndexBuffer = buffer.mHandle;
+			mImpl->mPendingDraw.mIndexBufferOffset = buffer.mOffset;
+			mImpl->mPendingDraw.mIndexType = buffer.mIndexType;
+		}
+	});
+}
+
+void GraphicsDeviceGL::SetInstanceData(const void* data, uint32_t elementsCount, const VertexFormat& instanceFormat, uint32_t divisor) {
+	uint32_t size = elementsCount * instanceFormat.mStride;
+	if (data == nullptr || size == 0) {
+		mImpl->mQueue.Push([this]() { mImpl->ResetInstanceData(); });
+		return;
+	}
+
+	divisor = std::max(divisor, 1u);
+	if (mImpl->GetCaps().mInstancing) {
+		TransientBuffer buffer;
+		bool allocated = mImpl->AllocTransient(mImpl->mTransientVertices, false, data, size, buffer);
+		mImpl->mQueue.Push([=]() {
+			mImpl->ResetInstanceData();
+			if (allocated) {
+				auto& pending = mImpl->mPendingDraw;
+				pending.mInstanceFormat = instanceFormat;
+				pending.mInstanceDivisor = divisor;
+				pending.mInstanceBuffer = buffer.mHandle;
+				pending.mInstanceBufferOffset = buffer.mOffset;
+			}
+		});
+		return;
+	}
+
+	JobData bytes = mImpl->mQueue.Copy(data, size);
+	mImpl->mQueue.Push([=]() {
+		mImpl->ResetInstanceData();
+		auto& pending = mImpl->mPendingDraw;
+		pending.mInstanceFormat = instanceFormat;
+		pending.mInstanceDivisor = divisor;
+		auto& instanceData = mImpl->mInstanceData;
+		pending.mInstanceDataOffset = static_cast<uint32_t>(instanceData.size());
+		const uint8_t* elements = static_cast<const uint8_t*>(bytes.Get());
+		instanceData.insert(instanceData.end(), elements, elements + size);
+	});
 }
 
 ShaderHandle GraphicsDeviceGL::CreateShader(ShaderType::Enum type, const char* source) {
-	ShaderHandle handle = ShaderHandle(mImpl->mShadersCount++);
-	auto& shader = mImpl->mShaders[handle.mHandle];
-	shader.Create(tinyngine::gl::GetShaderType(type), source);
-	return shader.IsValid() ? handle : ShaderHandle(cInvalidHandle);
+	JobData text = mImpl->mQueue.Copy(source, strlen(source) + 1);
+	// compiled when linked, unless the program binary is found in the cache
+	return mImpl->CreateResource(mImpl->mShaders, [this, type, text](ShaderGL& shader) {
+		const GraphicsCaps& caps = mImpl->QueryCaps();
+		const char* shaderSource = static_cast<const char*>(text.Get());
+		// defined before the program cache hashes the source, so the cached binary is the variant of this device
+		std::string defined;
+		if (!caps.mInstancing) {
+			defined = AddDefine(shaderSource, "TINYNGINE_PSEUDO_INSTANCING");
+			shaderSource = defined.c_str();
+		}
+		shader.Create(tinyngine::gl::GetShaderType(type), shaderSource, caps.mProgramBinary);
+	});
 }
 
 ProgramHandle GraphicsDeviceGL::CreateProgram(ShaderHandle& vertexShaderHandle, ShaderHandle& fragmentShaderHandle, bool destroyShaders) {
@@ -195,90 +1928,321 @@ ProgramHandle GraphicsDeviceGL::CreateProgram(ShaderHandle& vertexShaderHandle,
 		return ProgramHandle(cInvalidHandle);
 	}
 
-	auto& vertexShader = mImpl->mShaders[vertexShaderHandle.mHandle];
-	auto& fragmentShader = mImpl->mShaders[fragmentShaderHandle.mHandle];
-
-	ProgramHandle handle = ProgramHandle(mImpl->mProgramsCount++);
-	auto& program = mImpl->mPrograms[handle.mHandle];
-	program.Create(vertexShader, fragmentShader);
+	ShaderHandle vs = vertexShaderHandle;
+	ShaderHandle fs = fragmentShaderHandle;
+	ProgramHandle handle = mImpl->mPrograms.Allocate();
+	if (handle.IsValid()) {
+		mImpl->SetProgramStatus(handle, ProgramStatus::Pending);
+	}
+	mImpl->mQueue.Push([=]() {
+		auto& vertexShader = mImpl->mShaders.Get(vs);
+		auto& fragmentShader = mImpl->mShaders.Get(fs);
+		if (handle.IsValid()) {
+			auto& program = mImpl->mPrograms.Get(handle);
+			mImpl->mProgramCache.Create(program, vertexShader, fragmentShader);
+			mImpl->SetProgramStatus(handle, program.IsValid() ? ProgramStatus::Ready : ProgramStatus::Failed);
+		}
+		if (destroyShaders) {
+			vertexShader.Destroy();
+			fragmentShader.Destroy();
+		}
+	});
+	mImpl->mProgramsPending = true;
 
-	program.Initialize();
+	if (handle.IsValid() && !mImpl->mQueue.IsThreaded() && !mImpl->mPrograms.Get(handle).IsValid()) {
+		mImpl->mPrograms.Free(handle);
+		handle = ProgramHandle(cInvalidHandle);
+	}
 
+	// shaders are not referenced by recorded draws, their slots can be recycled once the link job has run
 	if (destroyShaders) {
-		vertexShader.Destroy();
-		fragmentShader.Destroy();
+		mImpl->FreeSlot(PendingDestroy::Shader, vertexShaderHandle);
+		mImpl->FreeSlot(PendingDestroy::Shader, fragmentShaderHandle);
+		vertexShaderHandle = ShaderHandle(cInvalidHandle);
+		fragmentShaderHandle = ShaderHandle(cInvalidHandle);
 	}
 
-	return program.IsValid() ? handle : ProgramHandle(cInvalidHandle);
+	return handle;
 }
 
-void GraphicsDeviceGL::SetProgram(const ProgramHandle& handle, const VertexFormat& vertexFormat) {
-	if (mImpl->mCurrentProgramHandle.IsValid()) {
-		auto& program = mImpl->mPrograms[mImpl->mCurrentProgramHandle.mHandle];
-		program.UnbindAttributes();
+ProgramHandle GraphicsDeviceGL::CreateProgramAsync(ShaderHandle& vertexShaderHandle, ShaderHandle& fragmentShaderHandle, bool destroyShaders) {
+	if (!vertexShaderHandle.IsValid()) {
+		return ProgramHandle(cInvalidHandle);
 	}
 
-	mImpl->mCurrentProgramHandle = handle;
-	if (mImpl->mCurrentProgramHandle.IsValid()) {
-		auto& program = mImpl->mPrograms[mImpl->mCurrentProgramHandle.mHandle];
-		GL_CHECK(glUseProgram(program.GetId()));
-		program.BindAttributes(vertexFormat, mImpl->mAttributesVertexBufferHandles);
+	ShaderHandle vs = vertexShaderHandle;
+	ShaderHandle fs = fragmentShaderHandle;
+	ProgramHandle handle = mImpl->mPrograms.Allocate();
+	if (handle.IsValid()) {
+		mImpl->SetProgramStatus(handle, ProgramStatus::Pending);
+	}
+	mImpl->mQueue.Push([=]() {
+		auto& vertexShader = mImpl->mShaders.Get(vs);
+		auto& fragmentShader = mImpl->mShaders.Get(fs);
+		if (handle.IsValid()) {
+			auto& program = mImpl->mPrograms.Get(handle);
+			uint64_t cacheKey = mImpl->mProgramCache.Submit(program, vertexShader, fragmentShader);
+			if (program.IsPending()) {
+				mImpl->mCompilingPrograms.push_back({ handle, cacheKey });
+			} else {
+				mImpl->SetProgramStatus(handle, program.IsValid() ? ProgramStatus::Ready : ProgramStatus::Failed);
+			}
+		}
+		// attached shaders are only flagged for deletion, they are released with the program
+		if (destroyShaders) {
+			vertexShader.Destroy();
+			fragmentShader.Destroy();
+		}
+	});
+	mImpl->mProgramsPending = true;
+
+	if (destroyShaders) {
+		mImpl->FreeSlot(PendingDestroy::Shader, vertexShaderHandle);
+		mImpl->FreeSlot(PendingDestroy::Shader, fragmentShaderHandle);
+		vertexShaderHandle = ShaderHandle(cInvalidHandle);
+		fragmentShaderHandle = ShaderHandle(cInvalidHandle);
 	}
+
+	return handle;
+}
+
+ProgramStatus::Enum GraphicsDeviceGL::GetProgramStatus(const ProgramHandle& handle) const {
+	if (!mImpl->mPrograms.IsValid(handle)) {
+		return ProgramStatus::Failed;
+	}
+	return static_cast<ProgramStatus::Enum>(mImpl->mProgramStatus[HandlePool<ProgramGL, cMaxProgramHandles>::GetIndex(handle)].load());
+}
+
+void GraphicsDeviceGL::SetProgramCacheDirectory(const char* directory) {
+	JobData path = mImpl->mQueue.Copy(directory ? directory : "", directory ? strlen(directory) + 1 : 1);
+	mImpl->mQueue.Push([this, path]() { mImpl->mProgramCache.SetDirectory(static_cast<const char*>(path.Get())); });
+}
+
+void GraphicsDeviceGL::DestroyProgram(ProgramHandle& handle) {
+	mImpl->QueueDestroy(PendingDestroy::Program, handle);
+	handle = ProgramHandle(cInvalidHandle);
+}
+
+void GraphicsDeviceGL::SetProgram(const ProgramHandle& handle, const VertexFormat& vertexFormat) {
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->mPendingDraw.mProgram = handle;
+			mImpl->mPendingDraw.mVertexFormat = vertexFormat;
+			return;
+		}
+		mImpl->mPendingDraw.mProgram = handle;
+		mImpl->mPendingDraw.mVertexFormat = vertexFormat;
+		mImpl->BindProgram(handle, vertexFormat);
+	});
 }
 
 UniformHandle GraphicsDeviceGL::GetUniform(const ProgramHandle& programHandle, const char* uniformName) const {
+	return GetUniform(programHandle, UniformId(uniformName));
+}
+
+// uniforms are introspected at link time, wait for the programs still queued for the render thread
+UniformHandle GraphicsDeviceGL::GetUniform(const ProgramHandle& programHandle, const UniformId& uniformId) const {
 	if (!programHandle.IsValid()) {
 		return UniformHandle(cInvalidHandle);
 	}
-	auto& program = mImpl->mPrograms[programHandle.mHandle];
-	return program.GetUniformHandle(uniformName);
+	if (GetProgramStatus(programHandle) == ProgramStatus::Pending) {
+		mImpl->mQueue.Push([this, programHandle]() { mImpl->CompleteProgram(programHandle); });
+		mImpl->mProgramsPending = true;
+	}
+	if (mImpl->mProgramsPending) {
+		mImpl->mQueue.Flush();
+		mImpl->mProgramsPending = false;
+	}
+	auto& program = mImpl->mPrograms.Get(programHandle);
+	return program.GetUniformHandle(uniformId);
 }
 
 void GraphicsDeviceGL::setUniform1i(const ProgramHandle& programHandle, UniformHandle& uniformHandle, int32_t data) {
 	if (!programHandle.IsValid()) {
 		return;
 	}
-	auto& program = mImpl->mPrograms[programHandle.mHandle];
-	program.SetUniformInt(uniformHandle, data);
+	UniformHandle uniform = uniformHandle;
+	mImpl->mQueue.Push([=]() {
+		if (!mImpl->HasUniform(programHandle, uniform)) {
+			return;
+		}
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->RecordUniform(programHandle, uniform, &data, sizeof(data));
+			return;
+		}
+		mImpl->CountUniformUpload(mImpl->mPrograms.Get(programHandle).SetUniformInt(uniform, data));
+	});
 }
 
 void GraphicsDeviceGL::SetUniformFloat(const ProgramHandle& programHandle, UniformHandle& uniformHandle, float data) {
 	if (!programHandle.IsValid()) {
 		return;
 	}
-	auto& program = mImpl->mPrograms[programHandle.mHandle];
-	program.SetUniformFloat(uniformHandle, data);
+	UniformHandle uniform = uniformHandle;
+	mImpl->mQueue.Push([=]() {
+		if (!mImpl->HasUniform(programHandle, uniform)) {
+			return;
+		}
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->RecordUniform(programHandle, uniform, &data, sizeof(data));
+			return;
+		}
+		mImpl->CountUniformUpload(mImpl->mPrograms.Get(programHandle).SetUniformFloat(uniform, data));
+	});
 }
 
+// The uniform table is read-only once linked and the handle comes from GetUniform, which waited for the link,
+// so the array size can be looked up from the calling thread.
 void GraphicsDeviceGL::SetUniformFloat3(const ProgramHandle& programHandle, UniformHandle& uniformHandle, const float* data) {
 	if (!programHandle.IsValid()) {
 		return;
 	}
-	auto& program = mImpl->mPrograms[programHandle.mHandle];
-	program.SetUniformFloat3(uniformHandle, data);
+	UniformHandle uniform = uniformHandle;
+	if (!mImpl->HasUniform(programHandle, uniform)) {
+		return;
+	}
+	uint32_t size = sizeof(float) * 3 * mImpl->mPrograms.Get(programHandle).GetUniform(uniform).mSize;
+	JobData values = mImpl->mQueue.Copy(data, size);
+	mImpl->mQueue.Push([=]() {
+		// the program may have been destroyed since
+		if (!mImpl->HasUniform(programHandle, uniform)) {
+			return;
+		}
+		const float* floats = static_cast<const float*>(values.Get());
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->RecordUniform(programHandle, uniform, floats, size);
+			return;
+		}
+		mImpl->CountUniformUpload(mImpl->mPrograms.Get(programHandle).SetUniformFloat3(uniform, floats));
+	});
 }
 
 void GraphicsDeviceGL::SetUniformMat4(const ProgramHandle& programHandle, const UniformHandle& uniformHandle, const float* data, bool transpose) {
 	if (!programHandle.IsValid()) {
 		return;
 	}
-	auto& program = mImpl->mPrograms[programHandle.mHandle];
-	program.SetUniformMat4(uniformHandle, data, transpose);
+	UniformHandle uniform = uniformHandle;
+	if (!mImpl->HasUniform(programHandle, uniform)) {
+		return;
+	}
+	uint32_t size = sizeof(float) * 16 * mImpl->mPrograms.Get(programHandle).GetUniform(uniform).mSize;
+	JobData values = mImpl->mQueue.Copy(data, size);
+	mImpl->mQueue.Push([=]() {
+		// the program may have been destroyed since
+		if (!mImpl->HasUniform(programHandle, uniform)) {
+			return;
+		}
+		const float* floats = static_cast<const float*>(values.Get());
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			// recorded values are replayed without transposition
+			if (transpose) {
+				auto& transposed = mImpl->mTransposedScratch;
+				transposed.resize(size / sizeof(float));
+				for (uint32_t offset = 0; offset < transposed.size(); offset += 16) {
+					for (uint32_t n = 0; n < 16; n++) {
+						transposed[offset + n] = floats[offset + (n % 4) * 4 + n / 4];
+					}
+				}
+				floats = transposed.data();
+			}
+			mImpl->RecordUniform(programHandle, uniform, floats, size);
+			return;
+		}
+		mImpl->CountUniformUpload(mImpl->mPrograms.Get(programHandle).SetUniformMat4(uniform, floats, transpose));
+	});
 }
 
+// the image is read on the render thread and callers usually release it right after, wait for the upload
 TextureHandle GraphicsDeviceGL::CreateTexture2D(const ImageHandle& imageHandle, ImageManager& imageManager, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps) {
-	TextureHandle handle = TextureHandle(mImpl->mTexturesCount++);
-	auto& texture = mImpl->mTextures[handle.mHandle];
-	texture.Create(GL_TEXTURE_2D, imageHandle, imageManager, format, filtering, useMipmaps);
-	return texture.IsValid() ? handle : TextureHandle(cInvalidHandle);
+	ImageManager* images = &imageManager;
+	TextureHandle handle = mImpl->CreateResource(mImpl->mTextures, [imageHandle, images, format, filtering, useMipmaps](TextureGL& texture) {
+		texture.Create(GL_TEXTURE_2D, imageHandle, *images, format, filtering, useMipmaps);
+	});
+	if (handle.IsValid()) {
+		mImpl->SetTextureResident(handle, true);
+	}
+	mImpl->mQueue.Flush();
+	return handle;
+}
+
+TextureHandle GraphicsDeviceGL::CreateTexture2DAsync(const char* filename, ImageManager& imageManager, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps) {
+	if (GetTextureFormatInfo(format).mCompressed) {
+		Log(Logger::Error, "Texture streaming: compressed formats are not supported, %s", filename);
+		return TextureHandle(cInvalidHandle);
+	}
+	TextureHandle handle = mImpl->mTextures.Allocate();
+	if (!handle.IsValid()) {
+		return handle;
+	}
+	mImpl->SetTextureResident(handle, false);
+	uint32_t request = mImpl->mTextureStreamer.Decode(filename, imageManager, format, useMipmaps);
+	mImpl->mQueue.Push([=]() {
+		mImpl->mTextures.Get(handle).CreatePlaceholder(GL_TEXTURE_2D);
+		mImpl->mTextureStreamer.Track(handle, request, format, filtering, useMipmaps);
+	});
+	return handle;
+}
+
+bool GraphicsDeviceGL::IsTextureResident(const TextureHandle& handle) const {
+	return mImpl->mTextures.IsValid(handle) && mImpl->mTexturesResident[HandlePool<TextureGL, cMaxTextureHandle>::GetIndex(handle)].load();
+}
+
+void GraphicsDeviceGL::SetTextureUploadBudget(uint32_t bytesPerFrame) {
+	mImpl->mQueue.Push([=]() { mImpl->mTextureStreamer.SetBudget(bytesPerFrame); });
+}
+
+void GraphicsDeviceGL::DestroyTexture(TextureHandle& handle) {
+	mImpl->QueueDestroy(PendingDestroy::Texture, handle);
+	handle = TextureHandle(cInvalidHandle);
 }
 
 void GraphicsDeviceGL::SetTexture(uint32_t stage, const TextureHandle& textureHandle) {
-	if (!textureHandle.IsValid()) {
-		return;
+	mImpl->mQueue.Push([=]() {
+		if (stage < cMaxTextureStages) {
+			mImpl->mPendingDraw.mTextures[stage] = textureHandle;
+		}
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			return;
+		}
+		if (!textureHandle.IsValid()) {
+			return;
+		}
+		auto& texture = mImpl->mTextures.Get(textureHandle);
+		texture.Bind(stage);
+	});
+}
+
+// with a render thread the last complete frame is the one before the frame it may still be running
+bool GraphicsDeviceGL::ReadPixels(uint32_t x, uint32_t y, uint32_t width, uint32_t height, void* rgba) {
+	if (rgba == nullptr) {
+		return false;
 	}
-	auto& texture = mImpl->mTextures[textureHandle.mHandle];
-	texture.Bind(stage);
+	mImpl->mQueue.Push([=]() {
+		if (mImpl->mSubmissionMode == SubmissionMode::Deferred) {
+			mImpl->Replay();
+		}
+		GL_CHECK(glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba));
+	});
+	mImpl->mQueue.Flush();
+	return true;
+}
+
+// in deferred submission the draws run at the next replay, outside of the ranges they were recorded in
+void GraphicsDeviceGL::BeginGpuScope(const char* name) {
+	mImpl->mQueue.Push([=]() { mImpl->mGpuTimer.BeginScope(name); });
+}
+
+void GraphicsDeviceGL::EndGpuScope() {
+	mImpl->mQueue.Push([=]() { mImpl->mGpuTimer.EndScope(); });
+}
+
+const GraphicsStats& GraphicsDeviceGL::GetStats() const {
+	uint64_t frame = mImpl->mFrameIndex + (mImpl->mQueue.IsThreaded() ? 0 : 1);
+	return mImpl->mLastFrameStats[frame & 1];
+}
+
+const GraphicsCaps& GraphicsDeviceGL::GetCaps() const {
+	return mImpl->GetCaps();
 }
 
 } // namespace tinyngine
\ No newline at end of file
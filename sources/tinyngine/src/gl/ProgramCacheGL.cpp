@@ -0,0 +1,169 @@
+#include "ProgramCacheGL.h"
+#include "ProgramGL.h"
+#include "ShaderGL.h"
+#include "Log.h"
+#include "Profiler.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+
+static constexpr uint32_t cCacheMagic = 0x43505454; // "TTPC"
+static constexpr uint32_t cCacheVersion = 1;
+
+struct CacheHeader {
+	uint32_t mMagic;
+	uint32_t mVersion;
+	uint64_t mKey;
+	uint32_t mFormat;
+	uint32_t mBinarySize;
+	uint32_t mReflectionSize;
+	uint32_t mPadding;
+};
+
+// FNV-1a, the terminating zero is hashed so that consecutive strings cannot be shifted into one another
+static uint64_t HashString(const char* text, uint64_t hash = 14695981039346656037ull) {
+	const char* position = text ? text : "";
+	do {
+		hash = (hash ^ static_cast<uint8_t>(*position)) * 1099511628211ull;
+	} while (*position++);
+	return hash;
+}
+
+static bool MakeDirectory(const char* path) {
+#if defined(_WIN32)
+	return _mkdir(path) == 0 || errno == EEXIST;
+#else
+	return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+}
+
+namespace tinyngine
+{
+
+bool ProgramCacheGL::Initialize() {
+	mEnabled = tinyngine::gl::InitProgramBinary();
+	if (mEnabled) {
+		mDriverHash = HashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+		mDriverHash = HashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), mDriverHash);
+		mDriverHash = HashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), mDriverHash);
+	}
+	return mEnabled;
+}
+
+void ProgramCacheGL::SetDirectory(const char* directory) {
+	mDirectory = directory ? directory : "";
+	mDirectoryCreated = false;
+}
+
+void ProgramCacheGL::Create(ProgramGL& program, ShaderGL& vs, ShaderGL& fs) {
+	TINYNGINE_PROFILE_SCOPE("CreateProgram");
+
+	// a shader that failed to compile has no source left
+	bool cached = mEnabled && !mDirectory.empty() && !vs.GetSource().empty();
+	uint64_t key = cached ? ComputeKey(vs, fs) : 0;
+	if (cached && Load(key, program)) {
+		return;
+	}
+
+	program.Create(vs, fs);
+	Complete(program, key);
+}
+
+uint64_t ProgramCacheGL::Submit(ProgramGL& program, ShaderGL& vs, ShaderGL& fs) {
+	TINYNGINE_PROFILE_SCOPE("SubmitProgram");
+
+	bool cached = mEnabled && !mDirectory.empty() && !vs.GetSource().empty();
+	uint64_t key = cached ? ComputeKey(vs, fs) : 0;
+	if (cached && Load(key, program)) {
+		return key;
+	}
+
+	program.Submit(vs, fs);
+	return key;
+}
+
+void ProgramCacheGL::Complete(ProgramGL& program, uint64_t key) {
+	program.Initialize();
+	if (key != 0 && program.IsValid()) {
+		Store(key, program);
+	}
+}
+
+uint64_t ProgramCacheGL::ComputeKey(const ShaderGL& vs, const ShaderGL& fs) const {
+	uint64_t key = HashString(vs.GetSource().c_str(), mDriverHash);
+	return HashString(fs.GetSource().c_str(), key);
+}
+
+std::string ProgramCacheGL::GetPath(uint64_t key) const {
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.bin", static_cast<unsigned long long>(key));
+	return mDirectory + name;
+}
+
+bool ProgramCacheGL::Load(uint64_t key, ProgramGL& program) {
+	std::string path = GetPath(key);
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file) {
+		return false;
+	}
+
+	CacheHeader header;
+	bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.mMagic == cCacheMagic && header.mVersion == cCacheVersion && header.mKey == key;
+	if (valid) {
+		mScratch.resize(header.mBinarySize + header.mReflectionSize);
+		valid = !mScratch.empty() && fread(mScratch.data(), mScratch.size(), 1, file) == 1;
+	}
+	fclose(file);
+
+	valid = valid && program.Create(header.mFormat, mScratch.data(), header.mBinarySize);
+	valid = valid && program.Initialize(mScratch.data() + header.mBinarySize, header.mReflectionSize);
+	if (!valid) {
+		Log(Logger::Verbose, "Discarding the stale program binary %s", path.c_str());
+		program.Destroy();
+		remove(path.c_str());
+	}
+	return valid;
+}
+
+void ProgramCacheGL::Store(uint64_t key, const ProgramGL& program) {
+	GLenum format = 0;
+	if (!program.GetBinary(format, mScratch)) {
+		return;
+	}
+	CacheHeader header{ cCacheMagic, cCacheVersion, key, format, static_cast<uint32_t>(mScratch.size()), 0, 0 };
+	program.SerializeReflection(mScratch);
+	header.mReflectionSize = static_cast<uint32_t>(mScratch.size()) - header.mBinarySize;
+
+	if (!mDirectoryCreated) {
+		mDirectoryCreated = MakeDirectory(mDirectory.c_str());
+	}
+
+	// written aside and renamed, a file interrupted halfway is never picked up
+	std::string path = GetPath(key);
+	std::string temporaryPath = path + ".tmp";
+	FILE* file = fopen(temporaryPath.c_str(), "wb");
+	if (!file) {
+		Log(Logger::Warning, "Cannot write the program cache in %s", mDirectory.c_str());
+		return;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(mScratch.data(), mScratch.size(), 1, file) == 1;
+	written = fclose(file) == 0 && written;
+	remove(path.c_str());
+	if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+		remove(temporaryPath.c_str());
+	}
+}
+
+} // namespace tinyngine
\ No newline at end of file
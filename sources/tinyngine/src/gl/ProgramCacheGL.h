@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GLApi.h"
+
+#include <string>
+#include <vector>
+
+namespace tinyngine
+{
+
+class ProgramGL;
+class ShaderGL;
+
+// On-disk cache of linked programs, one file per program named after a hash of both shader sources and of the
+// driver strings. A file holds the program binary along with the reflection data of ProgramGL, so that a hit
+// neither compiles, links nor queries the program. Runs on the thread owning the context.
+class ProgramCacheGL final {
+public:
+	ProgramCacheGL() = default;
+
+	ProgramCacheGL(const ProgramCacheGL& other) = delete;
+	ProgramCacheGL& operator=(const ProgramCacheGL& other) = delete;
+
+	// returns false when the driver cannot save programs, Create always compiles then
+	bool Initialize();
+
+	// an empty directory disables the cache, it is created on first store
+	void SetDirectory(const char* directory);
+
+	// loads the program from the cache, or compiles and links the shaders and stores the result
+	void Create(ProgramGL& program, ShaderGL& vs, ShaderGL& fs);
+
+	// Loads the program from the cache, or submits the shaders and leaves the program pending. Returns the key
+	// to hand to Complete once the pending program is done.
+	uint64_t Submit(ProgramGL& program, ShaderGL& vs, ShaderGL& fs);
+	void Complete(ProgramGL& program, uint64_t key);
+
+private:
+	uint64_t ComputeKey(const ShaderGL& vs, const ShaderGL& fs) const;
+	std::string GetPath(uint64_t key) const;
+	bool Load(uint64_t key, ProgramGL& program);
+	void Store(uint64_t key, const ProgramGL& program);
+
+private:
+	std::string mDirectory = "programcache";
+	bool mDirectoryCreated = false;
+	uint64_t mDriverHash = 0;
+	bool mEnabled = false;
+	std::vector<uint8_t> mScratch;
+};
+
+} // namespace tinyngine
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include "ProgramGL.h"
 #include "VertexFormat.h"
+#include "Log.h"
 
 #include <memory>
 #include <algorithm>
 #include <map>
+#include <cstring>
 
 namespace
 {
@@ -28,12 +30,52 @@ static std::map<GLenum, tinyngine::UniformType::Enum> cUniformTypeTranslationTab
 	{ GL_SAMPLER_CUBE, tinyngine::UniformType::SamplerCube }
 };
 
+// bytes per array element, indexed by UniformType
+static const uint8_t cUniformTypeSize[]{
+	4, 8, 12, 16,
+	4, 8, 12, 16,
+	4, 8, 12, 16,
+	16, 36, 64,
+	4, 4
+};
+
+static_assert(sizeof(cUniformTypeSize) == tinyngine::UniformType::Count, "cUniformTypeSize must cover every UniformType");
+
+template<typename T>
+static void Write(std::vector<uint8_t>& buffer, const T& value) {
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template<typename T>
+static bool Read(const uint8_t*& position, const uint8_t* end, T& value) {
+	if (static_cast<size_t>(end - position) < sizeof(T)) {
+		return false;
+	}
+	memcpy(&value, position, sizeof(T));
+	position += sizeof(T);
+	return true;
+}
+
 }
 
 namespace tinyngine
 {
 
-void ProgramGL::Create(const ShaderGL& vs, const ShaderGL& fs) {
+void ProgramGL::Create(ShaderGL& vs, ShaderGL& fs) {
+	vs.Compile();
+	fs.Compile();
+	Link(vs, fs);
+	Poll(true);
+}
+
+void ProgramGL::Submit(ShaderGL& vs, ShaderGL& fs) {
+	vs.Submit();
+	fs.Submit();
+	Link(vs, fs);
+}
+
+void ProgramGL::Link(const ShaderGL& vs, const ShaderGL& fs) {
 	mId = glCreateProgram();
 	GL_ERROR(mId == 0);
 	
@@ -43,6 +85,21 @@ void ProgramGL::Create(const ShaderGL& vs, const ShaderGL& fs) {
 	}
 
 	GL_CHECK(glLinkProgram(mId));
+	mPending = true;
+}
+
+bool ProgramGL::Poll(bool wait) {
+	if (!mPending) {
+		return true;
+	}
+	if (!wait) {
+		GLint completed = GL_TRUE;
+		GL_CHECK(glGetProgramiv(mId, GL_COMPLETION_STATUS_KHR, &completed));
+		if (!completed) {
+			return false;
+		}
+	}
+	mPending = false;
 
 	GLint isLinked;
 	GL_CHECK(glGetProgramiv(mId, GL_LINK_STATUS, &isLinked));
@@ -59,6 +116,24 @@ void ProgramGL::Create(const ShaderGL& vs, const ShaderGL& fs) {
 		GL_CHECK(glDeleteProgram(mId));
 		mId = 0;
 	}
+	return true;
+}
+
+bool ProgramGL::Create(GLenum format, const void* binary, GLsizei length) {
+	mId = glCreateProgram();
+	GL_ERROR(mId == 0);
+
+	tinyngine::gl::ProgramBinary(mId, format, binary, length);
+	// a rejected binary is reported through the link status, the GL error it may raise is not an application error
+	while (glGetError() != GL_NO_ERROR) {}
+
+	GLint isLinked;
+	GL_CHECK(glGetProgramiv(mId, GL_LINK_STATUS, &isLinked));
+	if (!isLinked) {
+		GL_CHECK(glDeleteProgram(mId));
+		mId = 0;
+	}
+	return mId > 0;
 }
 
 void ProgramGL::Initialize() {
@@ -78,6 +153,8 @@ void ProgramGL::Initialize() {
 	GLint maxLength = std::max(maxAttribLength, maxUniformLength);
 	char* attribName = new char[maxLength + 1];
 
+	// GL zero-initializes uniforms at link time, which is exactly the initial shadow content
+	uint32_t shadowSize = 0;
 	mUniforms.reserve(activeUniforms);
 	for (GLint n = 0; n < activeUniforms; n++) {
 		GLint size;
@@ -87,14 +164,28 @@ void ProgramGL::Initialize() {
 		GLint location = glGetUniformLocation(mId, attribName);
 		GL_ERROR(location == -1);
 
+		// arrays are reported as "name[0]", they are looked up by their bare name
+		char* subscript = strchr(attribName, '[');
+		if (subscript) {
+			*subscript = '\0';
+		}
+
 		Uniform uniform;
 		uniform.mLocation = location;
+		uniform.mNameHash = HashUniformName(attribName);
 		uniform.mSize = static_cast<uint16_t>(size);
 		uniform.mType = cUniformTypeTranslationTable[type];
-		memset(uniform.mName, 0, sizeof(uniform.mName));
-		strcpy(uniform.mName, attribName);
+		uniform.mShadowOffset = shadowSize;
+		shadowSize += cUniformTypeSize[uniform.mType] * uniform.mSize;
+
+		for (const auto& other : mUniforms) {
+			if (other.mNameHash == uniform.mNameHash) {
+				Log(Logger::Error, "Uniform name hash collision on '%s'", attribName);
+			}
+		}
 		mUniforms.push_back(uniform);
 	}
+	mUniformShadow.assign(shadowSize, 0);
 
 	std::fill(std::begin(mAttributeLocations), std::end(mAttributeLocations), -1);
 	std::fill(std::begin(mUsedAttributes), std::end(mUsedAttributes), UINT8_MAX);
@@ -109,10 +200,87 @@ void ProgramGL::Initialize() {
 	}
 	mUsedAttributesCount = used;
 
-	delete attribName;
+	delete[] attribName;
+}
+
+bool ProgramGL::Initialize(const uint8_t* reflection, size_t size) {
+	if (!IsValid()) {
+		return false;
+	}
+
+	const uint8_t* position = reflection;
+	const uint8_t* end = reflection + size;
+	uint32_t uniformsCount = 0;
+	uint32_t shadowSize = 0;
+	bool valid = Read(position, end, uniformsCount) && Read(position, end, shadowSize);
+	mUniforms.resize(valid ? uniformsCount : 0);
+	for (auto& uniform : mUniforms) {
+		uint8_t type = 0;
+		valid = valid && Read(position, end, uniform.mLocation) && Read(position, end, uniform.mNameHash) && Read(position, end, uniform.mShadowOffset)
+			&& Read(position, end, uniform.mSize) && Read(position, end, type) && type < UniformType::Count;
+		uniform.mType = static_cast<UniformType::Enum>(type);
+		valid = valid && uniform.mShadowOffset + cUniformTypeSize[uniform.mType] * uniform.mSize <= shadowSize;
+	}
+	for (auto& location : mAttributeLocations) {
+		valid = valid && Read(position, end, location);
+	}
+	valid = valid && Read(position, end, mUsedAttributesCount) && mUsedAttributesCount <= Attributes::Count;
+	for (auto& attribute : mUsedAttributes) {
+		valid = valid && Read(position, end, attribute);
+	}
+
+	if (!valid || position != end) {
+		mUniforms.clear();
+		mUsedAttributesCount = 0;
+		return false;
+	}
+	mUniformShadow.assign(shadowSize, 0);
+	return true;
+}
+
+void ProgramGL::Destroy() {
+	if (mId > 0) {
+		GL_CHECK(glDeleteProgram(mId));
+		mId = 0;
+	}
+	mPending = false;
+	mUniforms.clear();
+	mUniformShadow.clear();
+	mUsedAttributesCount = 0;
+	mInstancingQueried = false;
+	mInstanceIndexLocation = -1;
+	mInstanceDataHandle = UniformHandle(cInvalidHandle);
+}
+
+bool ProgramGL::GetBinary(GLenum& format, std::vector<uint8_t>& binary) const {
+	GLint length = IsValid() ? tinyngine::gl::GetProgramBinaryLength(mId) : 0;
+	if (length <= 0) {
+		return false;
+	}
+	binary.resize(length);
+	return tinyngine::gl::GetProgramBinary(mId, length, format, binary.data());
+}
+
+void ProgramGL::SerializeReflection(std::vector<uint8_t>& reflection) const {
+	Write(reflection, static_cast<uint32_t>(mUniforms.size()));
+	Write(reflection, static_cast<uint32_t>(mUniformShadow.size()));
+	for (const auto& uniform : mUniforms) {
+		Write(reflection, uniform.mLocation);
+		Write(reflection, uniform.mNameHash);
+		Write(reflection, uniform.mShadowOffset);
+		Write(reflection, uniform.mSize);
+		Write(reflection, static_cast<uint8_t>(uniform.mType));
+	}
+	for (auto location : mAttributeLocations) {
+		Write(reflection, location);
+	}
+	Write(reflection, mUsedAttributesCount);
+	for (auto attribute : mUsedAttributes) {
+		Write(reflection, attribute);
+	}
 }
 
-void ProgramGL::BindAttributes(const VertexFormat& vertexFormat, const std::array<GLuint, Attributes::Count>& handles) {
+void ProgramGL::BindAttributes(const VertexFormat& vertexFormat, const std::array<GLuint, Attributes::Count>& handles, const std::array<uint32_t, Attributes::Count>& offsets) {
 	for (GLint n = 0; n < mUsedAttributesCount; n++) {
 		Attributes::Enum attrib = static_cast<Attributes::Enum>(mUsedAttributes[n]);
 		GLint location = mAttributeLocations[attrib];
@@ -125,12 +293,13 @@ void ProgramGL::BindAttributes(const VertexFormat& vertexFormat, const std::arra
 			GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, handles[attrib]));
 
 			GL_CHECK(glEnableVertexAttribArray(location));
-			GL_CHECK(glVertexAttribPointer(location, size, tinyngine::gl::GetAttributeType(static_cast<AttributeType::Enum>(type)), normalized, vertexFormat.mOffset[attrib], 0));
+			GL_CHECK(glVertexAttribPointer(location, size, tinyngine::gl::GetAttributeType(static_cast<AttributeType::Enum>(type)), normalized, 0, reinterpret_cast<const void*>(static_cast<uintptr_t>(offsets[attrib]))));
 		}
 	}
 }
 
-void ProgramGL::BindAttributes(const VertexFormat& vertexFormat, uint32_t baseVertex) {
+void ProgramGL::BindAttributes(const VertexFormat& vertexFormat, GLuint handle, uint32_t offset) {
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, handle));
 	for (GLint n = 0; n < mUsedAttributesCount; n++) {
 		Attributes::Enum attrib = static_cast<Attributes::Enum>(mUsedAttributes[n]);
 		GLint location = mAttributeLocations[attrib];
@@ -141,8 +310,8 @@ void ProgramGL::BindAttributes(const VertexFormat& vertexFormat, uint32_t baseVe
 			vertexFormat.Decode(attrib, type, size, normalized);
 
 			GL_CHECK(glEnableVertexAttribArray(location));
-			uint32_t firstIndex = baseVertex * vertexFormat.mStride + vertexFormat.mOffset[attrib];
-			GL_CHECK(glVertexAttribPointer(location, size, tinyngine::gl::GetAttributeType(static_cast<AttributeType::Enum>(type)), normalized, vertexFormat.mStride, (void*)(uintptr_t)firstIndex));
+			uint32_t attribOffset = offset + vertexFormat.mOffset[attrib];
+			GL_CHECK(glVertexAttribPointer(location, size, tinyngine::gl::GetAttributeType(static_cast<AttributeType::Enum>(type)), normalized, vertexFormat.mStride, reinterpret_cast<const void*>(static_cast<uintptr_t>(attribOffset))));
 		}
 	}
 }
@@ -157,35 +326,212 @@ void ProgramGL::UnbindAttributes() {
 	}
 }
 
-UniformHandle ProgramGL::GetUniformHandle(const char* uniformName) const {
-	int index = -1;
+void ProgramGL::BindInstanceAttributes(const VertexFormat& instanceFormat, GLuint handle, uint32_t offset, uint32_t divisor) {
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, handle));
+	for (uint8_t n = 0; n < Attributes::Count; n++) {
+		Attributes::Enum attrib = static_cast<Attributes::Enum>(n);
+		GLint location = mAttributeLocations[attrib];
+		if (location >= 0 && instanceFormat.IsValid(attrib)) {
+			uint8_t size;
+			uint8_t type;
+			bool normalized;
+			instanceFormat.Decode(attrib, type, size, normalized);
+
+			GL_CHECK(glEnableVertexAttribArray(location));
+			uint32_t attribOffset = offset + instanceFormat.mOffset[attrib];
+			GL_CHECK(glVertexAttribPointer(location, size, tinyngine::gl::GetAttributeType(static_cast<AttributeType::Enum>(type)), normalized, instanceFormat.mStride, reinterpret_cast<const void*>(static_cast<uintptr_t>(attribOffset))));
+			GL_CHECK(tinyngine::gl::VertexAttribDivisor(location, divisor));
+		}
+	}
+}
+
+void ProgramGL::UnbindInstanceAttributes(const VertexFormat& instanceFormat) {
+	for (uint8_t n = 0; n < Attributes::Count; n++) {
+		Attributes::Enum attrib = static_cast<Attributes::Enum>(n);
+		GLint location = mAttributeLocations[attrib];
+		if (location >= 0 && instanceFormat.IsValid(attrib)) {
+			GL_CHECK(tinyngine::gl::VertexAttribDivisor(location, 0));
+			GL_CHECK(glDisableVertexAttribArray(location));
+		}
+	}
+}
+
+void ProgramGL::SetInstanceAttributes(const VertexFormat& instanceFormat, const uint8_t* data) {
+	for (uint8_t n = 0; n < Attributes::Count; n++) {
+		Attributes::Enum attrib = static_cast<Attributes::Enum>(n);
+		GLint location = mAttributeLocations[attrib];
+		if (location < 0 || !instanceFormat.IsValid(attrib)) {
+			continue;
+		}
+		// generic attribute values are always float, missing components default like a fetched vertex would
+		GLfloat values[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		instanceFormat.Read(attrib, data + instanceFormat.mOffset[attrib], values);
+		GL_CHECK(glDisableVertexAttribArray(location));
+		GL_CHECK(glVertexAttrib4fv(location, values));
+	}
+}
+
+uint32_t ProgramGL::GetInstanceDataCapacity() {
+	if (!mInstancingQueried && IsReady()) {
+		mInstancingQueried = true;
+		mInstanceIndexLocation = glGetAttribLocation(mId, "a_instanceIndex");
+		UniformHandle handle = GetUniformHandle(UniformId("u_instanceData"));
+		if (handle.IsValid() && mUniforms[handle.mHandle].mType == UniformType::Float4) {
+			mInstanceDataHandle = handle;
+		}
+	}
+	if (mInstanceIndexLocation < 0 || !mInstanceDataHandle.IsValid()) {
+		return 0;
+	}
+	return mUniforms[mInstanceDataHandle.mHandle].mSize;
+}
+
+void ProgramGL::BindInstanceIndex(GLuint handle) {
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, handle));
+	GL_CHECK(glEnableVertexAttribArray(mInstanceIndexLocation));
+	GL_CHECK(glVertexAttribPointer(mInstanceIndexLocation, 1, GL_FLOAT, GL_FALSE, 0, nullptr));
+}
+
+void ProgramGL::SetInstanceIndex(float index) {
+	GL_CHECK(glDisableVertexAttribArray(mInstanceIndexLocation));
+	GL_CHECK(glVertexAttrib1f(mInstanceIndexLocation, index));
+}
+
+void ProgramGL::UnbindInstanceIndex() {
+	GL_CHECK(glDisableVertexAttribArray(mInstanceIndexLocation));
+}
+
+bool ProgramGL::SetInstanceData(const float* data, uint32_t count) {
+	const Uniform& uniform = mUniforms[mInstanceDataHandle.mHandle];
+	if (!UpdateShadow(uniform, data, count * 4 * sizeof(float))) {
+		return false;
+	}
+	GL_CHECK(glUniform4fv(uniform.mLocation, count, data));
+	return true;
+}
+
+UniformHandle ProgramGL::GetUniformHandle(const UniformId& uniformId) const {
 	for (size_t n = 0; n < mUniforms.size(); n++) {
-		if (strcmp(mUniforms[n].mName, uniformName) == 0) {
-			index = n;
-			break;
+		if (mUniforms[n].mNameHash == uniformId.mHash) {
+			return UniformHandle(static_cast<uint32_t>(n));
 		}
 	}
-	return index != -1 ? UniformHandle(index) : UniformHandle(cInvalidHandle);
+	return UniformHandle(cInvalidHandle);
 }
 
-void ProgramGL::SetUniformInt(const UniformHandle& uniformHandle, int32_t data) {
+bool ProgramGL::UpdateShadow(const Uniform& uniform, const void* data, uint32_t size) {
+	// a size that does not match the declared type cannot be tracked, always upload it
+	if (size > static_cast<uint32_t>(cUniformTypeSize[uniform.mType] * uniform.mSize)) {
+		return true;
+	}
+	uint8_t* shadow = &mUniformShadow[uniform.mShadowOffset];
+	if (memcmp(shadow, data, size) == 0) {
+		return false;
+	}
+	memcpy(shadow, data, size);
+	return true;
+}
+
+bool ProgramGL::SetUniformInt(const UniformHandle& uniformHandle, int32_t data) {
 	auto& uniform = mUniforms[uniformHandle.mHandle];
+	if (!UpdateShadow(uniform, &data, sizeof(data))) {
+		return false;
+	}
 	GL_CHECK(glUniform1i(uniform.mLocation, data));
+	return true;
 }
 
-void ProgramGL::SetUniformFloat(const UniformHandle& uniformHandle, float data) {
+bool ProgramGL::SetUniformFloat(const UniformHandle& uniformHandle, float data) {
 	auto& uniform = mUniforms[uniformHandle.mHandle];
+	if (!UpdateShadow(uniform, &data, sizeof(data))) {
+		return false;
+	}
 	GL_CHECK(glUniform1f(uniform.mLocation, data));
+	return true;
 }
 
-void ProgramGL::SetUniformFloat3(const UniformHandle& uniformHandle, const float* data) {
+bool ProgramGL::SetUniformFloat3(const UniformHandle& uniformHandle, const float* data) {
 	auto& uniform = mUniforms[uniformHandle.mHandle];
+	if (!UpdateShadow(uniform, data, sizeof(float) * 3 * uniform.mSize)) {
+		return false;
+	}
 	GL_CHECK(glUniform3fv(uniform.mLocation, uniform.mSize, data));
+	return true;
 }
 
-void ProgramGL::SetUniformMat4(const UniformHandle& uniformHandle, const float* data, bool transpose) {
+bool ProgramGL::SetUniformMat4(const UniformHandle& uniformHandle, const float* data, bool transpose) {
 	auto& uniform = mUniforms[uniformHandle.mHandle];
+	if (!UpdateShadow(uniform, data, sizeof(float) * 16 * uniform.mSize)) {
+		return false;
+	}
 	GL_CHECK(glUniformMatrix4fv(uniform.mLocation, uniform.mSize, transpose ? GL_TRUE : GL_FALSE, data));
+	return true;
+}
+
+uint32_t ProgramGL::SetUniforms(const uint8_t* values, size_t size) {
+	if (size != mUniformShadow.size()) {
+		return 0;
+	}
+	uint32_t uploads = 0;
+	for (const auto& uniform : mUniforms) {
+		uint32_t bytes = cUniformTypeSize[uniform.mType] * uniform.mSize;
+		const uint8_t* value = values + uniform.mShadowOffset;
+		uint8_t* shadow = &mUniformShadow[uniform.mShadowOffset];
+		if (memcmp(shadow, value, bytes) != 0) {
+			memcpy(shadow, value, bytes);
+			Upload(uniform, value);
+			uploads++;
+		}
+	}
+	return uploads;
+}
+
+void ProgramGL::Upload(const Uniform& uniform, const void* data) {
+	const GLfloat* floats = static_cast<const GLfloat*>(data);
+	const GLint* ints = static_cast<const GLint*>(data);
+	switch (uniform.mType) {
+	case UniformType::Float:
+		GL_CHECK(glUniform1fv(uniform.mLocation, uniform.mSize, floats));
+		break;
+	case UniformType::Float2:
+		GL_CHECK(glUniform2fv(uniform.mLocation, uniform.mSize, floats));
+		break;
+	case UniformType::Float3:
+		GL_CHECK(glUniform3fv(uniform.mLocation, uniform.mSize, floats));
+		break;
+	case UniformType::Float4:
+		GL_CHECK(glUniform4fv(uniform.mLocation, uniform.mSize, floats));
+		break;
+	case UniformType::Int:
+	case UniformType::Bool:
+	case UniformType::Sampler2D:
+	case UniformType::SamplerCube:
+		GL_CHECK(glUniform1iv(uniform.mLocation, uniform.mSize, ints));
+		break;
+	case UniformType::Int2:
+	case UniformType::Bool2:
+		GL_CHECK(glUniform2iv(uniform.mLocation, uniform.mSize, ints));
+		break;
+	case UniformType::Int3:
+	case UniformType::Bool3:
+		GL_CHECK(glUniform3iv(uniform.mLocation, uniform.mSize, ints));
+		break;
+	case UniformType::Int4:
+	case UniformType::Bool4:
+		GL_CHECK(glUniform4iv(uniform.mLocation, uniform.mSize, ints));
+		break;
+	case UniformType::Mat2:
+		GL_CHECK(glUniformMatrix2fv(uniform.mLocation, uniform.mSize, GL_FALSE, floats));
+		break;
+	case UniformType::Mat3:
+		GL_CHECK(glUniformMatrix3fv(uniform.mLocation, uniform.mSize, GL_FALSE, floats));
+		break;
+	case UniformType::Mat4:
+		GL_CHECK(glUniformMatrix4fv(uniform.mLocation, uniform.mSize, GL_FALSE, floats));
+		break;
+	default:
+		break;
+	}
 }
 
 } // namespace tinyngine
\ No newline at end of file
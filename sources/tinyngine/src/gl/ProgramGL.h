@@ -14,29 +14,79 @@ class ProgramGL {
 public:
 	ProgramGL() : mId(0) {}
 
-	void Create(const ShaderGL& vs, const ShaderGL& fs);
+	// compiles the shaders that were created with a deferred compilation
+	void Create(ShaderGL& vs, ShaderGL& fs);
+	// compiles and links without waiting for the results, the program is pending until Poll returns true
+	void Submit(ShaderGL& vs, ShaderGL& fs);
+	// true once the link status is known, the program is invalid afterwards if linking failed. Polling without
+	// waiting needs KHR_parallel_shader_compile.
+	bool Poll(bool wait);
+	// links a binary returned by GetBinary, fails when the driver rejects it (typically after an update)
+	bool Create(GLenum format, const void* binary, GLsizei length);
 	void Initialize();
+	// restores the reflection data written by SerializeReflection instead of querying it from GL
+	bool Initialize(const uint8_t* reflection, size_t size);
+	void Destroy();
 
-	void BindAttributes(const VertexFormat& vertexFormat, const std::array<GLuint, Attributes::Count>& handles);
-	void BindAttributes(const VertexFormat& vertexFormat, uint32_t baseVertex);
+	bool GetBinary(GLenum& format, std::vector<uint8_t>& binary) const;
+	void SerializeReflection(std::vector<uint8_t>& reflection) const;
+
+	// one tightly packed buffer per attribute
+	void BindAttributes(const VertexFormat& vertexFormat, const std::array<GLuint, Attributes::Count>& handles, const std::array<uint32_t, Attributes::Count>& offsets);
+	// all attributes interleaved in a single buffer, laid out as described by vertexFormat
+	void BindAttributes(const VertexFormat& vertexFormat, GLuint handle, uint32_t offset);
 	void UnbindAttributes();
 
-	UniformHandle GetUniformHandle(const char* uniformName) const;
+	// per-instance attributes read from handle, advanced every divisor instances (needs instanced arrays)
+	void BindInstanceAttributes(const VertexFormat& instanceFormat, GLuint handle, uint32_t offset, uint32_t divisor);
+	void UnbindInstanceAttributes(const VertexFormat& instanceFormat);
+	// without instanced arrays, one instance element is fed as constant attribute values
+	void SetInstanceAttributes(const VertexFormat& instanceFormat, const uint8_t* data);
+
+	// Pseudo-instancing, for the programs declaring "uniform vec4 u_instanceData[N]" and "attribute float
+	// a_instanceIndex": the capacity of u_instanceData in vec4, 0 when the program does not declare both
+	uint32_t GetInstanceDataCapacity();
+	// one float per vertex read from handle, or the same index for every vertex
+	void BindInstanceIndex(GLuint handle);
+	void SetInstanceIndex(float index);
+	void UnbindInstanceIndex();
+	bool SetInstanceData(const float* data, uint32_t count);
+
+	UniformHandle GetUniformHandle(const UniformId& uniformId) const;
+	inline bool HasUniform(const UniformHandle& uniformHandle) const { return uniformHandle.mHandle < mUniforms.size(); }
+	inline const Uniform& GetUniform(const UniformHandle& uniformHandle) const { return mUniforms[uniformHandle.mHandle]; }
+	inline const std::vector<uint8_t>& GetUniformShadow() const { return mUniformShadow; }
 
-	void SetUniformInt(const UniformHandle& uniformHandle, int32_t data);
-	void SetUniformFloat(const UniformHandle& uniformHandle, float data);
-	void SetUniformFloat3(const UniformHandle& uniformHandle, const float* data);
-	void SetUniformMat4(const UniformHandle& uniformHandle, const float* data, bool transpose);
+	// setters return false when the value matches the shadow copy and no upload was issued
+	bool SetUniformInt(const UniformHandle& uniformHandle, int32_t data);
+	bool SetUniformFloat(const UniformHandle& uniformHandle, float data);
+	bool SetUniformFloat3(const UniformHandle& uniformHandle, const float* data);
+	bool SetUniformMat4(const UniformHandle& uniformHandle, const float* data, bool transpose);
+	// values are laid out like the shadow copy, the uniforms that differ from it are uploaded and counted
+	uint32_t SetUniforms(const uint8_t* values, size_t size);
 
 	inline GLint GetId() const { return mId; }
 	inline bool IsValid() const { return mId > 0; }
+	inline bool IsPending() const { return mPending; }
+	inline bool IsReady() const { return mId > 0 && !mPending; }
+
+private:
+	void Link(const ShaderGL& vs, const ShaderGL& fs);
+	bool UpdateShadow(const Uniform& uniform, const void* data, uint32_t size);
+	void Upload(const Uniform& uniform, const void* data);
 
 private:
 	GLint mId;
-	std::array<GLint, Attributes::Count> mAttributeLocations;
-	uint16_t mUsedAttributesCount;
-	std::array<uint8_t, Attributes::Count> mUsedAttributes;
+	bool mPending = false;
+	std::array<GLint, Attributes::Count> mAttributeLocations{};
+	uint16_t mUsedAttributesCount = 0;
+	std::array<uint8_t, Attributes::Count> mUsedAttributes{};
 	std::vector<Uniform> mUniforms;
+	std::vector<uint8_t> mUniformShadow;
+	// not part of the cached reflection, looked up on first use
+	bool mInstancingQueried = false;
+	GLint mInstanceIndexLocation = -1;
+	UniformHandle mInstanceDataHandle = UniformHandle(cInvalidHandle);
 };
 
 } // namespace tinyngine
\ No newline at end of file
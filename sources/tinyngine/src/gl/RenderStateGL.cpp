@@ -0,0 +1,56 @@
+#include "RenderStateGL.h"
+
+namespace
+{
+
+inline uint8_t StateBit(tinyngine::RendererStateType::Enum type, bool enabled) {
+	return enabled ? static_cast<uint8_t>(1 << type) : 0;
+}
+
+}
+
+namespace tinyngine
+{
+
+void RenderStateGL::Create(const RenderStateDesc& desc) {
+	mValid = desc.mBlend.mSrcFactor < BlendFuncs::Count && desc.mBlend.mDstFactor < BlendFuncs::Count
+		&& desc.mDepth.mFunc < DepthFuncs::Count
+		&& desc.mStencil.mFunc < StencilFuncs::Count
+		&& desc.mStencil.mStencilFail < StencilOpTypes::Count && desc.mStencil.mDepthFail < StencilOpTypes::Count && desc.mStencil.mDepthPass < StencilOpTypes::Count
+		&& desc.mRaster.mCullMode < CullFaceModes::Count && desc.mRaster.mWinding < WindingModes::Count
+		&& (desc.mColorMask & ~ColorMask::All) == 0;
+	if (!mValid) {
+		Log(Logger::Error, "Invalid render state description");
+		return;
+	}
+
+	mEnabledStates = StateBit(RendererStateType::Blend, desc.mBlend.mEnabled)
+		| StateBit(RendererStateType::CullFace, desc.mRaster.mCullEnabled)
+		| StateBit(RendererStateType::DepthTest, desc.mDepth.mTestEnabled)
+		| StateBit(RendererStateType::PolygonOffset, desc.mRaster.mPolygonOffsetEnabled)
+		| StateBit(RendererStateType::Scissor, desc.mRaster.mScissorEnabled)
+		| StateBit(RendererStateType::Stencil, desc.mStencil.mEnabled);
+
+	mBlendSrc = tinyngine::gl::GetBlendFunc(desc.mBlend.mSrcFactor);
+	mBlendDst = tinyngine::gl::GetBlendFunc(desc.mBlend.mDstFactor);
+
+	mDepthFunc = tinyngine::gl::GetDepthFunc(desc.mDepth.mFunc);
+	mDepthMask = desc.mDepth.mWriteEnabled ? GL_TRUE : GL_FALSE;
+
+	mStencilFunc = tinyngine::gl::GetStencilFunc(desc.mStencil.mFunc);
+	mStencilRef = desc.mStencil.mRef;
+	mStencilReadMask = desc.mStencil.mReadMask;
+	mStencilWriteMask = desc.mStencil.mWriteMask;
+	mStencilFail = tinyngine::gl::GetStencilOpType(desc.mStencil.mStencilFail);
+	mStencilDepthFail = tinyngine::gl::GetStencilOpType(desc.mStencil.mDepthFail);
+	mStencilDepthPass = tinyngine::gl::GetStencilOpType(desc.mStencil.mDepthPass);
+
+	mCullFace = tinyngine::gl::GetCullFaceMode(desc.mRaster.mCullMode);
+	mFrontFace = tinyngine::gl::GetWindingMode(desc.mRaster.mWinding);
+	mPolygonOffsetFactor = desc.mRaster.mPolygonOffsetFactor;
+	mPolygonOffsetUnits = desc.mRaster.mPolygonOffsetUnits;
+
+	mColorMask = desc.mColorMask;
+}
+
+} // namespace tinyngine
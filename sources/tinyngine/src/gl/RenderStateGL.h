@@ -0,0 +1,34 @@
+#pragma once
+
+#include "GraphicsTypes.h"
+#include "GLApi.h"
+
+namespace tinyngine
+{
+
+struct RenderStateGL {
+	void Create(const RenderStateDesc& desc);
+
+	inline bool IsValid() const { return mValid; }
+
+	bool mValid = false;
+	uint8_t mEnabledStates = 0;
+	GLenum mBlendSrc = GL_ONE;
+	GLenum mBlendDst = GL_ZERO;
+	GLenum mDepthFunc = GL_LESS;
+	GLboolean mDepthMask = GL_TRUE;
+	GLenum mStencilFunc = GL_ALWAYS;
+	GLint mStencilRef = 0;
+	GLuint mStencilReadMask = UINT32_MAX;
+	GLuint mStencilWriteMask = UINT32_MAX;
+	GLenum mStencilFail = GL_KEEP;
+	GLenum mStencilDepthFail = GL_KEEP;
+	GLenum mStencilDepthPass = GL_KEEP;
+	GLenum mCullFace = GL_BACK;
+	GLenum mFrontFace = GL_CCW;
+	GLfloat mPolygonOffsetFactor = 0.0f;
+	GLfloat mPolygonOffsetUnits = 0.0f;
+	uint8_t mColorMask = ColorMask::All;
+};
+
+} // namespace tinyngine
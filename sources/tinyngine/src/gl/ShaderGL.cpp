@@ -3,37 +3,63 @@
 namespace tinyngine
 {
 
-void ShaderGL::Create(GLenum type, const char* source) {
+void ShaderGL::Create(GLenum type, const char* source, bool deferCompile) {
 	if (source != nullptr) {
-		mId = glCreateShader(type);
-		GL_ERROR(mId == 0);
-
-		GL_CHECK(glShaderSource(mId, 1, (const char**)&source, nullptr));
-		GL_CHECK(glCompileShader(mId));
-
-		GLint compileResult;
-		GL_CHECK(glGetShaderiv(mId, GL_COMPILE_STATUS, &compileResult));
-		if (compileResult == 0) {
-			GLint infoLogLength;
-			GL_CHECK(glGetShaderiv(mId, GL_INFO_LOG_LENGTH, &infoLogLength));
-			if (infoLogLength > 1) {
-				char* infoLog = new char[infoLogLength];
-				int charactersWritten = 0;
-				GL_CHECK(glGetShaderInfoLog(mId, infoLogLength, &charactersWritten, infoLog));
-				// write somewhere!
-				delete[] infoLog;
-			}
-			GL_CHECK(glDeleteShader(mId));
-			mId = 0;
+		mType = type;
+		mSource = source;
+		if (!deferCompile) {
+			Compile();
 		}
 	}
 }
 
+bool ShaderGL::Compile() {
+	if (mId || mSource.empty()) {
+		return mId > 0;
+	}
+
+	Submit();
+
+	GLint compileResult;
+	GL_CHECK(glGetShaderiv(mId, GL_COMPILE_STATUS, &compileResult));
+	if (compileResult == 0) {
+		GLint infoLogLength;
+		GL_CHECK(glGetShaderiv(mId, GL_INFO_LOG_LENGTH, &infoLogLength));
+		if (infoLogLength > 1) {
+			char* infoLog = new char[infoLogLength];
+			int charactersWritten = 0;
+			GL_CHECK(glGetShaderInfoLog(mId, infoLogLength, &charactersWritten, infoLog));
+			// write somewhere!
+			delete[] infoLog;
+		}
+		GL_CHECK(glDeleteShader(mId));
+		mId = 0;
+		// a failed compilation is not retried
+		mSource.clear();
+	}
+	return mId > 0;
+}
+
+void ShaderGL::Submit() {
+	if (mId || mSource.empty()) {
+		return;
+	}
+
+	mId = glCreateShader(mType);
+	GL_ERROR(mId == 0);
+
+	const char* source = mSource.c_str();
+	GL_CHECK(glShaderSource(mId, 1, &source, nullptr));
+	GL_CHECK(glCompileShader(mId));
+}
+
 void ShaderGL::Destroy() {
 	if (mId) {
 		GL_CHECK(glDeleteShader(mId));
 		mId = 0;
 	}
+	mSource.clear();
+	mSource.shrink_to_fit();
 }
 
 } // namespace tinyngine
\ No newline at end of file
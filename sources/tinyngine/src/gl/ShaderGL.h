@@ -2,23 +2,33 @@
 
 #include "GLApi.h"
 
+#include <string>
+
 namespace tinyngine
 {
 
+// Keeps its source until destroyed: the program cache hashes it, and only compiles it when no binary of the
+// program it is linked into was found.
 class ShaderGL {
 public:
 	ShaderGL() : mId(0), mType(0) {}
 
-	void Create(GLenum type, const char* source);
+	void Create(GLenum type, const char* source, bool deferCompile);
+	bool Compile();
+	// starts the compilation without waiting for its status, the program linking the shader reports the errors
+	void Submit();
 	void Destroy();
 
 	inline GLint GetId() const { return mId; }
+	inline const std::string& GetSource() const { return mSource; }
 
-	inline bool IsValid() const { return mId > 0; }
+	// a shader waiting for its deferred compilation is assumed valid
+	inline bool IsValid() const { return mId > 0 || !mSource.empty(); }
 
 private:
 	GLuint mId;
 	GLenum mType;
+	std::string mSource;
 };
 
 } // namespace tinyngine
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "TextureGL.h"
 #include "PlatformDefine.h"
 #include "GLApi.h"
+#include "MipmapGenerator.h"
+
+#include <algorithm>
 
 namespace
 {
@@ -26,6 +29,20 @@ void TextureGL::Create(GLenum target, const ImageHandle& imageHandle, ImageManag
 	mTarget = target;
 	mUseMipmaps = useMipmaps;
 
+	ImageData imageData;
+	if (!imageManager.GetImageData(imageHandle, 0, imageData)) {
+		return;
+	}
+	// compressed images are uploaded in the format they were encoded in
+	GLenum compressedFormat = 0;
+	if (GetTextureFormatInfo(imageData.mFormat).mCompressed) {
+		compressedFormat = tinyngine::gl::GetCompressedTextureFormat(imageData.mFormat);
+		if (compressedFormat == 0) {
+			Log(Logger::Error, "Texture format %u is not supported by the device", imageData.mFormat);
+			return;
+		}
+	}
+
 	GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
 
 	GL_CHECK(glGenTextures(1, &mId));
@@ -36,21 +53,25 @@ void TextureGL::Create(GLenum target, const ImageHandle& imageHandle, ImageManag
 	GLenum format = sTextureFormats[textureFormat].mFormat;
 	GLenum type = sTextureFormats[textureFormat].mType;
 
-	ImageData imageData;
-	imageManager.GetImageData(imageHandle, 0, imageData);
-	GL_CHECK(glTexImage2D(target, 0, internalFormat, imageData.mWidth, imageData.mHeight, 0, format, type, imageData.mData));
-	if (mUseMipmaps) {
-		uint32_t numMipmaps = imageManager.ImageGetMipmapsCount(imageHandle);
-		if (numMipmaps > 1) {
-			for (uint32_t level = 1; level < numMipmaps; level++) {
-				imageManager.GetImageData(imageHandle, level, imageData);
-				GL_CHECK(glTexImage2D(target, 0, internalFormat, imageData.mWidth, imageData.mHeight, 0, format, type, imageData.mData));
-			}
+	// A complete chain stored in the image is uploaded level by level, glGenerateMipmap builds the others but cannot
+	// encode compressed blocks.
+	uint32_t levels = imageManager.ImageGetMipmapsCount(imageHandle);
+	bool completeChain = levels == GetMipmapsCount(imageData.mWidth, imageData.mHeight);
+	mUseMipmaps = mUseMipmaps && (completeChain || compressedFormat == 0);
+	levels = mUseMipmaps && completeChain ? levels : 1;
+	for (uint32_t level = 0; level < levels; level++) {
+		if (level > 0) {
+			imageManager.GetImageData(imageHandle, level, imageData);
 		}
-		else {
-			GL_CHECK(glGenerateMipmap(target));
+		if (compressedFormat != 0) {
+			GL_CHECK(glCompressedTexImage2D(target, level, compressedFormat, imageData.mWidth, imageData.mHeight, 0, imageData.mSize, imageData.mData));
+		} else {
+			GL_CHECK(glTexImage2D(target, level, internalFormat, imageData.mWidth, imageData.mHeight, 0, format, type, imageData.mData));
 		}
 	}
+	if (mUseMipmaps && !completeChain) {
+		GL_CHECK(glGenerateMipmap(target));
+	}
 	GLint magParam = GL_NEAREST;
 	GLint minParam = mUseMipmaps ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
 	switch (filtering) {
@@ -73,12 +94,86 @@ void TextureGL::Create(GLenum target, const ImageHandle& imageHandle, ImageManag
 	GL_CHECK(glBindTexture(mTarget, 0));
 }
 
+void TextureGL::CreatePlaceholder(GLenum target) {
+	static const uint8_t cPlaceholderTexel[]{ 128, 128, 128, 255 };
+
+	mTarget = target;
+	mUseMipmaps = false;
+
+	GL_CHECK(glGenTextures(1, &mId));
+	GL_ERROR(mId == 0);
+	GL_CHECK(glBindTexture(mTarget, mId));
+	GL_CHECK(glTexImage2D(target, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, cPlaceholderTexel));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+	GL_CHECK(glBindTexture(mTarget, 0));
+}
+
+bool TextureGL::Stream(const ImageData* levels, uint32_t levelsCount, uint32_t& uploadedLevel, uint32_t& uploadedRows, uint32_t& budget, TextureFormats::Enum textureFormat, TextureFilteringMode::Enum filtering, bool useMipmaps) {
+	GLenum internalFormat = sTextureFormats[textureFormat].mInternalFormat;
+	GLenum format = sTextureFormats[textureFormat].mFormat;
+	GLenum type = sTextureFormats[textureFormat].mType;
+
+	GL_CHECK(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+	if (mStreamId == 0) {
+		GL_CHECK(glGenTextures(1, &mStreamId));
+		GL_ERROR(mStreamId == 0);
+		GL_CHECK(glBindTexture(mTarget, mStreamId));
+		for (uint32_t level = 0; level < levelsCount; level++) {
+			GL_CHECK(glTexImage2D(mTarget, level, internalFormat, levels[level].mWidth, levels[level].mHeight, 0, format, type, nullptr));
+		}
+	} else {
+		GL_CHECK(glBindTexture(mTarget, mStreamId));
+	}
+
+	do {
+		const ImageData& imageData = levels[uploadedLevel];
+		uint32_t rowSize = imageData.mWidth * (imageData.mBitsPerPixel / 8);
+		uint32_t rows = std::min(std::max(budget / std::max(rowSize, 1u), 1u), imageData.mHeight - uploadedRows);
+		const uint8_t* pixels = static_cast<const uint8_t*>(imageData.mData) + static_cast<size_t>(uploadedRows) * rowSize;
+		GL_CHECK(glTexSubImage2D(mTarget, uploadedLevel, 0, uploadedRows, imageData.mWidth, rows, format, type, pixels));
+		uploadedRows += rows;
+		budget -= std::min(budget, rows * rowSize);
+		if (uploadedRows == imageData.mHeight) {
+			uploadedLevel++;
+			uploadedRows = 0;
+		}
+	} while (budget > 0 && uploadedLevel < levelsCount);
+
+	if (uploadedLevel < levelsCount) {
+		GL_CHECK(glBindTexture(mTarget, 0));
+		return false;
+	}
+
+	if (useMipmaps && levelsCount == 1) {
+		GL_CHECK(glGenerateMipmap(mTarget));
+	}
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT));
+	GL_CHECK(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT));
+	GL_CHECK(glBindTexture(mTarget, 0));
+
+	// the placeholder is unbound from the units it may still be bound to
+	GL_CHECK(glDeleteTextures(1, &mId));
+	mId = mStreamId;
+	mStreamId = 0;
+	mWidth = levels[0].mWidth;
+	mHeight = levels[0].mHeight;
+	mUseMipmaps = useMipmaps;
+	SetFilteringMode(filtering);
+	GL_CHECK(glBindTexture(mTarget, 0));
+	return true;
+}
+
 void TextureGL::Destroy() {
 	if (mId > 0) {
 		GL_CHECK(glBindTexture(mTarget, mId));
 		GL_CHECK(glDeleteTextures(1, &mId));
 		mId = 0;
 	}
+	if (mStreamId > 0) {
+		GL_CHECK(glDeleteTextures(1, &mStreamId));
+		mStreamId = 0;
+	}
 }
 
 void TextureGL::Bind(uint32_t stage) {
@@ -11,6 +11,11 @@ public:
 	TextureGL() = default;
 
 	void Create(GLenum target, const ImageHandle& imageHandle, ImageManager& imageManager, TextureFormats::Enum textureFormat, TextureFilteringMode::Enum filtering, bool useMipmaps);
+	// 1x1 grey texture sampled until a streamed image is complete
+	void CreatePlaceholder(GLenum target);
+	// Uploads the next rows of the levels, as many as budget bytes allow but at least one, into a texture that
+	// replaces the placeholder once complete. glGenerateMipmap completes a single level. Returns true when done.
+	bool Stream(const ImageData* levels, uint32_t levelsCount, uint32_t& uploadedLevel, uint32_t& uploadedRows, uint32_t& budget, TextureFormats::Enum textureFormat, TextureFilteringMode::Enum filtering, bool useMipmaps);
 	void Destroy();
 	void Bind(uint32_t stage);
 
@@ -24,6 +29,7 @@ public:
 
 private:
 	GLuint mId = 0;
+	GLuint mStreamId = 0;
 	GLenum mTarget = 0;
 	GLsizei mWidth = 0;
 	GLsizei mHeight = 0;
@@ -0,0 +1,171 @@
+#include "TextureStreamerGL.h"
+#include "TextureGL.h"
+#include "ImageManager.h"
+#include "Log.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+// buffers kept around for the next images, the others are released once uploaded
+static constexpr size_t cMaxStagingBuffers = 4;
+
+static const uint32_t cTextureFormatChannels[]{
+	3, // RGB8
+	4, // RGBA8
+	4 // BGRA8
+	// the compressed formats are not streamed
+};
+
+}
+
+namespace tinyngine
+{
+
+std::vector<uint8_t> TextureStreamerGL::StagingArea::AcquireBuffer(uint32_t size) {
+	std::vector<uint8_t> buffer;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto found = std::find_if(mFreeBuffers.begin(), mFreeBuffers.end(), [size](const std::vector<uint8_t>& candidate) {
+			return candidate.capacity() >= size;
+		});
+		if (found == mFreeBuffers.end() && !mFreeBuffers.empty()) {
+			found = mFreeBuffers.begin();
+		}
+		if (found != mFreeBuffers.end()) {
+			buffer = std::move(*found);
+			mFreeBuffers.erase(found);
+		}
+	}
+	buffer.resize(size);
+	return buffer;
+}
+
+void TextureStreamerGL::StagingArea::ReleaseBuffer(std::vector<uint8_t>&& buffer) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	if (mFreeBuffers.size() < cMaxStagingBuffers && buffer.capacity() > 0) {
+		buffer.clear();
+		mFreeBuffers.push_back(std::move(buffer));
+	}
+}
+
+TextureStreamerGL::TextureStreamerGL() : mStaging(std::make_shared<StagingArea>()) {
+
+}
+
+TextureStreamerGL::~TextureStreamerGL() {
+
+}
+
+uint32_t TextureStreamerGL::Decode(const char* filename, ImageManager& imageManager, TextureFormats::Enum format, bool useMipmaps) {
+	uint32_t request = mNextRequest++;
+	std::shared_ptr<StagingArea> staging = mStaging;
+	MipmapFilter::Enum filter = useMipmaps ? MipmapFilter::Box : MipmapFilter::None;
+	imageManager.DecodeImageAsync(filename, cTextureFormatChannels[format], filter, [staging, request](const ImageData* levels, uint32_t levelsCount) {
+		StagedImage image;
+		image.mRequest = request;
+		if (levels[0].mData) {
+			uint32_t size = 0;
+			for (uint32_t level = 0; level < levelsCount; level++) {
+				size += levels[level].mSize;
+			}
+			image.mBuffer = staging->AcquireBuffer(size);
+			uint8_t* data = image.mBuffer.data();
+			for (uint32_t level = 0; level < levelsCount; level++) {
+				memcpy(data, levels[level].mData, levels[level].mSize);
+				image.mLevels.push_back(levels[level]);
+				image.mLevels.back().mData = data;
+				data += levels[level].mSize;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(staging->mMutex);
+		staging->mDecoded.push_back(std::move(image));
+	});
+	return request;
+}
+
+void TextureStreamerGL::Track(const TextureHandle& handle, uint32_t request, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps) {
+	StreamingTexture texture{ handle, request, format, filtering, useMipmaps, false, StagedImage(), 0, 0 };
+	auto orphan = std::find_if(mOrphans.begin(), mOrphans.end(), [request](const StagedImage& image) { return image.mRequest == request; });
+	if (orphan != mOrphans.end()) {
+		texture.mImage = std::move(*orphan);
+		texture.mDecoded = true;
+		mOrphans.erase(orphan);
+	}
+	mTextures.push_back(std::move(texture));
+}
+
+void TextureStreamerGL::Untrack(const TextureHandle& handle) {
+	auto found = std::find_if(mTextures.begin(), mTextures.end(), [&handle](const StreamingTexture& texture) { return texture.mHandle.mHandle == handle.mHandle; });
+	if (found == mTextures.end()) {
+		return;
+	}
+	if (found->mDecoded) {
+		mStaging->ReleaseBuffer(std::move(found->mImage.mBuffer));
+	} else {
+		mCancelled.push_back(found->mRequest);
+	}
+	mTextures.erase(found);
+}
+
+void TextureStreamerGL::Receive(StagedImage&& image) {
+	uint32_t request = image.mRequest;
+	auto cancelled = std::find(mCancelled.begin(), mCancelled.end(), request);
+	if (cancelled != mCancelled.end()) {
+		mStaging->ReleaseBuffer(std::move(image.mBuffer));
+		mCancelled.erase(cancelled);
+		return;
+	}
+	auto found = std::find_if(mTextures.begin(), mTextures.end(), [request](const StreamingTexture& texture) { return texture.mRequest == request; });
+	if (found == mTextures.end()) {
+		mOrphans.push_back(std::move(image));
+		return;
+	}
+	found->mImage = std::move(image);
+	found->mDecoded = true;
+}
+
+uint32_t TextureStreamerGL::Update(const std::function<TextureGL&(const TextureHandle&)>& getTexture, std::vector<TextureHandle>& resident) {
+	{
+		std::lock_guard<std::mutex> lock(mStaging->mMutex);
+		mReceived.swap(mStaging->mDecoded);
+	}
+	for (auto& image : mReceived) {
+		Receive(std::move(image));
+	}
+	mReceived.clear();
+
+	if (mTextures.empty()) {
+		return 0;
+	}
+
+	TINYNGINE_PROFILE_SCOPE("StreamTextures");
+	uint32_t budget = mBudget;
+	for (auto texture = mTextures.begin(); texture != mTextures.end() && budget > 0;) {
+		if (!texture->mDecoded) {
+			++texture;
+			continue;
+		}
+		// a file that could not be decoded keeps its placeholder
+		const std::vector<ImageData>& levels = texture->mImage.mLevels;
+		bool done = levels.empty();
+		if (done) {
+			Log(Logger::Error, "Texture streaming: could not decode the image of request %u", texture->mRequest);
+		} else if (getTexture(texture->mHandle).Stream(levels.data(), static_cast<uint32_t>(levels.size()), texture->mUploadedLevel, texture->mUploadedRows, budget, texture->mFormat, texture->mFiltering, texture->mUseMipmaps)) {
+			resident.push_back(texture->mHandle);
+			done = true;
+		}
+		if (!done) {
+			break;
+		}
+		mStaging->ReleaseBuffer(std::move(texture->mImage.mBuffer));
+		texture = mTextures.erase(texture);
+	}
+	return mBudget - budget;
+}
+
+} // namespace tinyngine
\ No newline at end of file
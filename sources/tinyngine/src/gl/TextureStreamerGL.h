@@ -0,0 +1,87 @@
+#pragma once
+
+#include "GLApi.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tinyngine
+{
+
+class ImageManager;
+class TextureGL;
+
+// bytes uploaded per frame by default, about a 1024x1024 RGBA8 image
+static constexpr uint32_t cDefaultTextureUploadBudget = (4 << 20);
+
+// Streams image files into textures. ImageManager decodes them on its worker threads into staging buffers recycled
+// by the streamer, the buffers are then uploaded on the GL thread a few rows at a time within a budget of bytes per
+// frame, so that a large image does not stall a frame.
+class TextureStreamerGL final {
+public:
+	TextureStreamerGL();
+	~TextureStreamerGL();
+
+	TextureStreamerGL(const TextureStreamerGL& other) = delete;
+	TextureStreamerGL& operator=(const TextureStreamerGL& other) = delete;
+
+	// any thread, returns the request to Track
+	// the mipmaps are generated by the decoding threads
+	uint32_t Decode(const char* filename, ImageManager& imageManager, TextureFormats::Enum format, bool useMipmaps);
+
+	// GL thread from here on
+	void Track(const TextureHandle& handle, uint32_t request, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps);
+	void Untrack(const TextureHandle& handle);
+
+	inline void SetBudget(uint32_t bytesPerFrame) { mBudget = bytesPerFrame; }
+
+	// Uploads the decoded images in request order, the handles of the textures completed are appended to resident.
+	// Returns the bytes uploaded.
+	uint32_t Update(const std::function<TextureGL&(const TextureHandle&)>& getTexture, std::vector<TextureHandle>& resident);
+
+private:
+	struct StagedImage {
+		uint32_t mRequest = 0;
+		std::vector<ImageData> mLevels; // in mBuffer, empty when the file could not be decoded
+		std::vector<uint8_t> mBuffer;
+	};
+
+	struct StreamingTexture {
+		TextureHandle mHandle;
+		uint32_t mRequest;
+		TextureFormats::Enum mFormat;
+		TextureFilteringMode::Enum mFiltering;
+		bool mUseMipmaps;
+		bool mDecoded;
+		StagedImage mImage;
+		uint32_t mUploadedLevel;
+		uint32_t mUploadedRows;
+	};
+
+	// shared with the decoding callbacks, which may outlive the streamer
+	struct StagingArea {
+		std::mutex mMutex;
+		std::vector<StagedImage> mDecoded;
+		std::vector<std::vector<uint8_t>> mFreeBuffers;
+
+		std::vector<uint8_t> AcquireBuffer(uint32_t size);
+		void ReleaseBuffer(std::vector<uint8_t>&& buffer);
+	};
+
+	void Receive(StagedImage&& image);
+
+private:
+	std::shared_ptr<StagingArea> mStaging;
+	std::atomic<uint32_t> mNextRequest{ 1 };
+	uint32_t mBudget = cDefaultTextureUploadBudget;
+
+	std::vector<StreamingTexture> mTextures;
+	std::vector<StagedImage> mOrphans; // decoded before being tracked
+	std::vector<uint32_t> mCancelled; // untracked before being decoded
+	std::vector<StagedImage> mReceived;
+};
+
+} // namespace tinyngine
\ No newline at end of file
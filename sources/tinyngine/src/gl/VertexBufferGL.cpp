@@ -1,16 +1,69 @@
 #include "VertexBufferGL.h"
 #include "PlatformDefine.h"
+#include "Log.h"
+
+#include <cstring>
 
 namespace tinyngine
 {
 
-void VertexBufferGL::Create(const void* data, uint32_t size, const VertexFormat& vertexFormat) {
+void VertexBufferGL::Create(const void* data, uint32_t size, const VertexFormat& vertexFormat, bool keepCopy) {
 	TINYNGINE_UNUSED(vertexFormat);
+	mSize = size;
+	mUsage = (data == nullptr ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+	mCopy.clear();
+	if (keepCopy) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		if (bytes) {
+			mCopy.assign(bytes, bytes + size);
+		} else {
+			mCopy.assign(size, 0);
+		}
+	}
 	glGenBuffers(1, &mId);
 	GL_ERROR(mId == UINT32_MAX);
 	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, mId));
-	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, size, data, (data == nullptr ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW)));
+	GL_CHECK(glBufferData(GL_ARRAY_BUFFER, size, data, mUsage));
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void VertexBufferGL::Update(uint32_t offset, const void* data, uint32_t size) {
+	if (mId == 0) {
+		return;
+	}
+	if (offset + size > mSize) {
+		Log(Logger::Error, "Buffer update out of bounds (offset %u, size %u, buffer size %u)", offset, size, mSize);
+		return;
+	}
+	if (!mCopy.empty()) {
+		memcpy(&mCopy[offset], data, size);
+	}
+	mVersion++;
+	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, mId));
+	if (offset == 0 && size == mSize) {
+		// respecifying the whole store lets the driver rename it instead of waiting for pending draws
+		GL_CHECK(glBufferData(GL_ARRAY_BUFFER, size, data, mUsage));
+	} else {
+		GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, offset, size, data));
+	}
 	GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
 }
 
+void VertexBufferGL::Orphan() {
+	if (mId > 0) {
+		GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, mId));
+		GL_CHECK(glBufferData(GL_ARRAY_BUFFER, mSize, nullptr, mUsage));
+		GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+	}
+}
+
+void VertexBufferGL::Destroy() {
+	if (mId > 0) {
+		GL_CHECK(glDeleteBuffers(1, &mId));
+		mId = 0;
+	}
+	mCopy.clear();
+	mCopy.shrink_to_fit();
+}
+
 } // namespace tinyngine
\ No newline at end of file
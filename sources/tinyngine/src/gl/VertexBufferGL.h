@@ -3,20 +3,33 @@
 #include "GraphicsTypes.h"
 #include "GLApi.h"
 #include "VertexFormat.h"
+#include <vector>
 
 namespace tinyngine
 {
 
 class VertexBufferGL {
 public:
-	void Create(const void* data, uint32_t size, const VertexFormat& vertexFormat);
+	// keepCopy keeps the content on the CPU too, to build the geometry of pseudo-instanced draws
+	void Create(const void* data, uint32_t size, const VertexFormat& vertexFormat, bool keepCopy);
+	void Update(uint32_t offset, const void* data, uint32_t size);
+	void Orphan();
+	void Destroy();
 
 	inline GLint GetId() const { return mId; }
+	inline uint32_t GetSize() const { return mSize; }
+	inline const std::vector<uint8_t>& GetCopy() const { return mCopy; }
+	// incremented by every update, tells whether geometry built from the copy is stale
+	inline uint32_t GetVersion() const { return mVersion; }
 
 	inline bool IsValid() const { return mId > 0; }
 
 private:
-	GLuint mId;
+	GLuint mId = 0;
+	uint32_t mSize = 0;
+	GLenum mUsage = GL_STATIC_DRAW;
+	std::vector<uint8_t> mCopy;
+	uint32_t mVersion = 0;
 };
 
 } // namespace tinyngine
\ No newline at end of file
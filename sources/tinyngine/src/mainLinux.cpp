@@ -0,0 +1,352 @@
+#include "IPlatformBridge.h"
+#include "IPlatformContext.h"
+#include "Application.h"
+#include "Engine.h"
+#include "Input.h"
+#include "GraphicsDevice.h"
+#include "ImGUIWrapper.h"
+#include "Profiler.h"
+#include "Log.h"
+#include "RenderQueue.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+static constexpr uint32_t cDefaultWidth = 1280;
+static constexpr uint32_t cDefaultHeight = 720;
+static constexpr uint32_t cDefaultFrames = 500;
+static constexpr uint32_t cDefaultWarmupFrames = 50;
+
+static const char* cCallNames[tinyngine::GraphicsCallType::Count]{
+	"clear",
+	"state",
+	"render_state",
+	"program",
+	"vertex_buffer",
+	"index_buffer",
+	"texture",
+	"uniform",
+	"draw",
+	"draw_instanced",
+	"create",
+	"update",
+	"destroy"
+};
+
+static const char* cBackendNames[]{
+	"gles",
+	"null",
+	"software"
+};
+
+static double GetClockMilliseconds(clockid_t clock) {
+	timespec now;
+	clock_gettime(clock, &now);
+	return double(now.tv_sec) * 1000.0 + double(now.tv_nsec) / 1000000.0;
+}
+
+struct FrameSample {
+	double mWallTime; // ms
+	double mProcessTime; // ms of cpu time over every thread of the process
+	double mThreadTime; // ms of cpu time of the application thread
+	tinyngine::GraphicsStats mStats;
+};
+
+struct Percentiles {
+	double mMin = 0.0;
+	double mMean = 0.0;
+	double mP50 = 0.0;
+	double mP90 = 0.0;
+	double mP95 = 0.0;
+	double mP99 = 0.0;
+	double mMax = 0.0;
+};
+
+// nearest rank on the sorted samples
+static Percentiles ComputePercentiles(std::vector<double> values) {
+	Percentiles result;
+	if (values.empty()) {
+		return result;
+	}
+	std::sort(values.begin(), values.end());
+	auto rank = [&values](double percentile) {
+		size_t index = static_cast<size_t>(percentile * double(values.size()) + 0.5);
+		return values[std::min(index > 0 ? index - 1 : 0, values.size() - 1)];
+	};
+	double sum = 0.0;
+	for (double value : values) {
+		sum += value;
+	}
+	result.mMin = values.front();
+	result.mMean = sum / double(values.size());
+	result.mP50 = rank(0.50);
+	result.mP90 = rank(0.90);
+	result.mP95 = rank(0.95);
+	result.mP99 = rank(0.99);
+	result.mMax = values.back();
+	return result;
+}
+
+static void WritePercentiles(FILE* file, const char* name, const Percentiles& p) {
+	fprintf(file, "\t\t\"%s\": { \"min\": %.4f, \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+		name, p.mMin, p.mMean, p.mP50, p.mP90, p.mP95, p.mP99, p.mMax);
+}
+
+static void WriteCounters(FILE* file, const tinyngine::GraphicsStats& stats) {
+	fprintf(file, "\"state_changes\": %u, \"state_changes_elided\": %u, \"uniform_uploads\": %u, \"uniform_uploads_elided\": %u, \"invalid_handles\": %u, \"draws_skipped\": %u, \"texture_upload_bytes\": %u",
+		stats.mStateChanges, stats.mStateChangesElided, stats.mUniformUploads, stats.mUniformUploadsElided, stats.mInvalidHandles, stats.mDrawsSkipped, stats.mTextureUploadBytes);
+	for (uint32_t n = 0; n < tinyngine::GraphicsCallType::Count; n++) {
+		fprintf(file, ", \"%s\": %u", cCallNames[n], stats.mCalls[n]);
+	}
+}
+
+}
+
+namespace tinyngine
+{
+
+// Runs an application without window nor input: a fixed number of frames are rendered offscreen as fast as possible
+// and the frame times and graphics counters are reported. The OpenGL ES backend renders to a pbuffer, which Mesa's
+// llvmpipe provides without a display server.
+class PlatformBridgeLinux : public IPlatformBridge {
+public:
+	PlatformBridgeLinux() {
+		mEventQueue = std::make_unique<EventQueue>();
+	}
+
+	std::unique_ptr<Event> PollEvents() override {
+		return mEventQueue->poll();
+	}
+
+	int Run(int argc, char** argv) {
+		if (!ParseArguments(argc, argv)) {
+			PrintUsage(argv[0]);
+			return 1;
+		}
+
+		mApplication = CreateApplication();
+		if (!mApplication) { return 1; }
+
+		mApplication->InitApplication();
+
+		ContextAttribs& contextAttribs = mApplication->GetContextAttribs();
+		if (mBackendOverride) {
+			contextAttribs.mGraphicsBackend = mBackend;
+		}
+		GraphicsBackend backend = contextAttribs.mGraphicsBackend;
+		bool headless = backend != GraphicsBackend::OpenGLES;
+		if (!headless) {
+			mPlatformContext = CreateOffscreenPlatformContext(mWidth, mHeight, contextAttribs);
+			if (!mPlatformContext || mPlatformContext->Initialize() != Result::Success) {
+				Log(Logger::Error, "Offscreen OpenGL ES context creation failed");
+				return 1;
+			}
+		}
+
+		IPlatformContext* platformContext = mPlatformContext;
+		RenderQueue renderQueue;
+		if (!headless && contextAttribs.mRenderThread) {
+			platformContext->ReleaseCurrent();
+			renderQueue.Start([platformContext]() { platformContext->MakeCurrent(); }, [platformContext]() { platformContext->ReleaseCurrent(); });
+		}
+
+		std::unique_ptr<Engine> engine = std::make_unique<Engine>(renderQueue, backend);
+		GraphicsDevice& graphicsDevice = engine->GetSystem<GraphicsDevice>();
+		ImGUIWrapper& uiWrapper = engine->GetSystem<ImGUIWrapper>();
+		Profiler& profiler = engine->GetSystem<Profiler>();
+		Profiler::SetThreadName("Main");
+
+		mApplication->InitView((*engine), mWidth, mHeight);
+		graphicsDevice.SetViewport(0, 0, mWidth, mHeight);
+
+		std::vector<FrameSample> samples;
+		samples.reserve(mFrames);
+		MouseState mouseState;
+		uint8_t pixel[4];
+		for (uint32_t frame = 0; frame < mWarmupFrames + mFrames; frame++) {
+			double wallStart = GetClockMilliseconds(CLOCK_MONOTONIC);
+			double processStart = GetClockMilliseconds(CLOCK_PROCESS_CPUTIME_ID);
+			double threadStart = GetClockMilliseconds(CLOCK_THREAD_CPUTIME_ID);
+
+			uiWrapper.BeginFrame(mouseState, mWidth, mHeight);
+
+			{
+				TINYNGINE_PROFILE_SCOPE("RenderFrame");
+				mApplication->RenderFrame((*engine));
+			}
+
+			uiWrapper.EndFrame();
+
+			if (!headless) {
+				TINYNGINE_PROFILE_SCOPE("Present");
+				renderQueue.Push([platformContext]() { platformContext->Present(); });
+				renderQueue.Submit();
+				// pbuffer swaps do not wait for the driver, reading a pixel back makes the frame time cover the rendering
+				if (!renderQueue.IsThreaded()) {
+					graphicsDevice.ReadPixels(0, 0, 1, 1, pixel);
+				}
+			}
+
+			if (frame >= mWarmupFrames) {
+				FrameSample sample;
+				sample.mWallTime = GetClockMilliseconds(CLOCK_MONOTONIC) - wallStart;
+				sample.mProcessTime = GetClockMilliseconds(CLOCK_PROCESS_CPUTIME_ID) - processStart;
+				sample.mThreadTime = GetClockMilliseconds(CLOCK_THREAD_CPUTIME_ID) - threadStart;
+				sample.mStats = graphicsDevice.GetStats();
+				samples.push_back(sample);
+			}
+			profiler.NextFrame();
+		}
+
+		if (!mTracePath.empty()) {
+			profiler.WriteChromeTrace(mTracePath.c_str());
+		}
+
+		mApplication->ReleaseView((*engine));
+
+		engine.reset();
+
+		if (renderQueue.IsThreaded()) {
+			renderQueue.Stop();
+			platformContext->MakeCurrent();
+		}
+
+		if (mPlatformContext) {
+			mPlatformContext->Terminate();
+		}
+		mApplication->ReleaseApplication();
+
+		return WriteReport(backend, samples) ? 0 : 1;
+	}
+
+private:
+	bool ParseArguments(int argc, char** argv) {
+		for (int n = 1; n < argc; n++) {
+			const char* argument = argv[n];
+			const char* value = n + 1 < argc ? argv[n + 1] : nullptr;
+			if (strcmp(argument, "--frames") == 0 && value) {
+				mFrames = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+			} else if (strcmp(argument, "--warmup") == 0 && value) {
+				mWarmupFrames = static_cast<uint32_t>(strtoul(value, nullptr, 10));
+			} else if (strcmp(argument, "--resolution") == 0 && value) {
+				if (sscanf(value, "%ux%u", &mWidth, &mHeight) != 2) {
+					return false;
+				}
+			} else if (strcmp(argument, "--output") == 0 && value) {
+				mOutputPath = value;
+			} else if (strcmp(argument, "--trace") == 0 && value) {
+				mTracePath = value;
+			} else if (strcmp(argument, "--backend") == 0 && value) {
+				if (strcmp(value, "gles") == 0) {
+					mBackend = GraphicsBackend::OpenGLES;
+				} else if (strcmp(value, "null") == 0) {
+					mBackend = GraphicsBackend::Null;
+				} else if (strcmp(value, "software") == 0) {
+					mBackend = GraphicsBackend::Software;
+				} else {
+					return false;
+				}
+				mBackendOverride = true;
+			} else {
+				return false;
+			}
+			n++;
+		}
+		return mFrames > 0 && mWidth > 0 && mHeight > 0;
+	}
+
+	static void PrintUsage(const char* program) {
+		printf("usage: %s [--frames N] [--warmup N] [--resolution WxH] [--output stats.json] [--trace trace.json] [--backend gles|null|software]\n", program);
+	}
+
+	bool WriteReport(GraphicsBackend backend, const std::vector<FrameSample>& samples) {
+		std::vector<double> wallTimes;
+		std::vector<double> processTimes;
+		std::vector<double> threadTimes;
+		GraphicsStats totals;
+		for (const auto& sample : samples) {
+			wallTimes.push_back(sample.mWallTime);
+			processTimes.push_back(sample.mProcessTime);
+			threadTimes.push_back(sample.mThreadTime);
+			totals.mStateChanges += sample.mStats.mStateChanges;
+			totals.mStateChangesElided += sample.mStats.mStateChangesElided;
+			totals.mUniformUploads += sample.mStats.mUniformUploads;
+			totals.mUniformUploadsElided += sample.mStats.mUniformUploadsElided;
+			totals.mInvalidHandles += sample.mStats.mInvalidHandles;
+			totals.mDrawsSkipped += sample.mStats.mDrawsSkipped;
+			totals.mTextureUploadBytes += sample.mStats.mTextureUploadBytes;
+			for (uint32_t n = 0; n < GraphicsCallType::Count; n++) {
+				totals.mCalls[n] += sample.mStats.mCalls[n];
+			}
+		}
+		Percentiles wall = ComputePercentiles(wallTimes);
+		Percentiles process = ComputePercentiles(processTimes);
+		Percentiles thread = ComputePercentiles(threadTimes);
+
+		Log(Logger::Information, "%u frames at %ux%u: mean %.3f ms, p50 %.3f ms, p99 %.3f ms, cpu %.3f ms",
+			static_cast<uint32_t>(samples.size()), mWidth, mHeight, wall.mMean, wall.mP50, wall.mP99, process.mMean);
+
+		if (mOutputPath.empty()) {
+			return true;
+		}
+		FILE* file = fopen(mOutputPath.c_str(), "w");
+		if (!file) {
+			Log(Logger::Error, "Could not open %s for writing", mOutputPath.c_str());
+			return false;
+		}
+
+		fprintf(file, "{\n");
+		fprintf(file, "\t\"backend\": \"%s\",\n", cBackendNames[static_cast<int>(backend)]);
+		fprintf(file, "\t\"width\": %u,\n\t\"height\": %u,\n", mWidth, mHeight);
+		fprintf(file, "\t\"warmup\": %u,\n\t\"frames\": %u,\n", mWarmupFrames, static_cast<uint32_t>(samples.size()));
+		fprintf(file, "\t\"summary\": {\n");
+		WritePercentiles(file, "frame_ms", wall);
+		fprintf(file, ",\n");
+		WritePercentiles(file, "cpu_ms", process);
+		fprintf(file, ",\n");
+		WritePercentiles(file, "main_thread_cpu_ms", thread);
+		fprintf(file, "\n\t},\n");
+		fprintf(file, "\t\"counters\": { ");
+		WriteCounters(file, totals);
+		fprintf(file, " },\n");
+		fprintf(file, "\t\"per_frame\": [\n");
+		for (size_t n = 0; n < samples.size(); n++) {
+			const FrameSample& sample = samples[n];
+			fprintf(file, "\t\t{ \"frame_ms\": %.4f, \"cpu_ms\": %.4f, \"main_thread_cpu_ms\": %.4f, ", sample.mWallTime, sample.mProcessTime, sample.mThreadTime);
+			WriteCounters(file, sample.mStats);
+			fprintf(file, " }%s\n", n + 1 < samples.size() ? "," : "");
+		}
+		fprintf(file, "\t]\n}\n");
+		fclose(file);
+		return true;
+	}
+
+private:
+	IPlatformContext* mPlatformContext = nullptr;
+	Application* mApplication = nullptr;
+
+	uint32_t mWidth = cDefaultWidth;
+	uint32_t mHeight = cDefaultHeight;
+	uint32_t mFrames = cDefaultFrames;
+	uint32_t mWarmupFrames = cDefaultWarmupFrames;
+	std::string mOutputPath;
+	std::string mTracePath; // Chrome trace of the last frames
+	GraphicsBackend mBackend = GraphicsBackend::OpenGLES;
+	bool mBackendOverride = false;
+};
+
+} // namespace tinyngine
+
+int main(int argc, char** argv) {
+	tinyngine::PlatformBridgeLinux* platformInstance = new tinyngine::PlatformBridgeLinux();
+	return platformInstance->Run(argc, argv);
+}
\ No newline at end of file
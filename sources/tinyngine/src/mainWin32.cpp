@@ -6,7 +6,9 @@
 #include "Time.h"
 #include "GraphicsDevice.h"
 #include "ImGUIWrapper.h"
+#include "Profiler.h"
 #include "Log.h"
+#include "RenderQueue.h"
 #include "imgui.h"
 
 #define WIN32_LEAN_AND_MEAN
@@ -16,6 +18,7 @@
 #include <xinput.h>
 
 #include <thread>
+#include <vector>
 
 namespace
 {
@@ -275,6 +278,34 @@ public:
 		FillRect(hdc, &rect, brush);
 	}
 
+	// the software render target is bottom-up like a default DIB, only the channel order differs
+	void PresentSoftwareFrame(GraphicsDevice& graphicsDevice, std::vector<uint8_t>& frame) {
+		uint32_t width = mWidth;
+		uint32_t height = mHeight;
+		if (width == 0 || height == 0) {
+			return;
+		}
+		frame.resize(width * height * 4);
+		if (!graphicsDevice.ReadPixels(0, 0, width, height, frame.data())) {
+			return;
+		}
+		for (size_t n = 0; n < frame.size(); n += 4) {
+			std::swap(frame[n], frame[n + 2]);
+		}
+
+		BITMAPINFO info;
+		memset(&info, 0, sizeof(info));
+		info.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+		info.bmiHeader.biWidth = static_cast<LONG>(width);
+		info.bmiHeader.biHeight = static_cast<LONG>(height);
+		info.bmiHeader.biPlanes = 1;
+		info.bmiHeader.biBitCount = 32;
+		info.bmiHeader.biCompression = BI_RGB;
+		HDC hdc = GetDC(mHwnd);
+		SetDIBitsToDevice(hdc, 0, 0, width, height, 0, 0, 0, height, frame.data(), &info, DIB_RGB_COLORS);
+		ReleaseDC(mHwnd, hdc);
+	}
+
 	static LRESULT CALLBACK WndProc(HWND hwnd, UINT id, WPARAM wparam, LPARAM lparam);
 
 	IPlatformContext* mPlatformContext = nullptr;
@@ -410,20 +441,35 @@ void MainThread::Func(tinyngine::PlatformBridgeWin32* pinst) {
 
 	pinst->mApplication->InitApplication();
 
-	pinst->mPlatformContext = CreatePlatformContext(pinst->mHwnd, pinst->mApplication->GetContextAttribs());
-	if (!pinst->mPlatformContext) { return; }
+	const ContextAttribs& contextAttribs = pinst->mApplication->GetContextAttribs();
+	bool headless = contextAttribs.mGraphicsBackend != GraphicsBackend::OpenGLES;
+	if (!headless) {
+		pinst->mPlatformContext = CreatePlatformContext(pinst->mHwnd, contextAttribs);
+		if (!pinst->mPlatformContext) { return; }
 
-	Result result = pinst->mPlatformContext->Initialize();
-	if (result != Result::Success) { return; }
+		Result result = pinst->mPlatformContext->Initialize();
+		if (result != Result::Success) { return; }
+	}
+
+	// the context moves to the render thread, every GL call goes through renderQueue from now on
+	IPlatformContext* platformContext = pinst->mPlatformContext;
+	RenderQueue renderQueue;
+	if (!headless && contextAttribs.mRenderThread) {
+		platformContext->ReleaseCurrent();
+		renderQueue.Start([platformContext]() { platformContext->MakeCurrent(); }, [platformContext]() { platformContext->ReleaseCurrent(); });
+	}
 	
-	std::unique_ptr<Engine> engine = std::make_unique<Engine>();
+	std::unique_ptr<Engine> engine = std::make_unique<Engine>(renderQueue, contextAttribs.mGraphicsBackend);
 	GraphicsDevice& graphicsDevice = engine->GetSystem<GraphicsDevice>();
 	Input& input = engine->GetSystem<Input>();
 	ImGUIWrapper& uiWrapper = engine->GetSystem<ImGUIWrapper>();
+	Profiler& profiler = engine->GetSystem<Profiler>();
+	Profiler::SetThreadName("Main");
 
 	pinst->mApplication->InitView((*engine), pinst->mWidth, pinst->mHeight);
 
 	MouseState mouseState{ 0 };
+	std::vector<uint8_t> softwareFrame;
 	do {
 		std::unique_ptr<Event> event = pinst->PollEvents();
 		if (event) {
@@ -461,18 +507,38 @@ void MainThread::Func(tinyngine::PlatformBridgeWin32* pinst) {
 
 		uiWrapper.BeginFrame(mouseState, pinst->mWidth, pinst->mHeight);
 
-		pinst->mApplication->RenderFrame((*engine));
+		{
+			TINYNGINE_PROFILE_SCOPE("RenderFrame");
+			pinst->mApplication->RenderFrame((*engine));
+		}
 
 		uiWrapper.EndFrame();
 
-		pinst->mPlatformContext->Present();
+		{
+			TINYNGINE_PROFILE_SCOPE("Present");
+			if (!headless) {
+				renderQueue.Push([platformContext]() { platformContext->Present(); });
+				renderQueue.Submit();
+			} else if (contextAttribs.mGraphicsBackend == GraphicsBackend::Software) {
+				pinst->PresentSoftwareFrame(graphicsDevice, softwareFrame);
+			}
+		}
+
+		profiler.NextFrame();
 	} while (!pinst->mExitRequired);
 
 	pinst->mApplication->ReleaseView((*engine));
 
 	engine.reset();
 
-	pinst->mPlatformContext->Terminate();
+	if (renderQueue.IsThreaded()) {
+		renderQueue.Stop();
+		platformContext->MakeCurrent();
+	}
+
+	if (pinst->mPlatformContext) {
+		pinst->mPlatformContext->Terminate();
+	}
 	pinst->mApplication->ReleaseApplication();
 }
 
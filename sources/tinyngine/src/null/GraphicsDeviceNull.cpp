@@ -0,0 +1,515 @@
+#include "GraphicsDeviceNull.h"
+#include "PlatformDefine.h"
+#include "CommandBucket.h"
+#include "HandlePool.h"
+
+#include <algorithm>
+
+namespace
+{
+
+static constexpr uint32_t cMaxShaderHandles = (1 << 6);
+static constexpr uint32_t cMaxProgramHandles = (1 << 6);
+static constexpr uint32_t cMaxVertexBufferHandles = (1 << 10);
+static constexpr uint32_t cMaxIndexBufferHandle = (1 << 10);
+static constexpr uint32_t cMaxTextureHandle = (1 << 10);
+static constexpr uint32_t cMaxRenderStateHandles = (1 << 8);
+
+static constexpr uint32_t cTransientVertexBufferSize = (4 << 20);
+static constexpr uint32_t cTransientIndexBufferSize = (1 << 20);
+static constexpr uint32_t cTransientAlignment = 16;
+
+}
+
+namespace tinyngine
+{
+
+struct BufferNull {
+	uint32_t mSize = 0;
+	IndexType::Enum mType = IndexType::Uint16;
+};
+
+struct ShaderNull {
+	ShaderType::Enum mType = ShaderType::Count;
+};
+
+struct ProgramNull {
+	bool mLinked = false;
+};
+
+struct TextureNull {
+	TextureFormats::Enum mFormat = TextureFormats::Count;
+};
+
+struct RenderStateNull {
+	RenderStateDesc mDesc;
+};
+
+struct TransientRingNull {
+	ResourceHandle mHandle = ResourceHandle(cInvalidHandle);
+	uint32_t mSize = 0;
+	uint32_t mOffset = 0;
+};
+
+struct GraphicsDeviceNull::Impl {
+	HandlePool<BufferNull, cMaxVertexBufferHandles> mVertexBuffers;
+	HandlePool<BufferNull, cMaxIndexBufferHandle> mIndexBuffers;
+	HandlePool<ShaderNull, cMaxShaderHandles> mShaders;
+	HandlePool<ProgramNull, cMaxProgramHandles> mPrograms;
+	HandlePool<TextureNull, cMaxTextureHandle> mTextures;
+	HandlePool<RenderStateNull, cMaxRenderStateHandles> mRenderStates;
+
+	TransientRingNull mTransientVertices;
+	TransientRingNull mTransientIndices;
+
+	GraphicsStats mFrameStats;
+	GraphicsStats mLastFrameStats;
+	GraphicsCaps mCaps;
+
+	inline void Count(GraphicsCallType::Enum type) { mFrameStats.mCalls[type]++; }
+
+	template<typename T, uint32_t Size>
+	bool Validate(const HandlePool<T, Size>& pool, const ResourceHandle& handle) {
+		if (pool.IsValid(handle)) {
+			return true;
+		}
+		mFrameStats.mInvalidHandles++;
+		return false;
+	}
+
+	template<typename T, uint32_t Size>
+	ResourceHandle Create(HandlePool<T, Size>& pool, const T& value) {
+		Count(GraphicsCallType::Create);
+		ResourceHandle handle = pool.Allocate();
+		if (handle.IsValid()) {
+			pool.Get(handle) = value;
+		}
+		return handle;
+	}
+
+	template<typename T, uint32_t Size>
+	void Destroy(HandlePool<T, Size>& pool, ResourceHandle& handle) {
+		Count(GraphicsCallType::Destroy);
+		if (Validate(pool, handle)) {
+			pool.Free(handle);
+		}
+		handle = ResourceHandle(cInvalidHandle);
+	}
+
+	void UpdateBuffer(const BufferNull& buffer, uint32_t offset, const void* data, uint32_t size);
+	bool AllocTransient(TransientRingNull& ring, const void* data, uint32_t size, TransientBuffer& buffer);
+};
+
+void GraphicsDeviceNull::Impl::UpdateBuffer(const BufferNull& buffer, uint32_t offset, const void* data, uint32_t size) {
+	Count(GraphicsCallType::Update);
+	if (data == nullptr || offset + size > buffer.mSize) {
+		Log(Logger::Error, "Buffer update out of bounds (offset %u, size %u, buffer size %u)", offset, size, buffer.mSize);
+	}
+}
+
+bool GraphicsDeviceNull::Impl::AllocTransient(TransientRingNull& ring, const void* data, uint32_t size, TransientBuffer& buffer) {
+	Count(GraphicsCallType::Update);
+	uint32_t offset = (ring.mOffset + cTransientAlignment - 1) & ~(cTransientAlignment - 1);
+	if (data == nullptr || size == 0 || offset + size > ring.mSize) {
+		buffer.mHandle = ResourceHandle(cInvalidHandle);
+		return false;
+	}
+	ring.mOffset = offset + size;
+	buffer.mHandle = ring.mHandle;
+	buffer.mOffset = offset;
+	buffer.mSize = size;
+	return true;
+}
+
+//=============================================================================
+
+GraphicsDeviceNull::GraphicsDeviceNull() : mImpl(new Impl()) {
+	BufferNull ring;
+	ring.mSize = cTransientVertexBufferSize;
+	mImpl->mTransientVertices.mHandle = mImpl->mVertexBuffers.Allocate();
+	mImpl->mTransientVertices.mSize = ring.mSize;
+	mImpl->mVertexBuffers.Get(mImpl->mTransientVertices.mHandle) = ring;
+
+	ring.mSize = cTransientIndexBufferSize;
+	mImpl->mTransientIndices.mHandle = mImpl->mIndexBuffers.Allocate();
+	mImpl->mTransientIndices.mSize = ring.mSize;
+	mImpl->mIndexBuffers.Get(mImpl->mTransientIndices.mHandle) = ring;
+
+	mImpl->mCaps.mIndexUint32 = true;
+	mImpl->mCaps.mInstancing = true;
+	std::fill(std::begin(mImpl->mCaps.mTextureFormats), std::end(mImpl->mCaps.mTextureFormats), true);
+	std::fill(std::begin(mImpl->mCaps.mAttributeTypes), std::end(mImpl->mCaps.mAttributeTypes), true);
+}
+
+GraphicsDeviceNull::~GraphicsDeviceNull() {
+	delete mImpl;
+}
+
+void GraphicsDeviceNull::Commit() {
+	mImpl->mTransientVertices.mOffset = 0;
+	mImpl->mTransientIndices.mOffset = 0;
+	mImpl->mLastFrameStats = mImpl->mFrameStats;
+	mImpl->mFrameStats = GraphicsStats();
+}
+
+void GraphicsDeviceNull::SetSubmissionMode(SubmissionMode::Enum mode) {
+	TINYNGINE_UNUSED(mode);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetSortLayer(uint8_t layer) {
+	TINYNGINE_UNUSED(layer);
+}
+
+void GraphicsDeviceNull::SetSortDepth(float depth) {
+	TINYNGINE_UNUSED(depth);
+}
+
+void GraphicsDeviceNull::SetErrorCheckMode(ErrorCheckMode::Enum mode) {
+	TINYNGINE_UNUSED(mode);
+}
+
+void GraphicsDeviceNull::SetViewport(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+	TINYNGINE_UNUSED(x); TINYNGINE_UNUSED(y); TINYNGINE_UNUSED(width); TINYNGINE_UNUSED(height);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::Clear(uint8_t flags, Color color, float depth, uint8_t stencil) {
+	TINYNGINE_UNUSED(flags); TINYNGINE_UNUSED(color); TINYNGINE_UNUSED(depth); TINYNGINE_UNUSED(stencil);
+	mImpl->Count(GraphicsCallType::Clear);
+}
+
+void GraphicsDeviceNull::SetColorMake(bool red, bool green, bool blue, bool alpha) {
+	TINYNGINE_UNUSED(red); TINYNGINE_UNUSED(green); TINYNGINE_UNUSED(blue); TINYNGINE_UNUSED(alpha);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetDepthMask(bool flag) {
+	TINYNGINE_UNUSED(flag);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetStencilMask(uint32_t mask) {
+	TINYNGINE_UNUSED(mask);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetState(RendererStateType::Enum type, bool value) {
+	TINYNGINE_UNUSED(type); TINYNGINE_UNUSED(value);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetCullMode(CullFaceModes::Enum mode) {
+	TINYNGINE_UNUSED(mode);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetWinding(WindingModes::Enum mode) {
+	TINYNGINE_UNUSED(mode);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetBlendFunc(BlendFuncs::Enum sfactor, BlendFuncs::Enum dfactor) {
+	TINYNGINE_UNUSED(sfactor); TINYNGINE_UNUSED(dfactor);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetDepthFunc(DepthFuncs::Enum func) {
+	TINYNGINE_UNUSED(func);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetStencilFunc(StencilFuncs::Enum func, int32_t ref, uint32_t mask) {
+	TINYNGINE_UNUSED(func); TINYNGINE_UNUSED(ref); TINYNGINE_UNUSED(mask);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetStencilOp(StencilOpTypes::Enum sfail, StencilOpTypes::Enum dpfail, StencilOpTypes::Enum dppass) {
+	TINYNGINE_UNUSED(sfail); TINYNGINE_UNUSED(dpfail); TINYNGINE_UNUSED(dppass);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetBlendColor(Color color) {
+	TINYNGINE_UNUSED(color);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+void GraphicsDeviceNull::SetPolygonffset(float factor, float units) {
+	TINYNGINE_UNUSED(factor); TINYNGINE_UNUSED(units);
+	mImpl->Count(GraphicsCallType::State);
+}
+
+RenderStateHandle GraphicsDeviceNull::CreateRenderState(const RenderStateDesc& desc) {
+	RenderStateNull renderState;
+	renderState.mDesc = desc;
+	return mImpl->Create(mImpl->mRenderStates, renderState);
+}
+
+void GraphicsDeviceNull::SetRenderState(const RenderStateHandle& handle) {
+	mImpl->Count(GraphicsCallType::RenderState);
+	if (handle.IsValid()) {
+		mImpl->Validate(mImpl->mRenderStates, handle);
+	}
+}
+
+void GraphicsDeviceNull::DrawArray(PrimitiveType::Enum primitive, uint32_t first, uint32_t count) {
+	TINYNGINE_UNUSED(primitive); TINYNGINE_UNUSED(first); TINYNGINE_UNUSED(count);
+	mImpl->Count(GraphicsCallType::Draw);
+}
+
+void GraphicsDeviceNull::DrawElements(PrimitiveType::Enum primitive, uint32_t count) {
+	TINYNGINE_UNUSED(primitive); TINYNGINE_UNUSED(count);
+	mImpl->Count(GraphicsCallType::Draw);
+}
+
+void GraphicsDeviceNull::DrawArrayInstanced(PrimitiveType::Enum primitive, uint32_t first, uint32_t count, uint32_t instancesCount) {
+	TINYNGINE_UNUSED(primitive); TINYNGINE_UNUSED(first); TINYNGINE_UNUSED(count); TINYNGINE_UNUSED(instancesCount);
+	mImpl->Count(GraphicsCallType::DrawInstanced);
+}
+
+void GraphicsDeviceNull::DrawElementsInstanced(PrimitiveType::Enum primitive, uint32_t count, uint32_t instancesCount) {
+	TINYNGINE_UNUSED(primitive); TINYNGINE_UNUSED(count); TINYNGINE_UNUSED(instancesCount);
+	mImpl->Count(GraphicsCallType::DrawInstanced);
+}
+
+VertexBufferHandle GraphicsDeviceNull::CreateVertexBuffer(const void* data, uint32_t size, const VertexFormat& vertexFormat) {
+	TINYNGINE_UNUSED(data); TINYNGINE_UNUSED(vertexFormat);
+	BufferNull buffer;
+	buffer.mSize = size;
+	return mImpl->Create(mImpl->mVertexBuffers, buffer);
+}
+
+void GraphicsDeviceNull::UpdateVertexBuffer(const VertexBufferHandle& handle, uint32_t offset, const void* data, uint32_t size) {
+	if (mImpl->Validate(mImpl->mVertexBuffers, handle)) {
+		mImpl->UpdateBuffer(mImpl->mVertexBuffers.Get(handle), offset, data, size);
+	}
+}
+
+void GraphicsDeviceNull::DestroyVertexBuffer(VertexBufferHandle& handle) {
+	mImpl->Destroy(mImpl->mVertexBuffers, handle);
+}
+
+void GraphicsDeviceNull::SetVertexBuffer(const VertexBufferHandle& handle) {
+	mImpl->Count(GraphicsCallType::VertexBuffer);
+	mImpl->Validate(mImpl->mVertexBuffers, handle);
+}
+
+void GraphicsDeviceNull::SetVertexBuffer(const VertexBufferHandle& handle, Attributes::Enum attribute) {
+	TINYNGINE_UNUSED(attribute);
+	mImpl->Count(GraphicsCallType::VertexBuffer);
+	mImpl->Validate(mImpl->mVertexBuffers, handle);
+}
+
+IndexBufferHandle GraphicsDeviceNull::CreateIndexBuffer(const void* data, uint32_t size) {
+	return CreateIndexBuffer(data, size, IndexType::Uint32);
+}
+
+IndexBufferHandle GraphicsDeviceNull::CreateIndexBuffer(const void* data, uint32_t size, IndexType::Enum type) {
+	TINYNGINE_UNUSED(data);
+	BufferNull buffer;
+	buffer.mSize = size;
+	buffer.mType = type;
+	return mImpl->Create(mImpl->mIndexBuffers, buffer);
+}
+
+void GraphicsDeviceNull::UpdateIndexBuffer(const IndexBufferHandle& handle, uint32_t offset, const void* data, uint32_t size) {
+	if (mImpl->Validate(mImpl->mIndexBuffers, handle)) {
+		mImpl->UpdateBuffer(mImpl->mIndexBuffers.Get(handle), offset, data, size);
+	}
+}
+
+void GraphicsDeviceNull::DestroyIndexBuffer(IndexBufferHandle& handle) {
+	mImpl->Destroy(mImpl->mIndexBuffers, handle);
+}
+
+void GraphicsDeviceNull::SetIndexBuffer(const IndexBufferHandle& handle) {
+	mImpl->Count(GraphicsCallType::IndexBuffer);
+	if (handle.IsValid()) {
+		mImpl->Validate(mImpl->mIndexBuffers, handle);
+	}
+}
+
+bool GraphicsDeviceNull::AllocTransientVertexBuffer(const void* data, uint32_t size, TransientBuffer& buffer) {
+	return mImpl->AllocTransient(mImpl->mTransientVertices, data, size, buffer);
+}
+
+bool GraphicsDeviceNull::AllocTransientIndexBuffer(const void* data, uint32_t size, IndexType::Enum type, TransientBuffer& buffer) {
+	buffer.mIndexType = type;
+	return mImpl->AllocTransient(mImpl->mTransientIndices, data, size, buffer);
+}
+
+void GraphicsDeviceNull::SetTransientVertexBuffer(const TransientBuffer& buffer) {
+	mImpl->Count(GraphicsCallType::VertexBuffer);
+	mImpl->Validate(mImpl->mVertexBuffers, buffer.mHandle);
+}
+
+void GraphicsDeviceNull::SetTransientVertexBuffer(const TransientBuffer& buffer, Attributes::Enum attribute) {
+	TINYNGINE_UNUSED(attribute);
+	mImpl->Count(GraphicsCallType::VertexBuffer);
+	mImpl->Validate(mImpl->mVertexBuffers, buffer.mHandle);
+}
+
+void GraphicsDeviceNull::SetTransientIndexBuffer(const TransientBuffer& buffer) {
+	mImpl->Count(GraphicsCallType::IndexBuffer);
+	mImpl->Validate(mImpl->mIndexBuffers, buffer.mHandle);
+}
+
+void GraphicsDeviceNull::SetInstanceData(const void* data, uint32_t elementsCount, const VertexFormat& instanceFormat, uint32_t divisor) {
+	TINYNGINE_UNUSED(divisor);
+	if (data == nullptr || elementsCount == 0) {
+		return;
+	}
+	TransientBuffer buffer;
+	mImpl->AllocTransient(mImpl->mTransientVertices, data, elementsCount * instanceFormat.mStride, buffer);
+}
+
+ShaderHandle GraphicsDeviceNull::CreateShader(ShaderType::Enum type, const char* source) {
+	if (source == nullptr || *source == 0) {
+		return ShaderHandle(cInvalidHandle);
+	}
+	ShaderNull shader;
+	shader.mType = type;
+	return mImpl->Create(mImpl->mShaders, shader);
+}
+
+ProgramHandle GraphicsDeviceNull::CreateProgram(ShaderHandle& vertexShaderHandle, ShaderHandle& fragmentShaderHandle, bool destroyShaders) {
+	if (!mImpl->Validate(mImpl->mShaders, vertexShaderHandle) || !mImpl->Validate(mImpl->mShaders, fragmentShaderHandle)) {
+		return ProgramHandle(cInvalidHandle);
+	}
+
+	ProgramNull program;
+	program.mLinked = mImpl->mShaders.Get(vertexShaderHandle).mType == ShaderType::VertexProgram &&
+		mImpl->mShaders.Get(fragmentShaderHandle).mType == ShaderType::FragmentProgram;
+	ProgramHandle handle = program.mLinked ? mImpl->Create(mImpl->mPrograms, program) : ProgramHandle(cInvalidHandle);
+
+	if (destroyShaders) {
+		mImpl->Destroy(mImpl->mShaders, vertexShaderHandle);
+		mImpl->Destroy(mImpl->mShaders, fragmentShaderHandle);
+	}
+
+	return handle;
+}
+
+ProgramHandle GraphicsDeviceNull::CreateProgramAsync(ShaderHandle& vertexShaderHandle, ShaderHandle& fragmentShaderHandle, bool destroyShaders) {
+	return CreateProgram(vertexShaderHandle, fragmentShaderHandle, destroyShaders);
+}
+
+ProgramStatus::Enum GraphicsDeviceNull::GetProgramStatus(const ProgramHandle& handle) const {
+	return mImpl->mPrograms.IsValid(handle) ? ProgramStatus::Ready : ProgramStatus::Failed;
+}
+
+void GraphicsDeviceNull::SetProgramCacheDirectory(const char* directory) {
+	TINYNGINE_UNUSED(directory);
+}
+
+void GraphicsDeviceNull::DestroyProgram(ProgramHandle& handle) {
+	mImpl->Destroy(mImpl->mPrograms, handle);
+}
+
+void GraphicsDeviceNull::SetProgram(const ProgramHandle& handle, const VertexFormat& vertexFormat) {
+	TINYNGINE_UNUSED(vertexFormat);
+	mImpl->Count(GraphicsCallType::Program);
+	if (handle.IsValid()) {
+		mImpl->Validate(mImpl->mPrograms, handle);
+	}
+}
+
+UniformHandle GraphicsDeviceNull::GetUniform(const ProgramHandle& programHandle, const char* uniformName) const {
+	return GetUniform(programHandle, UniformId(uniformName));
+}
+
+// programs are not introspected, any name resolves to a handle derived from its hash
+UniformHandle GraphicsDeviceNull::GetUniform(const ProgramHandle& programHandle, const UniformId& uniformId) const {
+	if (!mImpl->Validate(mImpl->mPrograms, programHandle)) {
+		return UniformHandle(cInvalidHandle);
+	}
+	return UniformHandle(uniformId.mHash & ~(1u << 31));
+}
+
+void GraphicsDeviceNull::setUniform1i(const ProgramHandle& programHandle, UniformHandle& uniformHandle, int32_t data) {
+	TINYNGINE_UNUSED(uniformHandle); TINYNGINE_UNUSED(data);
+	mImpl->Count(GraphicsCallType::Uniform);
+	mImpl->Validate(mImpl->mPrograms, programHandle);
+}
+
+void GraphicsDeviceNull::SetUniformFloat(const ProgramHandle& programHandle, UniformHandle& uniformHandle, float data) {
+	TINYNGINE_UNUSED(uniformHandle); TINYNGINE_UNUSED(data);
+	mImpl->Count(GraphicsCallType::Uniform);
+	mImpl->Validate(mImpl->mPrograms, programHandle);
+}
+
+void GraphicsDeviceNull::SetUniformFloat3(const ProgramHandle& programHandle, UniformHandle& uniformHandle, const float* data) {
+	TINYNGINE_UNUSED(uniformHandle); TINYNGINE_UNUSED(data);
+	mImpl->Count(GraphicsCallType::Uniform);
+	mImpl->Validate(mImpl->mPrograms, programHandle);
+}
+
+void GraphicsDeviceNull::SetUniformMat4(const ProgramHandle& programHandle, const UniformHandle& uniformHandle, const float* data, bool transpose) {
+	TINYNGINE_UNUSED(uniformHandle); TINYNGINE_UNUSED(data); TINYNGINE_UNUSED(transpose);
+	mImpl->Count(GraphicsCallType::Uniform);
+	mImpl->Validate(mImpl->mPrograms, programHandle);
+}
+
+TextureHandle GraphicsDeviceNull::CreateTexture2D(const ImageHandle& imageHandle, ImageManager& imageManager, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps) {
+	TINYNGINE_UNUSED(filtering); TINYNGINE_UNUSED(useMipmaps);
+	ImageData imageData;
+	if (!imageHandle.IsValid() || !imageManager.GetImageData(imageHandle, 0, imageData)) {
+		return TextureHandle(cInvalidHandle);
+	}
+	TextureNull texture;
+	texture.mFormat = GetTextureFormatInfo(imageData.mFormat).mCompressed ? imageData.mFormat : format;
+	return mImpl->Create(mImpl->mTextures, texture);
+}
+
+// the file is not read, a missing one is only reported by the other devices
+TextureHandle GraphicsDeviceNull::CreateTexture2DAsync(const char* filename, ImageManager& imageManager, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps) {
+	TINYNGINE_UNUSED(filename); TINYNGINE_UNUSED(imageManager); TINYNGINE_UNUSED(filtering); TINYNGINE_UNUSED(useMipmaps);
+	TextureNull texture;
+	texture.mFormat = format;
+	return mImpl->Create(mImpl->mTextures, texture);
+}
+
+bool GraphicsDeviceNull::IsTextureResident(const TextureHandle& handle) const {
+	return mImpl->mTextures.IsValid(handle);
+}
+
+void GraphicsDeviceNull::SetTextureUploadBudget(uint32_t bytesPerFrame) {
+	TINYNGINE_UNUSED(bytesPerFrame);
+}
+
+void GraphicsDeviceNull::DestroyTexture(TextureHandle& handle) {
+	mImpl->Destroy(mImpl->mTextures, handle);
+}
+
+void GraphicsDeviceNull::SetTexture(uint32_t stage, const TextureHandle& textureHandle) {
+	mImpl->Count(GraphicsCallType::Texture);
+	if (stage >= cMaxTextureStages) {
+		mImpl->mFrameStats.mInvalidHandles++;
+		return;
+	}
+	if (textureHandle.IsValid()) {
+		mImpl->Validate(mImpl->mTextures, textureHandle);
+	}
+}
+
+bool GraphicsDeviceNull::ReadPixels(uint32_t x, uint32_t y, uint32_t width, uint32_t height, void* rgba) {
+	TINYNGINE_UNUSED(x); TINYNGINE_UNUSED(y); TINYNGINE_UNUSED(width); TINYNGINE_UNUSED(height); TINYNGINE_UNUSED(rgba);
+	return false;
+}
+
+void GraphicsDeviceNull::BeginGpuScope(const char* name) {
+	TINYNGINE_UNUSED(name);
+}
+
+void GraphicsDeviceNull::EndGpuScope() {
+}
+
+const GraphicsStats& GraphicsDeviceNull::GetStats() const {
+	return mImpl->mLastFrameStats;
+}
+
+const GraphicsCaps& GraphicsDeviceNull::GetCaps() const {
+	return mImpl->mCaps;
+}
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "GraphicsDevice.h"
+
+namespace tinyngine
+{
+
+// Device issuing no graphics API call: handles are allocated and validated and every call is counted by type in
+// GraphicsStats, so the CPU cost of the engine and of the application can be measured without a GPU or a display.
+class GraphicsDeviceNull : public GraphicsDevice {
+public:
+	GraphicsDeviceNull();
+	virtual ~GraphicsDeviceNull();
+
+	void Commit() override;
+
+	void SetSubmissionMode(SubmissionMode::Enum mode) override;
+	void SetSortLayer(uint8_t layer) override;
+	void SetSortDepth(float depth) override;
+	void SetErrorCheckMode(ErrorCheckMode::Enum mode) override;
+
+	void SetViewport(uint32_t x, uint32_t y, uint32_t width, uint32_t height) override;
+
+	void Clear(uint8_t flags, Color color, float depth = 1.0f, uint8_t stencil = 0) override;
+	void SetColorMake(bool red, bool green, bool blue, bool alpha) override;
+	void SetDepthMask(bool flag) override;
+	void SetStencilMask(uint32_t mask) override;
+
+	void SetState(RendererStateType::Enum type, bool value) override;
+	void SetCullMode(CullFaceModes::Enum mode) override;
+	void SetWinding(WindingModes::Enum mode) override;
+	void SetBlendFunc(BlendFuncs::Enum sfactor, BlendFuncs::Enum dfactor) override;
+	void SetDepthFunc(DepthFuncs::Enum func) override;
+	void SetStencilFunc(StencilFuncs::Enum func, int32_t ref, uint32_t mask) override;
+	void SetStencilOp(StencilOpTypes::Enum sfail, StencilOpTypes::Enum dpfail, StencilOpTypes::Enum dppass) override;
+	void SetBlendColor(Color color) override;
+	void SetPolygonffset(float factor, float units) override;
+
+	RenderStateHandle CreateRenderState(const RenderStateDesc& desc) override;
+	void SetRenderState(const RenderStateHandle& handle) override;
+
+	void DrawArray(PrimitiveType::Enum primitive, uint32_t first, uint32_t count) override;
+	void DrawElements(PrimitiveType::Enum primitive, uint32_t count) override;
+	void DrawArrayInstanced(PrimitiveType::Enum primitive, uint32_t first, uint32_t count, uint32_t instancesCount) override;
+	void DrawElementsInstanced(PrimitiveType::Enum primitive, uint32_t count, uint32_t instancesCount) override;
+
+	VertexBufferHandle CreateVertexBuffer(const void* data, uint32_t size, const VertexFormat& vertexFormat) override;
+	void UpdateVertexBuffer(const VertexBufferHandle& handle, uint32_t offset, const void* data, uint32_t size) override;
+	void DestroyVertexBuffer(VertexBufferHandle& handle) override;
+	void SetVertexBuffer(const VertexBufferHandle& handle) override;
+	void SetVertexBuffer(const VertexBufferHandle& handle, Attributes::Enum attribute) override;
+
+	IndexBufferHandle CreateIndexBuffer(const void* data, uint32_t size) override;
+	IndexBufferHandle CreateIndexBuffer(const void* data, uint32_t size, IndexType::Enum type) override;
+	void UpdateIndexBuffer(const IndexBufferHandle& handle, uint32_t offset, const void* data, uint32_t size) override;
+	void DestroyIndexBuffer(IndexBufferHandle& handle) override;
+	void SetIndexBuffer(const IndexBufferHandle& handle) override;
+
+	bool AllocTransientVertexBuffer(const void* data, uint32_t size, TransientBuffer& buffer) override;
+	bool AllocTransientIndexBuffer(const void* data, uint32_t size, IndexType::Enum type, TransientBuffer& buffer) override;
+	void SetTransientVertexBuffer(const TransientBuffer& buffer) override;
+	void SetTransientVertexBuffer(const TransientBuffer& buffer, Attributes::Enum attribute) override;
+	void SetTransientIndexBuffer(const TransientBuffer& buffer) override;
+
+	void SetInstanceData(const void* data, uint32_t elementsCount, const VertexFormat& instanceFormat, uint32_t divisor = 1) override;
+
+	ShaderHandle CreateShader(ShaderType::Enum type, const char* source) override;
+
+	ProgramHandle CreateProgram(ShaderHandle& vertexShaderHandle, ShaderHandle& fragmentShaderHandle, bool destroyShaders) override;
+	ProgramHandle CreateProgramAsync(ShaderHandle& vertexShaderHandle, ShaderHandle& fragmentShaderHandle, bool destroyShaders) override;
+	ProgramStatus::Enum GetProgramStatus(const ProgramHandle& handle) const override;
+	void SetProgramCacheDirectory(const char* directory) override;
+	void DestroyProgram(ProgramHandle& handle) override;
+	void SetProgram(const ProgramHandle& handle, const VertexFormat& vertexFormat) override;
+
+	UniformHandle GetUniform(const ProgramHandle& handle, const char* uniformName) const override;
+	UniformHandle GetUniform(const ProgramHandle& handle, const UniformId& uniformId) const override;
+	void setUniform1i(const ProgramHandle& programHandle, UniformHandle& uniformHandle, int32_t data) override;
+	void SetUniformFloat(const ProgramHandle& programHandle, UniformHandle& uniformHandle, float data) override;
+	void SetUniformFloat3(const ProgramHandle& programHandle, UniformHandle& uniformHandle, const float* data) override;
+	void SetUniformMat4(const ProgramHandle& handle, const UniformHandle& uniform, const float* data, bool transpose) override;
+	
+	TextureHandle CreateTexture2D(const ImageHandle& imageHandle, ImageManager& imageManager, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps) override;
+	TextureHandle CreateTexture2DAsync(const char* filename, ImageManager& imageManager, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps) override;
+	bool IsTextureResident(const TextureHandle& handle) const override;
+	void SetTextureUploadBudget(uint32_t bytesPerFrame) override;
+	void DestroyTexture(TextureHandle& handle) override;
+	void SetTexture(uint32_t stage, const TextureHandle& textureHandle) override;
+
+	bool ReadPixels(uint32_t x, uint32_t y, uint32_t width, uint32_t height, void* rgba) override;
+
+	void BeginGpuScope(const char* name) override;
+	void EndGpuScope() override;
+
+	const GraphicsStats& GetStats() const override;
+	const GraphicsCaps& GetCaps() const override;
+
+private:
+	struct Impl;
+	Impl* mImpl;
+};
+
+} // namespace tinyngine
@@ -0,0 +1,917 @@
+#include "GraphicsDeviceSW.h"
+#include "PlatformDefine.h"
+#include "RasterizerSW.h"
+#include "ShaderCompilerSW.h"
+#include "ShaderRegistrySW.h"
+#include "TextureSW.h"
+#include "HandlePool.h"
+#include "Log.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+
+static constexpr uint32_t cMaxShaderHandles = (1 << 6);
+static constexpr uint32_t cMaxProgramHandles = (1 << 6);
+static constexpr uint32_t cMaxVertexBufferHandles = (1 << 10);
+static constexpr uint32_t cMaxIndexBufferHandle = (1 << 10);
+static constexpr uint32_t cMaxTextureHandle = (1 << 10);
+static constexpr uint32_t cMaxRenderStateHandles = (1 << 8);
+
+static constexpr uint32_t cTransientVertexBufferSize = (4 << 20);
+static constexpr uint32_t cTransientIndexBufferSize = (1 << 20);
+static constexpr uint32_t cTransientAlignment = 16;
+
+}
+
+namespace tinyngine
+{
+
+struct BufferSW {
+	std::vector<uint8_t> mData;
+	IndexType::Enum mType = IndexType::Uint32;
+};
+
+struct ShaderSW {
+	ShaderType::Enum mType = ShaderType::Count;
+	uint32_t mSourceHash = 0;
+	std::string mSource;
+};
+
+// registered C++ stages, or the bytecode compiled from the GLSL sources
+struct ProgramSW {
+	SoftwareProgramDesc mDesc;
+	CompiledProgramSW mCode;
+	bool mCompiled = false;
+	std::vector<float> mUniforms;
+};
+
+struct RenderStateSW {
+	RenderStateDesc mDesc;
+};
+
+struct TransientRingSW {
+	ResourceHandle mHandle = ResourceHandle(cInvalidHandle);
+	uint32_t mOffset = 0;
+};
+
+struct VertexStreamSW {
+	VertexBufferHandle mBuffer = VertexBufferHandle(cInvalidHandle);
+	uint32_t mOffset = 0;
+};
+
+struct GraphicsDeviceSW::Impl {
+	HandlePool<BufferSW, cMaxVertexBufferHandles> mVertexBuffers;
+	std::array<VertexStreamSW, Attributes::Count> mStreams;
+	bool mInterleavedVertexBuffer = false;
+
+	HandlePool<BufferSW, cMaxIndexBufferHandle> mIndexBuffers;
+	IndexBufferHandle mIndexBuffer = IndexBufferHandle(cInvalidHandle);
+	uint32_t mIndexBufferOffset = 0;
+	IndexType::Enum mIndexType = IndexType::Uint32;
+
+	TransientRingSW mTransientVertices;
+	TransientRingSW mTransientIndices;
+
+	std::vector<uint8_t> mInstanceData;
+	VertexFormat mInstanceFormat;
+	uint32_t mInstanceElementsCount = 0;
+	uint32_t mInstanceDivisor = 1;
+
+	HandlePool<ShaderSW, cMaxShaderHandles> mShaders;
+
+	HandlePool<ProgramSW, cMaxProgramHandles> mPrograms;
+	ProgramHandle mCurrentProgramHandle = ResourceHandle(cInvalidHandle);
+	VertexFormat mVertexFormat;
+
+	HandlePool<TextureSW, cMaxTextureHandle> mTextures;
+	std::array<TextureHandle, cMaxSoftwareTextureStages> mBoundTextures;
+
+	HandlePool<RenderStateSW, cMaxRenderStateHandles> mRenderStates;
+
+	PipelineStateSW mPipeline;
+	int32_t mViewport[4] = {};
+
+	RasterizerSW mRasterizer;
+	ShaderMachineSW mVertexMachine;
+	std::vector<uint32_t> mShadeIndices; // unique vertices of the draw
+	std::vector<uint32_t> mVertexRefs; // position of each vertex of the draw in mShadeIndices
+	std::vector<uint32_t> mVertexRemap;
+	std::unordered_map<uint32_t, uint32_t> mVertexMap;
+	std::vector<ClipVertexSW> mShaded;
+	bool mPrimitiveWarned = false;
+
+	GraphicsStats mFrameStats;
+	GraphicsStats mLastFrameStats;
+	GraphicsCaps mCaps;
+
+	void ApplyRenderState(const RenderStateDesc& desc);
+	void FlushIfPending();
+	bool AllocTransient(TransientRingSW& ring, bool indices, const void* data, uint32_t size, TransientBuffer& buffer);
+	void UpdateBuffer(BufferSW& buffer, uint32_t offset, const void* data, uint32_t size);
+	void SetUniform(const ProgramHandle& programHandle, const UniformHandle& uniformHandle, const float* data, uint32_t count);
+
+	uint32_t FetchIndex(const BufferSW& indexBuffer, uint32_t n) const;
+	void FetchVertex(uint32_t vertexIndex, SoftwareVertexInput& input) const;
+	void GatherVertices(const BufferSW* indexBuffer, uint32_t first, uint32_t count);
+	void ShadeVertices(const ProgramSW& program, const SoftwareVertexInput& input, const SoftwareTexture* const* textures);
+	void Draw(PrimitiveType::Enum primitive, uint32_t first, uint32_t count, bool indexed, uint32_t instancesCount);
+};
+
+// same rule as the GL device: parameters of disabled stages are kept, write masks are always applied
+void GraphicsDeviceSW::Impl::ApplyRenderState(const RenderStateDesc& desc) {
+	mPipeline.mEnabled[RendererStateType::Blend] = desc.mBlend.mEnabled;
+	mPipeline.mEnabled[RendererStateType::DepthTest] = desc.mDepth.mTestEnabled;
+	mPipeline.mEnabled[RendererStateType::Stencil] = desc.mStencil.mEnabled;
+	mPipeline.mEnabled[RendererStateType::CullFace] = desc.mRaster.mCullEnabled;
+	mPipeline.mEnabled[RendererStateType::PolygonOffset] = desc.mRaster.mPolygonOffsetEnabled;
+	mPipeline.mEnabled[RendererStateType::Scissor] = desc.mRaster.mScissorEnabled;
+
+	if (desc.mBlend.mEnabled) {
+		mPipeline.mSrcFactor = desc.mBlend.mSrcFactor;
+		mPipeline.mDstFactor = desc.mBlend.mDstFactor;
+	}
+	if (desc.mDepth.mTestEnabled) {
+		mPipeline.mDepthFunc = desc.mDepth.mFunc;
+	}
+	if (desc.mStencil.mEnabled) {
+		mPipeline.mStencilFunc = desc.mStencil.mFunc;
+		mPipeline.mStencilRef = desc.mStencil.mRef;
+		mPipeline.mStencilReadMask = desc.mStencil.mReadMask;
+		mPipeline.mStencilFail = desc.mStencil.mStencilFail;
+		mPipeline.mDepthFail = desc.mStencil.mDepthFail;
+		mPipeline.mDepthPass = desc.mStencil.mDepthPass;
+	}
+	if (desc.mRaster.mCullEnabled) {
+		mPipeline.mCullMode = desc.mRaster.mCullMode;
+		mPipeline.mWinding = desc.mRaster.mWinding;
+	}
+	if (desc.mRaster.mPolygonOffsetEnabled) {
+		mPipeline.mPolygonOffsetFactor = desc.mRaster.mPolygonOffsetFactor;
+		mPipeline.mPolygonOffsetUnits = desc.mRaster.mPolygonOffsetUnits;
+	}
+	mPipeline.mDepthWrite = desc.mDepth.mWriteEnabled;
+	mPipeline.mStencilWriteMask = desc.mStencil.mWriteMask;
+	mPipeline.mColorMask = desc.mColorMask;
+}
+
+// recorded triangles reference the fragment stages and the textures, keep them alive until rasterized
+void GraphicsDeviceSW::Impl::FlushIfPending() {
+	if (mRasterizer.HasPendingWork()) {
+		mRasterizer.Flush();
+	}
+}
+
+bool GraphicsDeviceSW::Impl::AllocTransient(TransientRingSW& ring, bool indices, const void* data, uint32_t size, TransientBuffer& buffer) {
+	BufferSW& storage = indices ? mIndexBuffers.Get(ring.mHandle) : mVertexBuffers.Get(ring.mHandle);
+	uint32_t offset = (ring.mOffset + cTransientAlignment - 1) & ~(cTransientAlignment - 1);
+	if (data == nullptr || size == 0 || offset + size > storage.mData.size()) {
+		buffer.mHandle = ResourceHandle(cInvalidHandle);
+		return false;
+	}
+	memcpy(&storage.mData[offset], data, size);
+	ring.mOffset = offset + size;
+	buffer.mHandle = ring.mHandle;
+	buffer.mOffset = offset;
+	buffer.mSize = size;
+	return true;
+}
+
+void GraphicsDeviceSW::Impl::UpdateBuffer(BufferSW& buffer, uint32_t offset, const void* data, uint32_t size) {
+	if (data == nullptr || offset + size > buffer.mData.size()) {
+		Log(Logger::Error, "Buffer update out of bounds (offset %u, size %u, buffer size %u)", offset, size, static_cast<uint32_t>(buffer.mData.size()));
+		return;
+	}
+	memcpy(&buffer.mData[offset], data, size);
+}
+
+void GraphicsDeviceSW::Impl::SetUniform(const ProgramHandle& programHandle, const UniformHandle& uniformHandle, const float* data, uint32_t count) {
+	if (!mPrograms.IsValid(programHandle) || !uniformHandle.IsValid()) {
+		return;
+	}
+	auto& program = mPrograms.Get(programHandle);
+	uint32_t offset = uniformHandle.mHandle * cSoftwareUniformSize;
+	if (offset + count > program.mUniforms.size()) {
+		return;
+	}
+	if (memcmp(&program.mUniforms[offset], data, count * sizeof(float)) == 0) {
+		mFrameStats.mUniformUploadsElided++;
+		return;
+	}
+	memcpy(&program.mUniforms[offset], data, count * sizeof(float));
+	mFrameStats.mUniformUploads++;
+}
+
+uint32_t GraphicsDeviceSW::Impl::FetchIndex(const BufferSW& indexBuffer, uint32_t n) const {
+	if (mIndexType == IndexType::Uint16) {
+		uint16_t index;
+		memcpy(&index, &indexBuffer.mData[mIndexBufferOffset + n * sizeof(uint16_t)], sizeof(index));
+		return index;
+	}
+	uint32_t index;
+	memcpy(&index, &indexBuffer.mData[mIndexBufferOffset + n * sizeof(uint32_t)], sizeof(index));
+	return index;
+}
+
+// attributes out of the bound buffers keep their default value instead of reading past the end
+void GraphicsDeviceSW::Impl::FetchVertex(uint32_t vertexIndex, SoftwareVertexInput& input) const {
+	for (uint8_t n = 0; n < Attributes::Count; n++) {
+		Attributes::Enum attrib = static_cast<Attributes::Enum>(n);
+		if (!mVertexFormat.IsValid(attrib)) {
+			continue;
+		}
+		const VertexStreamSW& stream = mStreams[mInterleavedVertexBuffer ? 0 : attrib];
+		if (!mVertexBuffers.IsValid(stream.mBuffer)) {
+			continue;
+		}
+		const BufferSW& buffer = mVertexBuffers.Get(stream.mBuffer);
+		uint32_t size = mVertexFormat.GetSize(attrib);
+		uint32_t offset = mInterleavedVertexBuffer ?
+			stream.mOffset + vertexIndex * mVertexFormat.mStride + mVertexFormat.mOffset[attrib] :
+			stream.mOffset + vertexIndex * size;
+		if (offset + size <= buffer.mData.size()) {
+			mVertexFormat.Read(attrib, &buffer.mData[offset], input.mAttributes[attrib]);
+		}
+	}
+}
+
+// Draws shade each referenced vertex once per instance, whatever the order of the indices.
+void GraphicsDeviceSW::Impl::GatherVertices(const BufferSW* indexBuffer, uint32_t first, uint32_t count) {
+	mShadeIndices.clear();
+	mVertexRefs.resize(count);
+	if (indexBuffer == nullptr) {
+		for (uint32_t n = 0; n < count; n++) {
+			mShadeIndices.push_back(first + n);
+			mVertexRefs[n] = n;
+		}
+		return;
+	}
+
+	uint32_t minIndex = UINT32_MAX;
+	uint32_t maxIndex = 0;
+	for (uint32_t n = 0; n < count; n++) {
+		uint32_t vertexIndex = FetchIndex(*indexBuffer, n);
+		minIndex = std::min(minIndex, vertexIndex);
+		maxIndex = std::max(maxIndex, vertexIndex);
+		mVertexRefs[n] = vertexIndex;
+	}
+	// compact index ranges use a flat table, sparse ones a map
+	if (maxIndex - minIndex < 4 * count) {
+		mVertexRemap.assign(maxIndex - minIndex + 1, UINT32_MAX);
+		for (uint32_t& ref : mVertexRefs) {
+			uint32_t& slot = mVertexRemap[ref - minIndex];
+			if (slot == UINT32_MAX) {
+				slot = static_cast<uint32_t>(mShadeIndices.size());
+				mShadeIndices.push_back(ref);
+			}
+			ref = slot;
+		}
+	} else {
+		mVertexMap.clear();
+		for (uint32_t& ref : mVertexRefs) {
+			auto slot = mVertexMap.emplace(ref, static_cast<uint32_t>(mShadeIndices.size()));
+			if (slot.second) {
+				mShadeIndices.push_back(ref);
+			}
+			ref = slot.first->second;
+		}
+	}
+}
+
+// compiled programs shade cShaderLanes vertices per run of the bytecode
+void GraphicsDeviceSW::Impl::ShadeVertices(const ProgramSW& program, const SoftwareVertexInput& input, const SoftwareTexture* const* textures) {
+	TINYNGINE_PROFILE_SCOPE("ShadeVertices");
+	uint32_t count = static_cast<uint32_t>(mShadeIndices.size());
+	mShaded.resize(count);
+	if (!program.mCompiled) {
+		for (uint32_t n = 0; n < count; n++) {
+			SoftwareVertexInput vertexInput = input;
+			FetchVertex(mShadeIndices[n], vertexInput);
+			program.mDesc.mVertexStage(vertexInput, mShaded[n].mPosition, mShaded[n].mVaryings);
+		}
+		return;
+	}
+
+	// uniforms are updated in place, they are loaded again for every draw
+	mVertexMachine.Bind(&program.mCode.mVertex, program.mUniforms.data());
+	float* inputs = mVertexMachine.GetInputs();
+	const float* outputs = mVertexMachine.GetOutputs();
+	uint32_t varyingsCount = program.mCode.mVaryingsCount;
+	for (uint32_t base = 0; base < count; base += cShaderLanes) {
+		uint32_t lanes = std::min(count - base, cShaderLanes);
+		for (uint32_t lane = 0; lane < lanes; lane++) {
+			SoftwareVertexInput vertexInput = input;
+			FetchVertex(mShadeIndices[base + lane], vertexInput);
+			for (uint32_t attrib = 0; attrib < Attributes::Count; attrib++) {
+				for (uint32_t c = 0; c < 4; c++) {
+					inputs[(ShaderSlotsSW::VertexAttributes + attrib * 4 + c) * cShaderLanes + lane] = vertexInput.mAttributes[attrib][c];
+				}
+			}
+		}
+		mVertexMachine.Run((1u << lanes) - 1, textures);
+		for (uint32_t lane = 0; lane < lanes; lane++) {
+			ClipVertexSW& vertex = mShaded[base + lane];
+			for (uint32_t c = 0; c < 4; c++) {
+				vertex.mPosition[c] = outputs[(ShaderSlotsSW::VertexPosition + c) * cShaderLanes + lane];
+			}
+			for (uint32_t v = 0; v < varyingsCount; v++) {
+				vertex.mVaryings[v] = outputs[(ShaderSlotsSW::VertexVaryings + v) * cShaderLanes + lane];
+			}
+		}
+	}
+}
+
+void GraphicsDeviceSW::Impl::Draw(PrimitiveType::Enum primitive, uint32_t first, uint32_t count, bool indexed, uint32_t instancesCount) {
+	if (!mPrograms.IsValid(mCurrentProgramHandle) || count < 3) {
+		return;
+	}
+	if (primitive != PrimitiveType::Triangles && primitive != PrimitiveType::TriangleStrip) {
+		if (!mPrimitiveWarned) {
+			Log(Logger::Warning, "The software device only rasterizes triangles, lines and points are skipped");
+			mPrimitiveWarned = true;
+		}
+		return;
+	}
+	const BufferSW* indexBuffer = nullptr;
+	if (indexed) {
+		if (!mIndexBuffers.IsValid(mIndexBuffer)) {
+			return;
+		}
+		indexBuffer = &mIndexBuffers.Get(mIndexBuffer);
+		uint32_t indexSize = mIndexType == IndexType::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+		if (mIndexBufferOffset + count * indexSize > indexBuffer->mData.size()) {
+			Log(Logger::Error, "Draw reads past the end of the index buffer");
+			return;
+		}
+	}
+
+	const ProgramSW& program = mPrograms.Get(mCurrentProgramHandle);
+	DrawStateSW drawState;
+	drawState.mPipeline = mPipeline;
+	if (program.mCompiled) {
+		drawState.mFragmentCode = &program.mCode.mFragment;
+		drawState.mVaryingsCount = program.mCode.mVaryingsCount;
+	} else {
+		drawState.mFragmentStage = &program.mDesc.mFragmentStage;
+		drawState.mVaryingsCount = program.mDesc.mVaryingsCount;
+	}
+	for (uint32_t stage = 0; stage < cMaxSoftwareTextureStages; stage++) {
+		const TextureHandle& handle = mBoundTextures[stage];
+		drawState.mTextures[stage] = mTextures.IsValid(handle) ? &mTextures.Get(handle).GetTexture() : nullptr;
+	}
+	std::copy(std::begin(mViewport), std::end(mViewport), std::begin(drawState.mViewport));
+	uint32_t drawStateIndex = mRasterizer.AddDrawState(drawState, program.mUniforms.data(), static_cast<uint32_t>(program.mUniforms.size()));
+
+	GatherVertices(indexBuffer, first, count);
+
+	SoftwareVertexInput input;
+	input.mUniforms = program.mUniforms.data();
+	for (uint32_t instance = 0; instance < std::max(instancesCount, 1u); instance++) {
+		for (auto& attribute : input.mAttributes) {
+			attribute[0] = attribute[1] = attribute[2] = 0.0f;
+			attribute[3] = 1.0f;
+		}
+		uint32_t element = instance / mInstanceDivisor;
+		if (instancesCount > 0 && element < mInstanceElementsCount) {
+			const uint8_t* source = &mInstanceData[element * mInstanceFormat.mStride];
+			for (uint8_t n = 0; n < Attributes::Count; n++) {
+				Attributes::Enum attrib = static_cast<Attributes::Enum>(n);
+				if (mInstanceFormat.IsValid(attrib)) {
+					mInstanceFormat.Read(attrib, source + mInstanceFormat.mOffset[attrib], input.mAttributes[attrib]);
+				}
+			}
+		}
+
+		// vertex fetch overwrites the attributes of the format, instance attributes are never part of it
+		ShadeVertices(program, input, drawState.mTextures);
+
+		if (primitive == PrimitiveType::Triangles) {
+			for (uint32_t n = 0; n + 2 < count; n += 3) {
+				mRasterizer.DrawTriangle(drawStateIndex, mShaded[mVertexRefs[n]], mShaded[mVertexRefs[n + 1]], mShaded[mVertexRefs[n + 2]]);
+			}
+		} else {
+			// odd triangles of a strip are flipped to keep the winding of the first one
+			for (uint32_t n = 2; n < count; n++) {
+				bool odd = (n & 1) != 0;
+				const ClipVertexSW& v0 = mShaded[mVertexRefs[odd ? n - 1 : n - 2]];
+				const ClipVertexSW& v1 = mShaded[mVertexRefs[odd ? n - 2 : n - 1]];
+				mRasterizer.DrawTriangle(drawStateIndex, v0, v1, mShaded[mVertexRefs[n]]);
+			}
+		}
+	}
+}
+
+//=============================================================================
+
+GraphicsDeviceSW::GraphicsDeviceSW() : mImpl(new Impl()) {
+	BufferSW ring;
+	ring.mData.resize(cTransientVertexBufferSize);
+	mImpl->mTransientVertices.mHandle = mImpl->mVertexBuffers.Allocate();
+	mImpl->mVertexBuffers.Get(mImpl->mTransientVertices.mHandle) = ring;
+
+	ring.mData.resize(cTransientIndexBufferSize);
+	mImpl->mTransientIndices.mHandle = mImpl->mIndexBuffers.Allocate();
+	mImpl->mIndexBuffers.Get(mImpl->mTransientIndices.mHandle) = ring;
+
+	std::fill(std::begin(mImpl->mBoundTextures), std::end(mImpl->mBoundTextures), TextureHandle(cInvalidHandle));
+	mImpl->mCaps.mIndexUint32 = true;
+	mImpl->mCaps.mInstancing = true;
+	// compressed textures are not decoded
+	mImpl->mCaps.mTextureFormats[TextureFormats::RGB8] = true;
+	mImpl->mCaps.mTextureFormats[TextureFormats::RGBA8] = true;
+	mImpl->mCaps.mTextureFormats[TextureFormats::BGRA8] = true;
+	std::fill(std::begin(mImpl->mCaps.mAttributeTypes), std::end(mImpl->mCaps.mAttributeTypes), true);
+
+	Log(Logger::Information, "Software rasterizer running on %u threads", mImpl->mRasterizer.GetWorkersCount());
+}
+
+GraphicsDeviceSW::~GraphicsDeviceSW() {
+	delete mImpl;
+}
+
+// the rasterization stands for the GPU work of the frame, the draws themselves are not timed
+void GraphicsDeviceSW::Commit() {
+	int64_t begin = Profiler::GetTime();
+	mImpl->mRasterizer.Flush();
+	Profiler::RecordGpuRange("Frame", begin, Profiler::GetTime(), 0);
+	mImpl->mTransientVertices.mOffset = 0;
+	mImpl->mTransientIndices.mOffset = 0;
+	mImpl->mInstanceData.clear();
+	mImpl->mInstanceElementsCount = 0;
+	mImpl->mLastFrameStats = mImpl->mFrameStats;
+	mImpl->mFrameStats = GraphicsStats();
+}
+
+// draws are rasterized in submission order, there is no state change to save by sorting them
+void GraphicsDeviceSW::SetSubmissionMode(SubmissionMode::Enum mode) {
+	TINYNGINE_UNUSED(mode);
+}
+
+void GraphicsDeviceSW::SetSortLayer(uint8_t layer) {
+	TINYNGINE_UNUSED(layer);
+}
+
+void GraphicsDeviceSW::SetSortDepth(float depth) {
+	TINYNGINE_UNUSED(depth);
+}
+
+void GraphicsDeviceSW::SetErrorCheckMode(ErrorCheckMode::Enum mode) {
+	TINYNGINE_UNUSED(mode);
+}
+
+// the render target only grows, resizing drops its content
+void GraphicsDeviceSW::SetViewport(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+	mImpl->mViewport[0] = static_cast<int32_t>(x);
+	mImpl->mViewport[1] = static_cast<int32_t>(y);
+	mImpl->mViewport[2] = static_cast<int32_t>(width);
+	mImpl->mViewport[3] = static_cast<int32_t>(height);
+	auto& rasterizer = mImpl->mRasterizer;
+	if (x + width > rasterizer.GetWidth() || y + height > rasterizer.GetHeight()) {
+		rasterizer.Resize(std::max(x + width, rasterizer.GetWidth()), std::max(y + height, rasterizer.GetHeight()));
+	}
+}
+
+void GraphicsDeviceSW::Clear(uint8_t flags, Color color, float depth, uint8_t stencil) {
+	const PipelineStateSW& pipeline = mImpl->mPipeline;
+	float rgba[4] = { color.red(), color.green(), color.blue(), color.alpha() };
+	mImpl->mRasterizer.Clear(flags, rgba, depth, stencil, pipeline.mColorMask, pipeline.mDepthWrite, static_cast<uint8_t>(pipeline.mStencilWriteMask));
+}
+
+void GraphicsDeviceSW::SetColorMake(bool red, bool green, bool blue, bool alpha) {
+	mImpl->mPipeline.mColorMask = (red ? ColorMask::Red : 0) | (green ? ColorMask::Green : 0) | (blue ? ColorMask::Blue : 0) | (alpha ? ColorMask::Alpha : 0);
+}
+
+void GraphicsDeviceSW::SetDepthMask(bool flag) {
+	mImpl->mPipeline.mDepthWrite = flag;
+}
+
+void GraphicsDeviceSW::SetStencilMask(uint32_t mask) {
+	mImpl->mPipeline.mStencilWriteMask = mask;
+}
+
+void GraphicsDeviceSW::SetState(RendererStateType::Enum type, bool value) {
+	if (mImpl->mPipeline.mEnabled[type] == value) {
+		mImpl->mFrameStats.mStateChangesElided++;
+		return;
+	}
+	mImpl->mPipeline.mEnabled[type] = value;
+	mImpl->mFrameStats.mStateChanges++;
+}
+
+void GraphicsDeviceSW::SetCullMode(CullFaceModes::Enum mode) {
+	mImpl->mPipeline.mCullMode = mode;
+}
+
+void GraphicsDeviceSW::SetWinding(WindingModes::Enum mode) {
+	mImpl->mPipeline.mWinding = mode;
+}
+
+void GraphicsDeviceSW::SetBlendFunc(BlendFuncs::Enum sfactor, BlendFuncs::Enum dfactor) {
+	mImpl->mPipeline.mSrcFactor = sfactor;
+	mImpl->mPipeline.mDstFactor = dfactor;
+}
+
+void GraphicsDeviceSW::SetDepthFunc(DepthFuncs::Enum func) {
+	mImpl->mPipeline.mDepthFunc = func;
+}
+
+void GraphicsDeviceSW::SetStencilFunc(StencilFuncs::Enum func, int32_t ref, uint32_t mask) {
+	mImpl->mPipeline.mStencilFunc = func;
+	mImpl->mPipeline.mStencilRef = ref;
+	mImpl->mPipeline.mStencilReadMask = mask;
+}
+
+void GraphicsDeviceSW::SetStencilOp(StencilOpTypes::Enum sfail, StencilOpTypes::Enum dpfail, StencilOpTypes::Enum dppass) {
+	mImpl->mPipeline.mStencilFail = sfail;
+	mImpl->mPipeline.mDepthFail = dpfail;
+	mImpl->mPipeline.mDepthPass = dppass;
+}
+
+void GraphicsDeviceSW::SetBlendColor(Color color) {
+	float* blendColor = mImpl->mPipeline.mBlendColor;
+	blendColor[0] = color.red();
+	blendColor[1] = color.green();
+	blendColor[2] = color.blue();
+	blendColor[3] = color.alpha();
+}
+
+void GraphicsDeviceSW::SetPolygonffset(float factor, float units) {
+	mImpl->mPipeline.mPolygonOffsetFactor = factor;
+	mImpl->mPipeline.mPolygonOffsetUnits = units;
+}
+
+RenderStateHandle GraphicsDeviceSW::CreateRenderState(const RenderStateDesc& desc) {
+	RenderStateHandle handle = mImpl->mRenderStates.Allocate();
+	if (handle.IsValid()) {
+		mImpl->mRenderStates.Get(handle).mDesc = desc;
+	}
+	return handle;
+}
+
+void GraphicsDeviceSW::SetRenderState(const RenderStateHandle& handle) {
+	if (mImpl->mRenderStates.IsValid(handle)) {
+		mImpl->ApplyRenderState(mImpl->mRenderStates.Get(handle).mDesc);
+	}
+}
+
+void GraphicsDeviceSW::DrawArray(PrimitiveType::Enum primitive, uint32_t first, uint32_t count) {
+	mImpl->Draw(primitive, first, count, false, 0);
+}
+
+void GraphicsDeviceSW::DrawElements(PrimitiveType::Enum primitive, uint32_t count) {
+	mImpl->Draw(primitive, 0, count, true, 0);
+}
+
+void GraphicsDeviceSW::DrawArrayInstanced(PrimitiveType::Enum primitive, uint32_t first, uint32_t count, uint32_t instancesCount) {
+	if (instancesCount > 0) {
+		mImpl->Draw(primitive, first, count, false, instancesCount);
+	}
+}
+
+void GraphicsDeviceSW::DrawElementsInstanced(PrimitiveType::Enum primitive, uint32_t count, uint32_t instancesCount) {
+	if (instancesCount > 0) {
+		mImpl->Draw(primitive, 0, count, true, instancesCount);
+	}
+}
+
+VertexBufferHandle GraphicsDeviceSW::CreateVertexBuffer(const void* data, uint32_t size, const VertexFormat& vertexFormat) {
+	TINYNGINE_UNUSED(vertexFormat);
+	VertexBufferHandle handle = mImpl->mVertexBuffers.Allocate();
+	if (handle.IsValid()) {
+		auto& buffer = mImpl->mVertexBuffers.Get(handle);
+		buffer.mData.resize(size);
+		if (data != nullptr && size > 0) {
+			memcpy(buffer.mData.data(), data, size);
+		}
+	}
+	return handle;
+}
+
+void GraphicsDeviceSW::UpdateVertexBuffer(const VertexBufferHandle& handle, uint32_t offset, const void* data, uint32_t size) {
+	if (mImpl->mVertexBuffers.IsValid(handle)) {
+		mImpl->UpdateBuffer(mImpl->mVertexBuffers.Get(handle), offset, data, size);
+	}
+}
+
+// vertices are transformed when the draw is submitted, buffers are not referenced by the rasterizer
+void GraphicsDeviceSW::DestroyVertexBuffer(VertexBufferHandle& handle) {
+	mImpl->mVertexBuffers.Free(handle);
+	handle = VertexBufferHandle(cInvalidHandle);
+}
+
+void GraphicsDeviceSW::SetVertexBuffer(const VertexBufferHandle& handle) {
+	if (handle.IsValid()) {
+		VertexStreamSW stream;
+		stream.mBuffer = handle;
+		mImpl->mStreams.fill(stream);
+		mImpl->mInterleavedVertexBuffer = true;
+	}
+}
+
+void GraphicsDeviceSW::SetVertexBuffer(const VertexBufferHandle& handle, Attributes::Enum attribute) {
+	if (handle.IsValid()) {
+		mImpl->mStreams[attribute].mBuffer = handle;
+		mImpl->mStreams[attribute].mOffset = 0;
+		mImpl->mInterleavedVertexBuffer = false;
+	}
+}
+
+IndexBufferHandle GraphicsDeviceSW::CreateIndexBuffer(const void* data, uint32_t size) {
+	return CreateIndexBuffer(data, size, IndexType::Uint32);
+}
+
+IndexBufferHandle GraphicsDeviceSW::CreateIndexBuffer(const void* data, uint32_t size, IndexType::Enum type) {
+	IndexBufferHandle handle = mImpl->mIndexBuffers.Allocate();
+	if (handle.IsValid()) {
+		auto& buffer = mImpl->mIndexBuffers.Get(handle);
+		buffer.mData.resize(size);
+		buffer.mType = type;
+		if (data != nullptr && size > 0) {
+			memcpy(buffer.mData.data(), data, size);
+		}
+	}
+	return handle;
+}
+
+void GraphicsDeviceSW::UpdateIndexBuffer(const IndexBufferHandle& handle, uint32_t offset, const void* data, uint32_t size) {
+	if (mImpl->mIndexBuffers.IsValid(handle)) {
+		mImpl->UpdateBuffer(mImpl->mIndexBuffers.Get(handle), offset, data, size);
+	}
+}
+
+void GraphicsDeviceSW::DestroyIndexBuffer(IndexBufferHandle& handle) {
+	mImpl->mIndexBuffers.Free(handle);
+	handle = IndexBufferHandle(cInvalidHandle);
+}
+
+void GraphicsDeviceSW::SetIndexBuffer(const IndexBufferHandle& handle) {
+	if (mImpl->mIndexBuffers.IsValid(handle)) {
+		mImpl->mIndexBuffer = handle;
+		mImpl->mIndexBufferOffset = 0;
+		mImpl->mIndexType = mImpl->mIndexBuffers.Get(handle).mType;
+	}
+}
+
+bool GraphicsDeviceSW::AllocTransientVertexBuffer(const void* data, uint32_t size, TransientBuffer& buffer) {
+	return mImpl->AllocTransient(mImpl->mTransientVertices, false, data, size, buffer);
+}
+
+bool GraphicsDeviceSW::AllocTransientIndexBuffer(const void* data, uint32_t size, IndexType::Enum type, TransientBuffer& buffer) {
+	buffer.mIndexType = type;
+	return mImpl->AllocTransient(mImpl->mTransientIndices, true, data, size, buffer);
+}
+
+void GraphicsDeviceSW::SetTransientVertexBuffer(const TransientBuffer& buffer) {
+	if (buffer.mHandle.IsValid()) {
+		VertexStreamSW stream;
+		stream.mBuffer = buffer.mHandle;
+		stream.mOffset = buffer.mOffset;
+		mImpl->mStreams.fill(stream);
+		mImpl->mInterleavedVertexBuffer = true;
+	}
+}
+
+void GraphicsDeviceSW::SetTransientVertexBuffer(const TransientBuffer& buffer, Attributes::Enum attribute) {
+	if (buffer.mHandle.IsValid()) {
+		mImpl->mStreams[attribute].mBuffer = buffer.mHandle;
+		mImpl->mStreams[attribute].mOffset = buffer.mOffset;
+		mImpl->mInterleavedVertexBuffer = false;
+	}
+}
+
+void GraphicsDeviceSW::SetTransientIndexBuffer(const TransientBuffer& buffer) {
+	if (buffer.mHandle.IsValid()) {
+		mImpl->mIndexBuffer = buffer.mHandle;
+		mImpl->mIndexBufferOffset = buffer.mOffset;
+		mImpl->mIndexType = buffer.mIndexType;
+	}
+}
+
+void GraphicsDeviceSW::SetInstanceData(const void* data, uint32_t elementsCount, const VertexFormat& instanceFormat, uint32_t divisor) {
+	uint32_t size = elementsCount * instanceFormat.mStride;
+	mImpl->mInstanceElementsCount = 0;
+	if (data == nullptr || size == 0) {
+		return;
+	}
+	const uint8_t* elements = static_cast<const uint8_t*>(data);
+	mImpl->mInstanceData.assign(elements, elements + size);
+	mImpl->mInstanceFormat = instanceFormat;
+	mImpl->mInstanceElementsCount = elementsCount;
+	mImpl->mInstanceDivisor = std::max(divisor, 1u);
+}
+
+ShaderHandle GraphicsDeviceSW::CreateShader(ShaderType::Enum type, const char* source) {
+	if (source == nullptr) {
+		return ShaderHandle(cInvalidHandle);
+	}
+	ShaderHandle handle = mImpl->mShaders.Allocate();
+	if (handle.IsValid()) {
+		auto& shader = mImpl->mShaders.Get(handle);
+		shader.mType = type;
+		shader.mSourceHash = HashShaderSource(source);
+		shader.mSource = source;
+	}
+	return handle;
+}
+
+ProgramHandle GraphicsDeviceSW::CreateProgram(ShaderHandle& vertexShaderHandle, ShaderHandle& fragmentShaderHandle, bool destroyShaders) {
+	if (!mImpl->mShaders.IsValid(vertexShaderHandle) || !mImpl->mShaders.IsValid(fragmentShaderHandle)) {
+		return ProgramHandle(cInvalidHandle);
+	}
+
+	// registered stages take precedence over the compiled GLSL
+	const ShaderSW& vertexShader = mImpl->mShaders.Get(vertexShaderHandle);
+	const ShaderSW& fragmentShader = mImpl->mShaders.Get(fragmentShaderHandle);
+	ProgramSW program;
+	bool linked = false;
+	if (FindSoftwareProgram(vertexShader.mSourceHash, fragmentShader.mSourceHash, program.mDesc)) {
+		const SoftwareProgramDesc& desc = program.mDesc;
+		if (!desc.mVertexStage || !desc.mFragmentStage || desc.mVaryingsCount > cMaxSoftwareVaryings) {
+			Log(Logger::Error, "Invalid software program (%u varyings, at most %u)", desc.mVaryingsCount, cMaxSoftwareVaryings);
+		} else {
+			program.mUniforms.assign(desc.mUniforms.size() * cSoftwareUniformSize, 0.0f);
+			linked = true;
+		}
+	} else {
+		std::string error;
+		if (!CompileShaderProgramSW(vertexShader.mSource.c_str(), fragmentShader.mSource.c_str(), program.mCode, error)) {
+			Log(Logger::Error, "Software shader compilation failed: %s", error.c_str());
+		} else {
+			program.mUniforms.assign(program.mCode.mUniforms.size() * cSoftwareUniformSize, 0.0f);
+			program.mCompiled = true;
+			linked = true;
+		}
+	}
+
+	ProgramHandle handle = linked ? mImpl->mPrograms.Allocate() : ProgramHandle(cInvalidHandle);
+	if (handle.IsValid()) {
+		mImpl->mPrograms.Get(handle) = std::move(program);
+	}
+
+	if (destroyShaders) {
+		mImpl->mShaders.Free(vertexShaderHandle);
+		mImpl->mShaders.Free(fragmentShaderHandle);
+		vertexShaderHandle = ShaderHandle(cInvalidHandle);
+		fragmentShaderHandle = ShaderHandle(cInvalidHandle);
+	}
+
+	return handle;
+}
+
+// the bytecode compiler is fast enough to run inline
+ProgramHandle GraphicsDeviceSW::CreateProgramAsync(ShaderHandle& vertexShaderHandle, ShaderHandle& fragmentShaderHandle, bool destroyShaders) {
+	return CreateProgram(vertexShaderHandle, fragmentShaderHandle, destroyShaders);
+}
+
+ProgramStatus::Enum GraphicsDeviceSW::GetProgramStatus(const ProgramHandle& handle) const {
+	return mImpl->mPrograms.IsValid(handle) ? ProgramStatus::Ready : ProgramStatus::Failed;
+}
+
+void GraphicsDeviceSW::SetProgramCacheDirectory(const char* directory) {
+	// shaders are compiled to bytecode in memory, there is no driver compilation to save
+	TINYNGINE_UNUSED(directory);
+}
+
+void GraphicsDeviceSW::DestroyProgram(ProgramHandle& handle) {
+	mImpl->FlushIfPending();
+	mImpl->mPrograms.Free(handle);
+	handle = ProgramHandle(cInvalidHandle);
+}
+
+void GraphicsDeviceSW::SetProgram(const ProgramHandle& handle, const VertexFormat& vertexFormat) {
+	mImpl->mCurrentProgramHandle = handle;
+	mImpl->mVertexFormat = vertexFormat;
+}
+
+UniformHandle GraphicsDeviceSW::GetUniform(const ProgramHandle& programHandle, const char* uniformName) const {
+	return GetUniform(programHandle, UniformId(uniformName));
+}
+
+UniformHandle GraphicsDeviceSW::GetUniform(const ProgramHandle& programHandle, const UniformId& uniformId) const {
+	if (!mImpl->mPrograms.IsValid(programHandle)) {
+		return UniformHandle(cInvalidHandle);
+	}
+	const auto& program = mImpl->mPrograms.Get(programHandle);
+	if (program.mCompiled) {
+		for (const Uniform& uniform : program.mCode.mUniforms) {
+			if (uniform.mNameHash == uniformId.mHash) {
+				return UniformHandle(static_cast<uint32_t>(uniform.mLocation));
+			}
+		}
+		return UniformHandle(cInvalidHandle);
+	}
+	const auto& uniforms = program.mDesc.mUniforms;
+	for (size_t n = 0; n < uniforms.size(); n++) {
+		if (uniforms[n].mHash == uniformId.mHash) {
+			return UniformHandle(static_cast<uint32_t>(n));
+		}
+	}
+	return UniformHandle(cInvalidHandle);
+}
+
+void GraphicsDeviceSW::setUniform1i(const ProgramHandle& programHandle, UniformHandle& uniformHandle, int32_t data) {
+	float value = static_cast<float>(data);
+	mImpl->SetUniform(programHandle, uniformHandle, &value, 1);
+}
+
+void GraphicsDeviceSW::SetUniformFloat(const ProgramHandle& programHandle, UniformHandle& uniformHandle, float data) {
+	mImpl->SetUniform(programHandle, uniformHandle, &data, 1);
+}
+
+void GraphicsDeviceSW::SetUniformFloat3(const ProgramHandle& programHandle, UniformHandle& uniformHandle, const float* data) {
+	mImpl->SetUniform(programHandle, uniformHandle, data, 3);
+}
+
+void GraphicsDeviceSW::SetUniformMat4(const ProgramHandle& programHandle, const UniformHandle& uniformHandle, const float* data, bool transpose) {
+	if (!transpose) {
+		mImpl->SetUniform(programHandle, uniformHandle, data, 16);
+		return;
+	}
+	float matrix[16];
+	for (uint32_t column = 0; column < 4; column++) {
+		for (uint32_t row = 0; row < 4; row++) {
+			matrix[column * 4 + row] = data[row * 4 + column];
+		}
+	}
+	mImpl->SetUniform(programHandle, uniformHandle, matrix, 16);
+}
+
+TextureHandle GraphicsDeviceSW::CreateTexture2D(const ImageHandle& imageHandle, ImageManager& imageManager, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps) {
+	TINYNGINE_UNUSED(useMipmaps);
+	if (!imageHandle.IsValid()) {
+		return TextureHandle(cInvalidHandle);
+	}
+	TextureHandle handle = mImpl->mTextures.Allocate();
+	if (!handle.IsValid()) {
+		return handle;
+	}
+	auto& texture = mImpl->mTextures.Get(handle);
+	texture.Create(imageHandle, imageManager, format, filtering);
+	if (!texture.IsValid()) {
+		mImpl->mTextures.Free(handle);
+		return TextureHandle(cInvalidHandle);
+	}
+	return handle;
+}
+
+// textures are sampled from system memory, there is nothing to stream and the file is loaded right away
+TextureHandle GraphicsDeviceSW::CreateTexture2DAsync(const char* filename, ImageManager& imageManager, TextureFormats::Enum format, TextureFilteringMode::Enum filtering, bool useMipmaps) {
+	ImageHandle imageHandle = imageManager.LoadImageFromFile(filename);
+	TextureHandle handle = CreateTexture2D(imageHandle, imageManager, format, filtering, useMipmaps);
+	imageManager.ReleaseImage(imageHandle);
+	return handle;
+}
+
+bool GraphicsDeviceSW::IsTextureResident(const TextureHandle& handle) const {
+	return mImpl->mTextures.IsValid(handle);
+}
+
+void GraphicsDeviceSW::SetTextureUploadBudget(uint32_t bytesPerFrame) {
+	TINYNGINE_UNUSED(bytesPerFrame);
+}
+
+void GraphicsDeviceSW::DestroyTexture(TextureHandle& handle) {
+	mImpl->FlushIfPending();
+	if (mImpl->mTextures.IsValid(handle)) {
+		mImpl->mTextures.Get(handle).Destroy();
+		mImpl->mTextures.Free(handle);
+	}
+	handle = TextureHandle(cInvalidHandle);
+}
+
+void GraphicsDeviceSW::SetTexture(uint32_t stage, const TextureHandle& textureHandle) {
+	if (stage < cMaxSoftwareTextureStages) {
+		mImpl->mBoundTextures[stage] = textureHandle;
+	}
+}
+
+bool GraphicsDeviceSW::ReadPixels(uint32_t x, uint32_t y, uint32_t width, uint32_t height, void* rgba) {
+	if (rgba == nullptr) {
+		return false;
+	}
+	mImpl->mRasterizer.ReadPixels(x, y, width, height, rgba);
+	return true;
+}
+
+void GraphicsDeviceSW::BeginGpuScope(const char* name) {
+	TINYNGINE_UNUSED(name);
+}
+
+void GraphicsDeviceSW::EndGpuScope() {
+}
+
+const GraphicsStats& GraphicsDeviceSW::GetStats() const {
+	return mImpl->mLastFrameStats;
+}
+
+const GraphicsCaps& GraphicsDeviceSW::GetCaps() const {
+	return mImpl->mCaps;
+}
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,719 @@
+#include "RasterizerSW.h"
+#include "GraphicsDevice.h"
+#include "PlatformDefine.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define TINYNGINE_SW_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TINYNGINE_SW_SSE2 1
+#endif
+
+namespace
+{
+
+static constexpr uint32_t cClearCommand = 1u << 31;
+static constexpr float cSubPixelScale = 256.0f;
+// keeps snapped window coordinates within the 24 bits of a float mantissa
+static constexpr float cGuardBandPixels = 16384.0f;
+static constexpr float cDepthUnit = 1.0f / 16777216.0f;
+static constexpr uint32_t cMaxClipVertices = 9;
+static constexpr uint32_t cClipPlanesCount = 6;
+
+// Edge functions are evaluated cLanes pixels at a time, only the coverage mask comes out of the vector code.
+#if defined(TINYNGINE_SW_AVX2)
+static constexpr uint32_t cLanes = 8;
+using LaneFloat = __m256;
+inline LaneFloat LaneSet(float value) { return _mm256_set1_ps(value); }
+inline LaneFloat LaneOffsets() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+inline LaneFloat LaneEdge(LaneFloat a, LaneFloat dx, LaneFloat rowBase) { return _mm256_add_ps(_mm256_mul_ps(a, dx), rowBase); }
+inline uint32_t LaneInside(LaneFloat edge, bool owner) {
+	__m256 zero = _mm256_setzero_ps();
+	__m256 inside = owner ? _mm256_cmp_ps(edge, zero, _CMP_GE_OQ) : _mm256_cmp_ps(edge, zero, _CMP_GT_OQ);
+	return static_cast<uint32_t>(_mm256_movemask_ps(inside));
+}
+#elif defined(TINYNGINE_SW_SSE2)
+static constexpr uint32_t cLanes = 4;
+using LaneFloat = __m128;
+inline LaneFloat LaneSet(float value) { return _mm_set1_ps(value); }
+inline LaneFloat LaneOffsets() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+inline LaneFloat LaneEdge(LaneFloat a, LaneFloat dx, LaneFloat rowBase) { return _mm_add_ps(_mm_mul_ps(a, dx), rowBase); }
+inline uint32_t LaneInside(LaneFloat edge, bool owner) {
+	__m128 zero = _mm_setzero_ps();
+	__m128 inside = owner ? _mm_cmpge_ps(edge, zero) : _mm_cmpgt_ps(edge, zero);
+	return static_cast<uint32_t>(_mm_movemask_ps(inside));
+}
+#else
+static constexpr uint32_t cLanes = 1;
+using LaneFloat = float;
+inline LaneFloat LaneSet(float value) { return value; }
+inline LaneFloat LaneOffsets() { return 0.0f; }
+inline LaneFloat LaneEdge(LaneFloat a, LaneFloat dx, LaneFloat rowBase) { return a * dx + rowBase; }
+inline uint32_t LaneInside(LaneFloat edge, bool owner) { return (owner ? edge >= 0.0f : edge > 0.0f) ? 1 : 0; }
+#endif
+
+inline LaneFloat LaneAdd(LaneFloat a, LaneFloat b) {
+#if defined(TINYNGINE_SW_AVX2)
+	return _mm256_add_ps(a, b);
+#elif defined(TINYNGINE_SW_SSE2)
+	return _mm_add_ps(a, b);
+#else
+	return a + b;
+#endif
+}
+
+inline uint8_t ToUnorm8(float value) {
+	value = std::min(std::max(value, 0.0f), 1.0f);
+	return static_cast<uint8_t>(value * 255.0f + 0.5f);
+}
+
+template<typename Func>
+inline bool CompareFunc(Func func, uint32_t reference, uint32_t value) {
+	switch (func) {
+	case Func::Never: return false;
+	case Func::Less: return reference < value;
+	case Func::Equal: return reference == value;
+	case Func::LessEqual: return reference <= value;
+	case Func::Greater: return reference > value;
+	case Func::NotEqual: return reference != value;
+	case Func::GreaterEqual: return reference >= value;
+	default: return true;
+	}
+}
+
+inline bool DepthTest(tinyngine::DepthFuncs::Enum func, float depth, float stored) {
+	switch (func) {
+	case tinyngine::DepthFuncs::Never: return false;
+	case tinyngine::DepthFuncs::Less: return depth < stored;
+	case tinyngine::DepthFuncs::Equal: return depth == stored;
+	case tinyngine::DepthFuncs::LessEqual: return depth <= stored;
+	case tinyngine::DepthFuncs::Greater: return depth > stored;
+	case tinyngine::DepthFuncs::NotEqual: return depth != stored;
+	case tinyngine::DepthFuncs::GreaterEqual: return depth >= stored;
+	default: return true;
+	}
+}
+
+inline uint8_t StencilOp(tinyngine::StencilOpTypes::Enum op, uint8_t value, uint8_t reference) {
+	switch (op) {
+	case tinyngine::StencilOpTypes::Zero: return 0;
+	case tinyngine::StencilOpTypes::Replace: return reference;
+	case tinyngine::StencilOpTypes::Increment: return value == UINT8_MAX ? value : static_cast<uint8_t>(value + 1);
+	case tinyngine::StencilOpTypes::IncrementWrap: return static_cast<uint8_t>(value + 1);
+	case tinyngine::StencilOpTypes::Decrement: return value == 0 ? value : static_cast<uint8_t>(value - 1);
+	case tinyngine::StencilOpTypes::DecrementWrap: return static_cast<uint8_t>(value - 1);
+	case tinyngine::StencilOpTypes::Invert: return static_cast<uint8_t>(~value);
+	default: return value;
+	}
+}
+
+inline void BlendFactor(tinyngine::BlendFuncs::Enum func, const float* src, const float* dst, const float* constant, float factor[4]) {
+	switch (func) {
+	case tinyngine::BlendFuncs::Zero: factor[0] = factor[1] = factor[2] = factor[3] = 0.0f; break;
+	case tinyngine::BlendFuncs::SrcColor: for (int c = 0; c < 4; c++) { factor[c] = src[c]; } break;
+	case tinyngine::BlendFuncs::OneMinusSrcColor: for (int c = 0; c < 4; c++) { factor[c] = 1.0f - src[c]; } break;
+	case tinyngine::BlendFuncs::DstColor: for (int c = 0; c < 4; c++) { factor[c] = dst[c]; } break;
+	case tinyngine::BlendFuncs::OneMinusDstColor: for (int c = 0; c < 4; c++) { factor[c] = 1.0f - dst[c]; } break;
+	case tinyngine::BlendFuncs::SrcAlpha: factor[0] = factor[1] = factor[2] = factor[3] = src[3]; break;
+	case tinyngine::BlendFuncs::OneMinusSrcAlpha: factor[0] = factor[1] = factor[2] = factor[3] = 1.0f - src[3]; break;
+	case tinyngine::BlendFuncs::DstAlpha: factor[0] = factor[1] = factor[2] = factor[3] = dst[3]; break;
+	case tinyngine::BlendFuncs::OneMinusDstAlpha: factor[0] = factor[1] = factor[2] = factor[3] = 1.0f - dst[3]; break;
+	case tinyngine::BlendFuncs::ConstantColor: for (int c = 0; c < 4; c++) { factor[c] = constant[c]; } break;
+	case tinyngine::BlendFuncs::OneMinusConstantColor: for (int c = 0; c < 4; c++) { factor[c] = 1.0f - constant[c]; } break;
+	case tinyngine::BlendFuncs::ConstantAlpha: factor[0] = factor[1] = factor[2] = factor[3] = constant[3]; break;
+	case tinyngine::BlendFuncs::OneMinusConstantAlpha: factor[0] = factor[1] = factor[2] = factor[3] = 1.0f - constant[3]; break;
+	case tinyngine::BlendFuncs::SrcAlphaSaturate:
+		factor[0] = factor[1] = factor[2] = std::min(src[3], 1.0f - dst[3]);
+		factor[3] = 1.0f;
+		break;
+	default: factor[0] = factor[1] = factor[2] = factor[3] = 1.0f; break;
+	}
+}
+
+// signed distance of a clip space position to the near, far and guard band planes, inside when positive
+inline float ClipDistance(const float* position, uint32_t plane, float guardBand) {
+	switch (plane) {
+	case 0: return position[3] + position[2];
+	case 1: return position[3] - position[2];
+	case 2: return guardBand * position[3] - position[0];
+	case 3: return guardBand * position[3] + position[0];
+	case 4: return guardBand * position[3] - position[1];
+	default: return guardBand * position[3] + position[1];
+	}
+}
+
+}
+
+namespace tinyngine
+{
+
+RasterizerSW::RasterizerSW() {
+	uint32_t threadsCount = std::max(std::thread::hardware_concurrency(), 1u);
+	for (uint32_t n = 1; n < threadsCount; n++) {
+		mWorkers.emplace_back(&RasterizerSW::WorkerFunc, this, n);
+	}
+}
+
+RasterizerSW::~RasterizerSW() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mExit = true;
+	}
+	mWorkCondition.notify_all();
+	for (auto& worker : mWorkers) {
+		worker.join();
+	}
+}
+
+void RasterizerSW::Resize(uint32_t width, uint32_t height) {
+	if (width == mWidth && height == mHeight) {
+		return;
+	}
+	Flush();
+	mWidth = width;
+	mHeight = height;
+	mTilesX = (width + cTileSize - 1) / cTileSize;
+	mTilesY = (height + cTileSize - 1) / cTileSize;
+	mColor.assign(width * height, 0);
+	mDepth.assign(width * height, 1.0f);
+	mStencil.assign(width * height, 0);
+	mBins.resize(mTilesX * mTilesY);
+}
+
+void RasterizerSW::Clear(uint8_t flags, const float color[4], float depth, uint8_t stencil, uint8_t colorMask, bool depthMask, uint8_t stencilMask) {
+	if (mWidth == 0 || mHeight == 0) {
+		return;
+	}
+	ClearSW clear;
+	clear.mFlags = flags;
+	for (uint32_t c = 0; c < 4; c++) {
+		clear.mColor[c] = ToUnorm8(color[c]);
+	}
+	clear.mDepth = std::min(std::max(depth, 0.0f), 1.0f);
+	clear.mStencil = stencil;
+	clear.mColorMask = colorMask;
+	clear.mDepthMask = depthMask;
+	clear.mStencilMask = stencilMask;
+	mClears.push_back(clear);
+	BinCommand(cClearCommand | static_cast<uint32_t>(mClears.size() - 1), 0, 0, mWidth - 1, mHeight - 1);
+}
+
+uint32_t RasterizerSW::AddDrawState(const DrawStateSW& state, const float* uniforms, uint32_t uniformsCount) {
+	mDrawStates.push_back(state);
+	mDrawStates.back().mUniformsOffset = static_cast<uint32_t>(mUniforms.size());
+	mUniforms.insert(mUniforms.end(), uniforms, uniforms + uniformsCount);
+	return static_cast<uint32_t>(mDrawStates.size() - 1);
+}
+
+void RasterizerSW::DrawTriangle(uint32_t drawStateIndex, const ClipVertexSW& v0, const ClipVertexSW& v1, const ClipVertexSW& v2) {
+	const DrawStateSW& drawState = mDrawStates[drawStateIndex];
+	float guardBand = std::max(1.0f, 2.0f * cGuardBandPixels / std::max(drawState.mViewport[2], drawState.mViewport[3]));
+
+	const ClipVertexSW* vertices[3] = { &v0, &v1, &v2 };
+	uint32_t outside = 0;
+	for (uint32_t plane = 0; plane < cClipPlanesCount; plane++) {
+		uint32_t count = 0;
+		for (uint32_t n = 0; n < 3; n++) {
+			count += ClipDistance(vertices[n]->mPosition, plane, guardBand) < 0.0f ? 1 : 0;
+		}
+		if (count == 3) {
+			return;
+		}
+		outside |= count > 0 ? (1u << plane) : 0;
+	}
+	if (outside == 0) {
+		SetupTriangle(drawStateIndex, vertices);
+		return;
+	}
+
+	// Sutherland-Hodgman against the planes crossed by the triangle, the result is drawn as a fan
+	uint32_t varyingsCount = drawState.mVaryingsCount;
+	ClipVertexSW buffers[2][cMaxClipVertices];
+	uint32_t counts[2] = { 3, 0 };
+	buffers[0][0] = v0;
+	buffers[0][1] = v1;
+	buffers[0][2] = v2;
+	uint32_t current = 0;
+	for (uint32_t plane = 0; plane < cClipPlanesCount; plane++) {
+		if ((outside & (1u << plane)) == 0) {
+			continue;
+		}
+		const ClipVertexSW* input = buffers[current];
+		ClipVertexSW* output = buffers[current ^ 1];
+		uint32_t inputCount = counts[current];
+		uint32_t outputCount = 0;
+		for (uint32_t n = 0; n < inputCount; n++) {
+			const ClipVertexSW& a = input[n];
+			const ClipVertexSW& b = input[(n + 1) % inputCount];
+			float da = ClipDistance(a.mPosition, plane, guardBand);
+			float db = ClipDistance(b.mPosition, plane, guardBand);
+			if (da >= 0.0f && outputCount < cMaxClipVertices) {
+				output[outputCount++] = a;
+			}
+			if ((da >= 0.0f) != (db >= 0.0f) && outputCount < cMaxClipVertices) {
+				float t = da / (da - db);
+				ClipVertexSW& clipped = output[outputCount++];
+				for (uint32_t c = 0; c < 4; c++) {
+					clipped.mPosition[c] = a.mPosition[c] + (b.mPosition[c] - a.mPosition[c]) * t;
+				}
+				for (uint32_t c = 0; c < varyingsCount; c++) {
+					clipped.mVaryings[c] = a.mVaryings[c] + (b.mVaryings[c] - a.mVaryings[c]) * t;
+				}
+			}
+		}
+		counts[current ^ 1] = outputCount;
+		current ^= 1;
+		if (outputCount < 3) {
+			return;
+		}
+	}
+
+	const ClipVertexSW* polygon = buffers[current];
+	for (uint32_t n = 1; n + 1 < counts[current]; n++) {
+		const ClipVertexSW* fan[3] = { &polygon[0], &polygon[n], &polygon[n + 1] };
+		SetupTriangle(drawStateIndex, fan);
+	}
+}
+
+void RasterizerSW::SetupTriangle(uint32_t drawStateIndex, const ClipVertexSW* const* vertices) {
+	const DrawStateSW& drawState = mDrawStates[drawStateIndex];
+	const PipelineStateSW& pipeline = drawState.mPipeline;
+	const int32_t* viewport = drawState.mViewport;
+
+	TriangleSW triangle;
+	for (uint32_t n = 0; n < 3; n++) {
+		const float* position = vertices[n]->mPosition;
+		if (position[3] <= 0.0f) {
+			return;
+		}
+		float invW = 1.0f / position[3];
+		float x = (position[0] * invW * 0.5f + 0.5f) * viewport[2] + viewport[0];
+		float y = (position[1] * invW * 0.5f + 0.5f) * viewport[3] + viewport[1];
+		triangle.mX[n] = std::floor(x * cSubPixelScale + 0.5f) / cSubPixelScale;
+		triangle.mY[n] = std::floor(y * cSubPixelScale + 0.5f) / cSubPixelScale;
+		triangle.mZ[n] = position[2] * invW * 0.5f + 0.5f;
+		triangle.mInvW[n] = invW;
+	}
+
+	float area = (triangle.mX[1] - triangle.mX[0]) * (triangle.mY[2] - triangle.mY[0]) - (triangle.mX[2] - triangle.mX[0]) * (triangle.mY[1] - triangle.mY[0]);
+	if (area == 0.0f) {
+		return;
+	}
+	// window coordinates are y up as in GL, a positive area is counter clockwise
+	triangle.mFrontFacing = (pipeline.mWinding == WindingModes::CounterClockWise) == (area > 0.0f);
+	if (pipeline.mEnabled[RendererStateType::CullFace]) {
+		if (pipeline.mCullMode == CullFaceModes::FrontAndBack ||
+			(pipeline.mCullMode == CullFaceModes::Front && triangle.mFrontFacing) ||
+			(pipeline.mCullMode == CullFaceModes::Back && !triangle.mFrontFacing)) {
+			return;
+		}
+	}
+	triangle.mArea = area;
+
+	float minX = std::min(std::min(triangle.mX[0], triangle.mX[1]), triangle.mX[2]);
+	float minY = std::min(std::min(triangle.mY[0], triangle.mY[1]), triangle.mY[2]);
+	float maxX = std::max(std::max(triangle.mX[0], triangle.mX[1]), triangle.mX[2]);
+	float maxY = std::max(std::max(triangle.mY[0], triangle.mY[1]), triangle.mY[2]);
+	triangle.mMinX = std::max(static_cast<int32_t>(std::floor(minX)), std::max(viewport[0], 0));
+	triangle.mMinY = std::max(static_cast<int32_t>(std::floor(minY)), std::max(viewport[1], 0));
+	triangle.mMaxX = std::min(static_cast<int32_t>(std::floor(maxX)), std::min(viewport[0] + viewport[2], static_cast<int32_t>(mWidth)) - 1);
+	triangle.mMaxY = std::min(static_cast<int32_t>(std::floor(maxY)), std::min(viewport[1] + viewport[3], static_cast<int32_t>(mHeight)) - 1);
+	if (triangle.mMinX > triangle.mMaxX || triangle.mMinY > triangle.mMaxY) {
+		return;
+	}
+
+	if (pipeline.mEnabled[RendererStateType::PolygonOffset]) {
+		float dz1 = triangle.mZ[1] - triangle.mZ[0];
+		float dz2 = triangle.mZ[2] - triangle.mZ[0];
+		float dzdx = (dz1 * (triangle.mY[2] - triangle.mY[0]) - dz2 * (triangle.mY[1] - triangle.mY[0])) / area;
+		float dzdy = (dz2 * (triangle.mX[1] - triangle.mX[0]) - dz1 * (triangle.mX[2] - triangle.mX[0])) / area;
+		float offset = pipeline.mPolygonOffsetFactor * std::max(std::fabs(dzdx), std::fabs(dzdy)) + pipeline.mPolygonOffsetUnits * cDepthUnit;
+		for (uint32_t n = 0; n < 3; n++) {
+			triangle.mZ[n] += offset;
+		}
+	}
+
+	uint32_t varyingsCount = drawState.mVaryingsCount;
+	triangle.mVaryingsOffset = static_cast<uint32_t>(mVaryings.size());
+	for (uint32_t n = 0; n < 3; n++) {
+		for (uint32_t c = 0; c < varyingsCount; c++) {
+			mVaryings.push_back(vertices[n]->mVaryings[c] * triangle.mInvW[n]);
+		}
+	}
+	triangle.mDrawState = drawStateIndex;
+	mTriangles.push_back(triangle);
+
+	// skip the tiles of the bounding box lying entirely outside one of the edges
+	double sign = area > 0.0f ? 1.0 : -1.0;
+	double a[3], b[3], c[3];
+	for (uint32_t n = 0; n < 3; n++) {
+		uint32_t v0 = (n + 1) % 3;
+		uint32_t v1 = (n + 2) % 3;
+		a[n] = sign * (static_cast<double>(triangle.mY[v0]) - triangle.mY[v1]);
+		b[n] = sign * (static_cast<double>(triangle.mX[v1]) - triangle.mX[v0]);
+		c[n] = sign * (static_cast<double>(triangle.mX[v0]) * triangle.mY[v1] - static_cast<double>(triangle.mX[v1]) * triangle.mY[v0]);
+	}
+	uint32_t command = static_cast<uint32_t>(mTriangles.size() - 1);
+	uint32_t tileMinX = triangle.mMinX / cTileSize;
+	uint32_t tileMinY = triangle.mMinY / cTileSize;
+	uint32_t tileMaxX = triangle.mMaxX / cTileSize;
+	uint32_t tileMaxY = triangle.mMaxY / cTileSize;
+	for (uint32_t tileY = tileMinY; tileY <= tileMaxY; tileY++) {
+		for (uint32_t tileX = tileMinX; tileX <= tileMaxX; tileX++) {
+			double x0 = static_cast<double>(tileX * cTileSize);
+			double y0 = static_cast<double>(tileY * cTileSize);
+			bool overlaps = true;
+			for (uint32_t n = 0; n < 3 && overlaps; n++) {
+				double x = a[n] > 0.0 ? x0 + cTileSize : x0;
+				double y = b[n] > 0.0 ? y0 + cTileSize : y0;
+				overlaps = a[n] * x + b[n] * y + c[n] >= 0.0;
+			}
+			if (overlaps) {
+				mBins[tileY * mTilesX + tileX].push_back(command);
+				mCommandsCount++;
+			}
+		}
+	}
+}
+
+void RasterizerSW::BinCommand(uint32_t command, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY) {
+	for (int32_t tileY = minY / static_cast<int32_t>(cTileSize); tileY <= maxY / static_cast<int32_t>(cTileSize); tileY++) {
+		for (int32_t tileX = minX / static_cast<int32_t>(cTileSize); tileX <= maxX / static_cast<int32_t>(cTileSize); tileX++) {
+			mBins[tileY * mTilesX + tileX].push_back(command);
+			mCommandsCount++;
+		}
+	}
+}
+
+void RasterizerSW::Flush() {
+	if (mCommandsCount == 0) {
+		return;
+	}
+
+	mNextTile = 0;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mGeneration++;
+		mActiveWorkers = static_cast<uint32_t>(mWorkers.size());
+	}
+	mWorkCondition.notify_all();
+	RunTiles();
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDoneCondition.wait(lock, [this]() { return mActiveWorkers == 0; });
+	}
+
+	for (auto& bin : mBins) {
+		bin.clear();
+	}
+	mClears.clear();
+	mTriangles.clear();
+	mDrawStates.clear();
+	mVaryings.clear();
+	mUniforms.clear();
+	mCommandsCount = 0;
+}
+
+void RasterizerSW::ReadPixels(uint32_t x, uint32_t y, uint32_t width, uint32_t height, void* rgba) {
+	Flush();
+	uint8_t* destination = static_cast<uint8_t*>(rgba);
+	for (uint32_t row = 0; row < height; row++) {
+		uint8_t* line = destination + row * width * 4;
+		if (y + row >= mHeight || x >= mWidth) {
+			std::memset(line, 0, width * 4);
+			continue;
+		}
+		uint32_t count = std::min(width, mWidth - x);
+		std::memcpy(line, &mColor[(y + row) * mWidth + x], count * 4);
+		std::memset(line + count * 4, 0, (width - count) * 4);
+	}
+}
+
+void RasterizerSW::WorkerFunc(uint32_t index) {
+	Profiler::SetThreadName(("Rasterizer " + std::to_string(index)).c_str());
+
+	uint64_t generation = 0;
+	std::unique_lock<std::mutex> lock(mMutex);
+	for (;;) {
+		mWorkCondition.wait(lock, [this, generation]() { return mExit || mGeneration != generation; });
+		if (mExit) {
+			break;
+		}
+		generation = mGeneration;
+		lock.unlock();
+		RunTiles();
+		lock.lock();
+		if (--mActiveWorkers == 0) {
+			mDoneCondition.notify_all();
+		}
+	}
+}
+
+// the shader machine holds the registers of the compiled fragment stages run by this thread
+void RasterizerSW::RunTiles() {
+	TINYNGINE_PROFILE_SCOPE("RunTiles");
+	ShaderMachineSW machine;
+	uint32_t tilesCount = mTilesX * mTilesY;
+	for (;;) {
+		uint32_t tileIndex = mNextTile++;
+		if (tileIndex >= tilesCount) {
+			break;
+		}
+		if (!mBins[tileIndex].empty()) {
+			RasterTile(tileIndex, machine);
+		}
+	}
+}
+
+void RasterizerSW::RasterTile(uint32_t tileIndex, ShaderMachineSW& machine) {
+	int32_t minX = static_cast<int32_t>((tileIndex % mTilesX) * cTileSize);
+	int32_t minY = static_cast<int32_t>((tileIndex / mTilesX) * cTileSize);
+	int32_t maxX = std::min(minX + static_cast<int32_t>(cTileSize), static_cast<int32_t>(mWidth)) - 1;
+	int32_t maxY = std::min(minY + static_cast<int32_t>(cTileSize), static_cast<int32_t>(mHeight)) - 1;
+	for (uint32_t command : mBins[tileIndex]) {
+		if (command & cClearCommand) {
+			ClearTile(mClears[command & ~cClearCommand], minX, minY, maxX, maxY);
+		} else {
+			RasterTriangle(mTriangles[command], minX, minY, maxX, maxY, machine);
+		}
+	}
+}
+
+void RasterizerSW::ClearTile(const ClearSW& clear, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY) {
+	uint32_t color;
+	std::memcpy(&color, clear.mColor, sizeof(color));
+	uint32_t keepMask = 0;
+	for (uint32_t c = 0; c < 4; c++) {
+		keepMask |= (clear.mColorMask & (1 << c)) ? 0 : (0xffu << (c * 8));
+	}
+	for (int32_t y = minY; y <= maxY; y++) {
+		uint32_t row = static_cast<uint32_t>(y) * mWidth;
+		for (int32_t x = minX; x <= maxX; x++) {
+			uint32_t index = row + x;
+			if (clear.mFlags & GraphicsDevice::ColorBuffer) {
+				mColor[index] = (mColor[index] & keepMask) | (color & ~keepMask);
+			}
+			if ((clear.mFlags & GraphicsDevice::DepthBuffer) && clear.mDepthMask) {
+				mDepth[index] = clear.mDepth;
+			}
+			if (clear.mFlags & GraphicsDevice::StencilBuffer) {
+				mStencil[index] = (mStencil[index] & ~clear.mStencilMask) | (clear.mStencil & clear.mStencilMask);
+			}
+		}
+	}
+}
+
+void RasterizerSW::RasterTriangle(const TriangleSW& triangle, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, ShaderMachineSW& machine) {
+	minX = std::max(minX, triangle.mMinX);
+	minY = std::max(minY, triangle.mMinY);
+	maxX = std::min(maxX, triangle.mMaxX);
+	maxY = std::min(maxY, triangle.mMaxY);
+	if (minX > maxX || minY > maxY) {
+		return;
+	}
+	const DrawStateSW& drawState = mDrawStates[triangle.mDrawState];
+
+	// Edge functions relative to the tile origin, shared by every triangle touching the tile: an edge shared by two
+	// triangles evaluates to exactly opposite values and the ownership rule assigns its pixels to a single one.
+	int32_t originX = minX - minX % static_cast<int32_t>(cTileSize);
+	int32_t originY = minY - minY % static_cast<int32_t>(cTileSize);
+	double sign = triangle.mArea > 0.0f ? 1.0 : -1.0;
+	float a[3], b[3], c[3];
+	bool owner[3];
+	for (uint32_t n = 0; n < 3; n++) {
+		uint32_t v0 = (n + 1) % 3;
+		uint32_t v1 = (n + 2) % 3;
+		double ea = sign * (static_cast<double>(triangle.mY[v0]) - triangle.mY[v1]);
+		double eb = sign * (static_cast<double>(triangle.mX[v1]) - triangle.mX[v0]);
+		double ec = sign * (static_cast<double>(triangle.mX[v0]) * triangle.mY[v1] - static_cast<double>(triangle.mX[v1]) * triangle.mY[v0]);
+		a[n] = static_cast<float>(ea);
+		b[n] = static_cast<float>(eb);
+		c[n] = static_cast<float>(ea * originX + eb * originY + ec);
+		owner[n] = a[n] > 0.0f || (a[n] == 0.0f && b[n] > 0.0f);
+	}
+
+	LaneFloat laneA[3];
+	for (uint32_t n = 0; n < 3; n++) {
+		laneA[n] = LaneSet(a[n]);
+	}
+	LaneFloat laneOffsets = LaneOffsets();
+
+	// compiled fragment stages run on batches of covered pixels, in raster order
+	bool compiled = drawState.mFragmentCode != nullptr;
+	FragmentSW batch[cShaderLanes];
+	uint32_t batchCount = 0;
+
+	for (int32_t y = minY; y <= maxY; y++) {
+		float dy = static_cast<float>(y - originY) + 0.5f;
+		float rowBase[3];
+		LaneFloat laneRowBase[3];
+		for (uint32_t n = 0; n < 3; n++) {
+			rowBase[n] = b[n] * dy + c[n];
+			laneRowBase[n] = LaneSet(rowBase[n]);
+		}
+		for (int32_t x = minX; x <= maxX; x += cLanes) {
+			float dx = static_cast<float>(x - originX) + 0.5f;
+			LaneFloat laneDx = LaneAdd(LaneSet(dx), laneOffsets);
+			uint32_t mask = LaneInside(LaneEdge(laneA[0], laneDx, laneRowBase[0]), owner[0]);
+			mask &= LaneInside(LaneEdge(laneA[1], laneDx, laneRowBase[1]), owner[1]);
+			mask &= LaneInside(LaneEdge(laneA[2], laneDx, laneRowBase[2]), owner[2]);
+			uint32_t remaining = static_cast<uint32_t>(maxX - x + 1);
+			if (remaining < cLanes) {
+				mask &= (1u << remaining) - 1;
+			}
+			for (uint32_t lane = 0; mask != 0; lane++, mask >>= 1) {
+				if (mask & 1) {
+					float laneX = dx + static_cast<float>(lane);
+					float edges[3] = { a[0] * laneX + rowBase[0], a[1] * laneX + rowBase[1], a[2] * laneX + rowBase[2] };
+					if (!compiled) {
+						ShadePixel(triangle, drawState, x + static_cast<int32_t>(lane), y, edges);
+					} else if (SetupFragment(triangle, drawState, x + static_cast<int32_t>(lane), y, edges, batch[batchCount]) && ++batchCount == cShaderLanes) {
+						ShadeBatch(triangle, drawState, batch, batchCount, machine);
+						batchCount = 0;
+					}
+				}
+			}
+		}
+	}
+	if (batchCount > 0) {
+		ShadeBatch(triangle, drawState, batch, batchCount, machine);
+	}
+}
+
+// returns false when the fragment has no effect and can be skipped
+bool RasterizerSW::SetupFragment(const TriangleSW& triangle, const DrawStateSW& drawState, int32_t x, int32_t y, const float* edges, FragmentSW& fragment) const {
+	const PipelineStateSW& pipeline = drawState.mPipeline;
+	float invArea = 1.0f / std::fabs(triangle.mArea);
+	float weights[3] = { edges[0] * invArea, edges[1] * invArea, edges[2] * invArea };
+	float depth = weights[0] * triangle.mZ[0] + weights[1] * triangle.mZ[1] + weights[2] * triangle.mZ[2];
+	fragment.mDepth = std::min(std::max(depth, 0.0f), 1.0f);
+	fragment.mX = x;
+	fragment.mY = y;
+	fragment.mIndex = static_cast<uint32_t>(y) * mWidth + static_cast<uint32_t>(x);
+	fragment.mDepthPass = !pipeline.mEnabled[RendererStateType::DepthTest] || DepthTest(pipeline.mDepthFunc, fragment.mDepth, mDepth[fragment.mIndex]);
+	// without stencil a failing depth test has no side effect, the fragment stage can be skipped
+	if (!pipeline.mEnabled[RendererStateType::Stencil] && !fragment.mDepthPass) {
+		return false;
+	}
+
+	fragment.mInvW = weights[0] * triangle.mInvW[0] + weights[1] * triangle.mInvW[1] + weights[2] * triangle.mInvW[2];
+	float w = 1.0f / fragment.mInvW;
+	uint32_t varyingsCount = drawState.mVaryingsCount;
+	const float* vertexVaryings = &mVaryings[triangle.mVaryingsOffset];
+	for (uint32_t n = 0; n < varyingsCount; n++) {
+		float value = weights[0] * vertexVaryings[n] + weights[1] * vertexVaryings[varyingsCount + n] + weights[2] * vertexVaryings[2 * varyingsCount + n];
+		fragment.mVaryings[n] = value * w;
+	}
+	return true;
+}
+
+void RasterizerSW::ShadePixel(const TriangleSW& triangle, const DrawStateSW& drawState, int32_t x, int32_t y, const float* edges) {
+	FragmentSW fragment;
+	if (!SetupFragment(triangle, drawState, x, y, edges, fragment)) {
+		return;
+	}
+
+	SoftwareFragmentInput input;
+	input.mVaryings = fragment.mVaryings;
+	input.mUniforms = mUniforms.empty() ? nullptr : &mUniforms[drawState.mUniformsOffset];
+	input.mTextures = drawState.mTextures;
+	input.mFragCoord[0] = x + 0.5f;
+	input.mFragCoord[1] = y + 0.5f;
+	input.mFragCoord[2] = fragment.mDepth;
+	input.mFragCoord[3] = fragment.mInvW;
+	input.mFrontFacing = triangle.mFrontFacing;
+	float color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	if (drawState.mFragmentStage == nullptr || !(*drawState.mFragmentStage)(input, color)) {
+		return;
+	}
+	WriteFragment(drawState.mPipeline, fragment, color);
+}
+
+// the pixels of a batch are distinct, the depth tests done by SetupFragment stay valid until the writes
+void RasterizerSW::ShadeBatch(const TriangleSW& triangle, const DrawStateSW& drawState, const FragmentSW* fragments, uint32_t count, ShaderMachineSW& machine) {
+	const float* uniforms = mUniforms.empty() ? nullptr : &mUniforms[drawState.mUniformsOffset];
+	if (!machine.IsBound(drawState.mFragmentCode, uniforms)) {
+		machine.Bind(drawState.mFragmentCode, uniforms);
+	}
+	float* inputs = machine.GetInputs();
+	for (uint32_t lane = 0; lane < count; lane++) {
+		const FragmentSW& fragment = fragments[lane];
+		inputs[(ShaderSlotsSW::FragmentCoord + 0) * cShaderLanes + lane] = fragment.mX + 0.5f;
+		inputs[(ShaderSlotsSW::FragmentCoord + 1) * cShaderLanes + lane] = fragment.mY + 0.5f;
+		inputs[(ShaderSlotsSW::FragmentCoord + 2) * cShaderLanes + lane] = fragment.mDepth;
+		inputs[(ShaderSlotsSW::FragmentCoord + 3) * cShaderLanes + lane] = fragment.mInvW;
+		inputs[ShaderSlotsSW::FragmentFrontFacing * cShaderLanes + lane] = triangle.mFrontFacing ? 1.0f : 0.0f;
+		for (uint32_t n = 0; n < drawState.mVaryingsCount; n++) {
+			inputs[(ShaderSlotsSW::FragmentVaryings + n) * cShaderLanes + lane] = fragment.mVaryings[n];
+		}
+	}
+
+	uint32_t written = machine.Run((1u << count) - 1, drawState.mTextures);
+	const float* outputs = machine.GetOutputs();
+	for (uint32_t lane = 0; lane < count; lane++) {
+		if (written & (1u << lane)) {
+			float color[4];
+			for (uint32_t n = 0; n < 4; n++) {
+				color[n] = outputs[(ShaderSlotsSW::FragmentColor + n) * cShaderLanes + lane];
+			}
+			WriteFragment(drawState.mPipeline, fragments[lane], color);
+		}
+	}
+}
+
+// stencil operations, depth write, blending and color mask of a shaded fragment
+void RasterizerSW::WriteFragment(const PipelineStateSW& pipeline, const FragmentSW& fragment, float color[4]) {
+	uint32_t index = fragment.mIndex;
+	bool depthPass = fragment.mDepthPass;
+	if (pipeline.mEnabled[RendererStateType::Stencil]) {
+		uint8_t stencil = mStencil[index];
+		uint8_t reference = static_cast<uint8_t>(pipeline.mStencilRef);
+		uint32_t readMask = pipeline.mStencilReadMask;
+		StencilOpTypes::Enum op = pipeline.mDepthPass;
+		bool stencilPass = CompareFunc(pipeline.mStencilFunc, reference & readMask, stencil & readMask);
+		if (!stencilPass) {
+			op = pipeline.mStencilFail;
+		} else if (!depthPass) {
+			op = pipeline.mDepthFail;
+		}
+		uint8_t writeMask = static_cast<uint8_t>(pipeline.mStencilWriteMask);
+		mStencil[index] = (stencil & ~writeMask) | (StencilOp(op, stencil, reference) & writeMask);
+		if (!stencilPass || !depthPass) {
+			return;
+		}
+	}
+
+	if (pipeline.mEnabled[RendererStateType::DepthTest] && pipeline.mDepthWrite) {
+		mDepth[index] = fragment.mDepth;
+	}
+
+	uint8_t* destination = reinterpret_cast<uint8_t*>(&mColor[index]);
+	if (pipeline.mEnabled[RendererStateType::Blend]) {
+		float dst[4];
+		for (uint32_t n = 0; n < 4; n++) {
+			color[n] = std::min(std::max(color[n], 0.0f), 1.0f);
+			dst[n] = destination[n] * (1.0f / 255.0f);
+		}
+		float srcFactor[4];
+		float dstFactor[4];
+		BlendFactor(pipeline.mSrcFactor, color, dst, pipeline.mBlendColor, srcFactor);
+		BlendFactor(pipeline.mDstFactor, color, dst, pipeline.mBlendColor, dstFactor);
+		for (uint32_t n = 0; n < 4; n++) {
+			color[n] = color[n] * srcFactor[n] + dst[n] * dstFactor[n];
+		}
+	}
+	for (uint32_t n = 0; n < 4; n++) {
+		if (pipeline.mColorMask & (1 << n)) {
+			destination[n] = ToUnorm8(color[n]);
+		}
+	}
+}
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "GraphicsTypes.h"
+#include "ShaderBytecodeSW.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tinyngine
+{
+
+// Fixed function state of a draw, mirrors what the GL device tracks through SetState and the render states.
+struct PipelineStateSW {
+	bool mEnabled[RendererStateType::Count] = {};
+	BlendFuncs::Enum mSrcFactor = BlendFuncs::One;
+	BlendFuncs::Enum mDstFactor = BlendFuncs::Zero;
+	float mBlendColor[4] = {};
+	DepthFuncs::Enum mDepthFunc = DepthFuncs::Less;
+	bool mDepthWrite = true;
+	StencilFuncs::Enum mStencilFunc = StencilFuncs::Always;
+	int32_t mStencilRef = 0;
+	uint32_t mStencilReadMask = UINT32_MAX;
+	uint32_t mStencilWriteMask = UINT32_MAX;
+	StencilOpTypes::Enum mStencilFail = StencilOpTypes::Keep;
+	StencilOpTypes::Enum mDepthFail = StencilOpTypes::Keep;
+	StencilOpTypes::Enum mDepthPass = StencilOpTypes::Keep;
+	CullFaceModes::Enum mCullMode = CullFaceModes::Back;
+	WindingModes::Enum mWinding = WindingModes::CounterClockWise;
+	float mPolygonOffsetFactor = 0.0f;
+	float mPolygonOffsetUnits = 0.0f;
+	uint8_t mColorMask = ColorMask::All;
+};
+
+struct DrawStateSW {
+	PipelineStateSW mPipeline;
+	const SoftwareFragmentStage* mFragmentStage = nullptr;
+	const ShaderBytecodeSW* mFragmentCode = nullptr; // compiled stage, used instead of mFragmentStage when set
+	uint32_t mVaryingsCount = 0;
+	uint32_t mUniformsOffset = 0;
+	const SoftwareTexture* mTextures[cMaxSoftwareTextureStages] = {};
+	int32_t mViewport[4] = {};
+};
+
+// output of the vertex stage, in clip space
+struct ClipVertexSW {
+	float mPosition[4];
+	float mVaryings[cMaxSoftwareVaryings];
+};
+
+// Tiled rasterizer: triangles are clipped, set up and binned to the screen tiles they touch as they are submitted,
+// Flush then rasterizes the tiles on a pool of worker threads. A tile is owned by a single thread, so the commands
+// of a tile run in submission order and need no synchronization. The render target is bottom-up like GL.
+class RasterizerSW final {
+public:
+	static constexpr uint32_t cTileSize = 64;
+
+	RasterizerSW();
+	~RasterizerSW();
+
+	RasterizerSW(const RasterizerSW& other) = delete;
+	RasterizerSW& operator=(const RasterizerSW& other) = delete;
+
+	// content is lost, pending work is flushed first
+	void Resize(uint32_t width, uint32_t height);
+
+	inline uint32_t GetWidth() const { return mWidth; }
+	inline uint32_t GetHeight() const { return mHeight; }
+	inline bool HasPendingWork() const { return mCommandsCount > 0; }
+
+	void Clear(uint8_t flags, const float color[4], float depth, uint8_t stencil, uint8_t colorMask, bool depthMask, uint8_t stencilMask);
+
+	// the uniforms are copied, the fragment stage or code and the textures must stay alive until the next Flush
+	uint32_t AddDrawState(const DrawStateSW& state, const float* uniforms, uint32_t uniformsCount);
+	void DrawTriangle(uint32_t drawStateIndex, const ClipVertexSW& v0, const ClipVertexSW& v1, const ClipVertexSW& v2);
+
+	void Flush();
+
+	// RGBA8, rows bottom to top like glReadPixels
+	void ReadPixels(uint32_t x, uint32_t y, uint32_t width, uint32_t height, void* rgba);
+
+	inline uint32_t GetWorkersCount() const { return static_cast<uint32_t>(mWorkers.size()) + 1; }
+
+private:
+	struct ClearSW {
+		uint8_t mFlags;
+		uint8_t mColor[4];
+		float mDepth;
+		uint8_t mStencil;
+		uint8_t mColorMask;
+		bool mDepthMask;
+		uint8_t mStencilMask;
+	};
+
+	struct TriangleSW {
+		float mX[3]; // window coordinates snapped to the sub-pixel grid
+		float mY[3];
+		float mZ[3]; // window depth, polygon offset applied
+		float mInvW[3];
+		float mArea;
+		uint32_t mVaryingsOffset; // 3 vertices of varyings premultiplied by 1 / w
+		uint32_t mDrawState;
+		int32_t mMinX;
+		int32_t mMinY;
+		int32_t mMaxX;
+		int32_t mMaxY;
+		bool mFrontFacing;
+	};
+
+	struct FragmentSW {
+		uint32_t mIndex;
+		int32_t mX;
+		int32_t mY;
+		float mDepth;
+		float mInvW;
+		bool mDepthPass;
+		float mVaryings[cMaxSoftwareVaryings];
+	};
+
+	void SetupTriangle(uint32_t drawStateIndex, const ClipVertexSW* const* vertices);
+	void BinCommand(uint32_t command, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY);
+
+	void WorkerFunc(uint32_t index);
+	void RunTiles();
+	void RasterTile(uint32_t tileIndex, ShaderMachineSW& machine);
+	void ClearTile(const ClearSW& clear, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY);
+	void RasterTriangle(const TriangleSW& triangle, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY, ShaderMachineSW& machine);
+	bool SetupFragment(const TriangleSW& triangle, const DrawStateSW& drawState, int32_t x, int32_t y, const float* edges, FragmentSW& fragment) const;
+	void ShadePixel(const TriangleSW& triangle, const DrawStateSW& drawState, int32_t x, int32_t y, const float* edges);
+	void ShadeBatch(const TriangleSW& triangle, const DrawStateSW& drawState, const FragmentSW* fragments, uint32_t count, ShaderMachineSW& machine);
+	void WriteFragment(const PipelineStateSW& pipeline, const FragmentSW& fragment, float color[4]);
+
+private:
+	uint32_t mWidth = 0;
+	uint32_t mHeight = 0;
+	uint32_t mTilesX = 0;
+	uint32_t mTilesY = 0;
+	std::vector<uint32_t> mColor;
+	std::vector<float> mDepth;
+	std::vector<uint8_t> mStencil;
+
+	std::vector<std::vector<uint32_t>> mBins;
+	std::vector<ClearSW> mClears;
+	std::vector<TriangleSW> mTriangles;
+	std::vector<DrawStateSW> mDrawStates;
+	std::vector<float> mVaryings;
+	std::vector<float> mUniforms;
+	uint32_t mCommandsCount = 0;
+
+	std::vector<std::thread> mWorkers;
+	std::mutex mMutex;
+	std::condition_variable mWorkCondition;
+	std::condition_variable mDoneCondition;
+	uint64_t mGeneration = 0;
+	uint32_t mActiveWorkers = 0;
+	bool mExit = false;
+	std::atomic<uint32_t> mNextTile{ 0 };
+};
+
+} // namespace tinyngine
\ No newline at end of file
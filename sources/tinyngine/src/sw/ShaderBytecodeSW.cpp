@@ -0,0 +1,120 @@
+#include "ShaderBytecodeSW.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+using tinyngine::cShaderLanes;
+
+// Every operation is a fixed length loop over the lanes, left to the compiler to turn into SSE or AVX code.
+template<typename Func>
+inline void Unary(float* d, const float* a, Func func) {
+	for (uint32_t lane = 0; lane < cShaderLanes; lane++) {
+		d[lane] = func(a[lane]);
+	}
+}
+
+template<typename Func>
+inline void Binary(float* d, const float* a, const float* b, Func func) {
+	for (uint32_t lane = 0; lane < cShaderLanes; lane++) {
+		d[lane] = func(a[lane], b[lane]);
+	}
+}
+
+}
+
+namespace tinyngine
+{
+
+void ShaderMachineSW::Bind(const ShaderBytecodeSW* code, const float* uniforms) {
+	mCode = code;
+	mUniforms = uniforms;
+	mRegisters.resize(code->mRegistersCount * cShaderLanes);
+	mInputs.resize(std::max(code->mInputSlotsCount, 1u) * cShaderLanes);
+	mOutputs.resize(std::max(code->mOutputSlotsCount, 1u) * cShaderLanes);
+	for (const auto& constant : code->mConstants) {
+		std::fill_n(Register(constant.mRegister), cShaderLanes, constant.mValue);
+	}
+	for (const auto& uniform : code->mUniforms) {
+		std::fill_n(Register(uniform.mRegister), cShaderLanes, uniforms != nullptr ? uniforms[uniform.mSlot] : 0.0f);
+	}
+}
+
+uint32_t ShaderMachineSW::Run(uint32_t lanesMask, const SoftwareTexture* const* textures) {
+	for (const auto& input : mCode->mInputs) {
+		std::copy_n(&mInputs[input.mSlot * cShaderLanes], cShaderLanes, Register(input.mRegister));
+	}
+
+	uint32_t killed = 0;
+	for (const auto& instruction : mCode->mInstructions) {
+		float* d = Register(instruction.mDst);
+		const float* a = Register(instruction.mA);
+		const float* b = Register(instruction.mB);
+		const float* c = Register(instruction.mC);
+		switch (instruction.mOp) {
+		case ShaderOpSW::Mov: std::copy_n(a, cShaderLanes, d); break;
+		case ShaderOpSW::Add: Binary(d, a, b, [](float x, float y) { return x + y; }); break;
+		case ShaderOpSW::Sub: Binary(d, a, b, [](float x, float y) { return x - y; }); break;
+		case ShaderOpSW::Mul: Binary(d, a, b, [](float x, float y) { return x * y; }); break;
+		case ShaderOpSW::Div: Binary(d, a, b, [](float x, float y) { return x / y; }); break;
+		case ShaderOpSW::Mad:
+			for (uint32_t lane = 0; lane < cShaderLanes; lane++) {
+				d[lane] = a[lane] * b[lane] + c[lane];
+			}
+			break;
+		case ShaderOpSW::Min: Binary(d, a, b, [](float x, float y) { return y < x ? y : x; }); break;
+		case ShaderOpSW::Max: Binary(d, a, b, [](float x, float y) { return x < y ? y : x; }); break;
+		case ShaderOpSW::Abs: Unary(d, a, [](float x) { return std::fabs(x); }); break;
+		case ShaderOpSW::Sign: Unary(d, a, [](float x) { return x > 0.0f ? 1.0f : (x < 0.0f ? -1.0f : 0.0f); }); break;
+		case ShaderOpSW::Floor: Unary(d, a, [](float x) { return std::floor(x); }); break;
+		case ShaderOpSW::Sqrt: Unary(d, a, [](float x) { return std::sqrt(x); }); break;
+		case ShaderOpSW::Rsqrt: Unary(d, a, [](float x) { return 1.0f / std::sqrt(x); }); break;
+		case ShaderOpSW::Pow: Binary(d, a, b, [](float x, float y) { return std::pow(x, y); }); break;
+		case ShaderOpSW::Exp2: Unary(d, a, [](float x) { return std::exp2(x); }); break;
+		case ShaderOpSW::Log2: Unary(d, a, [](float x) { return std::log2(x); }); break;
+		case ShaderOpSW::Sin: Unary(d, a, [](float x) { return std::sin(x); }); break;
+		case ShaderOpSW::Cos: Unary(d, a, [](float x) { return std::cos(x); }); break;
+		case ShaderOpSW::Atan2: Binary(d, a, b, [](float x, float y) { return std::atan2(x, y); }); break;
+		case ShaderOpSW::Lt: Binary(d, a, b, [](float x, float y) { return x < y ? 1.0f : 0.0f; }); break;
+		case ShaderOpSW::Le: Binary(d, a, b, [](float x, float y) { return x <= y ? 1.0f : 0.0f; }); break;
+		case ShaderOpSW::Eq: Binary(d, a, b, [](float x, float y) { return x == y ? 1.0f : 0.0f; }); break;
+		case ShaderOpSW::Ne: Binary(d, a, b, [](float x, float y) { return x != y ? 1.0f : 0.0f; }); break;
+		case ShaderOpSW::Select:
+			for (uint32_t lane = 0; lane < cShaderLanes; lane++) {
+				d[lane] = a[lane] != 0.0f ? b[lane] : c[lane];
+			}
+			break;
+		case ShaderOpSW::Kill:
+			for (uint32_t lane = 0; lane < cShaderLanes; lane++) {
+				killed |= a[lane] != 0.0f ? (1u << lane) : 0;
+			}
+			break;
+		case ShaderOpSW::Tex: {
+			// sampling is scalar, inactive lanes may hold garbage coordinates and are skipped
+			uint32_t stage = static_cast<uint32_t>(c[0]);
+			const SoftwareTexture* texture = stage < cMaxSoftwareTextureStages ? textures[stage] : nullptr;
+			for (uint32_t lane = 0; lane < cShaderLanes; lane++) {
+				float rgba[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+				if (lanesMask & (1u << lane)) {
+					SampleSoftwareTexture(texture, a[lane], b[lane], rgba);
+				}
+				for (uint32_t n = 0; n < 4; n++) {
+					d[n * cShaderLanes + lane] = rgba[n];
+				}
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	for (const auto& output : mCode->mOutputs) {
+		std::copy_n(Register(output.mRegister), cShaderLanes, &mOutputs[output.mSlot * cShaderLanes]);
+	}
+	return lanesMask & ~killed;
+}
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "SoftwareShader.h"
+
+#include <vector>
+
+namespace tinyngine
+{
+
+// vertices or fragments run by a single pass over the bytecode
+static constexpr uint32_t cShaderLanes = 8;
+
+// Input and output slots of the compiled stages, one float each.
+struct ShaderSlotsSW {
+	enum Enum : uint16_t {
+		VertexAttributes = 0, // attribute * 4 + component
+		VertexPosition = 0, // outputs, then the varyings
+		VertexVaryings = 4,
+		FragmentCoord = 0, // inputs, gl_FragCoord, gl_FrontFacing, then the varyings
+		FragmentFrontFacing = 4,
+		FragmentVaryings = 5,
+		FragmentColor = 0 // outputs
+	};
+};
+
+// Scalar instructions over registers of cShaderLanes floats: vector and matrix operations of the source are
+// broken down to components by the compiler. Booleans are 0 or 1.
+struct ShaderOpSW {
+	enum Enum : uint8_t {
+		Mov, // d = a
+		Add,
+		Sub,
+		Mul,
+		Div,
+		Mad, // d = a * b + c
+		Min,
+		Max,
+		Abs,
+		Sign,
+		Floor,
+		Sqrt,
+		Rsqrt,
+		Pow,
+		Exp2,
+		Log2,
+		Sin,
+		Cos,
+		Atan2, // d = atan(a, b)
+		Lt, // d = a < b
+		Le,
+		Eq,
+		Ne,
+		Select, // d = a != 0 ? b : c
+		Kill, // discards the lanes where a != 0
+		Tex, // d..d+3 = texture2D(sampler c, vec2(a, b)), c holds the texture stage
+		Count
+	};
+};
+
+struct ShaderInstructionSW {
+	ShaderOpSW::Enum mOp;
+	uint16_t mDst;
+	uint16_t mA;
+	uint16_t mB;
+	uint16_t mC;
+};
+
+struct ShaderBindingSW {
+	uint16_t mRegister;
+	uint16_t mSlot; // input or output slot, or float offset in the uniform storage of the program
+};
+
+struct ShaderConstantSW {
+	uint16_t mRegister;
+	float mValue;
+};
+
+struct ShaderBytecodeSW {
+	std::vector<ShaderInstructionSW> mInstructions;
+	std::vector<ShaderConstantSW> mConstants;
+	std::vector<ShaderBindingSW> mUniforms;
+	std::vector<ShaderBindingSW> mInputs;
+	std::vector<ShaderBindingSW> mOutputs;
+	uint32_t mRegistersCount = 0;
+	uint32_t mInputSlotsCount = 0;
+	uint32_t mOutputSlotsCount = 0;
+};
+
+// Register file of one thread, inputs and outputs are laid out slot major: [slot * cShaderLanes + lane].
+class ShaderMachineSW final {
+public:
+	ShaderMachineSW() = default;
+
+	ShaderMachineSW(const ShaderMachineSW& other) = delete;
+	ShaderMachineSW& operator=(const ShaderMachineSW& other) = delete;
+
+	// loads the constants and the uniforms, the bytecode and the uniforms must outlive the following runs
+	void Bind(const ShaderBytecodeSW* code, const float* uniforms);
+	inline bool IsBound(const ShaderBytecodeSW* code, const float* uniforms) const { return mCode == code && mUniforms == uniforms; }
+
+	inline float* GetInputs() { return mInputs.data(); }
+	inline const float* GetOutputs() const { return mOutputs.data(); }
+
+	// returns the lanes of lanesMask that were not discarded
+	uint32_t Run(uint32_t lanesMask, const SoftwareTexture* const* textures);
+
+private:
+	inline float* Register(uint16_t index) { return &mRegisters[index * cShaderLanes]; }
+
+private:
+	const ShaderBytecodeSW* mCode = nullptr;
+	const float* mUniforms = nullptr;
+	std::vector<float> mRegisters;
+	std::vector<float> mInputs;
+	std::vector<float> mOutputs;
+};
+
+} // namespace tinyngine
\ No newline at end of file
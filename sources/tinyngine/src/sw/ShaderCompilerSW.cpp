@@ -0,0 +1,2458 @@
+#include "ShaderCompilerSW.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+
+using tinyngine::Attributes;
+using tinyngine::ShaderBindingSW;
+using tinyngine::ShaderBytecodeSW;
+using tinyngine::ShaderInstructionSW;
+using tinyngine::ShaderOpSW;
+using tinyngine::ShaderSlotsSW;
+using tinyngine::ShaderType;
+using tinyngine::UniformType;
+
+static constexpr uint16_t cNoRegister = UINT16_MAX;
+static constexpr uint32_t cMaxComponents = 16;
+static constexpr uint32_t cMaxInlineDepth = 32;
+static constexpr uint32_t cMaxMacroDepth = 32;
+static constexpr float cPi = 3.14159265358979f;
+
+// names bound by the GL device, see GLApi.cpp
+static const char* cAttributeNames[] = {
+	"a_position",
+	"a_normal",
+	"a_tangent",
+	"a_bitangent",
+	"a_color0",
+	"a_color1",
+	"a_texcoord0",
+	"a_texcoord1",
+	"a_texcoord2",
+	"a_texcoord3"
+};
+static_assert(sizeof(cAttributeNames) / sizeof(cAttributeNames[0]) == Attributes::Count, "Missing attribute names");
+
+// longest first, the lexer takes the first match
+static const char* cPunctuators[] = {
+	"++", "--", "+=", "-=", "*=", "/=", "==", "!=", "<=", ">=", "&&", "||", "^^",
+	"+", "-", "*", "/", "%", "<", ">", "=", "!", "~", "&", "|", "^", "(", ")", "[", "]", "{", "}", ".", ",", ";", "?", ":", "#"
+};
+
+// operands read by each instruction, in ShaderOpSW order
+static const uint8_t cOperandsCount[] = {
+	1, 2, 2, 2, 2, 3, 2, 2, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 2, 2, 2, 2, 2, 3, 1, 3
+};
+static_assert(sizeof(cOperandsCount) == ShaderOpSW::Count, "Missing operand counts");
+
+struct TokenType {
+	enum Enum {
+		Identifier,
+		Number,
+		Punctuation,
+		End
+	};
+};
+
+struct Token {
+	TokenType::Enum mType;
+	std::string mText;
+	float mValue;
+	bool mInteger;
+	uint32_t mLine;
+};
+
+// int and bool vectors share the float vector types, every value is stored as floats
+struct GlslType {
+	enum Enum {
+		Void,
+		Bool,
+		Int,
+		Float,
+		Vec2,
+		Vec3,
+		Vec4,
+		Mat2,
+		Mat3,
+		Mat4,
+		Sampler2D,
+		Count
+	};
+};
+
+static const uint32_t cComponents[GlslType::Count] = { 0, 1, 1, 1, 2, 3, 4, 4, 9, 16, 1 };
+
+static const UniformType::Enum cUniformTypes[GlslType::Count] = {
+	UniformType::Float,
+	UniformType::Bool,
+	UniformType::Int,
+	UniformType::Float,
+	UniformType::Float2,
+	UniformType::Float3,
+	UniformType::Float4,
+	UniformType::Mat2,
+	UniformType::Mat3,
+	UniformType::Mat4,
+	UniformType::Sampler2D
+};
+
+struct TypeName {
+	const char* mName;
+	GlslType::Enum mType;
+};
+
+static const TypeName cTypeNames[] = {
+	{ "void", GlslType::Void },
+	{ "bool", GlslType::Bool },
+	{ "int", GlslType::Int },
+	{ "float", GlslType::Float },
+	{ "vec2", GlslType::Vec2 },
+	{ "vec3", GlslType::Vec3 },
+	{ "vec4", GlslType::Vec4 },
+	{ "bvec2", GlslType::Vec2 },
+	{ "bvec3", GlslType::Vec3 },
+	{ "bvec4", GlslType::Vec4 },
+	{ "ivec2", GlslType::Vec2 },
+	{ "ivec3", GlslType::Vec3 },
+	{ "ivec4", GlslType::Vec4 },
+	{ "mat2", GlslType::Mat2 },
+	{ "mat3", GlslType::Mat3 },
+	{ "mat4", GlslType::Mat4 },
+	{ "sampler2D", GlslType::Sampler2D }
+};
+
+inline bool FindTypeName(const std::string& name, GlslType::Enum& type) {
+	for (const TypeName& typeName : cTypeNames) {
+		if (name == typeName.mName) {
+			type = typeName.mType;
+			return true;
+		}
+	}
+	return false;
+}
+
+inline bool IsVector(GlslType::Enum type) {
+	return type >= GlslType::Vec2 && type <= GlslType::Vec4;
+}
+
+inline bool IsMatrix(GlslType::Enum type) {
+	return type >= GlslType::Mat2 && type <= GlslType::Mat4;
+}
+
+inline uint32_t MatrixSize(GlslType::Enum type) {
+	return static_cast<uint32_t>(type - GlslType::Mat2) + 2;
+}
+
+inline GlslType::Enum VectorType(uint32_t components) {
+	return components <= 1 ? GlslType::Float : static_cast<GlslType::Enum>(GlslType::Vec2 + components - 2);
+}
+
+inline bool IsIdentifierChar(char c) {
+	return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_';
+}
+
+// same semantic as ShaderMachineSW::Run, used to fold constant expressions
+float EvaluateOp(ShaderOpSW::Enum op, float a, float b, float c) {
+	switch (op) {
+	case ShaderOpSW::Mov: return a;
+	case ShaderOpSW::Add: return a + b;
+	case ShaderOpSW::Sub: return a - b;
+	case ShaderOpSW::Mul: return a * b;
+	case ShaderOpSW::Div: return a / b;
+	case ShaderOpSW::Mad: return a * b + c;
+	case ShaderOpSW::Min: return b < a ? b : a;
+	case ShaderOpSW::Max: return a < b ? b : a;
+	case ShaderOpSW::Abs: return std::fabs(a);
+	case ShaderOpSW::Sign: return a > 0.0f ? 1.0f : (a < 0.0f ? -1.0f : 0.0f);
+	case ShaderOpSW::Floor: return std::floor(a);
+	case ShaderOpSW::Sqrt: return std::sqrt(a);
+	case ShaderOpSW::Rsqrt: return 1.0f / std::sqrt(a);
+	case ShaderOpSW::Pow: return std::pow(a, b);
+	case ShaderOpSW::Exp2: return std::exp2(a);
+	case ShaderOpSW::Log2: return std::log2(a);
+	case ShaderOpSW::Sin: return std::sin(a);
+	case ShaderOpSW::Cos: return std::cos(a);
+	case ShaderOpSW::Atan2: return std::atan2(a, b);
+	case ShaderOpSW::Lt: return a < b ? 1.0f : 0.0f;
+	case ShaderOpSW::Le: return a <= b ? 1.0f : 0.0f;
+	case ShaderOpSW::Eq: return a == b ? 1.0f : 0.0f;
+	case ShaderOpSW::Ne: return a != b ? 1.0f : 0.0f;
+	case ShaderOpSW::Select: return a != 0.0f ? b : c;
+	default: return 0.0f;
+	}
+}
+
+bool LexLine(const std::string& line, uint32_t lineNumber, std::vector<Token>& tokens, std::string& error) {
+	size_t n = 0;
+	while (n < line.size()) {
+		char c = line[n];
+		if (std::isspace(static_cast<unsigned char>(c))) {
+			n++;
+			continue;
+		}
+		Token token = {};
+		token.mLine = lineNumber;
+		if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+			size_t start = n;
+			while (n < line.size() && IsIdentifierChar(line[n])) {
+				n++;
+			}
+			token.mType = TokenType::Identifier;
+			token.mText = line.substr(start, n - start);
+		} else if (std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && n + 1 < line.size() && std::isdigit(static_cast<unsigned char>(line[n + 1])))) {
+			const char* begin = line.c_str() + n;
+			char* end = nullptr;
+			if (c == '0' && (line[n + 1] == 'x' || line[n + 1] == 'X')) {
+				token.mValue = static_cast<float>(std::strtoul(begin, &end, 16));
+				token.mInteger = true;
+			} else {
+				token.mValue = std::strtof(begin, &end);
+				token.mInteger = std::none_of(begin, static_cast<const char*>(end), [](char digit) { return digit == '.' || digit == 'e' || digit == 'E'; });
+			}
+			size_t length = static_cast<size_t>(end - begin);
+			token.mType = TokenType::Number;
+			token.mText.assign(begin, length);
+			n += length;
+			if (n < line.size() && (IsIdentifierChar(line[n]) || line[n] == '.')) {
+				error = "invalid number '" + token.mText + line[n] + "'";
+				return false;
+			}
+		} else {
+			const char* match = nullptr;
+			for (const char* punctuator : cPunctuators) {
+				if (line.compare(n, std::strlen(punctuator), punctuator) == 0) {
+					match = punctuator;
+					break;
+				}
+			}
+			if (match == nullptr) {
+				error = std::string("unexpected character '") + c + "'";
+				return false;
+			}
+			token.mType = TokenType::Punctuation;
+			token.mText = match;
+			n += token.mText.size();
+		}
+		tokens.push_back(token);
+	}
+	return true;
+}
+
+using MacroMap = std::unordered_map<std::string, std::vector<Token>>;
+
+// Integer expression of #if and #elif. Identifiers that are not macros evaluate to 0 as in C.
+class ConditionSW final {
+public:
+	ConditionSW(const std::vector<Token>& tokens, size_t first, const MacroMap& macros) : mTokens(tokens), mPos(first), mMacros(macros) {}
+
+	bool Evaluate(int32_t& value) {
+		value = Or();
+		return !mFailed && mPos == mTokens.size();
+	}
+
+private:
+	bool Accept(const char* text) {
+		if (mPos < mTokens.size() && mTokens[mPos].mType == TokenType::Punctuation && mTokens[mPos].mText == text) {
+			mPos++;
+			return true;
+		}
+		return false;
+	}
+
+	int32_t Or() {
+		int32_t value = And();
+		while (Accept("||")) {
+			int32_t rhs = And();
+			value = (value != 0 || rhs != 0) ? 1 : 0;
+		}
+		return value;
+	}
+
+	int32_t And() {
+		int32_t value = Equality();
+		while (Accept("&&")) {
+			int32_t rhs = Equality();
+			value = (value != 0 && rhs != 0) ? 1 : 0;
+		}
+		return value;
+	}
+
+	int32_t Equality() {
+		int32_t value = Relational();
+		for (;;) {
+			if (Accept("==")) {
+				value = value == Relational() ? 1 : 0;
+			} else if (Accept("!=")) {
+				value = value != Relational() ? 1 : 0;
+			} else {
+				return value;
+			}
+		}
+	}
+
+	int32_t Relational() {
+		int32_t value = Additive();
+		for (;;) {
+			if (Accept("<=")) {
+				value = value <= Additive() ? 1 : 0;
+			} else if (Accept(">=")) {
+				value = value >= Additive() ? 1 : 0;
+			} else if (Accept("<")) {
+				value = value < Additive() ? 1 : 0;
+			} else if (Accept(">")) {
+				value = value > Additive() ? 1 : 0;
+			} else {
+				return value;
+			}
+		}
+	}
+
+	int32_t Additive() {
+		int32_t value = Unary();
+		for (;;) {
+			if (Accept("+")) {
+				value += Unary();
+			} else if (Accept("-")) {
+				value -= Unary();
+			} else {
+				return value;
+			}
+		}
+	}
+
+	int32_t Unary() {
+		if (Accept("!")) {
+			return Unary() == 0 ? 1 : 0;
+		}
+		if (Accept("-")) {
+			return -Unary();
+		}
+		if (Accept("+")) {
+			return Unary();
+		}
+		return Primary();
+	}
+
+	int32_t Primary() {
+		if (mPos >= mTokens.size()) {
+			mFailed = true;
+			return 0;
+		}
+		if (Accept("(")) {
+			int32_t value = Or();
+			mFailed |= !Accept(")");
+			return value;
+		}
+		const Token& token = mTokens[mPos++];
+		if (token.mType == TokenType::Number) {
+			return static_cast<int32_t>(token.mValue);
+		}
+		if (token.mType != TokenType::Identifier) {
+			mFailed = true;
+			return 0;
+		}
+		if (token.mText == "defined") {
+			bool parenthesis = Accept("(");
+			if (mPos >= mTokens.size() || mTokens[mPos].mType != TokenType::Identifier) {
+				mFailed = true;
+				return 0;
+			}
+			int32_t value = mMacros.count(mTokens[mPos++].mText) != 0 ? 1 : 0;
+			mFailed |= parenthesis && !Accept(")");
+			return value;
+		}
+		auto macro = mMacros.find(token.mText);
+		if (macro != mMacros.end() && macro->second.size() == 1 && macro->second[0].mType == TokenType::Number) {
+			return static_cast<int32_t>(macro->second[0].mValue);
+		}
+		return 0;
+	}
+
+private:
+	const std::vector<Token>& mTokens;
+	size_t mPos;
+	const MacroMap& mMacros;
+	bool mFailed = false;
+};
+
+// Strips the comments, runs the directives and expands the object-like macros.
+class PreprocessorSW final {
+public:
+	bool Run(const char* source, ShaderType::Enum type, std::vector<Token>& tokens, std::string& error);
+
+private:
+	struct ConditionalSW {
+		bool mActive;
+		bool mTaken;
+		bool mParentActive;
+	};
+
+	inline bool IsActive() const { return mConditionals.empty() || mConditionals.back().mActive; }
+	void Define(const char* name, int32_t value);
+	bool Directive(const std::vector<Token>& line, const std::string& text, std::string& error);
+	void Expand(const Token& token, uint32_t line, std::vector<Token>& output, uint32_t depth) const;
+
+private:
+	MacroMap mMacros;
+	std::vector<ConditionalSW> mConditionals;
+};
+
+void PreprocessorSW::Define(const char* name, int32_t value) {
+	Token token = {};
+	token.mType = TokenType::Number;
+	token.mText = std::to_string(value);
+	token.mValue = static_cast<float>(value);
+	token.mInteger = true;
+	mMacros[name] = std::vector<Token>(1, token);
+}
+
+bool PreprocessorSW::Run(const char* source, ShaderType::Enum type, std::vector<Token>& tokens, std::string& error) {
+	Define("GL_ES", 1);
+	Define("__VERSION__", 100);
+	if (type == ShaderType::FragmentProgram) {
+		Define("GL_FRAGMENT_PRECISION_HIGH", 1);
+	}
+
+	// comments become a space, their newlines are kept for the line numbers of the errors
+	std::string text;
+	text.reserve(std::strlen(source));
+	for (const char* c = source; *c; c++) {
+		if (c[0] == '/' && c[1] == '/') {
+			while (*c && *c != '\n') {
+				c++;
+			}
+			if (*c == '\0') {
+				break;
+			}
+			text += '\n';
+		} else if (c[0] == '/' && c[1] == '*') {
+			for (c += 2; *c && !(c[0] == '*' && c[1] == '/'); c++) {
+				if (*c == '\n') {
+					text += '\n';
+				}
+			}
+			if (*c == '\0') {
+				error = "unterminated comment";
+				return false;
+			}
+			c++;
+			text += ' ';
+		} else {
+			text += *c;
+		}
+	}
+
+	uint32_t lineNumber = 0;
+	for (size_t start = 0; start <= text.size(); ) {
+		size_t end = std::min(text.find('\n', start), text.size());
+		std::string line = text.substr(start, end - start);
+		start = end + 1;
+		lineNumber++;
+
+		std::vector<Token> lineTokens;
+		size_t first = line.find_first_not_of(" \t\r");
+		bool directive = first != std::string::npos && line[first] == '#';
+		if (!directive && !IsActive()) {
+			continue;
+		}
+		std::string content = directive ? line.substr(first + 1) : line;
+		if (!LexLine(content, lineNumber, lineTokens, error) || (directive && !Directive(lineTokens, content, error))) {
+			error = "line " + std::to_string(lineNumber) + ": " + error;
+			return false;
+		}
+		if (!directive) {
+			for (const Token& token : lineTokens) {
+				Expand(token, lineNumber, tokens, 0);
+			}
+		}
+	}
+	if (!mConditionals.empty()) {
+		error = "missing #endif";
+		return false;
+	}
+
+	Token end = {};
+	end.mType = TokenType::End;
+	end.mText = "end of source";
+	end.mLine = lineNumber;
+	tokens.push_back(end);
+	return true;
+}
+
+bool PreprocessorSW::Directive(const std::vector<Token>& line, const std::string& text, std::string& error) {
+	if (line.empty()) {
+		return true;
+	}
+	const std::string& name = line[0].mText;
+	if (name == "ifdef" || name == "ifndef") {
+		if (line.size() != 2 || line[1].mType != TokenType::Identifier) {
+			error = "#" + name + " expects a macro name";
+			return false;
+		}
+		bool parent = IsActive();
+		bool active = parent && (mMacros.count(line[1].mText) != 0) == (name == "ifdef");
+		mConditionals.push_back({ active, active, parent });
+		return true;
+	}
+	if (name == "if") {
+		bool parent = IsActive();
+		int32_t value = 0;
+		if (parent && !ConditionSW(line, 1, mMacros).Evaluate(value)) {
+			error = "invalid #if expression";
+			return false;
+		}
+		bool active = parent && value != 0;
+		mConditionals.push_back({ active, active, parent });
+		return true;
+	}
+	if (name == "elif" || name == "else" || name == "endif") {
+		if (mConditionals.empty()) {
+			error = "#" + name + " without #if";
+			return false;
+		}
+		ConditionalSW& conditional = mConditionals.back();
+		if (name == "endif") {
+			mConditionals.pop_back();
+		} else if (name == "else") {
+			conditional.mActive = conditional.mParentActive && !conditional.mTaken;
+			conditional.mTaken = true;
+		} else {
+			int32_t value = 0;
+			bool evaluate = conditional.mParentActive && !conditional.mTaken;
+			if (evaluate && !ConditionSW(line, 1, mMacros).Evaluate(value)) {
+				error = "invalid #elif expression";
+				return false;
+			}
+			conditional.mActive = evaluate && value != 0;
+			conditional.mTaken = conditional.mTaken || conditional.mActive;
+		}
+		return true;
+	}
+	if (!IsActive()) {
+		return true;
+	}
+
+	if (name == "define") {
+		if (line.size() < 2 || line[1].mType != TokenType::Identifier) {
+			error = "#define expects a macro name";
+			return false;
+		}
+		size_t nameEnd = text.find(line[1].mText, text.find("define") + 6) + line[1].mText.size();
+		if (nameEnd < text.size() && text[nameEnd] == '(') {
+			error = "function-like macros are not supported";
+			return false;
+		}
+		mMacros[line[1].mText] = std::vector<Token>(line.begin() + 2, line.end());
+	} else if (name == "undef") {
+		if (line.size() == 2) {
+			mMacros.erase(line[1].mText);
+		}
+	} else if (name == "version") {
+		if (line.size() != 2 || line[1].mValue != 100.0f) {
+			error = "only #version 100 is supported";
+			return false;
+		}
+	} else if (name == "error") {
+		error = "#error";
+		for (size_t n = 1; n < line.size(); n++) {
+			error += " " + line[n].mText;
+		}
+		return false;
+	} else if (name != "extension" && name != "pragma" && name != "line") {
+		error = "unknown directive #" + name;
+		return false;
+	}
+	return true;
+}
+
+void PreprocessorSW::Expand(const Token& token, uint32_t line, std::vector<Token>& output, uint32_t depth) const {
+	auto macro = (token.mType == TokenType::Identifier && depth < cMaxMacroDepth) ? mMacros.find(token.mText) : mMacros.end();
+	if (macro == mMacros.end()) {
+		output.push_back(token);
+		output.back().mLine = line;
+		return;
+	}
+	for (const Token& replacement : macro->second) {
+		Expand(replacement, line, output, depth + 1);
+	}
+}
+
+//=============================================================================
+
+struct QualifierSW {
+	enum Enum {
+		None,
+		Const,
+		Uniform,
+		Attribute,
+		Varying
+	};
+};
+
+struct SymbolSW {
+	GlslType::Enum mType;
+	uint16_t mRegisters[cMaxComponents];
+	bool mWritable;
+};
+
+// Result of an expression: the registers holding each component, in column major order for matrices. Swizzles
+// and constructors only shuffle registers, an l-value designates the registers of a variable.
+struct ValueSW {
+	GlslType::Enum mType;
+	uint16_t mRegisters[cMaxComponents];
+	bool mLValue;
+};
+
+struct InterfaceSW {
+	std::string mName;
+	GlslType::Enum mType;
+	uint16_t mRegisters[cMaxComponents];
+};
+
+struct StageSW {
+	ShaderBytecodeSW mCode;
+	std::vector<InterfaceSW> mUniforms;
+	std::vector<InterfaceSW> mVaryings;
+};
+
+struct ParameterSW {
+	GlslType::Enum mType;
+	std::string mName;
+	bool mIn;
+	bool mOut;
+};
+
+struct FunctionSW {
+	std::string mName;
+	GlslType::Enum mReturnType;
+	std::vector<ParameterSW> mParameters;
+	size_t mBody; // token of the opening brace
+};
+
+// inlined function being compiled
+struct FrameSW {
+	GlslType::Enum mReturnType;
+	uint16_t mReturn[cMaxComponents];
+	bool mReturned;
+	uint16_t mAlive; // lanes that did not return yet, cNoRegister until a return
+	size_t mScopeBase;
+};
+
+// Lanes executing the current statement. The full mask includes the conditions of the callers, the local mask
+// only those of the current function: the return value is only ever read in the lanes that called the function.
+struct MaskSW {
+	uint16_t mFull;
+	uint16_t mLocal;
+};
+
+struct RegisterSW {
+	float mValue;
+	bool mConstant;
+	bool mAdoptable; // temporary only referenced by the expression that computed it
+};
+
+// Single pass compiler: statements are translated as they are parsed, functions are inlined at every call by parsing
+// their body again. Without loops every statement runs once per invocation, branches run both sides under a lane mask
+// and assignments become selects.
+class CompilerSW final {
+public:
+	CompilerSW(ShaderType::Enum type, const std::vector<Token>& tokens, StageSW& stage) : mType(type), mTokens(tokens), mStage(stage) {}
+
+	CompilerSW(const CompilerSW& other) = delete;
+	CompilerSW& operator=(const CompilerSW& other) = delete;
+
+	bool Compile(std::string& error);
+
+private:
+	const Token& Peek(size_t ahead = 0) const;
+	const Token& Next();
+	bool IsToken(const char* text, size_t ahead = 0) const;
+	bool Accept(const char* text);
+	bool Expect(const char* text);
+	bool ExpectIdentifier(std::string& name);
+	void Fail(const std::string& message);
+	bool ParseType(GlslType::Enum& type);
+	void SkipPrecision();
+	void SkipStatement();
+
+	void DeclareBuiltin(const char* name, GlslType::Enum type, bool writable, uint32_t inputSlot, uint32_t outputSlot);
+	void ParseGlobal();
+	void ParseFunction(GlslType::Enum returnType, const std::string& name);
+	void ParseDeclarators(GlslType::Enum type, QualifierSW::Enum qualifier);
+	void Declare(const std::string& name, GlslType::Enum type, QualifierSW::Enum qualifier, const ValueSW* initializer);
+	const SymbolSW* Lookup(const std::string& name) const;
+
+	void ParseStatement();
+	void ParseSubStatement();
+	void ParseBlock();
+	void ParseIf();
+	void ParseReturn();
+	void ParseDiscard();
+
+	ValueSW ParseExpression();
+	ValueSW ParseAssignment();
+	ValueSW ParseConditional();
+	ValueSW ParseBinary(int32_t minPrecedence);
+	ValueSW ParseUnary();
+	ValueSW ParsePostfix();
+	ValueSW ParsePrimary();
+	ValueSW ParseCall(const std::string& name);
+
+	uint16_t NewRegisters(uint32_t count);
+	uint16_t Constant(float value);
+	bool IsConstant(uint16_t reg, float& value) const;
+	void Emit(ShaderOpSW::Enum op, uint16_t d, uint16_t a, uint16_t b = 0, uint16_t c = 0);
+	uint16_t Op(ShaderOpSW::Enum op, uint16_t a, uint16_t b = 0, uint16_t c = 0);
+	uint16_t And(uint16_t a, uint16_t b);
+	uint16_t FullMask();
+	uint16_t LocalMask();
+	void Store(const ValueSW& target, const ValueSW& value, uint16_t mask);
+	void Adopt(const ValueSW& value, uint16_t* registers);
+
+	ValueSW Scalar(uint16_t reg, GlslType::Enum type = GlslType::Float) const;
+	ValueSW Temporary(GlslType::Enum type);
+	ValueSW Copy(const ValueSW& value);
+	ValueSW Map(ShaderOpSW::Enum op, const ValueSW& a);
+	ValueSW Componentwise(ShaderOpSW::Enum op, const ValueSW& a, const ValueSW& b);
+	ValueSW Multiply(const ValueSW& a, const ValueSW& b);
+	ValueSW Truncate(const ValueSW& value);
+	ValueSW Binary(const std::string& op, const ValueSW& a, const ValueSW& b);
+	uint16_t Dot(const uint16_t* a, const uint16_t* b, uint32_t count);
+	uint16_t Dot(const ValueSW& a, const ValueSW& b);
+	ValueSW Swizzle(const ValueSW& value, const std::string& fields);
+	ValueSW Index(const ValueSW& value, const ValueSW& index);
+	ValueSW Construct(GlslType::Enum type, const std::vector<ValueSW>& arguments);
+	ValueSW Sample(const ValueSW& sampler, uint16_t u, uint16_t v);
+	bool CheckArguments(const std::string& name, const std::vector<ValueSW>& arguments, size_t count);
+	bool CallBuiltin(const std::string& name, const std::vector<ValueSW>& arguments, ValueSW& result);
+	const FunctionSW* FindOverload(const std::string& name, const std::vector<ValueSW>& arguments) const;
+	ValueSW CallFunction(const FunctionSW& function, const std::vector<ValueSW>& arguments);
+
+private:
+	ShaderType::Enum mType;
+	const std::vector<Token>& mTokens;
+	size_t mPos = 0;
+	StageSW& mStage;
+
+	std::vector<RegisterSW> mRegisters;
+	std::unordered_map<uint32_t, uint16_t> mConstants; // bits of the value to the register
+	std::unordered_map<uint64_t, uint16_t> mExpressions; // operation to the register holding its result
+	std::vector<std::unordered_map<std::string, SymbolSW>> mScopes;
+	std::unordered_map<std::string, std::vector<FunctionSW>> mFunctions;
+	std::vector<FrameSW> mFrames;
+	std::vector<MaskSW> mMasks;
+
+	bool mFailed = false;
+	std::string mError;
+};
+
+bool CompilerSW::Compile(std::string& error) {
+	mScopes.emplace_back();
+	// register 0 holds 0, unused operands point to it
+	Constant(0.0f);
+	if (mType == ShaderType::VertexProgram) {
+		DeclareBuiltin("gl_Position", GlslType::Vec4, true, cNoRegister, ShaderSlotsSW::VertexPosition);
+		DeclareBuiltin("gl_PointSize", GlslType::Float, true, cNoRegister, cNoRegister);
+	} else {
+		DeclareBuiltin("gl_FragCoord", GlslType::Vec4, false, ShaderSlotsSW::FragmentCoord, cNoRegister);
+		DeclareBuiltin("gl_FrontFacing", GlslType::Bool, false, ShaderSlotsSW::FragmentFrontFacing, cNoRegister);
+		DeclareBuiltin("gl_PointCoord", GlslType::Vec2, false, cNoRegister, cNoRegister);
+		DeclareBuiltin("gl_FragColor", GlslType::Vec4, true, cNoRegister, ShaderSlotsSW::FragmentColor);
+	}
+
+	while (!mFailed && Peek().mType != TokenType::End) {
+		ParseGlobal();
+	}
+
+	if (!mFailed) {
+		const FunctionSW* main = FindOverload("main", std::vector<ValueSW>());
+		if (main == nullptr || main->mReturnType != GlslType::Void) {
+			Fail("missing void main()");
+		} else {
+			CallFunction(*main, std::vector<ValueSW>());
+		}
+	}
+	if (mFailed) {
+		error = mError;
+		return false;
+	}
+
+	mStage.mCode.mRegistersCount = static_cast<uint32_t>(mRegisters.size());
+	for (size_t n = 0; n < mRegisters.size(); n++) {
+		if (mRegisters[n].mConstant) {
+			mStage.mCode.mConstants.push_back({ static_cast<uint16_t>(n), mRegisters[n].mValue });
+		}
+	}
+	return true;
+}
+
+//=============================================================================
+// Tokens
+
+const Token& CompilerSW::Peek(size_t ahead) const {
+	return mTokens[std::min(mPos + ahead, mTokens.size() - 1)];
+}
+
+const Token& CompilerSW::Next() {
+	const Token& token = Peek();
+	if (mPos + 1 < mTokens.size()) {
+		mPos++;
+	}
+	return token;
+}
+
+bool CompilerSW::IsToken(const char* text, size_t ahead) const {
+	const Token& token = Peek(ahead);
+	return (token.mType == TokenType::Identifier || token.mType == TokenType::Punctuation) && token.mText == text;
+}
+
+bool CompilerSW::Accept(const char* text) {
+	if (IsToken(text)) {
+		Next();
+		return true;
+	}
+	return false;
+}
+
+bool CompilerSW::Expect(const char* text) {
+	if (Accept(text)) {
+		return true;
+	}
+	Fail(std::string("expected '") + text + "' before '" + Peek().mText + "'");
+	return false;
+}
+
+bool CompilerSW::ExpectIdentifier(std::string& name) {
+	if (Peek().mType != TokenType::Identifier) {
+		Fail("expected an identifier before '" + Peek().mText + "'");
+		return false;
+	}
+	name = Next().mText;
+	return true;
+}
+
+void CompilerSW::Fail(const std::string& message) {
+	if (!mFailed) {
+		mFailed = true;
+		mError = "line " + std::to_string(Peek().mLine) + ": " + message;
+	}
+}
+
+bool CompilerSW::ParseType(GlslType::Enum& type) {
+	const Token& token = Peek();
+	if (token.mType == TokenType::Identifier && FindTypeName(token.mText, type)) {
+		Next();
+		return true;
+	}
+	if (token.mText == "struct") {
+		Fail("structures are not supported");
+	} else if (token.mText.compare(0, 7, "sampler") == 0) {
+		Fail(token.mText + " is not supported, only sampler2D");
+	} else {
+		Fail("unknown type '" + token.mText + "'");
+	}
+	return false;
+}
+
+// precision only matters to GL
+void CompilerSW::SkipPrecision() {
+	if (!Accept("highp") && !Accept("mediump")) {
+		Accept("lowp");
+	}
+}
+
+void CompilerSW::SkipStatement() {
+	while (!mFailed && !Accept(";")) {
+		if (Peek().mType == TokenType::End) {
+			Fail("expected ';' before end of source");
+		}
+		Next();
+	}
+}
+
+//=============================================================================
+// Declarations
+
+void CompilerSW::DeclareBuiltin(const char* name, GlslType::Enum type, bool writable, uint32_t inputSlot, uint32_t outputSlot) {
+	SymbolSW symbol = {};
+	symbol.mType = type;
+	symbol.mWritable = writable;
+	uint16_t base = NewRegisters(cComponents[type]);
+	for (uint32_t c = 0; c < cComponents[type]; c++) {
+		symbol.mRegisters[c] = static_cast<uint16_t>(base + c);
+		if (inputSlot != cNoRegister) {
+			mStage.mCode.mInputs.push_back({ symbol.mRegisters[c], static_cast<uint16_t>(inputSlot + c) });
+		}
+		if (outputSlot != cNoRegister) {
+			mStage.mCode.mOutputs.push_back({ symbol.mRegisters[c], static_cast<uint16_t>(outputSlot + c) });
+		}
+	}
+	mScopes[0][name] = symbol;
+}
+
+void CompilerSW::ParseGlobal() {
+	if (Accept(";")) {
+		return;
+	}
+	if (Accept("precision")) {
+		SkipStatement();
+		return;
+	}
+	// invariance only matters between GL programs
+	if (Accept("invariant") && Peek().mType == TokenType::Identifier && (IsToken(";", 1) || IsToken(",", 1))) {
+		SkipStatement();
+		return;
+	}
+
+	QualifierSW::Enum qualifier = QualifierSW::None;
+	if (Accept("const")) {
+		qualifier = QualifierSW::Const;
+	} else if (Accept("uniform")) {
+		qualifier = QualifierSW::Uniform;
+	} else if (Accept("attribute")) {
+		qualifier = QualifierSW::Attribute;
+	} else if (Accept("varying")) {
+		qualifier = QualifierSW::Varying;
+	}
+	SkipPrecision();
+	GlslType::Enum type;
+	if (!ParseType(type)) {
+		return;
+	}
+	if (qualifier == QualifierSW::None && Peek().mType == TokenType::Identifier && IsToken("(", 1)) {
+		std::string name = Next().mText;
+		ParseFunction(type, name);
+		return;
+	}
+	ParseDeclarators(type, qualifier);
+}
+
+// Bodies are only recorded here, they are compiled at each call.
+void CompilerSW::ParseFunction(GlslType::Enum returnType, const std::string& name) {
+	FunctionSW function;
+	function.mName = name;
+	function.mReturnType = returnType;
+	function.mBody = 0;
+	Expect("(");
+	if (IsToken("void") && IsToken(")", 1)) {
+		Next();
+	}
+	while (!mFailed && !Accept(")")) {
+		if (!function.mParameters.empty()) {
+			Expect(",");
+		}
+		ParameterSW parameter;
+		parameter.mIn = true;
+		parameter.mOut = false;
+		Accept("const");
+		if (Accept("out")) {
+			parameter.mIn = false;
+			parameter.mOut = true;
+		} else if (Accept("inout")) {
+			parameter.mOut = true;
+		} else {
+			Accept("in");
+		}
+		SkipPrecision();
+		if (!ParseType(parameter.mType)) {
+			return;
+		}
+		if (Peek().mType == TokenType::Identifier) {
+			parameter.mName = Next().mText;
+		}
+		if (IsToken("[")) {
+			Fail("arrays are not supported");
+			return;
+		}
+		function.mParameters.push_back(parameter);
+	}
+	if (mFailed || Accept(";")) {
+		return;
+	}
+	if (!IsToken("{")) {
+		Fail("expected the body of '" + name + "'");
+		return;
+	}
+
+	function.mBody = mPos;
+	uint32_t depth = 0;
+	do {
+		if (Peek().mType == TokenType::End) {
+			Fail("missing '}' at the end of '" + name + "'");
+			return;
+		}
+		const Token& token = Next();
+		if (token.mType == TokenType::Punctuation && token.mText == "{") {
+			depth++;
+		} else if (token.mType == TokenType::Punctuation && token.mText == "}") {
+			depth--;
+		}
+	} while (depth > 0);
+
+	auto& overloads = mFunctions[name];
+	for (const FunctionSW& other : overloads) {
+		bool same = other.mParameters.size() == function.mParameters.size();
+		for (size_t n = 0; same && n < other.mParameters.size(); n++) {
+			same = other.mParameters[n].mType == function.mParameters[n].mType;
+		}
+		if (same) {
+			Fail("redefinition of '" + name + "'");
+			return;
+		}
+	}
+	overloads.push_back(function);
+}
+
+void CompilerSW::ParseDeclarators(GlslType::Enum type, QualifierSW::Enum qualifier) {
+	if (type == GlslType::Void) {
+		Fail("variables cannot be void");
+		return;
+	}
+	do {
+		std::string name;
+		if (!ExpectIdentifier(name)) {
+			return;
+		}
+		if (IsToken("[")) {
+			Fail("arrays are not supported");
+			return;
+		}
+		if (Accept("=")) {
+			ValueSW initializer = ParseAssignment();
+			Declare(name, type, qualifier, &initializer);
+		} else {
+			Declare(name, type, qualifier, nullptr);
+		}
+	} while (!mFailed && Accept(","));
+	Expect(";");
+}
+
+void CompilerSW::Declare(const std::string& name, GlslType::Enum type, QualifierSW::Enum qualifier, const ValueSW* initializer) {
+	if (mFailed) {
+		return;
+	}
+	auto& scope = mScopes.back();
+	if (scope.count(name) != 0) {
+		Fail("redefinition of '" + name + "'");
+		return;
+	}
+	uint32_t components = cComponents[type];
+	if (initializer != nullptr && cComponents[initializer->mType] != components) {
+		Fail("cannot initialize '" + name + "' with a value of another type");
+		return;
+	}
+	bool interface = qualifier == QualifierSW::Uniform || qualifier == QualifierSW::Attribute || qualifier == QualifierSW::Varying;
+	if (interface && initializer != nullptr) {
+		Fail("'" + name + "' cannot be initialized");
+		return;
+	}
+
+	SymbolSW symbol = {};
+	symbol.mType = type;
+	symbol.mWritable = true;
+	if (qualifier == QualifierSW::Const) {
+		if (initializer == nullptr) {
+			Fail("const '" + name + "' must be initialized");
+			return;
+		}
+		std::copy_n(initializer->mRegisters, components, symbol.mRegisters);
+		symbol.mWritable = false;
+	} else if (initializer != nullptr) {
+		Adopt(*initializer, symbol.mRegisters);
+	} else {
+		uint16_t base = NewRegisters(components);
+		for (uint32_t c = 0; c < components; c++) {
+			symbol.mRegisters[c] = static_cast<uint16_t>(base + c);
+		}
+	}
+
+	if (interface) {
+		InterfaceSW variable;
+		variable.mName = name;
+		variable.mType = type;
+		std::copy_n(symbol.mRegisters, components, variable.mRegisters);
+		if (qualifier == QualifierSW::Uniform) {
+			symbol.mWritable = false;
+			mStage.mUniforms.push_back(variable);
+		} else if (qualifier == QualifierSW::Attribute) {
+			const char* const* attribute = std::find_if(std::begin(cAttributeNames), std::end(cAttributeNames), [&name](const char* attributeName) { return name == attributeName; });
+			if (mType != ShaderType::VertexProgram) {
+				Fail("attributes are only allowed in vertex shaders");
+				return;
+			}
+			if (type != GlslType::Float && !IsVector(type)) {
+				Fail("attribute '" + name + "' must be a float or a vector");
+				return;
+			}
+			if (attribute == std::end(cAttributeNames)) {
+				Fail("unknown attribute '" + name + "', the names of the Attributes enum are expected (a_position, a_normal, ...)");
+				return;
+			}
+			uint32_t slot = ShaderSlotsSW::VertexAttributes + static_cast<uint32_t>(attribute - std::begin(cAttributeNames)) * 4;
+			for (uint32_t c = 0; c < components; c++) {
+				mStage.mCode.mInputs.push_back({ symbol.mRegisters[c], static_cast<uint16_t>(slot + c) });
+			}
+			symbol.mWritable = false;
+		} else {
+			if (type == GlslType::Bool || type == GlslType::Int || type == GlslType::Sampler2D) {
+				Fail("varying '" + name + "' must be a float, a vector or a matrix");
+				return;
+			}
+			symbol.mWritable = mType == ShaderType::VertexProgram;
+			mStage.mVaryings.push_back(variable);
+		}
+	}
+	scope[name] = symbol;
+}
+
+// the body of a function only sees the globals and its own locals
+const SymbolSW* CompilerSW::Lookup(const std::string& name) const {
+	size_t base = mFrames.empty() ? 1 : mFrames.back().mScopeBase;
+	for (size_t n = mScopes.size(); n > base; n--) {
+		auto symbol = mScopes[n - 1].find(name);
+		if (symbol != mScopes[n - 1].end()) {
+			return &symbol->second;
+		}
+	}
+	auto symbol = mScopes[0].find(name);
+	return symbol != mScopes[0].end() ? &symbol->second : nullptr;
+}
+
+//=============================================================================
+// Statements
+
+void CompilerSW::ParseStatement() {
+	if (IsToken("{")) {
+		ParseBlock();
+		return;
+	}
+	if (Accept(";")) {
+		return;
+	}
+	if (Accept("precision")) {
+		SkipStatement();
+		return;
+	}
+	if (Accept("if")) {
+		ParseIf();
+		return;
+	}
+	if (Accept("return")) {
+		ParseReturn();
+		return;
+	}
+	if (Accept("discard")) {
+		ParseDiscard();
+		return;
+	}
+	if (IsToken("for") || IsToken("while") || IsToken("do") || IsToken("break") || IsToken("continue")) {
+		Fail("loops are not supported by the software device");
+		return;
+	}
+
+	GlslType::Enum type;
+	if (IsToken("const") || IsToken("highp") || IsToken("mediump") || IsToken("lowp") || (Peek().mType == TokenType::Identifier && FindTypeName(Peek().mText, type) && !IsToken("(", 1))) {
+		QualifierSW::Enum qualifier = Accept("const") ? QualifierSW::Const : QualifierSW::None;
+		SkipPrecision();
+		if (ParseType(type)) {
+			ParseDeclarators(type, qualifier);
+		}
+		return;
+	}
+
+	ParseExpression();
+	Expect(";");
+}
+
+void CompilerSW::ParseSubStatement() {
+	mScopes.emplace_back();
+	ParseStatement();
+	mScopes.pop_back();
+}
+
+void CompilerSW::ParseBlock() {
+	if (!Expect("{")) {
+		return;
+	}
+	mScopes.emplace_back();
+	while (!mFailed && !Accept("}")) {
+		if (Peek().mType == TokenType::End) {
+			Fail("expected '}' before end of source");
+			break;
+		}
+		ParseStatement();
+	}
+	mScopes.pop_back();
+}
+
+void CompilerSW::ParseIf() {
+	Expect("(");
+	ValueSW condition = ParseExpression();
+	Expect(")");
+	if (mFailed) {
+		return;
+	}
+	if (cComponents[condition.mType] != 1) {
+		Fail("the condition of an if must be a boolean");
+		return;
+	}
+	uint16_t full = FullMask();
+	uint16_t local = LocalMask();
+	uint16_t taken = condition.mRegisters[0];
+	mMasks.push_back({ And(full, taken), And(local, taken) });
+	ParseSubStatement();
+	mMasks.pop_back();
+	if (Accept("else")) {
+		uint16_t skipped = Op(ShaderOpSW::Sub, Constant(1.0f), taken);
+		mMasks.push_back({ And(full, skipped), And(local, skipped) });
+		ParseSubStatement();
+		mMasks.pop_back();
+	}
+}
+
+void CompilerSW::ParseReturn() {
+	if (mFrames.empty()) {
+		Fail("return outside of a function");
+		return;
+	}
+	uint16_t local = LocalMask();
+	if (mFrames.back().mReturnType == GlslType::Void) {
+		if (!IsToken(";")) {
+			Fail("void functions cannot return a value");
+			return;
+		}
+	} else {
+		ValueSW value = ParseExpression();
+		if (mFailed) {
+			return;
+		}
+		FrameSW& frame = mFrames.back();
+		uint32_t components = cComponents[frame.mReturnType];
+		if (cComponents[value.mType] != components) {
+			Fail("the returned value does not match the return type");
+			return;
+		}
+		if (!frame.mReturned && local == cNoRegister) {
+			// single return at the end of the function, the value is used as is
+			std::copy_n(value.mRegisters, components, frame.mReturn);
+		} else {
+			if (!frame.mReturned) {
+				ValueSW storage = Temporary(frame.mReturnType);
+				std::copy_n(storage.mRegisters, components, frame.mReturn);
+			}
+			ValueSW target = {};
+			target.mType = frame.mReturnType;
+			std::copy_n(frame.mReturn, components, target.mRegisters);
+			Store(target, value, local);
+		}
+		frame.mReturned = true;
+	}
+	Expect(";");
+
+	// the lanes that returned skip the rest of the function
+	FrameSW& frame = mFrames.back();
+	if (local == cNoRegister) {
+		frame.mAlive = Constant(0.0f);
+	} else {
+		frame.mAlive = Op(ShaderOpSW::Sub, frame.mAlive == cNoRegister ? Constant(1.0f) : frame.mAlive, local);
+	}
+}
+
+void CompilerSW::ParseDiscard() {
+	if (mType != ShaderType::FragmentProgram) {
+		Fail("discard is only allowed in fragment shaders");
+		return;
+	}
+	uint16_t mask = FullMask();
+	float value = 1.0f;
+	if (mask == cNoRegister) {
+		mask = Constant(1.0f);
+	}
+	if (!IsConstant(mask, value) || value != 0.0f) {
+		Emit(ShaderOpSW::Kill, 0, mask);
+	}
+	Expect(";");
+}
+
+//=============================================================================
+// Expressions
+
+ValueSW CompilerSW::ParseExpression() {
+	ValueSW value = ParseAssignment();
+	while (!mFailed && Accept(",")) {
+		value = ParseAssignment();
+	}
+	return value;
+}
+
+ValueSW CompilerSW::ParseAssignment() {
+	static const char* cAssignments[] = { "=", "+=", "-=", "*=", "/=" };
+	ValueSW target = ParseConditional();
+	for (const char* assignment : cAssignments) {
+		if (!IsToken(assignment)) {
+			continue;
+		}
+		Next();
+		ValueSW value = ParseAssignment();
+		if (mFailed) {
+			return target;
+		}
+		if (!target.mLValue) {
+			Fail(std::string("'") + assignment + "' needs a writable left operand");
+			return target;
+		}
+		if (assignment[1] != '\0') {
+			value = Binary(std::string(1, assignment[0]), target, value);
+		}
+		Store(target, value, FullMask());
+		target.mLValue = false;
+		return target;
+	}
+	return target;
+}
+
+// both sides are evaluated, expressions have no side effect worth masking
+ValueSW CompilerSW::ParseConditional() {
+	ValueSW condition = ParseBinary(1);
+	if (!Accept("?")) {
+		return condition;
+	}
+	ValueSW a = ParseAssignment();
+	Expect(":");
+	ValueSW b = ParseAssignment();
+	if (mFailed) {
+		return a;
+	}
+	if (cComponents[condition.mType] != 1 || a.mType != b.mType) {
+		Fail("invalid operands of '?:'");
+		return a;
+	}
+	ValueSW result = {};
+	result.mType = a.mType;
+	for (uint32_t c = 0; c < cComponents[a.mType]; c++) {
+		result.mRegisters[c] = Op(ShaderOpSW::Select, condition.mRegisters[0], a.mRegisters[c], b.mRegisters[c]);
+	}
+	return result;
+}
+
+int32_t BinaryPrecedence(const Token& token) {
+	static const struct {
+		const char* mText;
+		int32_t mPrecedence;
+	} cOperators[] = {
+		{ "||", 1 }, { "^^", 2 }, { "&&", 3 }, { "==", 4 }, { "!=", 4 }, { "<", 5 }, { ">", 5 }, { "<=", 5 }, { ">=", 5 },
+		{ "+", 6 }, { "-", 6 }, { "*", 7 }, { "/", 7 }
+	};
+	if (token.mType != TokenType::Punctuation) {
+		return 0;
+	}
+	for (const auto& op : cOperators) {
+		if (token.mText == op.mText) {
+			return op.mPrecedence;
+		}
+	}
+	return 0;
+}
+
+ValueSW CompilerSW::ParseBinary(int32_t minPrecedence) {
+	ValueSW lhs = ParseUnary();
+	for (;;) {
+		int32_t precedence = BinaryPrecedence(Peek());
+		if (mFailed || precedence == 0 || precedence < minPrecedence) {
+			break;
+		}
+		std::string op = Next().mText;
+		ValueSW rhs = ParseBinary(precedence + 1);
+		lhs = Binary(op, lhs, rhs);
+	}
+	return lhs;
+}
+
+ValueSW CompilerSW::ParseUnary() {
+	if (Accept("-")) {
+		ValueSW value = ParseUnary();
+		return Componentwise(ShaderOpSW::Sub, Scalar(Constant(0.0f), value.mType == GlslType::Int ? GlslType::Int : GlslType::Float), value);
+	}
+	if (Accept("+")) {
+		return ParseUnary();
+	}
+	if (Accept("!")) {
+		ValueSW value = ParseUnary();
+		if (cComponents[value.mType] != 1) {
+			Fail("'!' expects a boolean");
+			return value;
+		}
+		return Scalar(Op(ShaderOpSW::Eq, value.mRegisters[0], Constant(0.0f)), GlslType::Bool);
+	}
+	if (IsToken("++") || IsToken("--")) {
+		ShaderOpSW::Enum op = Next().mText == "++" ? ShaderOpSW::Add : ShaderOpSW::Sub;
+		ValueSW value = ParseUnary();
+		if (!value.mLValue) {
+			Fail("'++' and '--' need a writable operand");
+			return value;
+		}
+		Store(value, Componentwise(op, value, Scalar(Constant(1.0f))), FullMask());
+		value.mLValue = false;
+		return value;
+	}
+	return ParsePostfix();
+}
+
+ValueSW CompilerSW::ParsePostfix() {
+	ValueSW value = ParsePrimary();
+	while (!mFailed) {
+		if (Accept(".")) {
+			std::string fields;
+			if (ExpectIdentifier(fields)) {
+				value = Swizzle(value, fields);
+			}
+		} else if (Accept("[")) {
+			ValueSW index = ParseExpression();
+			Expect("]");
+			value = Index(value, index);
+		} else if (IsToken("++") || IsToken("--")) {
+			ShaderOpSW::Enum op = Next().mText == "++" ? ShaderOpSW::Add : ShaderOpSW::Sub;
+			if (!value.mLValue) {
+				Fail("'++' and '--' need a writable operand");
+				break;
+			}
+			ValueSW previous = Copy(value);
+			Store(value, Componentwise(op, value, Scalar(Constant(1.0f))), FullMask());
+			value = previous;
+		} else {
+			break;
+		}
+	}
+	return value;
+}
+
+ValueSW CompilerSW::ParsePrimary() {
+	ValueSW value = {};
+	const Token& token = Peek();
+	if (token.mType == TokenType::Number) {
+		Next();
+		return Scalar(Constant(token.mValue), token.mInteger ? GlslType::Int : GlslType::Float);
+	}
+	if (Accept("true")) {
+		return Scalar(Constant(1.0f), GlslType::Bool);
+	}
+	if (Accept("false")) {
+		return Scalar(Constant(0.0f), GlslType::Bool);
+	}
+	if (Accept("(")) {
+		value = ParseExpression();
+		Expect(")");
+		return value;
+	}
+	if (token.mType == TokenType::Identifier) {
+		std::string name = Next().mText;
+		if (IsToken("(")) {
+			return ParseCall(name);
+		}
+		const SymbolSW* symbol = Lookup(name);
+		if (symbol == nullptr) {
+			Fail("undeclared identifier '" + name + "'");
+			return value;
+		}
+		value.mType = symbol->mType;
+		std::copy_n(symbol->mRegisters, cComponents[symbol->mType], value.mRegisters);
+		value.mLValue = symbol->mWritable;
+		return value;
+	}
+	Fail("unexpected '" + token.mText + "'");
+	return value;
+}
+
+ValueSW CompilerSW::ParseCall(const std::string& name) {
+	std::vector<ValueSW> arguments;
+	Expect("(");
+	if (!Accept(")")) {
+		do {
+			arguments.push_back(ParseAssignment());
+		} while (!mFailed && Accept(","));
+		Expect(")");
+	}
+	ValueSW result = {};
+	if (mFailed) {
+		return result;
+	}
+	GlslType::Enum type;
+	if (FindTypeName(name, type)) {
+		return Construct(type, arguments);
+	}
+	const FunctionSW* function = FindOverload(name, arguments);
+	if (function != nullptr) {
+		return CallFunction(*function, arguments);
+	}
+	if (!CallBuiltin(name, arguments, result)) {
+		Fail("no matching function for call to '" + name + "'");
+	}
+	return result;
+}
+
+//=============================================================================
+// Code generation
+
+uint16_t CompilerSW::NewRegisters(uint32_t count) {
+	if (mRegisters.size() + count >= cNoRegister) {
+		Fail("the shader needs too many registers");
+		return 0;
+	}
+	uint16_t base = static_cast<uint16_t>(mRegisters.size());
+	RegisterSW reg = { 0.0f, false, false };
+	mRegisters.resize(mRegisters.size() + count, reg);
+	return base;
+}
+
+uint16_t CompilerSW::Constant(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	auto constant = mConstants.find(bits);
+	if (constant != mConstants.end()) {
+		return constant->second;
+	}
+	uint16_t reg = NewRegisters(1);
+	if (mFailed) {
+		return 0;
+	}
+	mRegisters[reg].mValue = value;
+	mRegisters[reg].mConstant = true;
+	mConstants[bits] = reg;
+	return reg;
+}
+
+bool CompilerSW::IsConstant(uint16_t reg, float& value) const {
+	if (reg >= mRegisters.size() || !mRegisters[reg].mConstant) {
+		return false;
+	}
+	value = mRegisters[reg].mValue;
+	return true;
+}
+
+void CompilerSW::Emit(ShaderOpSW::Enum op, uint16_t d, uint16_t a, uint16_t b, uint16_t c) {
+	ShaderInstructionSW instruction = { op, d, a, b, c };
+	mStage.mCode.mInstructions.push_back(instruction);
+}
+
+// New register holding the result of op, constant operands are folded and identities simplified.
+uint16_t CompilerSW::Op(ShaderOpSW::Enum op, uint16_t a, uint16_t b, uint16_t c) {
+	if (mFailed) {
+		return 0;
+	}
+	uint32_t operands = cOperandsCount[op];
+	b = operands > 1 ? b : 0;
+	c = operands > 2 ? c : 0;
+	float va = 0.0f, vb = 0.0f, vc = 0.0f;
+	bool ka = IsConstant(a, va);
+	bool kb = operands > 1 && IsConstant(b, vb);
+	bool kc = operands > 2 && IsConstant(c, vc);
+	if (ka && (operands < 2 || kb) && (operands < 3 || kc)) {
+		return Constant(EvaluateOp(op, va, vb, vc));
+	}
+	switch (op) {
+	case ShaderOpSW::Add:
+		if (ka && va == 0.0f) return b;
+		if (kb && vb == 0.0f) return a;
+		break;
+	case ShaderOpSW::Sub:
+		if (kb && vb == 0.0f) return a;
+		break;
+	case ShaderOpSW::Mul:
+		if ((ka && va == 0.0f) || (kb && vb == 0.0f)) return Constant(0.0f);
+		if (ka && va == 1.0f) return b;
+		if (kb && vb == 1.0f) return a;
+		break;
+	case ShaderOpSW::Div:
+		if (kb && vb == 1.0f) return a;
+		break;
+	case ShaderOpSW::Mad:
+		if ((ka && va == 0.0f) || (kb && vb == 0.0f)) return c;
+		if (kc && vc == 0.0f) return Op(ShaderOpSW::Mul, a, b);
+		if (ka && va == 1.0f) return Op(ShaderOpSW::Add, b, c);
+		if (kb && vb == 1.0f) return Op(ShaderOpSW::Add, a, c);
+		break;
+	case ShaderOpSW::Select:
+		if (ka) return va != 0.0f ? b : c;
+		if (b == c) return b;
+		break;
+	default:
+		break;
+	}
+
+	// registers are only overwritten by Store, which forgets the known expressions
+	uint64_t key = static_cast<uint64_t>(op) | (static_cast<uint64_t>(a) << 8) | (static_cast<uint64_t>(b) << 24) | (static_cast<uint64_t>(c) << 40);
+	auto expression = mExpressions.find(key);
+	if (expression != mExpressions.end()) {
+		return expression->second;
+	}
+	uint16_t d = NewRegisters(1);
+	if (mFailed) {
+		return 0;
+	}
+	mRegisters[d].mAdoptable = true;
+	Emit(op, d, a, b, c);
+	mExpressions[key] = d;
+	return d;
+}
+
+uint16_t CompilerSW::And(uint16_t a, uint16_t b) {
+	if (a == cNoRegister) {
+		return b;
+	}
+	if (b == cNoRegister) {
+		return a;
+	}
+	return Op(ShaderOpSW::Mul, a, b);
+}
+
+uint16_t CompilerSW::FullMask() {
+	uint16_t mask = mMasks.empty() ? cNoRegister : mMasks.back().mFull;
+	return mFrames.empty() ? mask : And(mask, mFrames.back().mAlive);
+}
+
+uint16_t CompilerSW::LocalMask() {
+	uint16_t mask = mMasks.empty() ? cNoRegister : mMasks.back().mLocal;
+	return mFrames.empty() ? mask : And(mask, mFrames.back().mAlive);
+}
+
+void CompilerSW::Store(const ValueSW& target, const ValueSW& value, uint16_t mask) {
+	uint32_t components = cComponents[target.mType];
+	if (cComponents[value.mType] != components || IsMatrix(target.mType) != IsMatrix(value.mType)) {
+		Fail("cannot assign a value of another type");
+		return;
+	}
+	float maskValue;
+	if (mask != cNoRegister && IsConstant(mask, maskValue)) {
+		if (maskValue == 0.0f) {
+			return;
+		}
+		mask = cNoRegister;
+	}
+
+	// sources overwritten by an earlier component, as in v.xy = v.yx, are copied first
+	uint16_t sources[cMaxComponents];
+	std::copy_n(value.mRegisters, components, sources);
+	for (uint32_t c = 1; c < components; c++) {
+		if (std::find(target.mRegisters, target.mRegisters + c, sources[c]) != target.mRegisters + c && sources[c] != target.mRegisters[c]) {
+			uint16_t copy = NewRegisters(1);
+			Emit(ShaderOpSW::Mov, copy, sources[c]);
+			sources[c] = copy;
+		}
+	}
+	for (uint32_t c = 0; c < components; c++) {
+		uint16_t d = target.mRegisters[c];
+		if (mask != cNoRegister) {
+			Emit(ShaderOpSW::Select, d, mask, sources[c], d);
+		} else if (d != sources[c]) {
+			Emit(ShaderOpSW::Mov, d, sources[c]);
+		}
+	}
+	mExpressions.clear();
+}
+
+// Registers of a new variable initialized with value: temporaries are taken over, anything else is copied.
+void CompilerSW::Adopt(const ValueSW& value, uint16_t* registers) {
+	for (uint32_t c = 0; c < cComponents[value.mType]; c++) {
+		uint16_t reg = value.mRegisters[c];
+		if (reg < mRegisters.size() && mRegisters[reg].mAdoptable) {
+			mRegisters[reg].mAdoptable = false;
+			registers[c] = reg;
+		} else {
+			registers[c] = NewRegisters(1);
+			Emit(ShaderOpSW::Mov, registers[c], reg);
+		}
+	}
+}
+
+ValueSW CompilerSW::Scalar(uint16_t reg, GlslType::Enum type) const {
+	ValueSW value = {};
+	value.mType = type;
+	value.mRegisters[0] = reg;
+	return value;
+}
+
+ValueSW CompilerSW::Temporary(GlslType::Enum type) {
+	ValueSW value = {};
+	value.mType = type;
+	uint16_t base = NewRegisters(cComponents[type]);
+	for (uint32_t c = 0; c < cComponents[type] && !mFailed; c++) {
+		value.mRegisters[c] = static_cast<uint16_t>(base + c);
+		mRegisters[base + c].mAdoptable = true;
+	}
+	return value;
+}
+
+ValueSW CompilerSW::Copy(const ValueSW& value) {
+	ValueSW copy = Temporary(value.mType);
+	for (uint32_t c = 0; c < cComponents[value.mType]; c++) {
+		Emit(ShaderOpSW::Mov, copy.mRegisters[c], value.mRegisters[c]);
+	}
+	return copy;
+}
+
+ValueSW CompilerSW::Map(ShaderOpSW::Enum op, const ValueSW& a) {
+	ValueSW result = {};
+	result.mType = a.mType;
+	for (uint32_t c = 0; c < cComponents[a.mType]; c++) {
+		result.mRegisters[c] = Op(op, a.mRegisters[c]);
+	}
+	return result;
+}
+
+// scalar operands are applied to every component of the other one
+ValueSW CompilerSW::Componentwise(ShaderOpSW::Enum op, const ValueSW& a, const ValueSW& b) {
+	ValueSW result = {};
+	uint32_t countA = cComponents[a.mType];
+	uint32_t countB = cComponents[b.mType];
+	if (countA == 0 || countB == 0 || a.mType == GlslType::Sampler2D || b.mType == GlslType::Sampler2D ||
+		(countA != countB && countA != 1 && countB != 1) || (countA == countB && IsMatrix(a.mType) != IsMatrix(b.mType))) {
+		Fail("operands of different sizes");
+		return result;
+	}
+	result.mType = countA > countB || (countA == countB && a.mType != GlslType::Int) ? a.mType : b.mType;
+	for (uint32_t c = 0; c < std::max(countA, countB); c++) {
+		result.mRegisters[c] = Op(op, a.mRegisters[countA == 1 ? 0 : c], b.mRegisters[countB == 1 ? 0 : c]);
+	}
+	return result;
+}
+
+// linear algebra products, matrices are column major
+ValueSW CompilerSW::Multiply(const ValueSW& a, const ValueSW& b) {
+	bool matrixA = IsMatrix(a.mType);
+	bool matrixB = IsMatrix(b.mType);
+	if ((!matrixA && !matrixB) || cComponents[a.mType] == 1 || cComponents[b.mType] == 1) {
+		return Componentwise(ShaderOpSW::Mul, a, b);
+	}
+	ValueSW result = {};
+	uint32_t size = MatrixSize(matrixA ? a.mType : b.mType);
+	if ((matrixA && matrixB && a.mType != b.mType) || (!matrixA && cComponents[a.mType] != size) || (!matrixB && cComponents[b.mType] != size)) {
+		Fail("operands of '*' do not match");
+		return result;
+	}
+	uint16_t row[4];
+	if (matrixA && matrixB) {
+		result.mType = a.mType;
+		for (uint32_t r = 0; r < size; r++) {
+			for (uint32_t k = 0; k < size; k++) {
+				row[k] = a.mRegisters[k * size + r];
+			}
+			for (uint32_t c = 0; c < size; c++) {
+				result.mRegisters[c * size + r] = Dot(row, &b.mRegisters[c * size], size);
+			}
+		}
+	} else if (matrixA) {
+		result.mType = VectorType(size);
+		for (uint32_t r = 0; r < size; r++) {
+			for (uint32_t k = 0; k < size; k++) {
+				row[k] = a.mRegisters[k * size + r];
+			}
+			result.mRegisters[r] = Dot(row, b.mRegisters, size);
+		}
+	} else {
+		result.mType = VectorType(size);
+		for (uint32_t c = 0; c < size; c++) {
+			result.mRegisters[c] = Dot(a.mRegisters, &b.mRegisters[c * size], size);
+		}
+	}
+	return result;
+}
+
+// ints are floats, conversions and divisions round toward zero
+ValueSW CompilerSW::Truncate(const ValueSW& value) {
+	ValueSW result = value;
+	result.mLValue = false;
+	for (uint32_t c = 0; c < cComponents[value.mType]; c++) {
+		uint16_t reg = value.mRegisters[c];
+		result.mRegisters[c] = Op(ShaderOpSW::Mul, Op(ShaderOpSW::Sign, reg), Op(ShaderOpSW::Floor, Op(ShaderOpSW::Abs, reg)));
+	}
+	return result;
+}
+
+ValueSW CompilerSW::Binary(const std::string& op, const ValueSW& a, const ValueSW& b) {
+	if (mFailed) {
+		return a;
+	}
+	if (op == "+") {
+		return Componentwise(ShaderOpSW::Add, a, b);
+	}
+	if (op == "-") {
+		return Componentwise(ShaderOpSW::Sub, a, b);
+	}
+	if (op == "*") {
+		return Multiply(a, b);
+	}
+	if (op == "/") {
+		ValueSW quotient = Componentwise(ShaderOpSW::Div, a, b);
+		return a.mType == GlslType::Int && b.mType == GlslType::Int ? Truncate(quotient) : quotient;
+	}
+	if (op == "==" || op == "!=") {
+		uint32_t components = cComponents[a.mType];
+		if (components == 0 || a.mType != b.mType) {
+			if (components != 1 || cComponents[b.mType] != 1) {
+				Fail("operands of '" + op + "' have different types");
+				return a;
+			}
+		}
+		if (components == 1) {
+			return Scalar(Op(op == "==" ? ShaderOpSW::Eq : ShaderOpSW::Ne, a.mRegisters[0], b.mRegisters[0]), GlslType::Bool);
+		}
+		uint16_t equal = cNoRegister;
+		for (uint32_t c = 0; c < components; c++) {
+			equal = And(equal, Op(ShaderOpSW::Eq, a.mRegisters[c], b.mRegisters[c]));
+		}
+		return Scalar(op == "==" ? equal : Op(ShaderOpSW::Sub, Constant(1.0f), equal), GlslType::Bool);
+	}
+	if (cComponents[a.mType] != 1 || cComponents[b.mType] != 1) {
+		Fail("operands of '" + op + "' must be scalars");
+		return a;
+	}
+	uint16_t x = a.mRegisters[0];
+	uint16_t y = b.mRegisters[0];
+	if (op == "&&") {
+		return Scalar(Op(ShaderOpSW::Mul, x, y), GlslType::Bool);
+	}
+	if (op == "||") {
+		return Scalar(Op(ShaderOpSW::Max, x, y), GlslType::Bool);
+	}
+	if (op == "^^") {
+		return Scalar(Op(ShaderOpSW::Ne, x, y), GlslType::Bool);
+	}
+	if (op == "<") {
+		return Scalar(Op(ShaderOpSW::Lt, x, y), GlslType::Bool);
+	}
+	if (op == ">") {
+		return Scalar(Op(ShaderOpSW::Lt, y, x), GlslType::Bool);
+	}
+	if (op == "<=") {
+		return Scalar(Op(ShaderOpSW::Le, x, y), GlslType::Bool);
+	}
+	return Scalar(Op(ShaderOpSW::Le, y, x), GlslType::Bool);
+}
+
+uint16_t CompilerSW::Dot(const uint16_t* a, const uint16_t* b, uint32_t count) {
+	uint16_t sum = Op(ShaderOpSW::Mul, a[0], b[0]);
+	for (uint32_t n = 1; n < count; n++) {
+		sum = Op(ShaderOpSW::Mad, a[n], b[n], sum);
+	}
+	return sum;
+}
+
+uint16_t CompilerSW::Dot(const ValueSW& a, const ValueSW& b) {
+	uint32_t components = cComponents[a.mType];
+	if (components == 0 || IsMatrix(a.mType) || a.mType != b.mType) {
+		Fail("operands of a dot product must be vectors of the same size");
+		return 0;
+	}
+	return Dot(a.mRegisters, b.mRegisters, components);
+}
+
+ValueSW CompilerSW::Swizzle(const ValueSW& value, const std::string& fields) {
+	static const char* cFieldSets[] = { "xyzw", "rgba", "stpq" };
+	uint32_t components = cComponents[value.mType];
+	if (!IsVector(value.mType) || fields.size() > 4) {
+		Fail("invalid swizzle '." + fields + "'");
+		return value;
+	}
+	const char* set = nullptr;
+	for (const char* candidate : cFieldSets) {
+		if (std::strchr(candidate, fields[0]) != nullptr) {
+			set = candidate;
+		}
+	}
+	ValueSW result = {};
+	result.mType = VectorType(static_cast<uint32_t>(fields.size()));
+	result.mLValue = value.mLValue;
+	uint32_t used = 0;
+	for (size_t n = 0; n < fields.size(); n++) {
+		const char* field = set != nullptr ? std::strchr(set, fields[n]) : nullptr;
+		uint32_t c = field != nullptr ? static_cast<uint32_t>(field - set) : 4;
+		if (c >= components) {
+			Fail("invalid swizzle '." + fields + "'");
+			return value;
+		}
+		// a component written twice makes the swizzle read-only
+		if (used & (1u << c)) {
+			result.mLValue = false;
+		}
+		used |= 1u << c;
+		result.mRegisters[n] = value.mRegisters[c];
+	}
+	return result;
+}
+
+ValueSW CompilerSW::Index(const ValueSW& value, const ValueSW& index) {
+	float constant = 0.0f;
+	if (mFailed) {
+		return value;
+	}
+	if (cComponents[index.mType] != 1 || !IsConstant(index.mRegisters[0], constant) || constant < 0.0f) {
+		Fail("indices must be non negative constant expressions");
+		return value;
+	}
+	uint32_t n = static_cast<uint32_t>(constant);
+	ValueSW result = {};
+	result.mLValue = value.mLValue;
+	if (IsVector(value.mType) && n < cComponents[value.mType]) {
+		result.mType = GlslType::Float;
+		result.mRegisters[0] = value.mRegisters[n];
+	} else if (IsMatrix(value.mType) && n < MatrixSize(value.mType)) {
+		uint32_t size = MatrixSize(value.mType);
+		result.mType = VectorType(size);
+		std::copy_n(&value.mRegisters[n * size], size, result.mRegisters);
+	} else {
+		Fail("index out of range");
+		return value;
+	}
+	return result;
+}
+
+ValueSW CompilerSW::Construct(GlslType::Enum type, const std::vector<ValueSW>& arguments) {
+	ValueSW result = {};
+	result.mType = type;
+	uint16_t flat[cMaxComponents * 4];
+	uint32_t count = 0;
+	for (const ValueSW& argument : arguments) {
+		if (argument.mType == GlslType::Void || argument.mType == GlslType::Sampler2D) {
+			Fail("invalid constructor argument");
+			return result;
+		}
+		for (uint32_t c = 0; c < cComponents[argument.mType] && count < cMaxComponents * 4; c++) {
+			flat[count++] = argument.mRegisters[c];
+		}
+	}
+	uint32_t components = cComponents[type];
+	if (count == 0 || type == GlslType::Void || type == GlslType::Sampler2D) {
+		Fail("invalid constructor");
+		return result;
+	}
+
+	if (components == 1) {
+		result.mRegisters[0] = flat[0];
+		if (type == GlslType::Int) {
+			return Truncate(result);
+		}
+		if (type == GlslType::Bool) {
+			result.mRegisters[0] = Op(ShaderOpSW::Ne, flat[0], Constant(0.0f));
+		}
+		return result;
+	}
+
+	if (IsMatrix(type)) {
+		uint32_t size = MatrixSize(type);
+		if (arguments.size() == 1 && count == 1) {
+			for (uint32_t c = 0; c < components; c++) {
+				result.mRegisters[c] = (c % (size + 1) == 0) ? flat[0] : Constant(0.0f);
+			}
+			return result;
+		}
+		if (arguments.size() == 1 && IsMatrix(arguments[0].mType)) {
+			uint32_t sourceSize = MatrixSize(arguments[0].mType);
+			for (uint32_t c = 0; c < size; c++) {
+				for (uint32_t r = 0; r < size; r++) {
+					result.mRegisters[c * size + r] = (c < sourceSize && r < sourceSize) ? flat[c * sourceSize + r] : Constant(c == r ? 1.0f : 0.0f);
+				}
+			}
+			return result;
+		}
+	} else if (count == 1) {
+		std::fill_n(result.mRegisters, components, flat[0]);
+		return result;
+	}
+
+	if (count < components) {
+		Fail("not enough data for the constructor");
+		return result;
+	}
+	std::copy_n(flat, components, result.mRegisters);
+	return result;
+}
+
+ValueSW CompilerSW::Sample(const ValueSW& sampler, uint16_t u, uint16_t v) {
+	if (sampler.mType != GlslType::Sampler2D) {
+		Fail("texture lookups expect a sampler2D");
+		return sampler;
+	}
+	ValueSW result = Temporary(GlslType::Vec4);
+	Emit(ShaderOpSW::Tex, result.mRegisters[0], u, v, sampler.mRegisters[0]);
+	return result;
+}
+
+bool CompilerSW::CheckArguments(const std::string& name, const std::vector<ValueSW>& arguments, size_t count) {
+	bool valid = arguments.size() == count;
+	for (size_t n = 0; valid && n < count; n++) {
+		valid = arguments[n].mType != GlslType::Void;
+	}
+	if (!valid) {
+		Fail("wrong arguments for '" + name + "'");
+	}
+	return valid;
+}
+
+// Returns false when name is not a built-in function.
+bool CompilerSW::CallBuiltin(const std::string& name, const std::vector<ValueSW>& arguments, ValueSW& result) {
+	static const struct {
+		const char* mName;
+		ShaderOpSW::Enum mOp;
+		uint32_t mArguments;
+	} cComponentwise[] = {
+		{ "abs", ShaderOpSW::Abs, 1 },
+		{ "sign", ShaderOpSW::Sign, 1 },
+		{ "floor", ShaderOpSW::Floor, 1 },
+		{ "sqrt", ShaderOpSW::Sqrt, 1 },
+		{ "inversesqrt", ShaderOpSW::Rsqrt, 1 },
+		{ "exp2", ShaderOpSW::Exp2, 1 },
+		{ "log2", ShaderOpSW::Log2, 1 },
+		{ "sin", ShaderOpSW::Sin, 1 },
+		{ "cos", ShaderOpSW::Cos, 1 },
+		{ "pow", ShaderOpSW::Pow, 2 },
+		{ "min", ShaderOpSW::Min, 2 },
+		{ "max", ShaderOpSW::Max, 2 },
+		{ "matrixCompMult", ShaderOpSW::Mul, 2 }
+	};
+	for (const auto& function : cComponentwise) {
+		if (name == function.mName) {
+			if (CheckArguments(name, arguments, function.mArguments)) {
+				result = function.mArguments == 1 ? Map(function.mOp, arguments[0]) : Componentwise(function.mOp, arguments[0], arguments[1]);
+			}
+			return true;
+		}
+	}
+
+	static const struct {
+		const char* mName;
+		ShaderOpSW::Enum mOp;
+		bool mSwap;
+	} cRelational[] = {
+		{ "lessThan", ShaderOpSW::Lt, false },
+		{ "lessThanEqual", ShaderOpSW::Le, false },
+		{ "greaterThan", ShaderOpSW::Lt, true },
+		{ "greaterThanEqual", ShaderOpSW::Le, true },
+		{ "equal", ShaderOpSW::Eq, false },
+		{ "notEqual", ShaderOpSW::Ne, false }
+	};
+	for (const auto& function : cRelational) {
+		if (name == function.mName) {
+			if (CheckArguments(name, arguments, 2)) {
+				result = function.mSwap ? Componentwise(function.mOp, arguments[1], arguments[0]) : Componentwise(function.mOp, arguments[0], arguments[1]);
+			}
+			return true;
+		}
+	}
+
+	static const char* cSingleArgument[] = {
+		"radians", "degrees", "tan", "asin", "acos", "exp", "log", "ceil", "fract", "length", "normalize", "any", "all", "not"
+	};
+	static const char* cTwoArguments[] = { "mod", "step", "distance", "dot", "cross", "reflect" };
+	static const char* cThreeArguments[] = { "clamp", "mix", "smoothstep", "faceforward", "refract" };
+	size_t expected = 0;
+	for (const char* function : cSingleArgument) {
+		expected = name == function ? 1 : expected;
+	}
+	for (const char* function : cTwoArguments) {
+		expected = name == function ? 2 : expected;
+	}
+	for (const char* function : cThreeArguments) {
+		expected = name == function ? 3 : expected;
+	}
+	if (name == "atan") {
+		expected = arguments.size() == 2 ? 2 : 1;
+	} else if (name.compare(0, 9, "texture2D") == 0) {
+		expected = arguments.size();
+	} else if (name.compare(0, 7, "texture") == 0) {
+		Fail("'" + name + "' is not supported, only 2D textures are");
+		return true;
+	}
+	if (expected == 0) {
+		return false;
+	}
+	if (!CheckArguments(name, arguments, expected)) {
+		return true;
+	}
+
+	const ValueSW& x = arguments[0];
+	uint32_t components = cComponents[x.mType];
+	uint16_t zero = Constant(0.0f);
+	uint16_t one = Constant(1.0f);
+	result = {};
+	result.mType = x.mType;
+
+	if (name == "radians" || name == "degrees") {
+		result = Componentwise(ShaderOpSW::Mul, x, Scalar(Constant(name == "radians" ? cPi / 180.0f : 180.0f / cPi)));
+	} else if (name == "tan") {
+		result = Componentwise(ShaderOpSW::Div, Map(ShaderOpSW::Sin, x), Map(ShaderOpSW::Cos, x));
+	} else if (name == "asin" || name == "acos") {
+		for (uint32_t c = 0; c < components; c++) {
+			uint16_t v = x.mRegisters[c];
+			uint16_t cosine = Op(ShaderOpSW::Sqrt, Op(ShaderOpSW::Sub, one, Op(ShaderOpSW::Mul, v, v)));
+			result.mRegisters[c] = name == "asin" ? Op(ShaderOpSW::Atan2, v, cosine) : Op(ShaderOpSW::Atan2, cosine, v);
+		}
+	} else if (name == "atan") {
+		result = Componentwise(ShaderOpSW::Atan2, x, arguments.size() == 2 ? arguments[1] : Scalar(one));
+	} else if (name == "exp") {
+		result = Map(ShaderOpSW::Exp2, Componentwise(ShaderOpSW::Mul, x, Scalar(Constant(1.44269504f))));
+	} else if (name == "log") {
+		result = Componentwise(ShaderOpSW::Mul, Map(ShaderOpSW::Log2, x), Scalar(Constant(0.69314718f)));
+	} else if (name == "ceil") {
+		for (uint32_t c = 0; c < components; c++) {
+			result.mRegisters[c] = Op(ShaderOpSW::Sub, zero, Op(ShaderOpSW::Floor, Op(ShaderOpSW::Sub, zero, x.mRegisters[c])));
+		}
+	} else if (name == "fract") {
+		result = Componentwise(ShaderOpSW::Sub, x, Map(ShaderOpSW::Floor, x));
+	} else if (name == "mod") {
+		ValueSW quotient = Map(ShaderOpSW::Floor, Componentwise(ShaderOpSW::Div, x, arguments[1]));
+		result = Componentwise(ShaderOpSW::Sub, x, Componentwise(ShaderOpSW::Mul, arguments[1], quotient));
+	} else if (name == "clamp") {
+		result = Componentwise(ShaderOpSW::Min, Componentwise(ShaderOpSW::Max, x, arguments[1]), arguments[2]);
+	} else if (name == "mix") {
+		ValueSW delta = Componentwise(ShaderOpSW::Sub, arguments[1], x);
+		result = Componentwise(ShaderOpSW::Add, x, Componentwise(ShaderOpSW::Mul, delta, arguments[2]));
+	} else if (name == "step") {
+		ValueSW below = Componentwise(ShaderOpSW::Lt, arguments[1], x);
+		result = Componentwise(ShaderOpSW::Sub, Scalar(one), below);
+	} else if (name == "smoothstep") {
+		ValueSW range = Componentwise(ShaderOpSW::Sub, arguments[1], x);
+		ValueSW t = Componentwise(ShaderOpSW::Div, Componentwise(ShaderOpSW::Sub, arguments[2], x), range);
+		t = Componentwise(ShaderOpSW::Min, Componentwise(ShaderOpSW::Max, t, Scalar(zero)), Scalar(one));
+		for (uint32_t c = 0; c < cComponents[t.mType]; c++) {
+			uint16_t v = t.mRegisters[c];
+			t.mRegisters[c] = Op(ShaderOpSW::Mul, Op(ShaderOpSW::Mul, v, v), Op(ShaderOpSW::Mad, Constant(-2.0f), v, Constant(3.0f)));
+		}
+		result = t;
+	} else if (name == "length") {
+		result = Scalar(Op(ShaderOpSW::Sqrt, Dot(x, x)));
+	} else if (name == "distance") {
+		ValueSW delta = Componentwise(ShaderOpSW::Sub, x, arguments[1]);
+		result = Scalar(Op(ShaderOpSW::Sqrt, Dot(delta, delta)));
+	} else if (name == "dot") {
+		result = Scalar(Dot(x, arguments[1]));
+	} else if (name == "normalize") {
+		result = Componentwise(ShaderOpSW::Mul, x, Scalar(Op(ShaderOpSW::Rsqrt, Dot(x, x))));
+	} else if (name == "cross") {
+		const ValueSW& y = arguments[1];
+		if (x.mType != GlslType::Vec3 || y.mType != GlslType::Vec3) {
+			Fail("cross expects two vec3");
+			return true;
+		}
+		for (uint32_t c = 0; c < 3; c++) {
+			uint32_t c1 = (c + 1) % 3;
+			uint32_t c2 = (c + 2) % 3;
+			result.mRegisters[c] = Op(ShaderOpSW::Sub, Op(ShaderOpSW::Mul, x.mRegisters[c1], y.mRegisters[c2]), Op(ShaderOpSW::Mul, x.mRegisters[c2], y.mRegisters[c1]));
+		}
+	} else if (name == "reflect") {
+		uint16_t twice = Op(ShaderOpSW::Mul, Constant(2.0f), Dot(arguments[1], x));
+		result = Componentwise(ShaderOpSW::Sub, x, Componentwise(ShaderOpSW::Mul, Scalar(twice), arguments[1]));
+	} else if (name == "faceforward") {
+		uint16_t facing = Op(ShaderOpSW::Lt, Dot(arguments[2], arguments[1]), zero);
+		for (uint32_t c = 0; c < components; c++) {
+			result.mRegisters[c] = Op(ShaderOpSW::Select, facing, x.mRegisters[c], Op(ShaderOpSW::Sub, zero, x.mRegisters[c]));
+		}
+	} else if (name == "refract") {
+		const ValueSW& normal = arguments[1];
+		uint16_t eta = arguments[2].mRegisters[0];
+		uint16_t d = Dot(normal, x);
+		uint16_t k = Op(ShaderOpSW::Sub, one, Op(ShaderOpSW::Mul, Op(ShaderOpSW::Mul, eta, eta), Op(ShaderOpSW::Sub, one, Op(ShaderOpSW::Mul, d, d))));
+		uint16_t scale = Op(ShaderOpSW::Mad, eta, d, Op(ShaderOpSW::Sqrt, k));
+		uint16_t total = Op(ShaderOpSW::Lt, k, zero);
+		for (uint32_t c = 0; c < components; c++) {
+			uint16_t refracted = Op(ShaderOpSW::Sub, Op(ShaderOpSW::Mul, eta, x.mRegisters[c]), Op(ShaderOpSW::Mul, scale, normal.mRegisters[c]));
+			result.mRegisters[c] = Op(ShaderOpSW::Select, total, zero, refracted);
+		}
+	} else if (name == "any" || name == "all") {
+		uint16_t combined = x.mRegisters[0];
+		for (uint32_t c = 1; c < components; c++) {
+			combined = Op(name == "any" ? ShaderOpSW::Max : ShaderOpSW::Mul, combined, x.mRegisters[c]);
+		}
+		result = Scalar(combined, GlslType::Bool);
+	} else if (name == "not") {
+		result = Componentwise(ShaderOpSW::Eq, x, Scalar(zero));
+	} else {
+		// texture2D(sampler, coord [, bias]), texture2DProj, texture2DLod and texture2DProjLod, level 0 is sampled
+		bool projected = name.find("Proj") != std::string::npos;
+		bool lod = name.find("Lod") != std::string::npos;
+		if ((name != "texture2D" && name != "texture2DProj" && name != "texture2DLod" && name != "texture2DProjLod") || arguments.size() < 2 || arguments.size() > 3 ||
+			(lod && arguments.size() != 3) || (lod && mType != ShaderType::VertexProgram)) {
+			Fail("wrong arguments for '" + name + "'");
+			return true;
+		}
+		const ValueSW& coord = arguments[1];
+		uint32_t coordComponents = cComponents[coord.mType];
+		if ((!projected && coord.mType != GlslType::Vec2) || (projected && coord.mType != GlslType::Vec3 && coord.mType != GlslType::Vec4)) {
+			Fail("wrong texture coordinates for '" + name + "'");
+			return true;
+		}
+		uint16_t u = coord.mRegisters[0];
+		uint16_t v = coord.mRegisters[1];
+		if (projected) {
+			uint16_t q = coord.mRegisters[coordComponents - 1];
+			u = Op(ShaderOpSW::Div, u, q);
+			v = Op(ShaderOpSW::Div, v, q);
+		}
+		result = Sample(x, u, v);
+	}
+	return true;
+}
+
+// exact parameter types first, then any parameters of the same sizes since ints are floats
+const FunctionSW* CompilerSW::FindOverload(const std::string& name, const std::vector<ValueSW>& arguments) const {
+	auto overloads = mFunctions.find(name);
+	if (overloads == mFunctions.end()) {
+		return nullptr;
+	}
+	for (uint32_t pass = 0; pass < 2; pass++) {
+		for (const FunctionSW& function : overloads->second) {
+			bool match = function.mParameters.size() == arguments.size();
+			for (size_t n = 0; match && n < arguments.size(); n++) {
+				GlslType::Enum expected = function.mParameters[n].mType;
+				GlslType::Enum type = arguments[n].mType;
+				match = expected == type || (pass == 1 && cComponents[expected] == cComponents[type] && IsMatrix(expected) == IsMatrix(type) && type != GlslType::Sampler2D);
+			}
+			if (match) {
+				return &function;
+			}
+		}
+	}
+	return nullptr;
+}
+
+ValueSW CompilerSW::CallFunction(const FunctionSW& function, const std::vector<ValueSW>& arguments) {
+	ValueSW result = {};
+	if (mFrames.size() >= cMaxInlineDepth) {
+		Fail("recursion is not allowed, '" + function.mName + "' calls itself");
+		return result;
+	}
+
+	std::unordered_map<std::string, SymbolSW> parameters;
+	std::vector<SymbolSW> symbols;
+	for (size_t n = 0; n < function.mParameters.size(); n++) {
+		const ParameterSW& parameter = function.mParameters[n];
+		if (parameter.mOut && !arguments[n].mLValue) {
+			Fail("argument " + std::to_string(n + 1) + " of '" + function.mName + "' must be writable");
+			return result;
+		}
+		SymbolSW symbol = {};
+		symbol.mType = parameter.mType;
+		symbol.mWritable = true;
+		if (parameter.mIn) {
+			Adopt(arguments[n], symbol.mRegisters);
+		} else {
+			uint16_t base = NewRegisters(cComponents[parameter.mType]);
+			for (uint32_t c = 0; c < cComponents[parameter.mType]; c++) {
+				symbol.mRegisters[c] = static_cast<uint16_t>(base + c);
+			}
+		}
+		symbols.push_back(symbol);
+		if (!parameter.mName.empty()) {
+			parameters[parameter.mName] = symbol;
+		}
+	}
+
+	FrameSW frame = {};
+	frame.mReturnType = function.mReturnType;
+	frame.mAlive = cNoRegister;
+	frame.mScopeBase = mScopes.size();
+	mMasks.push_back({ FullMask(), cNoRegister });
+	mScopes.push_back(std::move(parameters));
+	mFrames.push_back(frame);
+	size_t resume = mPos;
+	mPos = function.mBody;
+	ParseBlock();
+	mPos = resume;
+	frame = mFrames.back();
+	mFrames.pop_back();
+	mScopes.pop_back();
+	mMasks.pop_back();
+	if (mFailed) {
+		return result;
+	}
+
+	for (size_t n = 0; n < function.mParameters.size(); n++) {
+		if (function.mParameters[n].mOut) {
+			ValueSW value = {};
+			value.mType = symbols[n].mType;
+			std::copy_n(symbols[n].mRegisters, cComponents[value.mType], value.mRegisters);
+			Store(arguments[n], value, FullMask());
+		}
+	}
+	result.mType = function.mReturnType;
+	if (result.mType != GlslType::Void) {
+		if (!frame.mReturned) {
+			Fail("'" + function.mName + "' does not return a value");
+			return result;
+		}
+		std::copy_n(frame.mReturn, cComponents[result.mType], result.mRegisters);
+	}
+	return result;
+}
+
+//=============================================================================
+// Link
+
+// Drops the instructions whose results never reach an output, then numbers the registers left densely.
+void OptimizeBytecode(ShaderBytecodeSW& code) {
+	std::vector<bool> live(code.mRegistersCount, false);
+	for (const ShaderBindingSW& output : code.mOutputs) {
+		live[output.mRegister] = true;
+	}
+	std::vector<ShaderInstructionSW> kept;
+	for (size_t n = code.mInstructions.size(); n > 0; n--) {
+		const ShaderInstructionSW& instruction = code.mInstructions[n - 1];
+		uint32_t written = instruction.mOp == ShaderOpSW::Tex ? 4 : (instruction.mOp == ShaderOpSW::Kill ? 0 : 1);
+		bool needed = instruction.mOp == ShaderOpSW::Kill;
+		for (uint32_t w = 0; w < written; w++) {
+			needed = needed || live[instruction.mDst + w];
+		}
+		if (!needed) {
+			continue;
+		}
+		for (uint32_t w = 0; w < written; w++) {
+			live[instruction.mDst + w] = false;
+		}
+		const uint16_t operands[3] = { instruction.mA, instruction.mB, instruction.mC };
+		for (uint32_t o = 0; o < cOperandsCount[instruction.mOp]; o++) {
+			live[operands[o]] = true;
+		}
+		kept.push_back(instruction);
+	}
+	std::reverse(kept.begin(), kept.end());
+
+	// Tex writes 4 consecutive registers, numbering in the original order keeps them together
+	std::vector<bool> used(code.mRegistersCount, false);
+	for (const ShaderBindingSW& output : code.mOutputs) {
+		used[output.mRegister] = true;
+	}
+	for (const ShaderInstructionSW& instruction : kept) {
+		uint32_t written = instruction.mOp == ShaderOpSW::Tex ? 4 : (instruction.mOp == ShaderOpSW::Kill ? 0 : 1);
+		for (uint32_t w = 0; w < written; w++) {
+			used[instruction.mDst + w] = true;
+		}
+		const uint16_t operands[3] = { instruction.mA, instruction.mB, instruction.mC };
+		for (uint32_t o = 0; o < cOperandsCount[instruction.mOp]; o++) {
+			used[operands[o]] = true;
+		}
+	}
+	std::vector<uint16_t> remap(code.mRegistersCount, 0);
+	uint16_t count = 0;
+	for (uint32_t n = 0; n < code.mRegistersCount; n++) {
+		if (used[n]) {
+			remap[n] = count++;
+		}
+	}
+
+	for (ShaderInstructionSW& instruction : kept) {
+		uint32_t operands = cOperandsCount[instruction.mOp];
+		instruction.mDst = instruction.mOp == ShaderOpSW::Kill ? 0 : remap[instruction.mDst];
+		instruction.mA = remap[instruction.mA];
+		instruction.mB = operands > 1 ? remap[instruction.mB] : 0;
+		instruction.mC = operands > 2 ? remap[instruction.mC] : 0;
+	}
+	code.mInstructions = std::move(kept);
+
+	auto rebind = [&used, &remap](std::vector<ShaderBindingSW>& bindings) {
+		bindings.erase(std::remove_if(bindings.begin(), bindings.end(), [&used](const ShaderBindingSW& binding) { return !used[binding.mRegister]; }), bindings.end());
+		for (ShaderBindingSW& binding : bindings) {
+			binding.mRegister = remap[binding.mRegister];
+		}
+	};
+	rebind(code.mUniforms);
+	rebind(code.mInputs);
+	rebind(code.mOutputs);
+	code.mConstants.erase(std::remove_if(code.mConstants.begin(), code.mConstants.end(), [&used](const tinyngine::ShaderConstantSW& constant) { return !used[constant.mRegister]; }), code.mConstants.end());
+	for (auto& constant : code.mConstants) {
+		constant.mRegister = remap[constant.mRegister];
+	}
+	code.mRegistersCount = std::max<uint32_t>(count, 1);
+}
+
+bool LinkStages(StageSW& vertex, StageSW& fragment, tinyngine::CompiledProgramSW& program, std::string& error) {
+	// uniforms of both stages share the storage of the program
+	StageSW* stages[] = { &vertex, &fragment };
+	for (StageSW* stage : stages) {
+		for (const InterfaceSW& uniform : stage->mUniforms) {
+			uint32_t hash = tinyngine::HashUniformName(uniform.mName.c_str());
+			auto found = std::find_if(program.mUniforms.begin(), program.mUniforms.end(), [hash](const tinyngine::Uniform& entry) { return entry.mNameHash == hash; });
+			uint32_t index = static_cast<uint32_t>(found - program.mUniforms.begin());
+			if (found == program.mUniforms.end()) {
+				tinyngine::Uniform entry;
+				entry.mLocation = static_cast<int32_t>(index);
+				entry.mNameHash = hash;
+				entry.mShadowOffset = index * tinyngine::cSoftwareUniformSize;
+				entry.mSize = static_cast<uint16_t>(cComponents[uniform.mType]);
+				entry.mType = cUniformTypes[uniform.mType];
+				program.mUniforms.push_back(entry);
+			} else if (found->mType != cUniformTypes[uniform.mType]) {
+				error = "uniform " + uniform.mName + " has different types in the vertex and fragment shaders";
+				return false;
+			}
+			for (uint32_t c = 0; c < cComponents[uniform.mType]; c++) {
+				stage->mCode.mUniforms.push_back({ uniform.mRegisters[c], static_cast<uint16_t>(index * tinyngine::cSoftwareUniformSize + c) });
+			}
+		}
+	}
+
+	// only the varyings read by the fragment shader are interpolated, the code writing the others is dropped
+	uint32_t offset = 0;
+	for (const InterfaceSW& varying : fragment.mVaryings) {
+		auto source = std::find_if(vertex.mVaryings.begin(), vertex.mVaryings.end(), [&varying](const InterfaceSW& output) { return output.mName == varying.mName; });
+		if (source == vertex.mVaryings.end()) {
+			error = "varying " + varying.mName + " is not declared by the vertex shader";
+			return false;
+		}
+		if (source->mType != varying.mType) {
+			error = "varying " + varying.mName + " has different types in the vertex and fragment shaders";
+			return false;
+		}
+		uint32_t components = cComponents[varying.mType];
+		if (offset + components > tinyngine::cMaxSoftwareVaryings) {
+			error = "too many varyings, the software device interpolates at most " + std::to_string(tinyngine::cMaxSoftwareVaryings) + " floats";
+			return false;
+		}
+		for (uint32_t c = 0; c < components; c++) {
+			vertex.mCode.mOutputs.push_back({ source->mRegisters[c], static_cast<uint16_t>(ShaderSlotsSW::VertexVaryings + offset + c) });
+			fragment.mCode.mInputs.push_back({ varying.mRegisters[c], static_cast<uint16_t>(ShaderSlotsSW::FragmentVaryings + offset + c) });
+		}
+		offset += components;
+	}
+
+	vertex.mCode.mInputSlotsCount = ShaderSlotsSW::VertexAttributes + Attributes::Count * 4;
+	vertex.mCode.mOutputSlotsCount = ShaderSlotsSW::VertexVaryings + offset;
+	fragment.mCode.mInputSlotsCount = ShaderSlotsSW::FragmentVaryings + offset;
+	fragment.mCode.mOutputSlotsCount = ShaderSlotsSW::FragmentColor + 4;
+	OptimizeBytecode(vertex.mCode);
+	OptimizeBytecode(fragment.mCode);
+	program.mVertex = std::move(vertex.mCode);
+	program.mFragment = std::move(fragment.mCode);
+	program.mVaryingsCount = offset;
+	return true;
+}
+
+}
+
+namespace tinyngine
+{
+
+bool CompileShaderProgramSW(const char* vertexSource, const char* fragmentSource, CompiledProgramSW& program, std::string& error) {
+	static const char* cStageNames[ShaderType::Count] = { "vertex shader", "fragment shader" };
+	const char* sources[ShaderType::Count] = { vertexSource, fragmentSource };
+	StageSW stages[ShaderType::Count];
+	for (uint32_t n = 0; n < ShaderType::Count; n++) {
+		ShaderType::Enum type = static_cast<ShaderType::Enum>(n);
+		std::vector<Token> tokens;
+		std::string message = "no source";
+		PreprocessorSW preprocessor;
+		if (sources[n] == nullptr || !preprocessor.Run(sources[n], type, tokens, message) || !CompilerSW(type, tokens, stages[n]).Compile(message)) {
+			error = std::string(cStageNames[n]) + ", " + message;
+			return false;
+		}
+	}
+	program = CompiledProgramSW();
+	return LinkStages(stages[ShaderType::VertexProgram], stages[ShaderType::FragmentProgram], program, error);
+}
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "ShaderBytecodeSW.h"
+
+#include <string>
+
+namespace tinyngine
+{
+
+struct CompiledProgramSW {
+	ShaderBytecodeSW mVertex;
+	ShaderBytecodeSW mFragment;
+	std::vector<Uniform> mUniforms; // reflection table, mShadowOffset is the float offset in the uniform storage
+	uint32_t mVaryingsCount = 0;
+};
+
+// Compiles and links a pair of GLSL ES 1.00 shaders for the software device. The subset covers the float, int, bool,
+// vector and matrix types, sampler2D, the uniform, attribute and varying qualifiers, user functions (inlined), if/else,
+// the ternary operator, discard, the object-like macros of the preprocessor and the common built-in functions. Loops,
+// arrays and structures are rejected. Each uniform reserves cSoftwareUniformSize floats in the storage, in the order
+// of the table. Returns false and describes the problem in error on failure.
+bool CompileShaderProgramSW(const char* vertexSource, const char* fragmentSource, CompiledProgramSW& program, std::string& error);
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "ShaderRegistrySW.h"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+
+inline uint64_t MakeProgramKey(uint32_t vertexSourceHash, uint32_t fragmentSourceHash) {
+	return (static_cast<uint64_t>(vertexSourceHash) << 32) | fragmentSourceHash;
+}
+
+struct ShaderRegistry {
+	std::mutex mMutex;
+	std::unordered_map<uint64_t, tinyngine::SoftwareProgramDesc> mPrograms;
+};
+
+ShaderRegistry& GetRegistry() {
+	static ShaderRegistry sRegistry;
+	return sRegistry;
+}
+
+}
+
+namespace tinyngine
+{
+
+// same FNV-1a as HashUniformName, iterative since shader sources are far longer than uniform names
+uint32_t HashShaderSource(const char* source) {
+	uint32_t hash = 2166136261u;
+	for (; source != nullptr && *source; source++) {
+		hash = (hash ^ static_cast<uint8_t>(*source)) * 16777619u;
+	}
+	return hash;
+}
+
+bool FindSoftwareProgram(uint32_t vertexSourceHash, uint32_t fragmentSourceHash, SoftwareProgramDesc& desc) {
+	ShaderRegistry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mMutex);
+	auto it = registry.mPrograms.find(MakeProgramKey(vertexSourceHash, fragmentSourceHash));
+	if (it == registry.mPrograms.end()) {
+		return false;
+	}
+	desc = it->second;
+	return true;
+}
+
+void RegisterSoftwareProgram(const char* vertexSource, const char* fragmentSource, const SoftwareProgramDesc& desc) {
+	ShaderRegistry& registry = GetRegistry();
+	std::lock_guard<std::mutex> lock(registry.mMutex);
+	registry.mPrograms[MakeProgramKey(HashShaderSource(vertexSource), HashShaderSource(fragmentSource))] = desc;
+}
+
+} // namespace tinyngine
\ No newline at end of file
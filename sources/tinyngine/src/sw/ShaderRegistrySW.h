@@ -0,0 +1,13 @@
+#pragma once
+
+#include "SoftwareShader.h"
+
+namespace tinyngine
+{
+
+uint32_t HashShaderSource(const char* source);
+
+// stages registered with RegisterSoftwareProgram for this pair of sources
+bool FindSoftwareProgram(uint32_t vertexSourceHash, uint32_t fragmentSourceHash, SoftwareProgramDesc& desc);
+
+} // namespace tinyngine
\ No newline at end of file
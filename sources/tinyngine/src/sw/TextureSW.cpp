@@ -0,0 +1,102 @@
+#include "TextureSW.h"
+#include "PlatformDefine.h"
+#include "Log.h"
+
+#include <cmath>
+
+namespace
+{
+
+inline void FetchTexel(const tinyngine::SoftwareTexture* texture, int32_t x, int32_t y, float rgba[4]) {
+	int32_t width = static_cast<int32_t>(texture->mWidth);
+	int32_t height = static_cast<int32_t>(texture->mHeight);
+	x %= width;
+	y %= height;
+	x += x < 0 ? width : 0;
+	y += y < 0 ? height : 0;
+	const uint8_t* texel = texture->mPixels + (static_cast<uint32_t>(y) * texture->mWidth + static_cast<uint32_t>(x)) * 4;
+	for (uint32_t c = 0; c < 4; c++) {
+		rgba[c] = texel[c] * (1.0f / 255.0f);
+	}
+}
+
+}
+
+namespace tinyngine
+{
+
+// pixels are expanded to RGBA8 once so that sampling has a single layout to deal with
+void TextureSW::Create(const ImageHandle& imageHandle, ImageManager& imageManager, TextureFormats::Enum textureFormat, TextureFilteringMode::Enum filtering) {
+	TINYNGINE_UNUSED(textureFormat);
+
+	ImageData imageData;
+	if (!imageManager.GetImageData(imageHandle, 0, imageData) || imageData.mData == nullptr) {
+		return;
+	}
+	if (GetTextureFormatInfo(imageData.mFormat).mCompressed) {
+		Log(Logger::Error, "Texture format %u is not supported by the software device", imageData.mFormat);
+		return;
+	}
+	uint32_t components = imageData.mBitsPerPixel / 8;
+	if (components == 0 || components > 4) {
+		return;
+	}
+
+	uint32_t texelsCount = imageData.mWidth * imageData.mHeight;
+	mPixels.resize(texelsCount * 4);
+	const uint8_t* source = static_cast<const uint8_t*>(imageData.mData);
+	for (uint32_t n = 0; n < texelsCount; n++) {
+		uint8_t* texel = &mPixels[n * 4];
+		texel[0] = source[0];
+		texel[1] = components > 1 ? source[1] : source[0];
+		texel[2] = components > 2 ? source[2] : source[0];
+		texel[3] = components > 3 ? source[3] : (components == 2 ? source[1] : 255);
+		source += components;
+	}
+
+	mTexture.mPixels = mPixels.data();
+	mTexture.mWidth = imageData.mWidth;
+	mTexture.mHeight = imageData.mHeight;
+	mTexture.mFiltering = filtering;
+}
+
+void TextureSW::Destroy() {
+	mPixels.clear();
+	mPixels.shrink_to_fit();
+	mTexture = SoftwareTexture();
+}
+
+void SampleSoftwareTexture(const SoftwareTexture* texture, float u, float v, float rgba[4]) {
+	if (texture == nullptr || texture->mPixels == nullptr) {
+		rgba[0] = rgba[1] = rgba[2] = 0.0f;
+		rgba[3] = 1.0f;
+		return;
+	}
+
+	float x = u * texture->mWidth;
+	float y = v * texture->mHeight;
+	if (texture->mFiltering == TextureFilteringMode::Bilinear || texture->mFiltering == TextureFilteringMode::Trilinear) {
+		x -= 0.5f;
+		y -= 0.5f;
+		float x0 = std::floor(x);
+		float y0 = std::floor(y);
+		float fx = x - x0;
+		float fy = y - y0;
+		int32_t ix = static_cast<int32_t>(x0);
+		int32_t iy = static_cast<int32_t>(y0);
+		float t00[4], t10[4], t01[4], t11[4];
+		FetchTexel(texture, ix, iy, t00);
+		FetchTexel(texture, ix + 1, iy, t10);
+		FetchTexel(texture, ix, iy + 1, t01);
+		FetchTexel(texture, ix + 1, iy + 1, t11);
+		for (uint32_t c = 0; c < 4; c++) {
+			float top = t00[c] + (t10[c] - t00[c]) * fx;
+			float bottom = t01[c] + (t11[c] - t01[c]) * fx;
+			rgba[c] = top + (bottom - top) * fy;
+		}
+		return;
+	}
+	FetchTexel(texture, static_cast<int32_t>(std::floor(x)), static_cast<int32_t>(std::floor(y)), rgba);
+}
+
+} // namespace tinyngine
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ImageManager.h"
+#include "SoftwareShader.h"
+
+#include <vector>
+
+namespace tinyngine
+{
+
+class TextureSW {
+public:
+	TextureSW() = default;
+
+	void Create(const ImageHandle& imageHandle, ImageManager& imageManager, TextureFormats::Enum textureFormat, TextureFilteringMode::Enum filtering);
+	void Destroy();
+
+	inline const SoftwareTexture& GetTexture() const { return mTexture; }
+
+	inline bool IsValid() const { return mTexture.mPixels != nullptr; }
+
+private:
+	std::vector<uint8_t> mPixels;
+	SoftwareTexture mTexture;
+};
+
+} // namespace tinyngine
\ No newline at end of file